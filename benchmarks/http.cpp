@@ -0,0 +1,201 @@
+// HTTP load generator for the built-in server: keeps N connections busy for a while and reports requests per second.
+// Built as probescript-http-bench on Linux, start a server with http.Serve first, then run
+//   probescript-http-bench <port> [connections] [seconds] [--pipeline N] [--close] [--path /p]
+// --close sends Connection: close and reconnects for every request, to compare against keep-alive
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using Clock = std::chrono::steady_clock;
+
+struct Client
+{
+    int fd = -1;
+    std::string in;
+    size_t outstanding = 0;
+    bool reconnect = false;
+};
+
+struct Settings
+{
+    int port = 0;
+    size_t connections = 1000;
+    double seconds = 5;
+    size_t pipeline = 1;
+    bool close = false;
+    std::string path = "/";
+};
+
+static size_t g_completed = 0;
+static size_t g_errors = 0;
+
+static bool connectClient(Client& client, int epoll, const Settings& settings)
+{
+    client.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    client.in.clear();
+    client.outstanding = 0;
+    client.reconnect = false;
+
+    int one = 1;
+    setsockopt(client.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    sockaddr_in address {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(settings.port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (connect(client.fd, (sockaddr*)&address, sizeof(address)) < 0 && errno != EINPROGRESS)
+    {
+        close(client.fd);
+        return false;
+    }
+
+    epoll_event event {};
+    event.events = EPOLLOUT;
+    event.data.ptr = &client;
+    epoll_ctl(epoll, EPOLL_CTL_ADD, client.fd, &event);
+    return true;
+}
+
+static void sendBatch(Client& client, int epoll, const Settings& settings)
+{
+    std::string request = "GET " + settings.path + " HTTP/1.1\r\nHost: localhost\r\n";
+    if (settings.close) request += "Connection: close\r\n";
+    request += "\r\n";
+
+    size_t count = settings.close ? 1 : settings.pipeline;
+    std::string batch;
+    for (size_t i = 0; i < count; i++) batch += request;
+
+    // Small enough to always fit in an empty socket buffer
+    if (send(client.fd, batch.data(), batch.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(batch.size())) g_errors++;
+    client.outstanding = count;
+
+    epoll_event event {};
+    event.events = EPOLLIN;
+    event.data.ptr = &client;
+    epoll_ctl(epoll, EPOLL_CTL_MOD, client.fd, &event);
+}
+
+// Consumes the complete responses at the front of the buffer
+static void consume(Client& client)
+{
+    while (true)
+    {
+        size_t headerEnd = client.in.find("\r\n\r\n");
+        if (headerEnd == std::string::npos) return;
+
+        size_t length = 0;
+        size_t found = client.in.find("Content-Length: ");
+        if (found != std::string::npos && found < headerEnd) length = std::stoul(client.in.substr(found + 16));
+
+        if (client.in.size() < headerEnd + 4 + length) return;
+
+        if (client.in.compare(0, 12, "HTTP/1.1 200") != 0) g_errors++;
+        std::string headers = client.in.substr(0, headerEnd);
+        if (headers.find("Connection: close") != std::string::npos) client.reconnect = true;
+
+        client.in.erase(0, headerEnd + 4 + length);
+        client.outstanding--;
+        g_completed++;
+    }
+}
+
+static void restart(Client& client, int epoll, const Settings& settings)
+{
+    epoll_ctl(epoll, EPOLL_CTL_DEL, client.fd, nullptr);
+    close(client.fd);
+    if (!connectClient(client, epoll, settings)) g_errors++;
+}
+
+int main(int argc, char* argv[])
+{
+    Settings settings;
+    std::vector<std::string> positional;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--pipeline" && i + 1 < argc) settings.pipeline = std::stoul(argv[++i]);
+        else if (arg == "--path" && i + 1 < argc) settings.path = argv[++i];
+        else if (arg == "--close") settings.close = true;
+        else positional.push_back(arg);
+    }
+
+    if (positional.empty())
+    {
+        std::cerr << "Usage: probescript-http-bench <port> [connections] [seconds] [--pipeline N] [--close] [--path /p]\n";
+        return 1;
+    }
+
+    settings.port = std::stoi(positional[0]);
+    if (positional.size() > 1) settings.connections = std::stoul(positional[1]);
+    if (positional.size() > 2) settings.seconds = std::stod(positional[2]);
+
+    int epoll = epoll_create1(0);
+    std::vector<Client> clients(settings.connections);
+
+    for (Client& client : clients)
+    {
+        if (!connectClient(client, epoll, settings)) g_errors++;
+    }
+
+    Clock::time_point start = Clock::now();
+    Clock::time_point end = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(settings.seconds));
+    std::vector<epoll_event> events(1024);
+    char buffer[64 * 1024];
+
+    while (Clock::now() < end)
+    {
+        int count = epoll_wait(epoll, events.data(), events.size(), 100);
+
+        for (int i = 0; i < count; i++)
+        {
+            Client& client = *static_cast<Client*>(events[i].data.ptr);
+
+            if (events[i].events & EPOLLOUT)
+            {
+                sendBatch(client, epoll, settings);
+                continue;
+            }
+
+            ssize_t bytes = recv(client.fd, buffer, sizeof(buffer), 0);
+            if (bytes > 0)
+            {
+                client.in.append(buffer, bytes);
+                consume(client);
+            }
+            else if (bytes == 0 || (errno != EAGAIN && errno != EINTR))
+            {
+                // Closed with answers missing
+                if (client.outstanding > 0) g_errors++;
+                restart(client, epoll, settings);
+                continue;
+            }
+
+            if (client.outstanding > 0) continue;
+
+            if (client.reconnect) restart(client, epoll, settings);
+            else sendBatch(client, epoll, settings);
+        }
+    }
+
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::cout << settings.connections << " connections, " << (settings.close ? "close" : "keep-alive")
+              << ", pipeline " << (settings.close ? 1 : settings.pipeline) << ": "
+              << static_cast<size_t>(g_completed / elapsed) << " req/s, "
+              << g_completed << " requests, " << g_errors << " errors\n";
+
+    return 0;
+}
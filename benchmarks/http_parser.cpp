@@ -0,0 +1,298 @@
+// HTTP request parser fuzzing and throughput. First checks that the parser gives the same answer however the
+// input is split across reads, for valid requests, pipelined ones and randomly damaged ones, then reports how
+// fast it gets through a buffer of pipelined browser-like requests. Built as probescript-http-parser-bench
+//   probescript-http-parser-bench [fuzz cases] [seed]
+// Exits with 1 and prints the input when a check fails
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "request_parser.hpp"
+
+using namespace Probescript::Stdlib::Http;
+
+// Everything the parser says about one input, to compare runs over differently split input
+struct Outcome
+{
+    RequestParser::State state = RequestParser::State::Incomplete;
+    int error = 0;
+    size_t consumed = 0;
+    std::string method, target, path, query, head, body;
+    std::vector<std::pair<std::string, std::string>> headers;
+    bool keepAlive = false;
+
+    bool operator==(const Outcome& other) const
+    {
+        if (state != other.state) return false;
+        if (state == RequestParser::State::Error) return error == other.error;
+        if (state == RequestParser::State::Incomplete) return true;
+
+        return consumed == other.consumed && method == other.method && target == other.target && path == other.path && query == other.query
+            && head == other.head && body == other.body && headers == other.headers && keepAlive == other.keepAlive;
+    }
+};
+
+static const RequestParser::Limits g_limits = { 4096, 32, 64 * 1024 };
+
+static Outcome capture(const RequestParser& parser, RequestParser::State state)
+{
+    Outcome outcome;
+    outcome.state = state;
+    outcome.error = parser.error();
+    if (state != RequestParser::State::Complete) return outcome;
+
+    outcome.consumed = parser.consumed();
+    outcome.method = parser.method();
+    outcome.target = parser.target();
+    outcome.path = parser.path();
+    outcome.query = parser.query();
+    outcome.head = parser.head();
+    outcome.body = parser.body();
+    outcome.keepAlive = parser.keepAlive();
+    for (size_t i = 0; i < parser.headerCount(); i++)
+    {
+        auto [name, value] = parser.header(i);
+        outcome.headers.emplace_back(name, value);
+    }
+
+    return outcome;
+}
+
+// Parses every request in `input` in turn, handing the parser the bytes at the given cut points one read at a time
+static std::vector<Outcome> parseAll(const std::string& input, const std::vector<size_t>& cuts)
+{
+    std::vector<Outcome> outcomes;
+    RequestParser parser(g_limits);
+    std::string buffer;
+    size_t next = 0;
+
+    for (size_t cut = 0; cut <= cuts.size(); cut++)
+    {
+        size_t end = cut < cuts.size() ? cuts[cut] : input.size();
+        buffer.append(input, next, end - next);
+        next = end;
+
+        while (true)
+        {
+            RequestParser::State state = parser.parse(buffer);
+            if (state == RequestParser::State::Incomplete) break;
+
+            outcomes.push_back(capture(parser, state));
+            if (state == RequestParser::State::Error) return outcomes;
+
+            // Like the server, drop the request from the buffer and go on with what follows it
+            buffer.erase(0, parser.consumed());
+            parser.reset();
+        }
+    }
+
+    outcomes.push_back(capture(parser, RequestParser::State::Incomplete));
+    return outcomes;
+}
+
+static std::string escape(const std::string& text)
+{
+    std::string out;
+    for (unsigned char c : text)
+    {
+        if (c == '\r') out += "\\r";
+        else if (c == '\n') out += "\\n\n";
+        else if (c < 0x20 || c >= 0x7f) out += "\\x" + std::string(1, "0123456789abcdef"[c >> 4]) + "0123456789abcdef"[c & 15];
+        else out += static_cast<char>(c);
+    }
+
+    return out;
+}
+
+static const std::vector<std::string> g_corpus = {
+    "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n",
+    "GET /search?q=probe&page=2 HTTP/1.1\r\nHost: example.com\r\nConnection: close\r\n\r\n",
+    "GET /old HTTP/1.0\r\nconnection: Keep-Alive\r\n\r\n",
+    "GET /bare HTTP/1.1\nHost: lf-only\n\n",
+    "\r\nGET /after-crlf HTTP/1.1\r\nHost: a\r\n\r\n",
+    "POST /items HTTP/1.1\r\nHost: localhost\r\nContent-Type: application/json\r\nContent-Length: 27\r\n\r\n{\"name\":\"probe\",\"count\":3}\n",
+    "POST /upload HTTP/1.1\r\nHost: localhost\r\nTransfer-Encoding: chunked\r\n\r\n5\r\nhello\r\n1;ext=1\r\n \r\nA\r\n0123456789\r\n0\r\nX-Trailer: yes\r\n\r\n",
+    "PUT /empty HTTP/1.1\r\nContent-Length: 0\r\nCookie: a=1; b=2\r\nX-Dup: one\r\nX-Dup: two\r\n\r\n",
+    "GET /space HTTP/1.1\r\nHost:   padded value \t \r\n\r\n",
+    "BAD REQUEST LINE\r\n\r\n",
+    "GET / HTTP/1.1\r\n folded: header\r\n\r\n",
+    "POST / HTTP/1.1\r\nContent-Length: 3\r\nTransfer-Encoding: chunked\r\n\r\nabc",
+    "POST / HTTP/1.1\r\nTransfer-Encoding: gzip\r\n\r\n",
+    "POST / HTTP/1.1\r\nContent-Length: 1\r\nContent-Length: 2\r\n\r\nab",
+    "POST / HTTP/1.1\r\nContent-Length: 99999999\r\n\r\n",
+    "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\n",
+    "GET / HTTP/2.0\r\n\r\n",
+    "POST / HTTP/1.1\r\nTransfer-Encoding: gzip\r\nTransfer-Encoding: chunked\r\n\r\n5\r\nhello\r\n0\r\n\r\n",
+    "POST / HTTP/1.1\r\nTransfer-Encoding: chunked, chunked\r\n\r\n0\r\n\r\n",
+    "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\nTransfer-Encoding: \r\n\r\n0\r\n\r\n",
+};
+
+static std::vector<size_t> randomCuts(std::mt19937& random, size_t size)
+{
+    std::vector<size_t> cuts;
+    if (size == 0) return cuts;
+
+    size_t count = random() % 8;
+    for (size_t i = 0; i < count; i++) cuts.push_back(random() % size);
+    std::sort(cuts.begin(), cuts.end());
+    return cuts;
+}
+
+static std::string mutate(std::mt19937& random, std::string input)
+{
+    const std::string interesting = "\r\n :;?-0123456789abcdefABCDEF\t\x7f";
+    size_t edits = 1 + random() % 4;
+
+    for (size_t i = 0; i < edits && !input.empty(); i++)
+    {
+        size_t at = random() % input.size();
+        switch (random() % 5)
+        {
+            case 0: input[at] = static_cast<char>(random()); break;
+            case 1: input[at] = interesting[random() % interesting.size()]; break;
+            case 2: input.insert(at, 1, interesting[random() % interesting.size()]); break;
+            case 3: input.erase(at, 1 + random() % 8); break;
+            case 4: input.insert(at, input.substr(random() % input.size(), random() % 32)); break;
+        }
+    }
+
+    return input;
+}
+
+// The same input must give the same requests whatever the reads look like
+static bool check(const std::string& input, std::mt19937& random, size_t splits)
+{
+    std::vector<Outcome> whole = parseAll(input, {});
+
+    std::vector<size_t> everyByte;
+    for (size_t i = 1; i < input.size(); i++) everyByte.push_back(i);
+    std::vector<std::vector<size_t>> layouts = { everyByte };
+    for (size_t i = 0; i < splits; i++) layouts.push_back(randomCuts(random, input.size()));
+
+    for (const std::vector<size_t>& cuts : layouts)
+    {
+        std::vector<Outcome> split = parseAll(input, cuts);
+        if (split == whole) continue;
+
+        std::cerr << "http parser: result depends on how the input is split, input:\n" << escape(input) << "\n";
+        return false;
+    }
+
+    for (const Outcome& outcome : whole)
+    {
+        if (outcome.body.size() > g_limits.maxBodySize || outcome.head.size() > g_limits.maxHeaderSize || outcome.headers.size() > g_limits.maxHeaders)
+        {
+            std::cerr << "http parser: limit not enforced, input:\n" << escape(input) << "\n";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool expect(const std::string& input, size_t index, RequestParser::State state, const std::string& body, int error = 0)
+{
+    std::vector<Outcome> outcomes = parseAll(input, {});
+    if (index < outcomes.size() && outcomes[index].state == state && outcomes[index].body == body && outcomes[index].error == error) return true;
+
+    std::cerr << "http parser: unexpected result for:\n" << escape(input) << "\n";
+    return false;
+}
+
+static bool fuzz(size_t cases, unsigned seed)
+{
+    std::mt19937 random(seed);
+
+    // Known answers
+    bool ok = expect(g_corpus[5], 0, RequestParser::State::Complete, "{\"name\":\"probe\",\"count\":3}\n")
+        && expect(g_corpus[6], 0, RequestParser::State::Complete, "hello 0123456789")
+        && expect(g_corpus[10], 0, RequestParser::State::Error, "", 400)
+        && expect(g_corpus[11], 0, RequestParser::State::Error, "", 400)
+        && expect(g_corpus[12], 0, RequestParser::State::Error, "", 501)
+        && expect(g_corpus[14], 0, RequestParser::State::Error, "", 413)
+        && expect(g_corpus[17], 0, RequestParser::State::Error, "", 501)
+        && expect(g_corpus[18], 0, RequestParser::State::Error, "", 501)
+        && expect(g_corpus[19], 0, RequestParser::State::Complete, "")
+        && expect("GET / HTTP/1.1\r\nX: " + std::string(5000, 'a') + "\r\n\r\n", 0, RequestParser::State::Error, "", 431)
+        && expect("GET / HTTP/1.1\r\nX: " + std::string(5000, 'a'), 0, RequestParser::State::Error, "", 431);
+    if (!ok) return false;
+
+    for (const std::string& input : g_corpus)
+    {
+        if (!check(input, random, 64)) return false;
+    }
+
+    for (size_t i = 0; i < cases; i++)
+    {
+        // A few requests back to back, some of them damaged
+        std::string input;
+        size_t count = 1 + random() % 4;
+        for (size_t j = 0; j < count; j++) input += g_corpus[random() % g_corpus.size()];
+        if (random() % 4 != 0) input = mutate(random, input);
+
+        if (!check(input, random, 4)) return false;
+    }
+
+    return true;
+}
+
+static void throughput()
+{
+    const std::string request =
+        "GET /assets/app.js?v=3 HTTP/1.1\r\n"
+        "Host: localhost:8080\r\n"
+        "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:128.0) Gecko/20100101 Firefox/128.0\r\n"
+        "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+        "Accept-Language: en-US,en;q=0.5\r\n"
+        "Accept-Encoding: gzip, deflate, br\r\n"
+        "Connection: keep-alive\r\n"
+        "Cookie: session=4f2a9c1e7b; theme=dark\r\n"
+        "Cache-Control: max-age=0\r\n"
+        "\r\n";
+
+    const size_t count = 100000;
+    std::string input;
+    input.reserve(request.size() * count);
+    for (size_t i = 0; i < count; i++) input += request;
+
+    const int rounds = 5;
+    double best = 0;
+    size_t parsed = 0;
+
+    for (int round = 0; round < rounds; round++)
+    {
+        RequestParser parser;
+        std::string_view rest = input;
+        parsed = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        while (parser.parse(rest) == RequestParser::State::Complete)
+        {
+            parsed++;
+            rest.remove_prefix(parser.consumed());
+            parser.reset();
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        double rate = parsed / elapsed.count();
+        if (rate > best) best = rate;
+    }
+
+    std::cout << "http parser: " << parsed << " requests, " << static_cast<size_t>(best) << " req/s, "
+              << static_cast<int>(best * request.size() / (1024.0 * 1024.0)) << " MB/s\n";
+}
+
+int main(int argc, char* argv[])
+{
+    size_t cases = argc > 1 ? std::stoul(argv[1]) : 2000;
+    unsigned seed = argc > 2 ? static_cast<unsigned>(std::stoul(argv[2])) : 1;
+
+    if (!fuzz(cases, seed)) return 1;
+    std::cout << "http parser: " << cases << " fuzz cases passed\n";
+
+    throughput();
+    return 0;
+}
@@ -0,0 +1,72 @@
+// Lexer throughput: tokenizes a generated multi-megabyte source and reports MB/s.
+// Built as probescript-lexer-bench, pass a .prb file to measure that instead
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "frontend/lexer.hpp"
+
+using namespace Probescript;
+
+static std::string generate(size_t targetBytes)
+{
+    const std::string snippet =
+        "// Generated source for the lexer benchmark\n"
+        "fn clamp(value: num, low: num, high: num): num\n"
+        "{\n"
+        "    if (value < low && low != -1) return low;\n"
+        "    if (value >= high || high == 0.5) return high;\n"
+        "    return value;\n"
+        "}\n"
+        "\n"
+        "class Counter\n"
+        "{\n"
+        "    count = 0;\n"
+        "    label = \"counter with an \\\"escaped\\\" name\\n\";\n"
+        "    increment = fn() { this.count += 1; this.count++; };\n"
+        "}\n"
+        "\n"
+        "var items = [1, 2, 3, 42.75, 'single quoted'];\n"
+        "var lookup = { first: items[0], second: clamp(items[1] * 3 % 2, 0, 10) };\n"
+        "for (var i = 0; i < 100; i++) { lookup.first -= i / 2; }\n";
+
+    std::string source;
+    source.reserve(targetBytes + snippet.size());
+    while (source.size() < targetBytes) source += snippet;
+    return source;
+}
+
+int main(int argc, char* argv[])
+{
+    std::string source;
+
+    if (argc > 1)
+    {
+        std::ifstream stream(argv[1]);
+        std::stringstream buffer;
+        buffer << stream.rdbuf();
+        source = buffer.str();
+    }
+    else
+    {
+        source = generate(8 * 1024 * 1024);
+    }
+
+    const int rounds = 5;
+    size_t tokens = 0;
+    double best = 0;
+
+    for (int round = 0; round < rounds; round++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        tokens = Lexer::tokenize(source).size();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        double throughput = source.size() / (1024.0 * 1024.0) / elapsed.count();
+        if (throughput > best) best = throughput;
+    }
+
+    std::cout << "lexer: " << source.size() / 1024 << " KiB, " << tokens << " tokens, " << static_cast<int>(best) << " MB/s\n";
+    return 0;
+}
@@ -0,0 +1,92 @@
+#!/bin/bash
+
+# Parallel module loading: generates a project of many imported modules and times a cold start (--no-cache,
+# so every module is parsed and typechecked) with growing --workers counts. Registry::prepare spreads the
+# parse and check of independent modules over that many threads, so on a machine with several cores the
+# time should drop as workers go up, until it reaches the number of cores or the depth of the import graph.
+#
+# Usage: modules.sh [modules] [functions per module] [rounds]
+
+cd "$(dirname "${BASH_SOURCE[0]}")"
+
+YELLOW='\033[1;33m'
+NC='\033[0m'
+
+modules=${1:-64}
+functions=${2:-300}
+rounds=${3:-5}
+
+probescript="$(pwd)/../probescript"
+project="$(mktemp -d)"
+trap 'rm -rf "$project"' EXIT
+
+# Names are letters only, the parser does not take digits in identifiers
+name() {
+    local index=$1
+    local result="${2:-mod}"
+    for _ in 1 2 3; do
+        result+=$(printf "\\x$(printf %x $((97 + index % 26)))")
+        index=$((index / 26))
+    done
+    echo "$result"
+}
+
+echo '{ "name": "module benchmark" }' > "$project/project.json"
+mkdir -p "$project/modules"
+
+# Every module exports the same functions, so their source is built once
+body=""
+for ((f = 0; f < functions; f++)); do
+    body+="
+export fn $(name $f fn)(value: num, scale: num): num
+{
+    var total = value * scale;
+    var point = { left: total, right: value };
+    if (point.left > point.right) total = total - point.right;
+    return total + point.left;
+}
+"
+done
+
+# Layers of 16: every module past the first layer imports two of the one before it, so a layer can
+# only start checking once the one below is done
+for ((i = 0; i < modules; i++)); do
+    {
+        echo "module $(name $i);"
+        if ((i >= 16)); then
+            echo "import $(name $(( (i - 16) % 16 + (i / 16 - 1) * 16 )));"
+            echo "import $(name $(( (i - 15) % 16 + (i / 16 - 1) * 16 )));"
+        fi
+        echo "$body"
+    } > "$project/modules/$(name $i).probe"
+done
+
+{
+    for ((i = 0; i < modules; i++)); do echo "import $(name $i);"; done
+    cat <<'EOF'
+
+probe Main
+{
+    Main() {}
+}
+EOF
+} > "$project/main.prb"
+
+cores=$(nproc 2>/dev/null || sysctl -n hw.ncpu 2>/dev/null || echo "?")
+echo "Module loading: $modules modules of $functions functions, best of $rounds cold runs, $cores cores"
+
+baseline=0
+for workers in 1 2 4 8; do
+    best=0
+    for ((round = 0; round < rounds; round++)); do
+        start=$(date +%s%N)
+        "$probescript" run --no-cache --workers=$workers "$project/main.prb" > /dev/null || exit 1
+        end=$(date +%s%N)
+
+        elapsed=$(( (end - start) / 1000000 ))
+        if ((best == 0 || elapsed < best)); then best=$elapsed; fi
+    done
+
+    if ((workers == 1)); then baseline=$best; fi
+    printf "%-50s ${YELLOW}%d ms${NC}  %d.%02dx\n" "--workers=$workers" "$best" $((baseline / best)) $((baseline * 100 / best % 100))
+done
@@ -0,0 +1,32 @@
+#!/bin/bash
+
+cd "$(dirname "${BASH_SOURCE[0]}")"
+
+YELLOW='\033[1;33m'
+NC='\033[0m'
+
+echo "Running benchmarks..."
+echo "==================="
+
+while IFS= read -r -d '' file; do
+    rel_path="${file#./}"
+
+    start=$(date +%s%N)
+    ../probescript run "$file" "$@" > /dev/null
+    end=$(date +%s%N)
+
+    printf "%-50s ${YELLOW}%d ms${NC}\n" "$rel_path" "$(( (end - start) / 1000000 ))"
+done < <(find . -name "*.prb" -type f -print0 | sort -z)
+
+# Built next to the interpreter as probescript-lexer-bench
+if [ -x ../probescript-lexer-bench ]; then
+    ../probescript-lexer-bench
+fi
+
+# Fuzzes the HTTP request parser before timing it, built as probescript-http-parser-bench
+if [ -x ../probescript-http-parser-bench ]; then
+    ../probescript-http-parser-bench
+fi
+
+# Cold start of a generated project with many modules, timed with growing --workers counts
+bash modules.sh
@@ -0,0 +1,349 @@
+#include <cstring>
+#include <fstream>
+#include <random>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "cache.hpp"
+#include "frontend/parser.hpp"
+#include "frontend/resolver.hpp"
+#include "frontend/serializer.hpp"
+#include "frontend/sources.hpp"
+
+using namespace Probescript;
+
+namespace fs = std::filesystem;
+
+namespace
+{
+
+// Artifact layout: magic, LayoutVersion, interpreter version, source hash and size, whether the
+// program typechecked, the hash of the project configuration, the modules it depended on with their
+// source hashes, the import names with the files they resolved to, then the serialized program with its hash
+constexpr char Magic[4] = { 'P', 'R', 'B', 'C' };
+constexpr uint32_t LayoutVersion = 2;
+constexpr const char* Extension = ".prbc";
+
+bool g_enabled = false;
+fs::path g_directory;
+std::string g_version;
+
+// Read-only view of a whole file, memory mapped where the platform has mmap
+class MappedFile
+{
+public:
+    explicit MappedFile(const fs::path& path)
+    {
+#ifndef _WIN32
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+
+        struct stat info;
+        if (::fstat(fd, &info) == 0 && info.st_size > 0)
+        {
+            void* map = ::mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map != MAP_FAILED)
+            {
+                m_map = map;
+                m_size = info.st_size;
+            }
+        }
+
+        ::close(fd);
+#else
+        std::ifstream stream(path, std::ios::binary);
+        if (!stream) return;
+
+        m_buffer.assign((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+        m_open = !m_buffer.empty();
+#endif
+    }
+
+    ~MappedFile()
+    {
+#ifndef _WIN32
+        if (m_map) ::munmap(m_map, m_size);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+#ifndef _WIN32
+    bool ok() const { return m_map != nullptr; }
+    std::string_view data() const { return { static_cast<const char*>(m_map), m_size }; }
+#else
+    bool ok() const { return m_open; }
+    std::string_view data() const { return m_buffer; }
+#endif
+
+private:
+#ifndef _WIN32
+    void* m_map = nullptr;
+    size_t m_size = 0;
+#else
+    std::string m_buffer;
+    bool m_open = false;
+#endif
+};
+
+void putU32(std::string& out, uint32_t value) { out.append(reinterpret_cast<const char*>(&value), 4); }
+void putU64(std::string& out, uint64_t value) { out.append(reinterpret_cast<const char*>(&value), 8); }
+
+void putStr(std::string& out, std::string_view value)
+{
+    putU32(out, value.size());
+    out.append(value);
+}
+
+// Reads the header fields back, throwing on truncation like the program reader does
+struct Cursor
+{
+    std::string_view data;
+    size_t pos = 0;
+
+    std::string_view take(size_t size)
+    {
+        if (data.size() - pos < size) throw AST::SerializeError("Cache artifact is truncated");
+
+        std::string_view bytes = data.substr(pos, size);
+        pos += size;
+        return bytes;
+    }
+
+    // A count of entries at least `entrySize` bytes each, so a corrupt one cannot run past the artifact
+    uint32_t count(size_t entrySize)
+    {
+        uint32_t value = u32();
+        if (value > (data.size() - pos) / entrySize) throw AST::SerializeError("Cache artifact is truncated");
+        return value;
+    }
+
+    uint32_t u32() { uint32_t value; std::memcpy(&value, take(4).data(), 4); return value; }
+    uint64_t u64() { uint64_t value; std::memcpy(&value, take(8).data(), 8); return value; }
+    uint8_t u8() { return static_cast<uint8_t>(take(1)[0]); }
+    std::string_view str() { return take(u32()); }
+};
+
+bool hashFile(const fs::path& path, uint64_t& out)
+{
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream) return false;
+
+    std::string text((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+    out = Cache::hash(text);
+    return true;
+}
+
+std::string toHex(uint64_t value)
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string hex(16, '0');
+
+    for (int i = 15; i >= 0; i--, value >>= 4) hex[i] = digits[value & 0xF];
+    return hex;
+}
+
+// project.json is part of what a check depends on, its "ignore" patterns decide which files the import names map to
+uint64_t projectHash(const Context& ctx)
+{
+    return ctx.project.isEmpty() ? 0 : Cache::hash(ctx.project.toJSON());
+}
+
+// Keyed by content: the same source under the same name and interpreter version maps to the same file
+fs::path artifactPath(const Context& ctx, uint64_t sourceHash)
+{
+    return g_directory / (toHex(Cache::hash(ctx.filename, Cache::hash(g_version, sourceHash))) + Extension);
+}
+
+bool load(const fs::path& path, const Context& ctx, uint64_t sourceHash, Cache::Artifact& artifact)
+{
+    MappedFile file(path);
+    if (!file.ok()) return false;
+
+    Cursor in { file.data() };
+
+    if (in.take(4) != std::string_view(Magic, 4) || in.u32() != LayoutVersion) return false;
+    if (in.str() != g_version || in.u64() != sourceHash || in.u64() != ctx.file.size()) return false;
+
+    bool checked = in.u8() != 0;
+    if (in.u64() != projectHash(ctx)) checked = false;
+
+    uint32_t dependencies = in.count(12);
+    for (uint32_t i = 0; i < dependencies; i++)
+    {
+        fs::path dependency(std::string(in.str()));
+        uint64_t expected = in.u64();
+        uint64_t actual;
+
+        if (checked && (!hashFile(dependency, actual) || actual != expected)) checked = false;
+    }
+
+    uint32_t imports = in.count(8);
+    for (uint32_t i = 0; i < imports; i++)
+    {
+        std::string_view name = in.str();
+        std::string_view resolved = in.str();
+
+        auto found = ctx.modules.find(std::string(name));
+        if (resolved != (found != ctx.modules.end() ? found->second.string() : "")) checked = false;
+    }
+
+    uint64_t payloadHash = in.u64();
+    std::string_view payload = in.take(in.u64());
+    if (Cache::hash(payload) != payloadHash) return false;
+
+    artifact.program = AST::Serializer::read(payload, Lexer::Sources::add(ctx.filename, ctx.file));
+    artifact.checked = checked;
+
+    Resolver().resolve(artifact.program);
+    return true;
+}
+
+// A cache that cannot be written is skipped, it never fails the run
+void store(const fs::path& path, const Context& ctx, uint64_t sourceHash, const AST::ProgramType& program, bool checked,
+           const std::vector<fs::path>& dependencies, const std::vector<std::pair<std::string, std::string>>& imports)
+{
+    std::string out(Magic, 4);
+    putU32(out, LayoutVersion);
+    putStr(out, g_version);
+    putU64(out, sourceHash);
+    putU64(out, ctx.file.size());
+    out.push_back(checked ? 1 : 0);
+    putU64(out, projectHash(ctx));
+
+    std::vector<std::pair<std::string, uint64_t>> hashed;
+    for (const fs::path& dependency : dependencies)
+    {
+        uint64_t value;
+        if (!hashFile(dependency, value)) return;
+        hashed.push_back({ dependency.string(), value });
+    }
+
+    putU32(out, hashed.size());
+    for (const auto& [name, value] : hashed)
+    {
+        putStr(out, name);
+        putU64(out, value);
+    }
+
+    putU32(out, imports.size());
+    for (const auto& [name, resolved] : imports)
+    {
+        putStr(out, name);
+        putStr(out, resolved);
+    }
+
+    try
+    {
+        std::string payload = AST::Serializer::write(program);
+        putU64(out, Cache::hash(payload));
+        putU64(out, payload.size());
+        out.append(payload);
+    }
+    catch (const AST::SerializeError&)
+    {
+        return;
+    }
+
+    std::error_code error;
+    fs::create_directories(g_directory, error);
+    if (error) return;
+
+    // Written aside and renamed into place, so a concurrent run never maps a half written artifact
+    fs::path temp = path;
+    temp += ".tmp" + std::to_string(std::random_device()());
+
+    {
+        std::ofstream stream(temp, std::ios::binary | std::ios::trunc);
+        if (!stream.write(out.data(), out.size())) return;
+    }
+
+    fs::rename(temp, path, error);
+    if (error) fs::remove(temp, error);
+}
+
+} // namespace
+
+void Cache::enable(const fs::path& directory, const std::string& version)
+{
+    g_enabled = true;
+    g_directory = directory;
+    g_version = version;
+}
+
+bool Cache::enabled()
+{
+    return g_enabled;
+}
+
+Cache::Artifact Cache::parse(const std::shared_ptr<Context>& ctx)
+{
+    Artifact artifact;
+
+    if (!g_enabled)
+    {
+        artifact.program = Parser().parse(ctx->file, ctx);
+        return artifact;
+    }
+
+    uint64_t sourceHash = hash(ctx->file);
+    fs::path path = artifactPath(*ctx, sourceHash);
+
+    try
+    {
+        if (load(path, *ctx, sourceHash, artifact)) return artifact;
+    }
+    catch (...)
+    {
+        // A corrupt or foreign artifact is replaced below, whatever the reader or resolver made of it
+    }
+
+    artifact = Artifact();
+    artifact.program = Parser().parse(ctx->file, ctx);
+    store(path, *ctx, sourceHash, *artifact.program, false, {}, {});
+
+    return artifact;
+}
+
+void Cache::markChecked(const std::shared_ptr<Context>& ctx, const AST::ProgramType& program, const std::vector<fs::path>& dependencies,
+                        const std::vector<std::pair<std::string, std::string>>& imports)
+{
+    if (!g_enabled) return;
+
+    uint64_t sourceHash = hash(ctx->file);
+    store(artifactPath(*ctx, sourceHash), *ctx, sourceHash, program, true, dependencies, imports);
+}
+
+size_t Cache::clean(const fs::path& directory)
+{
+    std::error_code error;
+    if (!fs::is_directory(directory, error)) return 0;
+
+    size_t removed = 0;
+    for (const fs::directory_entry& entry : fs::directory_iterator(directory, error))
+    {
+        if (entry.path().extension() == Extension) removed++;
+    }
+
+    fs::remove_all(directory, error);
+    return removed;
+}
+
+uint64_t Cache::hash(std::string_view data, uint64_t seed)
+{
+    uint64_t value = seed;
+
+    for (char c : data)
+    {
+        value ^= static_cast<unsigned char>(c);
+        value *= 1099511628211ull;
+    }
+
+    return value;
+}
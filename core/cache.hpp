@@ -0,0 +1,42 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "context.hpp"
+#include "frontend/ast.hpp"
+
+namespace Probescript::Cache
+{
+
+// Turns the on-disk cache on for this process. Artifacts are written to `directory`, and only
+// reused when they were written by the same `version` of the interpreter
+void enable(const std::filesystem::path& directory, const std::string& version);
+bool enabled();
+
+struct Artifact
+{
+    std::shared_ptr<AST::ProgramType> program;
+    // The program typechecked when it was cached, and neither the modules it imported, what their names
+    // resolve to nor the project configuration have changed since
+    bool checked = false;
+};
+
+// Parses ctx->file as ctx->filename, or loads it from an artifact keyed by the hash of its source
+Artifact parse(const std::shared_ptr<Context>& ctx);
+
+// Records that the program parsed from `ctx` typechecked, given the current sources of `dependencies`, the
+// files the `imports` names resolved to and the project configuration
+void markChecked(const std::shared_ptr<Context>& ctx, const AST::ProgramType& program, const std::vector<std::filesystem::path>& dependencies,
+                 const std::vector<std::pair<std::string, std::string>>& imports);
+
+// Deletes the artifacts in `directory` and the directory itself, returning how many were removed
+size_t clean(const std::filesystem::path& directory);
+
+// 64 bit FNV-1a
+uint64_t hash(std::string_view data, uint64_t seed = 14695981039346656037ull);
+
+} // namespace Probescript::Cache
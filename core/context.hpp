@@ -3,14 +3,7 @@
 #include <filesystem>
 #include <unordered_map>
 
-namespace Probescript::Values
-{
-    
-struct RuntimeVal;
-
-using Val = std::shared_ptr<RuntimeVal>;
-
-} // namespace Probescript::Values
+#include "runtime/val.hpp"
 
 namespace Probescript
 {
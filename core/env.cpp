@@ -2,61 +2,173 @@
 
 using namespace Probescript;
 
-Env::Env(EnvPtr parentENV)
+Env::Env(EnvPtr parentENV, std::shared_ptr<AST::Scope> scope)
+    : parent(parentENV), m_scope(scope)
 {
-    parent = parentENV;
+    if (m_scope) m_slots.resize(m_scope->names.size());
 }
 
-void Env::init()
+Values::Val Env::declareVar(std::string varname, Values::Val value, Lexer::Token tk)
 {
-    m_ready = true;
-    for (const auto& [key, pair] : g_globals)
-        declareVar(key, pair.first, Lexer::Token());
+    if (findLocal(varname))
+    {
+        throw std::runtime_error(CustomError("Variable " + varname + " is already defined", "ReferenceError", tk));
+    }
+
+    if (value.isEmpty()) value = Values::makeUndefined();
+
+    variables[varname] = value;
+    return value;
 }
 
-Values::Val Env::declareVar(std::string varname, Values::Val value, Lexer::Token tk)
+Values::Val Env::declareVar(const AST::Address& address, const std::string& varname, Values::Val value, Lexer::Token tk)
 {
-    if (!m_ready) init();
-    if (variables.find(varname) != variables.end())
+    if (!owns(address)) return declareVar(varname, value, tk);
+
+    Values::Val& slot = m_slots[address.slot];
+    if (!slot.isEmpty() || (!variables.empty() && variables.count(varname)))
     {
         throw std::runtime_error(CustomError("Variable " + varname + " is already defined", "ReferenceError", tk));
     }
 
-    variables[varname] = value;
+    if (value.isEmpty()) value = Values::makeUndefined();
+
+    slot = value;
     return value;
 }
 
 Values::Val Env::assignVar(std::string varname, Values::Val value, Lexer::Token tk)
 {
-    if (!m_ready) init();
-    EnvPtr env = resolve(varname, tk);
+    Values::Val* target = find(varname);
+    if (!target && g_globals.count(varname))
+    {
+        // The shared builtin stays as it is, the program's root scope gets a variable shadowing it
+        Env* root = this;
+        while (root->parent) root = root->parent.get();
+        target = &root->variables[varname];
+    }
 
-    env->variables[varname] = value;
+    if (!target)
+    {
+        throw std::runtime_error(CustomError("Cannot resolve variable " + varname + " as it does not exist", "ReferenceError", tk));
+    }
 
+    if (value.isEmpty()) value = Values::makeUndefined();
+
+    *target = value;
+    return value;
+}
+
+Values::Val Env::assignVar(const AST::IdentifierType& ident, Values::Val value)
+{
+    Values::Val* target = at(ident.address);
+    if (!target) return assignVar(ident.symbol, value, ident.token);
+
+    if (value.isEmpty()) value = Values::makeUndefined();
+
+    *target = value;
     return value;
 }
 
 Values::Val Env::lookupVar(std::string varname, Lexer::Token tk)
 {
-    if (!m_ready) init();
-    EnvPtr env = resolve(varname, tk);
+    if (Values::Val* value = find(varname)) return *value;
+
+    // Globals live in one shared table rather than being copied into every scope, and are only ever read from it
+    auto global = g_globals.find(varname);
+    if (global == g_globals.end())
+    {
+        throw std::runtime_error(CustomError("Cannot resolve variable " + varname + " as it does not exist", "ReferenceError", tk));
+    }
+
+    return global->second.first;
+}
+
+Values::Val Env::lookupVar(const AST::IdentifierType& ident)
+{
+    Values::Val* value = at(ident.address);
+    if (!value) return lookupVar(ident.symbol, ident.token);
 
-    return env->variables[varname];
+    return *value;
 }
 
-EnvPtr Env::resolve(std::string varname, Lexer::Token tk)
+void Env::setVar(const AST::Address& address, const std::string& varname, Values::Val value)
 {
-    if (!m_ready) init();
+    if (value.isEmpty()) value = Values::makeUndefined();
 
-    if (variables.find(varname) != variables.end())
+    if (owns(address)) m_slots[address.slot] = value;
+    else variables[varname] = value;
+}
+
+void Env::addBase(EnvPtr base)
+{
+    m_bases.push_back(std::move(base));
+}
+
+EnvPtr Env::instanceOf(const AST::Scope* scope)
+{
+    for (Env* env = this; env; env = env->parent.get())
+    {
+        if (env->m_scope.get() == scope) return env->shared_from_this();
+        if (EnvPtr found = env->baseOf(scope)) return found;
+    }
+
+    return nullptr;
+}
+
+EnvPtr Env::baseOf(const AST::Scope* scope)
+{
+    for (const EnvPtr& base : m_bases)
     {
-        return shared_from_this();
+        if (base->m_scope.get() == scope) return base;
+        if (EnvPtr found = base->baseOf(scope)) return found;
     }
 
-    if (!parent)
+    return nullptr;
+}
+
+Values::Val* Env::findLocal(const std::string& varname)
+{
+    if (m_scope)
     {
-        throw std::runtime_error(CustomError("Cannot resolve variable " + varname + " as it does not exist", "ReferenceError", tk));
+        int slot = m_scope->find(varname);
+        if (slot >= 0 && !m_slots[slot].isEmpty()) return &m_slots[slot];
+    }
+
+    if (variables.empty()) return nullptr;
+
+    auto it = variables.find(varname);
+    return it != variables.end() ? &it->second : nullptr;
+}
+
+Values::Val* Env::find(const std::string& varname)
+{
+    for (Env* env = this; env; env = env->parent.get())
+    {
+        if (Values::Val* value = env->findLocal(varname))
+            return value;
     }
 
-    return parent->resolve(varname, tk);
-}
\ No newline at end of file
+    return nullptr;
+}
+
+// The slot a resolved address points at, or nullptr if the environments at runtime do not have the
+// layout the resolver expected or the variable has not been declared yet. Callers then fall back to the by-name lookup
+Values::Val* Env::at(const AST::Address& address)
+{
+    if (!address.scope) return nullptr;
+
+    Env* env = this;
+    for (int i = 0; i < address.depth && env; i++)
+        env = env->parent.get();
+
+    if (!env || env->m_scope.get() != address.scope) return nullptr;
+
+    Values::Val& value = env->m_slots[address.slot];
+    return value.isEmpty() ? nullptr : &value;
+}
+
+bool Env::owns(const AST::Address& address) const
+{
+    return address.scope && address.depth == 0 && m_scope.get() == address.scope;
+}
@@ -28,22 +28,43 @@ namespace Probescript
 class Env : public std::enable_shared_from_this<Env>
 {
 public:
-    Env(EnvPtr parentENV = nullptr);
+    Env(EnvPtr parentENV = nullptr, std::shared_ptr<AST::Scope> scope = nullptr);
 
+    // Variables declared by name, outside of the slots the resolver laid out for this scope
     std::unordered_map<std::string, Values::Val> variables = {};
 
     Values::Val declareVar(std::string varName, Values::Val value, Lexer::Token tk);
 
+    Values::Val declareVar(const AST::Address& address, const std::string& varName, Values::Val value, Lexer::Token tk);
+
     Values::Val assignVar(std::string varName, Values::Val value, Lexer::Token tk);
 
+    Values::Val assignVar(const AST::IdentifierType& ident, Values::Val value);
+
     Values::Val lookupVar(std::string varName, Lexer::Token tk);
 
-    EnvPtr resolve(std::string varname, Lexer::Token tk);
+    Values::Val lookupVar(const AST::IdentifierType& ident);
+
+    // Declares or overwrites a variable in this scope
+    void setVar(const AST::Address& address, const std::string& varName, Values::Val value);
+
+    // Keeps the instance of a superprobe made for the probe call this environment belongs to
+    void addBase(EnvPtr base);
+
+    // The closest environment of `scope` from here outwards, superprobe instances included. Null if there is none
+    EnvPtr instanceOf(const AST::Scope* scope);
+
 private:
     EnvPtr parent;
-    bool m_ready = false;
+    std::shared_ptr<AST::Scope> m_scope;
+    std::vector<Values::Val> m_slots;
+    std::vector<EnvPtr> m_bases;
 
-    void init();
+    Values::Val* findLocal(const std::string& varname);
+    EnvPtr baseOf(const AST::Scope* scope);
+    Values::Val* find(const std::string& varname);
+    Values::Val* at(const AST::Address& address);
+    bool owns(const AST::Address& address) const;
 };
 
 } // namespace Probescript
\ No newline at end of file
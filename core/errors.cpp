@@ -1,92 +1,62 @@
 #include "errors.hpp"
 
+using namespace Probescript;
+
 std::string Probescript::Error(const std::string& m)
 {
     return ConsoleColors::RED + "[Error]: " + ConsoleColors::RESET + m + "\n";
 }
 
-std::string Probescript::SyntaxError(const std::string& m, Lexer::Token tk, std::shared_ptr<Context> ctx)
+// Formats an error pointing at the token, with the lines around it when its source is known
+static std::string located(const std::string& label, const std::string& m, const Lexer::Token& tk)
 {
-    std::vector<std::string> file = split(ctx->file, "\n");
-    std::string line = file[tk.line - 1];
-    
-    if (line == "")
+    Lexer::Location location = tk.location();
+    std::vector<std::string> file = split(Lexer::Sources::text(tk.file), "\n");
+
+    if (location.line == 0 || location.line > file.size() || file[location.line - 1].empty())
     {
-        return ConsoleColors::RED + "[SyntaxError]: " + ConsoleColors::RESET + m + "\n";
+        return ConsoleColors::RED + "[" + label + "]: " + ConsoleColors::RESET + m + "\n";
     }
-    else
-    {
-        // Make the error message
-        // pointer: points to the token where the error occured
-
-        std::string pointer;
-        std::string nextline = (tk.line < file.size()) ? file[tk.line] : "";
-        std::string lastline = (tk.line > 1) ? file[tk.line - 2] + "\n" : "";
-
-        size_t len = line.size();
-
-        for (size_t i = 0; i < tk.col - 1 && i < len; i++)
-        {
-            pointer += (line[i] == '\t' ? "\t" : " ");
-        }
-
-        pointer += ConsoleColors::RED;
-
-        for (size_t i = 0; i < tk.value.size(); i++)
-            pointer += "^";
 
-        pointer += ConsoleColors::RESET + "\n";
+    // Make the error message
+    // pointer: points to the token where the error occured
 
-        return
-            ConsoleColors::RED + "[SyntaxError]: " + ConsoleColors::RESET + m + "\n\n"
-            + "At " + ctx->filename + ":" + std::to_string(tk.line) + ":" + std::to_string(tk.col) + "\n"
-            + lastline
-            + line + "\n"
-            + pointer
-            + nextline + "\n";
-    }
-}
+    std::string line = file[location.line - 1];
+    std::string pointer;
+    std::string nextline = (location.line < file.size()) ? file[location.line] : "";
+    std::string lastline = (location.line > 1) ? file[location.line - 2] + "\n" : "";
 
-std::string Probescript::TypeError(const std::string& m, Lexer::Token tk)
-{
-    std::vector<std::string> file = split(tk.ctx->file, "\n");
+    size_t len = line.size();
 
-    std::string line = file[tk.line - 1];
-    if (line.empty())
+    for (size_t i = 0; i < location.col - 1 && i < len; i++)
     {
-        return ConsoleColors::RED + "[TypeError]: " + ConsoleColors::RESET + m + "\n";
+        pointer += (line[i] == '\t' ? "\t" : " ");
     }
-    else
-    {
-        // Make the error message
-        // pointer: points to the token where the error occured
 
-        std::string pointer;
-        std::string nextline = (tk.line < file.size()) ? file[tk.line] : "";
-        std::string lastline = (tk.line > 1) ? file[tk.line - 2] + "\n" : "";
+    pointer += ConsoleColors::RED;
 
-        size_t len = line.size();
+    for (size_t i = 0; i < tk.value.size(); i++)
+        pointer += "^";
 
-        for (size_t i = 0; i < tk.col - 1 && i < len; i++)
-        {
-            pointer += (line[i] == '\t' ? "\t" : " ");
-        }
+    pointer += ConsoleColors::RESET + "\n";
 
-        pointer += ConsoleColors::RED;
-
-        for (size_t i = 0; i < tk.value.size(); i++)
-            pointer += "^";
+    return
+        ConsoleColors::RED + "[" + label + "]: " + ConsoleColors::RESET + m + "\n\n"
+        + "At " + Lexer::Sources::filename(tk.file) + ":" + std::to_string(location.line) + ":" + std::to_string(location.col) + "\n"
+        + lastline
+        + line + "\n"
+        + pointer
+        + nextline + "\n";
+}
 
-        pointer += ConsoleColors::RESET + "\n";
+std::string Probescript::SyntaxError(const std::string& m, const Lexer::Token& tk)
+{
+    return located("SyntaxError", m, tk);
+}
 
-        return
-            ConsoleColors::RED + "[TypeError]: " + ConsoleColors::RESET + m + "\n\n"
-            + "At " + tk.ctx->filename + ":" + std::to_string(tk.line) + ":" + std::to_string(tk.col) + "\n"
-            + lastline
-            + line + "\n"
-            + pointer
-            + nextline + "\n";
-    }
+std::string Probescript::TypeError(const std::string& m, const Lexer::Token& tk)
+{
+    return located("TypeError", m, tk);
 }
 
 std::string Probescript::ArgumentError(const std::string& m)
@@ -99,44 +69,7 @@ std::string Probescript::CustomError(const std::string& m, const std::string& n)
     return ConsoleColors::RED + "[" + n + "]: " + ConsoleColors::RESET + m + "\n";
 }
 
-std::string Probescript::CustomError(const std::string& m, const std::string& n, Lexer::Token tk)
+std::string Probescript::CustomError(const std::string& m, const std::string& n, const Lexer::Token& tk)
 {
-    std::vector<std::string> file = split(tk.ctx->file, "\n");
-
-    std::string line = file[tk.line - 1];
-    if (line.empty())
-    {
-        return ConsoleColors::RED + "[" + n + "]: " + ConsoleColors::RESET + m + "\n";
-    }
-    else
-    {
-        // Make the error message
-        // pointer: points to the token where the error occured
-
-        std::string pointer;
-        std::string nextline = (tk.line < file.size()) ? file[tk.line] : "";
-        std::string lastline = (tk.line > 1) ? file[tk.line - 2] + "\n" : "";
-
-        size_t len = line.size();
-
-        for (size_t i = 0; i < tk.col - 1 && i < len; i++)
-        {
-            pointer += (line[i] == '\t' ? "\t" : " ");
-        }
-
-        pointer += ConsoleColors::RED;
-
-        for (size_t i = 0; i < tk.value.size(); i++)
-            pointer += "^";
-
-        pointer += ConsoleColors::RESET + "\n";
-
-        return
-            ConsoleColors::RED + "[" + n + "]: " + ConsoleColors::RESET + m + "\n\n"
-            + "At " + tk.ctx->filename + ":" + std::to_string(tk.line) + ":" + std::to_string(tk.col) + "\n"
-            + lastline
-            + line + "\n"
-            + pointer
-            + nextline + "\n";
-    }
-}
\ No newline at end of file
+    return located(n, m, tk);
+}
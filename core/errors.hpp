@@ -9,10 +9,10 @@ namespace Probescript
 {
 
 std::string Error(const std::string& m);
-std::string SyntaxError(const std::string& m, Lexer::Token tk = Lexer::Token(), std::shared_ptr<Context> ctx = std::make_shared<Context>());
-std::string TypeError(const std::string& m, Lexer::Token tk = Lexer::Token());
+std::string SyntaxError(const std::string& m, const Lexer::Token& tk = Lexer::Token());
+std::string TypeError(const std::string& m, const Lexer::Token& tk = Lexer::Token());
 std::string ArgumentError(const std::string& m);
 std::string CustomError(const std::string& m, const std::string& n);
-std::string CustomError(const std::string& m, const std::string& n, Lexer::Token tk);
+std::string CustomError(const std::string& m, const std::string& n, const Lexer::Token& tk);
 
 } // namespace Probescript
\ No newline at end of file
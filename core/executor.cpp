@@ -0,0 +1,300 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "executor.hpp"
+
+using namespace Probescript;
+
+namespace
+{
+
+using Task = std::function<void()>;
+
+struct Worker
+{
+    std::mutex mutex;
+    // The owner pushes and pops at the back, thieves take from the front
+    std::deque<Task> tasks;
+};
+
+size_t g_configured = 0;
+
+// Threads that stand in for blocked workers. Past this many, a worker that blocks just blocks
+constexpr size_t MaxSpares = 256;
+// How long a spare no blocked worker needs any more stays around for the next one
+constexpr auto SpareLinger = std::chrono::seconds(2);
+// The worker index of a spare, which has no deque of its own
+constexpr size_t Spare = static_cast<size_t>(-1);
+
+// Never destroyed, a worker can be blocked for good (in ch.recv() on a channel nobody sends to, say) and joining
+// it would hang the exit. drain() waits for every other task instead
+class Pool
+{
+public:
+    explicit Pool(size_t size)
+    {
+        for (size_t i = 0; i < size; i++) m_workers.push_back(std::make_unique<Worker>());
+        for (size_t i = 0; i < size; i++) std::thread([this, i]() { loop(i); }).detach();
+    }
+
+    void post(Task task)
+    {
+        // Counted first, so a worker never sees the task before the count
+        m_pending.fetch_add(1);
+        m_queued.fetch_add(1);
+
+        if (t_pool == this && t_index != Spare)
+        {
+            std::lock_guard<std::mutex> lock(m_workers[t_index]->mutex);
+            m_workers[t_index]->tasks.push_back(std::move(task));
+        }
+        else
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_injected.push_back(std::move(task));
+        }
+
+        // Taking the lock orders the notify after a sleeping worker's check of m_queued
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+        }
+        m_wake.notify_one();
+    }
+
+    // The pool the calling thread works for, null outside of the pool
+    static Pool* current() { return t_pool; }
+
+    // Keeps as many threads running tasks as there are workers while the caller blocks
+    void blocking(const std::function<void()>& fn)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_blocked++;
+            if (m_pending.load() <= m_blocked) m_idle.notify_all();
+
+            if (m_spares < m_blocked && m_spares < MaxSpares)
+            {
+                m_spares++;
+                std::thread([this]() { loop(Spare); }).detach();
+            }
+        }
+
+        struct Unblock
+        {
+            Pool* pool;
+
+            ~Unblock()
+            {
+                std::lock_guard<std::mutex> lock(pool->m_mutex);
+                pool->m_blocked--;
+                // An idle spare may be one too many now
+                if (pool->m_spares > pool->m_blocked) pool->m_wake.notify_all();
+            }
+        } unblock { this };
+
+        fn();
+    }
+
+    // Returns once every task posted has finished, apart from those blocked in blocking()
+    void drain()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_idle.wait(lock, [this]() { return m_pending.load() <= m_blocked; });
+    }
+
+private:
+    std::vector<std::unique_ptr<Worker>> m_workers;
+
+    // Tasks posted from outside the pool
+    std::mutex m_mutex;
+    std::deque<Task> m_injected;
+    std::condition_variable m_wake;
+    std::atomic<size_t> m_queued { 0 };
+    // Tasks posted and not finished yet, queued or running
+    std::atomic<size_t> m_pending { 0 };
+    std::condition_variable m_idle;
+    // Workers inside blocking() and the spare threads standing in for them, both under m_mutex
+    size_t m_blocked = 0;
+    size_t m_spares = 0;
+
+    static thread_local Pool* t_pool;
+    static thread_local size_t t_index;
+
+    bool take(size_t index, Task& task)
+    {
+        if (m_queued.load() == 0) return false;
+
+        if (index != Spare)
+        {
+            Worker& own = *m_workers[index];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty())
+            {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                m_queued.fetch_sub(1);
+                return true;
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_injected.empty())
+            {
+                task = std::move(m_injected.front());
+                m_injected.pop_front();
+                m_queued.fetch_sub(1);
+                return true;
+            }
+        }
+
+        size_t first = index == Spare ? 0 : index + 1;
+        for (size_t i = 0; i < m_workers.size(); i++)
+        {
+            size_t victimIndex = (first + i) % m_workers.size();
+            if (victimIndex == index) continue;
+
+            Worker& victim = *m_workers[victimIndex];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty())
+            {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                m_queued.fetch_sub(1);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void finished()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_pending.fetch_sub(1) - 1 <= m_blocked) m_idle.notify_all();
+    }
+
+    void loop(size_t index)
+    {
+        t_pool = this;
+        t_index = index;
+
+        while (true)
+        {
+            Task task;
+            if (take(index, task))
+            {
+                task();
+                finished();
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (index != Spare)
+            {
+                m_wake.wait(lock, [this]() { return m_queued.load() > 0; });
+                continue;
+            }
+
+            // A spare leaves once the workers it stood in for are back and nothing new came for a while
+            if (m_spares <= m_blocked) m_wake.wait(lock, [this]() { return m_queued.load() > 0 || m_spares > m_blocked; });
+            if (m_queued.load() > 0) continue;
+
+            m_wake.wait_for(lock, SpareLinger, [this]() { return m_queued.load() > 0 || m_spares <= m_blocked; });
+            if (m_queued.load() == 0 && m_spares > m_blocked)
+            {
+                m_spares--;
+                return;
+            }
+        }
+    }
+};
+
+thread_local Pool* Pool::t_pool = nullptr;
+thread_local size_t Pool::t_index = 0;
+
+std::atomic<Pool*> g_pool { nullptr };
+std::once_flag g_poolStarted;
+
+Pool& pool()
+{
+    std::call_once(g_poolStarted, []() { g_pool.store(new Pool(Executor::workers())); });
+    return *g_pool.load();
+}
+
+} // namespace
+
+void Executor::configure(size_t workers)
+{
+    g_configured = workers;
+}
+
+size_t Executor::workers()
+{
+    if (g_configured > 0) return g_configured;
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+void Executor::post(std::function<void()> task)
+{
+    pool().post(std::move(task));
+}
+
+void Executor::drain()
+{
+    // A pool that never started has nothing to wait for
+    if (Pool* workers = g_pool.load()) workers->drain();
+}
+
+bool Executor::Job::run()
+{
+    if (claimed.exchange(true)) return false;
+
+    task();
+    // Lets go of what the function captured, the future keeps the result
+    task = std::packaged_task<Values::Val()>();
+    return true;
+}
+
+Values::Val Executor::submit(std::function<Values::Val()> fn)
+{
+    auto job = std::make_shared<Job>();
+    job->task = std::packaged_task<Values::Val()>(std::move(fn));
+    std::shared_future<Values::Val> future = job->task.get_future().share();
+
+    post([job]() { job->run(); });
+    return Values::make<Values::FutureVal>(future, job);
+}
+
+bool Executor::onWorker()
+{
+    return Pool::current() != nullptr;
+}
+
+void Executor::wait(const Values::Ref<Values::FutureVal>& future)
+{
+    if (future->future.wait_for(std::chrono::seconds(0)) == std::future_status::ready) return;
+
+    // Only the awaited task runs on this stack, an unrelated one could need a lock the caller holds
+    if (future->job && future->job->run()) return;
+
+    blocking([&]() { future->future.wait(); });
+}
+
+void Executor::blocking(const std::function<void()>& fn)
+{
+    Pool* workers = Pool::current();
+    if (!workers)
+    {
+        fn();
+        return;
+    }
+
+    workers->blocking(fn);
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+
+#include "runtime/values.hpp"
+
+namespace Probescript::Executor
+{
+
+// Sets how many worker threads the pool gets, 0 for one per hardware thread.
+// Only has an effect before the first task is posted
+void configure(size_t workers);
+
+// The size the pool has or will have
+size_t workers();
+
+// Queues `task` on the pool. From a worker thread it goes to that worker's own deque, where it runs next
+// unless an idle worker steals it first
+void post(std::function<void()> task);
+
+// A task started by submit(). Whoever claims it first runs it, the worker it was queued on or a thread that
+// waits for its result
+struct Job
+{
+    std::atomic<bool> claimed { false };
+    std::packaged_task<Values::Val()> task;
+
+    // Runs the task unless another thread already has, false if one had
+    bool run();
+};
+
+// Runs `fn` on the pool, its result or exception is delivered through the returned future
+Values::Val submit(std::function<Values::Val()> fn);
+
+// Whether the calling thread is one of the pool's workers
+bool onWorker();
+
+// Blocks until `future` is ready. A task no thread has started yet is run by the caller instead. A worker that
+// still has to block hands its place to a spare thread, so tasks awaiting other tasks cannot leave the whole
+// pool blocked
+void wait(const Values::Ref<Values::FutureVal>& future);
+
+// Runs `fn`, which blocks the calling thread, while a spare thread stands in for it if it is a worker
+void blocking(const std::function<void()>& fn);
+
+// Blocks until every task on the pool has finished, including async calls nobody awaited. Tasks blocked in
+// blocking(), like a running http.Serve, are not waited for
+void drain();
+
+} // namespace Probescript::Executor
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "frontend/sources.hpp"
+
+namespace Probescript::AST
+{
+
+// Bump allocator for the nodes of one program, owned by the program through an ArenaPtr. Nodes are never
+// freed one by one, but each one counts as a reference until it is, so closures and exports can outlive the
+// program. The blocks are released together once the program and the last node are gone
+class Arena
+{
+public:
+    static constexpr size_t BlockSize = 64 * 1024;
+
+    Arena() = default;
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // Only the thread building the program allocates, nodes may be released from any thread
+    void* allocate(size_t size, size_t align)
+    {
+        size_t offset = (m_used + align - 1) & ~(align - 1);
+
+        if (m_blocks.empty() || offset + size > m_capacity)
+        {
+            m_capacity = size > BlockSize ? size : BlockSize;
+            m_blocks.push_back(std::make_unique<std::byte[]>(m_capacity));
+            offset = 0;
+        }
+
+        m_used = offset + size;
+        m_allocated += size;
+        m_references.fetch_add(1, std::memory_order_relaxed);
+        return m_blocks.back().get() + offset;
+    }
+
+    // Drops the owner's reference or a freed node's
+    void release()
+    {
+        if (m_references.fetch_sub(1, std::memory_order_acq_rel) == 1) delete this;
+    }
+
+    // The source the tokens of the nodes point into, released with the arena
+    Lexer::Sources::Handle source;
+
+    size_t bytesAllocated() const { return m_allocated; }
+    size_t blockCount() const { return m_blocks.size(); }
+
+private:
+    std::vector<std::unique_ptr<std::byte[]>> m_blocks;
+    size_t m_capacity = 0;
+    size_t m_used = 0;
+    size_t m_allocated = 0;
+    // The owner's, plus one per node still alive
+    std::atomic<size_t> m_references = 1;
+};
+
+struct ArenaRelease
+{
+    void operator()(Arena* arena) const { arena->release(); }
+};
+
+using ArenaPtr = std::unique_ptr<Arena, ArenaRelease>;
+
+// Used with std::allocate_shared, so a node and its control block sit next to each other in the arena.
+// The control block keeps a copy of the allocator, so it holds a plain pointer rather than a reference count
+template <typename T>
+class ArenaAllocator
+{
+public:
+    using value_type = T;
+
+    explicit ArenaAllocator(Arena* arena) : m_arena(arena) {}
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : m_arena(other.arena()) {}
+
+    T* allocate(size_t n)
+    {
+        return static_cast<T*>(m_arena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T*, size_t) { m_arena->release(); }
+
+    Arena* arena() const { return m_arena; }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const { return m_arena == other.arena(); }
+
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const { return m_arena != other.arena(); }
+
+private:
+    Arena* m_arena;
+};
+
+} // namespace Probescript::AST
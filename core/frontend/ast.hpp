@@ -1,11 +1,15 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <vector>
 #include <string>
 #include <iostream>
 #include <memory>
 
 #include "frontend/lexer.hpp"
+#include "frontend/arena.hpp"
+#include "frontend/symbol.hpp"
 
 namespace Probescript::AST
 {
@@ -53,6 +57,99 @@ enum NodeType {
 
 struct Expr;
 
+// Operators are resolved from their source text once, when the node is built
+enum class Operator {
+    Add,
+    Sub,
+    Mul,
+    Div,
+    Mod,
+    Equal,
+    NotEqual,
+    Less,
+    Greater,
+    LessEqual,
+    GreaterEqual,
+    And,
+    Or,
+    Not,
+    Assign,
+    AddAssign,
+    SubAssign,
+    MulAssign,
+    DivAssign,
+    Increment,
+    Decrement,
+    Unknown,
+};
+
+inline Operator toOperator(const std::string& op)
+{
+    if (op == "+") return Operator::Add;
+    if (op == "-") return Operator::Sub;
+    if (op == "*") return Operator::Mul;
+    if (op == "/") return Operator::Div;
+    if (op == "%") return Operator::Mod;
+    if (op == "==") return Operator::Equal;
+    if (op == "!=") return Operator::NotEqual;
+    if (op == "<") return Operator::Less;
+    if (op == ">") return Operator::Greater;
+    if (op == "<=") return Operator::LessEqual;
+    if (op == ">=") return Operator::GreaterEqual;
+    if (op == "&&") return Operator::And;
+    if (op == "||") return Operator::Or;
+    if (op == "!") return Operator::Not;
+    if (op == "=") return Operator::Assign;
+    if (op == "+=") return Operator::AddAssign;
+    if (op == "-=") return Operator::SubAssign;
+    if (op == "*=") return Operator::MulAssign;
+    if (op == "/=") return Operator::DivAssign;
+    if (op == "++") return Operator::Increment;
+    if (op == "--") return Operator::Decrement;
+    return Operator::Unknown;
+}
+
+// The arithmetic behind a compound assignment, increment or decrement
+inline Operator arithmeticOf(Operator op)
+{
+    switch (op)
+    {
+        case Operator::AddAssign:
+        case Operator::Increment:
+            return Operator::Add;
+        case Operator::SubAssign:
+        case Operator::Decrement:
+            return Operator::Sub;
+        case Operator::MulAssign:
+            return Operator::Mul;
+        case Operator::DivAssign:
+            return Operator::Div;
+        default:
+            return op;
+    }
+}
+
+// Variable layout of a runtime scope, filled in by the resolver. Slot i holds names[i]
+struct Scope {
+    std::vector<std::string> names;
+
+    int find(const std::string& name) const
+    {
+        for (size_t i = 0; i < names.size(); i++)
+            if (names[i] == name) return i;
+
+        return -1;
+    }
+};
+
+// Lexical address of a variable: `slot` in the scope `depth` levels up.
+// `scope` is null when the resolver could not place the variable, it is then looked up by name
+struct Address {
+    const Scope* scope = nullptr;
+    int depth = 0;
+    int slot = -1;
+};
+
 struct Stmt {
     Lexer::Token token = Lexer::Token();
     NodeType kind;
@@ -66,6 +163,9 @@ struct ProgramType : public Stmt {
     ProgramType() : Stmt(NodeType::Program) {}
     ProgramType(std::vector<std::shared_ptr<Stmt>> body) : Stmt(NodeType::Program), body(body) {}
     std::vector<std::shared_ptr<Stmt>> body;
+    std::shared_ptr<Scope> scope = std::make_shared<Scope>();
+    // Backing storage for every node the parser built for this program
+    ArenaPtr arena;
 };
 
 struct ReturnStmtType : public Stmt {
@@ -83,27 +183,28 @@ struct Expr : public Stmt {
 };
 
 struct VarDeclarationType : public Stmt {
-    VarDeclarationType(std::shared_ptr<Expr> value, std::string ident, bool constant = false)
+    VarDeclarationType(std::shared_ptr<Expr> value, Symbol ident, bool constant = false)
         : Stmt(NodeType::VarDeclaration),
           value(value),
-          identifier(std::move(ident)),
+          identifier(ident),
           constant(constant),
           staticType(false),
           type(nullptr) {}
 
-    VarDeclarationType(std::shared_ptr<Expr> value, std::string ident, std::shared_ptr<Expr> type)
+    VarDeclarationType(std::shared_ptr<Expr> value, Symbol ident, std::shared_ptr<Expr> type)
         : Stmt(NodeType::VarDeclaration),
           value(value),
-          identifier(std::move(ident)),
+          identifier(ident),
           constant(false),
           staticType(true),
           type(type) {}
 
     std::shared_ptr<Expr> value;
-    std::string identifier;
+    Symbol identifier;
     bool constant;
     bool staticType;
     std::shared_ptr<Expr> type;
+    Address address;
 };
 
 struct UndefinedLiteralType : public Expr {
@@ -114,16 +215,18 @@ struct UndefinedLiteralType : public Expr {
 };
 
 struct FunctionDeclarationType : public Stmt {
-    FunctionDeclarationType(std::vector<std::shared_ptr<VarDeclarationType>> params, std::string name, std::vector<std::shared_ptr<Stmt>> body, bool isAsync = false) : Stmt(NodeType::FunctionDeclaration), parameters(params), name(name), body(body), isAsync(isAsync) {}
-    FunctionDeclarationType(std::vector<std::shared_ptr<VarDeclarationType>> params, std::string name, std::vector<std::shared_ptr<Stmt>> body, std::shared_ptr<Expr> rettype, bool isAsync = false) : Stmt(NodeType::FunctionDeclaration), parameters(params), name(name), body(body), rettype(rettype), staticRet(true), isAsync(isAsync) {}
+    FunctionDeclarationType(std::vector<std::shared_ptr<VarDeclarationType>> params, Symbol name, std::vector<std::shared_ptr<Stmt>> body, bool isAsync = false) : Stmt(NodeType::FunctionDeclaration), parameters(params), name(name), body(body), isAsync(isAsync) {}
+    FunctionDeclarationType(std::vector<std::shared_ptr<VarDeclarationType>> params, Symbol name, std::vector<std::shared_ptr<Stmt>> body, std::shared_ptr<Expr> rettype, bool isAsync = false) : Stmt(NodeType::FunctionDeclaration), parameters(params), name(name), body(body), rettype(rettype), staticRet(true), isAsync(isAsync) {}
 
     bool staticRet = false;
     std::shared_ptr<Expr> rettype = std::make_shared<UndefinedLiteralType>();
     std::vector<std::shared_ptr<VarDeclarationType>> parameters;
     std::vector<std::shared_ptr<VarDeclarationType>> templateparams = {};
-    std::string name;
+    Symbol name;
     std::vector<std::shared_ptr<Stmt>> body;
     bool isAsync = false;
+    Address address;
+    std::shared_ptr<Scope> scope = std::make_shared<Scope>();
 };
 
 struct ExportStmtType : public Stmt {
@@ -146,6 +249,7 @@ struct ImportStmtType : public Stmt {
     bool customIdent = false;
     std::string name;
     std::string ident;
+    Address address;
 };
 
 struct WhileStmtType : public Stmt {
@@ -153,6 +257,7 @@ struct WhileStmtType : public Stmt {
         : Stmt(NodeType::WhileStmt), condition(condition), body(body) {}
         std::shared_ptr<Expr> condition;
         std::vector<std::shared_ptr<Stmt>> body;
+        std::shared_ptr<Scope> scope = std::make_shared<Scope>();
     };
 
 struct ProbeDeclarationType : public Stmt {
@@ -163,6 +268,8 @@ struct ProbeDeclarationType : public Stmt {
     std::string name;
     std::shared_ptr<Expr> extends;
     std::vector<std::shared_ptr<Stmt>> body;
+    Address address;
+    std::shared_ptr<Scope> scope = std::make_shared<Scope>();
 };
 
 
@@ -172,6 +279,10 @@ struct ForStmtType : public Stmt {
     std::vector<std::shared_ptr<Expr>> updates;
     std::vector<std::shared_ptr<Stmt>> body;
 
+    // The declarations live in an outer scope, a fresh inner scope is created for each iteration
+    std::shared_ptr<Scope> declScope = std::make_shared<Scope>();
+    std::shared_ptr<Scope> scope = std::make_shared<Scope>();
+
     ForStmtType(std::vector<std::shared_ptr<Stmt>> decl, std::vector<std::shared_ptr<Expr>> cond, std::vector<std::shared_ptr<Expr>> update, std::vector<std::shared_ptr<Stmt>> body)
         : declarations(decl), conditions(cond), updates(update), body(body), Stmt(NodeType::ForStmt) {}
 };
@@ -183,21 +294,25 @@ struct IfStmtType : public Stmt {
     std::vector<std::shared_ptr<Stmt>> body;
     std::vector<std::shared_ptr<Stmt>> elseStmt;
     bool hasElse = false;
+    std::shared_ptr<Scope> scope = std::make_shared<Scope>();
+    std::shared_ptr<Scope> elseScope = std::make_shared<Scope>();
 };
 
 struct TryStmtType : public Stmt {
     std::vector<std::shared_ptr<Stmt>> body;
     std::shared_ptr<FunctionDeclarationType> catchHandler;
+    std::shared_ptr<Scope> scope = std::make_shared<Scope>();
 
     TryStmtType(std::vector<std::shared_ptr<Stmt>> body, std::shared_ptr<FunctionDeclarationType> catchHandler) : Stmt(NodeType::TryStmt), body(body), catchHandler(catchHandler) {}
 };
 
 struct AssignmentExprType : public Expr {
-    AssignmentExprType(std::shared_ptr<Expr> assigne, std::shared_ptr<Expr> value, std::string op) : Expr(NodeType::AssignmentExpr), assigne(assigne), value(value), op(op) {}
+    AssignmentExprType(std::shared_ptr<Expr> assigne, std::shared_ptr<Expr> value, std::string op) : Expr(NodeType::AssignmentExpr), assigne(assigne), value(value), op(op), opType(toOperator(op)) {}
 
     std::shared_ptr<Expr> assigne;
     std::shared_ptr<Expr> value;
     std::string op;
+    Operator opType;
 };
 
 struct TemplateArgumentType : public Expr {
@@ -241,25 +356,30 @@ struct UnaryPostFixType : public Expr {
     std::string op;
     std::shared_ptr<Expr> assigne;
 
+    Operator opType;
+
     UnaryPostFixType(std::string op, std::shared_ptr<Expr> assigne)
-        : op(op), assigne(assigne), Expr(NodeType::UnaryPostFix) {}
+        : op(op), opType(toOperator(op)), assigne(assigne), Expr(NodeType::UnaryPostFix) {}
 };
 
 struct UnaryPrefixType : public Expr {
     std::string op;
     std::shared_ptr<Expr> assigne;
 
+    Operator opType;
+
     UnaryPrefixType(std::string op, std::shared_ptr<Expr> assigne)
-        : op(op), assigne(assigne), Expr(NodeType::UnaryPrefix) {}
+        : op(op), opType(toOperator(op)), assigne(assigne), Expr(NodeType::UnaryPrefix) {}
 };
 
 struct BinaryExprType : public Expr {
     BinaryExprType(std::shared_ptr<Expr> left, std::shared_ptr<Expr> right, const std::string& op) 
-        : Expr(NodeType::BinaryExpr), left(left), right(right), op(op) {}
+        : Expr(NodeType::BinaryExpr), left(left), right(right), op(op), opType(toOperator(op)) {}
 
     std::shared_ptr<Expr> left;
     std::shared_ptr<Expr> right;
     std::string op;
+    Operator opType;
     
     std::string value() const override {
         return left->toString() + " " + op + " " + right->toString();
@@ -267,10 +387,11 @@ struct BinaryExprType : public Expr {
 };
 
 struct IdentifierType : public Expr {
-    IdentifierType(const std::string& symbol) 
+    IdentifierType(Symbol symbol) 
         : Expr(NodeType::Identifier), symbol(symbol) {}
 
-    std::string symbol;
+    Symbol symbol;
+    Address address;
     
     std::string value() const override {
         return symbol;
@@ -316,15 +437,16 @@ struct ClassDefinitionType : public Stmt {
     std::vector<std::shared_ptr<Stmt>> body;
     std::shared_ptr<Expr> extends;
     bool doesExtend = false;
+    Address address;
 };
 
 struct PropertyLiteralType : public Expr {
-    PropertyLiteralType(std::string key, std::shared_ptr<Expr> val) : Expr(NodeType::PropertyLiteral), key(key), val(val) {}
+    PropertyLiteralType(Symbol key, std::shared_ptr<Expr> val) : Expr(NodeType::PropertyLiteral), key(key), val(val) {}
     std::string value() const override {
         return "null";
     };
 
-    std::string key;
+    Symbol key;
     std::shared_ptr<Expr> val;
 };
 
@@ -346,6 +468,7 @@ struct ArrayLiteralType : public Expr {
 struct ArrowFunctionType : public Expr {
     std::vector<std::shared_ptr<VarDeclarationType>> params;
     std::vector<std::shared_ptr<Stmt>> body;
+    std::shared_ptr<Scope> scope = std::make_shared<Scope>();
 
     ArrowFunctionType(std::vector<std::shared_ptr<VarDeclarationType>> params, std::vector<std::shared_ptr<Stmt>> body) :
         Expr(NodeType::ArrowFunction), params(params), body(body) {}
@@ -364,22 +487,36 @@ struct CallExprType : public Expr {
     std::shared_ptr<Expr> calee;
 };
 
+// Remembers the slot a property was found at for the last few object shapes seen at one member site.
+// Each entry packs a Values::Shape id in the upper 32 bits and the slot in the lower ones, 0 is empty
+struct InlineCache {
+    static constexpr int Size = 4;
+    mutable std::atomic<uint64_t> entries[Size] = {};
+
+    InlineCache() = default;
+    InlineCache(const InlineCache&) {}
+    InlineCache& operator=(const InlineCache&) { return *this; }
+};
+
 struct MemberExprType : public Expr {
     MemberExprType(std::shared_ptr<Expr> object = std::make_shared<Expr>(), std::shared_ptr<Expr> property = std::make_shared<Expr>(), bool computed = false) : Expr(NodeType::MemberExpr), object(object), property(property), computed(computed) {}
-    MemberExprType(std::shared_ptr<Expr> object, std::shared_ptr<Expr> property, bool computed, std::string lastProp) : Expr(NodeType::MemberExpr), object(object), property(property), computed(computed), lastProp(lastProp) {}
+    MemberExprType(std::shared_ptr<Expr> object, std::shared_ptr<Expr> property, bool computed, Symbol lastProp) : Expr(NodeType::MemberExpr), object(object), property(property), computed(computed), lastProp(lastProp) {}
     std::shared_ptr<Expr> object;
     std::shared_ptr<Expr> property;
-    std::string lastProp;
+    Symbol lastProp;
     bool computed;
+    InlineCache cache;
 };
 
 struct MemberAssignmentType : public Expr {
     MemberAssignmentType(std::shared_ptr<Expr> obj, std::shared_ptr<Expr> property, std::shared_ptr<Expr> value, bool computed, std::string op) :
-        Expr(NodeType::MemberAssignment), object(obj), newvalue(value),property(property), computed(computed), op(op) {}
+        Expr(NodeType::MemberAssignment), object(obj), newvalue(value),property(property), computed(computed), op(op), opType(toOperator(op)) {}
     std::shared_ptr<Expr> object;
     std::shared_ptr<Expr> property;
     std::shared_ptr<Expr> newvalue;
     std::string op;
+    Operator opType;
+    InlineCache cache;
     bool computed;
 };
 
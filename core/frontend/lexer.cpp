@@ -1,195 +1,221 @@
+#include <array>
+
 #include "frontend/lexer.hpp"
 
 using namespace Probescript;
 using namespace Probescript::Lexer;
 
-std::vector<Token> Lexer::tokenize(const std::string& sourceCode)
+namespace
 {
-    std::vector<Token> tokens;
-    std::vector<std::string> src = splitToChars(sourceCode);
-    int line = 1;
-    int col = 1;
 
-    std::unordered_map<std::string, TokenType> keywords = getKeyWords();
+enum CharClass : uint8_t
+{
+    Other,
+    Space,
+    Digit,
+    Alpha,
+    Quote,
+    Punct,
+};
+
+constexpr std::array<CharClass, 256> makeClasses()
+{
+    std::array<CharClass, 256> classes {};
+
+    for (unsigned char c : { ' ', '\t', '\r', '\n' }) classes[c] = Space;
+    for (unsigned char c = '0'; c <= '9'; c++) classes[c] = Digit;
+    for (unsigned char c = 'a'; c <= 'z'; c++) classes[c] = Alpha;
+    for (unsigned char c = 'A'; c <= 'Z'; c++) classes[c] = Alpha;
+    classes['_'] = Alpha;
+    classes['"'] = Quote;
+    classes['\''] = Quote;
+    for (unsigned char c : { '(', ')', '{', '}', '[', ']', ',', ':', '.', ';', '+', '-', '*', '/', '%', '=', '<', '>', '!', '?', '&', '|' }) classes[c] = Punct;
+
+    return classes;
+}
+
+constexpr std::array<CharClass, 256> g_classes = makeClasses();
+
+inline CharClass classOf(char c)
+{
+    return g_classes[static_cast<unsigned char>(c)];
+}
 
-    std::unordered_map<std::string, TokenType> singleCharTokens =
+// Single character tokens, indexed by the character
+constexpr std::array<int, 256> makeSingleCharTokens()
+{
+    std::array<int, 256> tokens {};
+    for (int& type : tokens) type = -1;
+
+    tokens['('] = OpenParen; tokens[')'] = ClosedParen;
+    tokens['{'] = OpenBrace; tokens['}'] = ClosedBrace;
+    tokens['['] = OpenBracket; tokens[']'] = CloseBracket;
+    tokens[','] = Comma; tokens[':'] = Colon; tokens['.'] = Dot;
+    tokens['+'] = BinaryOperator; tokens['-'] = BinaryOperator;
+    tokens['*'] = BinaryOperator; tokens['/'] = BinaryOperator;
+    tokens['%'] = BinaryOperator; tokens['='] = Equals;
+    tokens['<'] = LessThan; tokens['>'] = GreaterThan;
+    tokens['!'] = Bang; tokens['?'] = Ternary;
+    tokens[';'] = Semicolon;
+
+    return tokens;
+}
+
+constexpr std::array<int, 256> g_singleCharTokens = makeSingleCharTokens();
+
+// Two character operators, keyed by their first character
+int twoCharToken(char first, char second)
+{
+    switch (first)
     {
-        { "(", OpenParen }, { ")", ClosedParen },
-        { "{", OpenBrace }, { "}", ClosedBrace },
-        { "[", OpenBracket }, { "]", CloseBracket },
-        { ",", Comma }, { ":", Colon }, { ".", Dot },
-        { "+", BinaryOperator }, { "-", BinaryOperator },
-        { "*", BinaryOperator }, { "/", BinaryOperator },
-        { "%", BinaryOperator }, { "=", Equals },
-        { "<", LessThan}, { ">", GreaterThan },
-        { "!", Bang }, { "?", Ternary },
-    };
+        case '&': return second == '&' ? AndOperator : -1;
+        case '|': return second == '|' ? OrOperator : -1;
+        case '=':
+            if (second == '=') return DoubleEquals;
+            if (second == '>') return Arrow;
+            return -1;
+        case '!': return second == '=' ? NotEquals : -1;
+        case '<':
+        case '>':
+            return second == '=' ? BinaryOperator : -1;
+        case '+':
+            if (second == '=') return AssignmentOperator;
+            if (second == '+') return Increment;
+            return -1;
+        case '-':
+            if (second == '=') return AssignmentOperator;
+            if (second == '-') return Decrement;
+            return -1;
+        case '*':
+        case '/':
+            return second == '=' ? AssignmentOperator : -1;
+        default:
+            return -1;
+    }
+}
 
-    std::vector<std::pair<std::string, TokenType>> multiCharTokens =
+} // namespace
+
+std::vector<Token> Lexer::tokenize(std::string_view src, uint32_t file)
+{
+    const std::unordered_map<std::string, TokenType>& keywords = getKeyWords();
+
+    std::vector<Token> tokens;
+    tokens.reserve(src.size() / 4);
+
+    size_t size = src.size();
+    size_t i = 0;
+
+    auto digitAt = [&](size_t index) { return index < size && classOf(src[index]) == Digit; };
+    auto push = [&](std::string value, TokenType type, size_t start)
     {
-        { "&&", AndOperator },
-        { "||", OrOperator },
-        { "==", DoubleEquals },
-        { "!=", NotEquals },
-        { "<=", BinaryOperator },
-        { ">=", BinaryOperator },
-        { "+=", AssignmentOperator },
-        { "-=", AssignmentOperator },
-        { "*=", AssignmentOperator },
-        { "/=", AssignmentOperator },
-        { "++", Increment },
-        { "--", Decrement },
-        { "=>", Arrow },
+        tokens.push_back({ std::move(value), type, file, static_cast<uint32_t>(start) });
     };
 
-    while (!src.empty())
+    while (i < size)
     {
-        if (src[0] == "\n")
-        {
-            line++;
-            col = 1;
-            shift(src);
-            continue;
-        }
+        char c = src[i];
 
-        if (isSkippable(src[0]))
+        switch (classOf(c))
         {
-            if (src[0] != "") col++;
-            shift(src);
-            continue;
-        }
+            case Space:
+                i++;
+                continue;
 
-        if (src[0] == ";")
-        {
-            col++;
-            tokens.push_back(token(shift(src), Semicolon, { line, col }));
-            continue;
-        }
-
-        if (!src.empty() && src[0] == "/" && src.size() > 1 && src[1] == "/")
-        {
-            shift(src);
-            shift(src);
-            col += 2;
-            while (!src.empty() && src[0] != "\n")
+            case Alpha:
             {
-                col++;
-                shift(src);
-            }
-            continue;
-        }        
-
-        if (isInt(src[0]) || ((src[0] == "-" || src[0] == ".") && isInt(src[1])))
-        {
-            std::string num = "";
-            int tokenLine = line;
-            int tokenCol = col;
+                size_t start = i;
+                while (i < size && classOf(src[i]) == Alpha) i++;
 
-            while (!src.empty() && (isInt(src[0]) || ((src[0] == "-" || src[0] == ".") && isInt(src[1]))))
-            {
-                col++;
-                num += shift(src);
+                std::string ident(src.substr(start, i - start));
+                auto keyword = keywords.find(ident);
+                push(std::move(ident), keyword != keywords.end() ? keyword->second : Identifier, start);
+                continue;
             }
 
-            tokens.push_back(token(num, Number, { tokenLine, tokenCol }));
-            continue;
-        }
-
-        bool matchedMulti = false;
-        for (const auto& [symbol, type] : multiCharTokens)
-        {
-            if (src.size() >= symbol.length())
+            case Quote:
             {
-                std::string joined = "";
-                for (size_t i = 0; i < symbol.length(); ++i)
-                    joined += src[i];
+                size_t start = ++i;
+                std::string value;
 
-                if (joined == symbol)
+                while (i < size && src[i] != c)
                 {
-                    int tokenLine = line;
-                    int tokenCol = col;
+                    if (src[i] != '\\')
+                    {
+                        // Copy the plain run up to the next quote or escape in one go
+                        size_t run = i;
+                        while (i < size && src[i] != c && src[i] != '\\') i++;
+                        value.append(src.substr(run, i - run));
+                        continue;
+                    }
 
-                    for (size_t i = 0; i < symbol.length(); ++i)
+                    if (++i >= size) break;
+
+                    switch (src[i++])
                     {
-                        col++;
-                        shift(src);
+                        case 'n': value += '\n'; break;
+                        case 't': value += '\t'; break;
+                        case 'r': value += '\r'; break;
+                        case 'b': value += '\b'; break;
+                        case 'f': value += '\f'; break;
+                        default: value += src[i - 1];
                     }
-                    tokens.push_back(token(symbol, type, { tokenLine, tokenCol }));
-                    matchedMulti = true;
-                    break;
                 }
-            }
-        }
-        if (matchedMulti) continue;
 
-        if (singleCharTokens.find(src[0]) != singleCharTokens.end())
-        {
-            tokens.push_back(token(src[0], singleCharTokens[src[0]], { line, col }));
-            shift(src);
-            col++;
-            continue;
-        }
+                if (i < size) i++;
+                push(std::move(value), String, start);
+                continue;
+            }
 
-        if (src[0] == "\"" || src[0] == "'")
-        {
-            col++;
-            int tokenLine = line;
-            int tokenCol = col;
-            std::string quoteType = shift(src);
-            std::string value = "";
-        
-            while (!src.empty() && src[0] != quoteType)
+            case Digit:
+            case Punct:
             {
-                std::string val = shift(src);
-                col++;
-                if (val == "\\") {
-                    if (src.empty()) break;
-                    col++;
-                    char c = shift(src)[0];
-                    if (c == 'n') value += '\n';
-                    else if (c == 't') value += '\t';
-                    else if (c == '\\') value += '\\';
-                    else if (c == '"') value += '"';
-                    else if (c == '\'') value += '\'';
-                    else if (c == 'r') value += '\r';
-                    else if (c == 'b') value += '\b';
-                    else if (c == 'f') value += '\f';
-                    else value += c;
-                } else {
-                    value += val;
+                // Numbers may start with - or . and continue through them, as long as a digit follows
+                if (classOf(c) == Digit || ((c == '-' || c == '.') && digitAt(i + 1)))
+                {
+                    size_t start = i;
+                    while (i < size && (classOf(src[i]) == Digit || ((src[i] == '-' || src[i] == '.') && digitAt(i + 1)))) i++;
+
+                    push(std::string(src.substr(start, i - start)), Number, start);
+                    continue;
                 }
-            }
-        
-            if (!src.empty()) { shift(src); col++; }
-            tokens.push_back(token(value, String, { tokenLine, tokenCol }));
-            continue;
-        }
 
-        if (isAlpha(src[0]) || src[0] == "_")
-        {
-            std::string ident = "";
-            int l = 0;
-            while (!src.empty() && (isAlpha(src[0]) || src[0] == "_"))
-            {
-                ident += shift(src);
-                l++;
-            }
-            if (keywords.find(ident) != keywords.end())
-            {
-                tokens.push_back(token(ident, keywords[ident], { line, col }));
-            }
-            else
-            {
-                tokens.push_back(token(ident, Identifier, { line, col }));
+                if (c == '/' && i + 1 < size && src[i + 1] == '/')
+                {
+                    while (i < size && src[i] != '\n') i++;
+                    continue;
+                }
+
+                if (i + 1 < size)
+                {
+                    int type = twoCharToken(c, src[i + 1]);
+                    if (type >= 0)
+                    {
+                        push(std::string(src.substr(i, 2)), static_cast<TokenType>(type), i);
+                        i += 2;
+                        continue;
+                    }
+                }
+
+                int type = g_singleCharTokens[static_cast<unsigned char>(c)];
+                if (type >= 0)
+                {
+                    push(std::string(1, c), static_cast<TokenType>(type), i);
+                    i++;
+                    continue;
+                }
+
+                break;
             }
-            col += l;
-            continue;
+
+            default:
+                break;
         }
 
-        throw std::runtime_error("Unrecognized character in source: '" + src[0] + "'\n");
+        throw std::runtime_error("Unrecognized character in source: '" + std::string(1, c) + "'\n");
     }
 
-    tokens.push_back(token("EndOfFile", END, { line, col }));
+    push("EndOfFile", END, size);
 
     return tokens;
-}
\ No newline at end of file
+}
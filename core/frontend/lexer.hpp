@@ -1,11 +1,13 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <vector>
 #include <unordered_map>
 #include <iostream>
 
 #include "utils.hpp"
 #include "context.hpp"
+#include "frontend/sources.hpp"
 
 namespace Probescript::Lexer
 {
@@ -73,38 +75,16 @@ struct Token
     std::string value;
     TokenType type;
 
-    int line = 0;
-    int col = 0;
-    std::string file;
-    std::shared_ptr<Context> ctx = std::make_shared<Context>();
-};
-
-inline Token token(const std::string& value, const TokenType type, const std::pair<int, int> pos)
-{
-    int line = pos.first;
-    int col = pos.second;
-    
-    return { value, type, line, col };
-}
-
-inline bool isAlpha(const std::string& str)
-{
-    return (str[0] >= 'a' && str[0] <= 'z') || (str[0] >= 'A' && str[0] <= 'Z');
-}
+    // Id in the source table and byte offset into that source
+    uint32_t file = 0;
+    uint32_t offset = 0;
 
-inline bool isInt(const std::string& str)
-{
-    return str.length() == 1 && isdigit(str[0]);
-}
-
-inline bool isSkippable(const std::string str)
-{
-    return str == " " || str == "\t" || str == "\r" || str == "";
-}
+    Location location() const { return Sources::locate(file, offset); }
+};
 
-inline std::unordered_map<std::string, TokenType> getKeyWords()
+inline const std::unordered_map<std::string, TokenType>& getKeyWords()
 {
-    static std::unordered_map<std::string, TokenType> keywords =
+    static const std::unordered_map<std::string, TokenType> keywords =
     {
         { "var", Probescript::Lexer::TokenType::Var },
         { "null", Probescript::Lexer::TokenType::Null },
@@ -138,6 +118,8 @@ inline std::unordered_map<std::string, TokenType> getKeyWords()
     return keywords;
 }
 
-std::vector<Token> tokenize(const std::string& sourceCode);
+// Scans the source once. Token values are copied out of the source, identifiers and
+// operators are short enough that this does not allocate
+std::vector<Token> tokenize(std::string_view sourceCode, uint32_t file = 0);
 
 } // namespace Probescript::Lexer
\ No newline at end of file
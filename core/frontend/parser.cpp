@@ -5,16 +5,23 @@ using namespace Probescript;
 
 std::shared_ptr<AST::ProgramType> Parser::parse(std::string& sourceCode, std::shared_ptr<Context> ctx)
 {
-    tokens = Lexer::tokenize(sourceCode);
+    Lexer::Sources::Handle source = Lexer::Sources::add(ctx->filename, sourceCode);
+    tokens = Lexer::tokenize(sourceCode, Lexer::Sources::id(source));
+    pos = 0;
     file = sourceCode;
     context = ctx;
     auto program = std::make_shared<AST::ProgramType>();
+    program->arena.reset(new AST::Arena());
+    program->arena->source = std::move(source);
+    arena = program->arena.get();
 
     while (notEOF())
     {
         program->body.push_back(parseStmt());
     }
 
+    Resolver().resolve(program);
+
     return program;
 }
 
@@ -313,7 +320,7 @@ std::shared_ptr<AST::Stmt> Parser::parseIfStmt()
     Token lastToken = eat();
     if (lastToken.type != Lexer::ClosedParen)
     {
-        throw std::runtime_error(SyntaxError("Expected closing parentheses, recieved " + lastToken.value, lastToken, context));
+        throw std::runtime_error(SyntaxError("Expected closing parentheses, recieved " + lastToken.value, lastToken));
     }
 
     std::vector<std::shared_ptr<AST::Stmt>> body = parseBody();
@@ -350,7 +357,7 @@ std::shared_ptr<AST::VarDeclarationType> Parser::parseVarDeclaration(bool isCons
     {
         if (isConstant)
         {
-            throw std::runtime_error(SyntaxError("Must assign value to constant variable", at(), context));
+            throw std::runtime_error(SyntaxError("Must assign value to constant variable", at()));
         }
 
         if (!hasType)
@@ -656,7 +663,7 @@ std::shared_ptr<AST::Expr> Parser::parseMemberExpr()
 
             if (property->kind != AST::NodeType::Identifier)
             {
-                throw std::runtime_error(SyntaxError("Cannot use dot operator without right hand side being an identifier", op, context));
+                throw std::runtime_error(SyntaxError("Cannot use dot operator without right hand side being an identifier", op));
             }
 
             lastProp = std::static_pointer_cast<AST::IdentifierType>(property)->symbol;
@@ -749,7 +756,7 @@ std::shared_ptr<AST::Expr> Parser::parseMemberChain(std::shared_ptr<AST::Expr> e
             
             if (property->kind != AST::NodeType::Identifier)
             {
-                throw std::runtime_error(SyntaxError("Cannot use dot operator without right hand side being an identifier", op, context));
+                throw std::runtime_error(SyntaxError("Cannot use dot operator without right hand side being an identifier", op));
             }
             
             lastProp = std::static_pointer_cast<AST::IdentifierType>(property)->symbol;
@@ -838,7 +845,7 @@ std::shared_ptr<AST::Expr> Parser::parsePrimaryExpr()
             break;
 
         default:
-            throw std::runtime_error(SyntaxError("Unexpected token found while parsing: " + at().value, at(), context));
+            throw std::runtime_error(SyntaxError("Unexpected token found while parsing: " + at().value, at()));
     }
 
     if (primary->kind == AST::NodeType::Identifier && at().type == Lexer::LessThan)
@@ -998,28 +1005,33 @@ std::vector<std::shared_ptr<AST::Stmt>> Parser::parseBody(bool methods, std::str
     }
 }
 
-Lexer::Token Parser::at(int index)
+// Looking past the end keeps returning the END token
+const Lexer::Token& Parser::at(int index)
 {
-    return tokens[index];
+    return pos + index < tokens.size() ? tokens[pos + index] : tokens.back();
 }
 
-Lexer::Token Parser::next()
+const Lexer::Token& Parser::next()
 {
-    return tokens[1];
+    return at(1);
 }
 
 Lexer::Token Parser::eat()
 {
-    Lexer::Token prev = shift(tokens);
-    return prev;
+    if (pos >= tokens.size())
+    {
+        throw std::runtime_error("[EmptyVectorShiftError]: Cannot shift an empty vector");
+    }
+
+    return tokens[pos++];
 }
 
 Lexer::Token Parser::expect(Lexer::TokenType type, std::string err)
 {
-    Lexer::Token prev = shift(tokens);
+    Lexer::Token prev = eat();
     if (prev.type != type)
     {
-        throw std::runtime_error(SyntaxError(err, prev, context));
+        throw std::runtime_error(SyntaxError(err, prev));
     }
 
     return prev;
@@ -1027,9 +1039,9 @@ Lexer::Token Parser::expect(Lexer::TokenType type, std::string err)
 
 std::string Parser::getCurrentLine(Lexer::Token at)
 {
-    return split(file, "\n")[at.line - 1];
+    return split(file, "\n")[at.location().line - 1];
 }
 
 bool Parser::notEOF() {
-    return tokens[0].type != Lexer::END;
+    return at().type != Lexer::END;
 }
\ No newline at end of file
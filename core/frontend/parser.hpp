@@ -10,6 +10,7 @@
 #include "context.hpp"
 #include "frontend/ast.hpp"
 #include "frontend/lexer.hpp"
+#include "frontend/resolver.hpp"
 
 namespace Probescript
 {
@@ -21,8 +22,12 @@ public:
 
 private:
     std::vector<Lexer::Token> tokens;
+    // Index of the current token, tokens before it have been consumed
+    size_t pos = 0;
     std::string file;
     std::shared_ptr<Context> context;
+    // Owned by the program being parsed
+    AST::Arena* arena = nullptr;
 
     // Statement methods
 
@@ -110,9 +115,9 @@ private:
 
     std::shared_ptr<AST::VarDeclarationType> parseParam();
 
-    Lexer::Token at(int index = 0);
+    const Lexer::Token& at(int index = 0);
 
-    Lexer::Token next();
+    const Lexer::Token& next();
 
     Lexer::Token eat();
 
@@ -125,8 +130,7 @@ private:
 
     template<typename T, typename... Args>
     std::shared_ptr<T> newnode(Lexer::Token tok, Args&&... args) {
-        std::shared_ptr<T> node = std::make_shared<T>(std::forward<Args>(args)...);
-        tok.ctx = context;
+        std::shared_ptr<T> node = std::allocate_shared<T>(AST::ArenaAllocator<T>(arena), std::forward<Args>(args)...);
         node->token = tok;
         return node;
     }
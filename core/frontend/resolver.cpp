@@ -0,0 +1,386 @@
+#include "frontend/resolver.hpp"
+
+using namespace Probescript;
+
+void Resolver::resolve(std::shared_ptr<AST::ProgramType> program)
+{
+    m_frames.clear();
+
+    push(program->scope);
+    declareBody(program->body);
+    resolveBody(program->body);
+    pop();
+}
+
+void Resolver::push(std::shared_ptr<AST::Scope> scope, bool opaque)
+{
+    m_frames.push_back({ scope.get(), opaque });
+}
+
+void Resolver::pushBarrier()
+{
+    m_frames.push_back({ nullptr, true });
+}
+
+void Resolver::pop()
+{
+    m_frames.pop_back();
+}
+
+AST::Address Resolver::declare(const std::string& name)
+{
+    AST::Address address;
+    AST::Scope* scope = m_frames.back().scope;
+    if (!scope) return address;
+
+    address.scope = scope;
+    address.slot = scope->find(name);
+
+    if (address.slot < 0)
+    {
+        address.slot = scope->names.size();
+        scope->names.push_back(name);
+    }
+
+    return address;
+}
+
+AST::Address Resolver::lookup(const std::string& name)
+{
+    int depth = 0;
+
+    for (auto frame = m_frames.rbegin(); frame != m_frames.rend(); ++frame)
+    {
+        if (!frame->scope) break;
+
+        int slot = frame->scope->find(name);
+        if (slot >= 0)
+        {
+            AST::Address address;
+            address.scope = frame->scope;
+            address.depth = depth;
+            address.slot = slot;
+            return address;
+        }
+
+        if (frame->opaque) break;
+        depth++;
+    }
+
+    return AST::Address();
+}
+
+// Slots are reserved for every declaration in a body up front, so that closures see
+// variables declared after them. Reading a slot before its declaration has run falls
+// back to the by-name lookup, which keeps the old shadowing behaviour
+void Resolver::declareBody(const std::vector<std::shared_ptr<AST::Stmt>>& body, bool probeBody)
+{
+    for (std::shared_ptr<AST::Stmt> stmt : body)
+        declareStmt(stmt, probeBody);
+}
+
+void Resolver::declareStmt(std::shared_ptr<AST::Stmt> stmt, bool probeBody)
+{
+    switch (stmt->kind)
+    {
+        case AST::NodeType::VarDeclaration:
+        {
+            std::shared_ptr<AST::VarDeclarationType> decl = std::static_pointer_cast<AST::VarDeclarationType>(stmt);
+            decl->address = declare(decl->identifier);
+            break;
+        }
+
+        case AST::NodeType::FunctionDeclaration:
+        {
+            std::shared_ptr<AST::FunctionDeclarationType> fn = std::static_pointer_cast<AST::FunctionDeclarationType>(stmt);
+            fn->address = declare(fn->name);
+
+            // Template arguments are declared next to the function when it is instantiated
+            for (std::shared_ptr<AST::VarDeclarationType> param : fn->templateparams)
+                param->address = declare(param->identifier);
+            break;
+        }
+
+        case AST::NodeType::ClassDefinition:
+        {
+            std::shared_ptr<AST::ClassDefinitionType> cls = std::static_pointer_cast<AST::ClassDefinitionType>(stmt);
+            cls->address = declare(cls->name);
+            break;
+        }
+
+        case AST::NodeType::ProbeDeclaration:
+        {
+            std::shared_ptr<AST::ProbeDeclarationType> probe = std::static_pointer_cast<AST::ProbeDeclarationType>(stmt);
+            probe->address = declare(probe->name);
+            break;
+        }
+
+        case AST::NodeType::ImportStmt:
+        {
+            std::shared_ptr<AST::ImportStmtType> import = std::static_pointer_cast<AST::ImportStmtType>(stmt);
+            std::string name = import->customIdent
+                ? import->ident
+                : import->hasMember ? std::static_pointer_cast<AST::MemberExprType>(import->module)->lastProp.str() : import->name;
+
+            import->address = declare(name);
+            break;
+        }
+
+        case AST::NodeType::ExportStmt:
+            declareStmt(std::static_pointer_cast<AST::ExportStmtType>(stmt)->exporting, probeBody);
+            break;
+
+        case AST::NodeType::AssignmentExpr:
+        {
+            // Probe bodies declare their fields by assigning to them
+            std::shared_ptr<AST::AssignmentExprType> assign = std::static_pointer_cast<AST::AssignmentExprType>(stmt);
+            if (probeBody && assign->assigne->kind == AST::NodeType::Identifier)
+                declare(std::static_pointer_cast<AST::IdentifierType>(assign->assigne)->symbol);
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+void Resolver::resolveBody(const std::vector<std::shared_ptr<AST::Stmt>>& body)
+{
+    for (std::shared_ptr<AST::Stmt> stmt : body)
+        resolveStmt(stmt);
+}
+
+void Resolver::resolveScope(std::shared_ptr<AST::Scope> scope, const std::vector<std::shared_ptr<AST::Stmt>>& body)
+{
+    push(scope);
+    declareBody(body);
+    resolveBody(body);
+    pop();
+}
+
+void Resolver::resolveFunction(std::shared_ptr<AST::Scope> scope, std::vector<std::shared_ptr<AST::VarDeclarationType>>& params, const std::vector<std::shared_ptr<AST::Stmt>>& body)
+{
+    push(scope);
+
+    // Default values are evaluated in the caller's environment, so they are left unresolved
+    for (std::shared_ptr<AST::VarDeclarationType> param : params)
+        param->address = declare(param->identifier);
+
+    declareBody(body);
+    resolveBody(body);
+    pop();
+}
+
+void Resolver::resolveStmt(std::shared_ptr<AST::Stmt> stmt)
+{
+    if (!stmt) return;
+
+    switch (stmt->kind)
+    {
+        case AST::NodeType::Identifier:
+        {
+            std::shared_ptr<AST::IdentifierType> ident = std::static_pointer_cast<AST::IdentifierType>(stmt);
+            ident->address = lookup(ident->symbol);
+            break;
+        }
+
+        case AST::NodeType::VarDeclaration:
+            resolveStmt(std::static_pointer_cast<AST::VarDeclarationType>(stmt)->value);
+            break;
+
+        case AST::NodeType::FunctionDeclaration:
+        {
+            std::shared_ptr<AST::FunctionDeclarationType> fn = std::static_pointer_cast<AST::FunctionDeclarationType>(stmt);
+            resolveFunction(fn->scope, fn->parameters, fn->body);
+            break;
+        }
+
+        case AST::NodeType::ArrowFunction:
+        {
+            std::shared_ptr<AST::ArrowFunctionType> fn = std::static_pointer_cast<AST::ArrowFunctionType>(stmt);
+            resolveFunction(fn->scope, fn->params, fn->body);
+            break;
+        }
+
+        case AST::NodeType::ReturnStmt:
+            resolveStmt(std::static_pointer_cast<AST::ReturnStmtType>(stmt)->val);
+            break;
+
+        case AST::NodeType::ThrowStmt:
+            resolveStmt(std::static_pointer_cast<AST::ThrowStmtType>(stmt)->err);
+            break;
+
+        case AST::NodeType::ExportStmt:
+            resolveStmt(std::static_pointer_cast<AST::ExportStmtType>(stmt)->exporting);
+            break;
+
+        case AST::NodeType::WhileStmt:
+        {
+            std::shared_ptr<AST::WhileStmtType> loop = std::static_pointer_cast<AST::WhileStmtType>(stmt);
+            resolveStmt(loop->condition);
+            resolveScope(loop->scope, loop->body);
+            break;
+        }
+
+        case AST::NodeType::ForStmt:
+        {
+            std::shared_ptr<AST::ForStmtType> loop = std::static_pointer_cast<AST::ForStmtType>(stmt);
+
+            push(loop->declScope);
+            declareBody(loop->declarations);
+            resolveBody(loop->declarations);
+
+            push(loop->scope);
+            declareBody(loop->body);
+
+            for (std::shared_ptr<AST::Expr> cond : loop->conditions)
+                resolveStmt(cond);
+
+            resolveBody(loop->body);
+
+            for (std::shared_ptr<AST::Expr> update : loop->updates)
+                resolveStmt(update);
+
+            pop();
+            pop();
+            break;
+        }
+
+        case AST::NodeType::IfStmt:
+        {
+            std::shared_ptr<AST::IfStmtType> ifstmt = std::static_pointer_cast<AST::IfStmtType>(stmt);
+            resolveStmt(ifstmt->condition);
+            resolveScope(ifstmt->scope, ifstmt->body);
+
+            if (ifstmt->hasElse)
+                resolveScope(ifstmt->elseScope, ifstmt->elseStmt);
+            break;
+        }
+
+        case AST::NodeType::TryStmt:
+        {
+            std::shared_ptr<AST::TryStmtType> trystmt = std::static_pointer_cast<AST::TryStmtType>(stmt);
+            resolveScope(trystmt->scope, trystmt->body);
+            resolveFunction(trystmt->catchHandler->scope, trystmt->catchHandler->parameters, trystmt->catchHandler->body);
+            break;
+        }
+
+        case AST::NodeType::ProbeDeclaration:
+        {
+            std::shared_ptr<AST::ProbeDeclarationType> probe = std::static_pointer_cast<AST::ProbeDeclarationType>(stmt);
+            resolveStmt(probe->extends);
+
+            // Inherited members are copied into the probe's environment by name
+            push(probe->scope, probe->doesExtend);
+            declareBody(probe->body, true);
+            resolveBody(probe->body);
+            pop();
+            break;
+        }
+
+        case AST::NodeType::ClassDefinition:
+        {
+            std::shared_ptr<AST::ClassDefinitionType> cls = std::static_pointer_cast<AST::ClassDefinitionType>(stmt);
+            resolveStmt(cls->extends);
+
+            pushBarrier();
+            resolveBody(cls->body);
+            pop();
+            break;
+        }
+
+        case AST::NodeType::AssignmentExpr:
+        {
+            std::shared_ptr<AST::AssignmentExprType> assign = std::static_pointer_cast<AST::AssignmentExprType>(stmt);
+            resolveStmt(assign->assigne);
+            resolveStmt(assign->value);
+            break;
+        }
+
+        case AST::NodeType::MemberAssignment:
+        {
+            std::shared_ptr<AST::MemberAssignmentType> assign = std::static_pointer_cast<AST::MemberAssignmentType>(stmt);
+            resolveStmt(assign->object);
+            if (assign->computed) resolveStmt(assign->property);
+            resolveStmt(assign->newvalue);
+            break;
+        }
+
+        case AST::NodeType::MemberExpr:
+        {
+            std::shared_ptr<AST::MemberExprType> member = std::static_pointer_cast<AST::MemberExprType>(stmt);
+            resolveStmt(member->object);
+            if (member->computed) resolveStmt(member->property);
+            break;
+        }
+
+        case AST::NodeType::CallExpr:
+        {
+            std::shared_ptr<AST::CallExprType> call = std::static_pointer_cast<AST::CallExprType>(stmt);
+            resolveStmt(call->calee);
+            for (std::shared_ptr<AST::Expr> arg : call->args)
+                resolveStmt(arg);
+            break;
+        }
+
+        case AST::NodeType::NewExpr:
+        {
+            std::shared_ptr<AST::NewExprType> newexpr = std::static_pointer_cast<AST::NewExprType>(stmt);
+            resolveStmt(newexpr->constructor);
+            for (std::shared_ptr<AST::Expr> arg : newexpr->args)
+                resolveStmt(arg);
+            break;
+        }
+
+        // Template arguments are evaluated in the function's declaration environment
+        case AST::NodeType::TemplateCall:
+            resolveStmt(std::static_pointer_cast<AST::TemplateCallType>(stmt)->caller);
+            break;
+
+        case AST::NodeType::TernaryExpr:
+        {
+            std::shared_ptr<AST::TernaryExprType> ternary = std::static_pointer_cast<AST::TernaryExprType>(stmt);
+            resolveStmt(ternary->cond);
+            resolveStmt(ternary->cons);
+            resolveStmt(ternary->alt);
+            break;
+        }
+
+        case AST::NodeType::BinaryExpr:
+        {
+            std::shared_ptr<AST::BinaryExprType> binop = std::static_pointer_cast<AST::BinaryExprType>(stmt);
+            resolveStmt(binop->left);
+            resolveStmt(binop->right);
+            break;
+        }
+
+        case AST::NodeType::UnaryPostFix:
+            resolveStmt(std::static_pointer_cast<AST::UnaryPostFixType>(stmt)->assigne);
+            break;
+
+        case AST::NodeType::UnaryPrefix:
+            resolveStmt(std::static_pointer_cast<AST::UnaryPrefixType>(stmt)->assigne);
+            break;
+
+        case AST::NodeType::CastExpr:
+            resolveStmt(std::static_pointer_cast<AST::CastExprType>(stmt)->left);
+            break;
+
+        case AST::NodeType::AwaitExpr:
+            resolveStmt(std::static_pointer_cast<AST::AwaitExprType>(stmt)->caller);
+            break;
+
+        case AST::NodeType::MapLiteral:
+            for (std::shared_ptr<AST::PropertyLiteralType> prop : std::static_pointer_cast<AST::MapLiteralType>(stmt)->properties)
+                resolveStmt(prop->val);
+            break;
+
+        case AST::NodeType::ArrayLiteral:
+            for (std::shared_ptr<AST::Expr> item : std::static_pointer_cast<AST::ArrayLiteralType>(stmt)->items)
+                resolveStmt(item);
+            break;
+
+        default:
+            break;
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "frontend/ast.hpp"
+
+namespace Probescript
+{
+
+// Assigns every identifier a lexical address (depth, slot) so the interpreter can read
+// variables out of flat slot vectors instead of searching each scope by name.
+// The scopes mirror the environments the interpreter creates: one per function call,
+// if/else body, while iteration, for loop (plus one per iteration), try body and probe.
+// Class bodies and other dynamically built environments are barriers: identifiers that
+// would have to be resolved through them are left to the by-name lookup
+class Resolver
+{
+public:
+    void resolve(std::shared_ptr<AST::ProgramType> program);
+
+private:
+    struct Frame
+    {
+        AST::Scope* scope;
+        // Names may be added to an opaque scope at runtime, so lookups do not continue past it
+        bool opaque;
+    };
+
+    std::vector<Frame> m_frames;
+
+    void push(std::shared_ptr<AST::Scope> scope, bool opaque = false);
+    void pushBarrier();
+    void pop();
+
+    AST::Address declare(const std::string& name);
+    AST::Address lookup(const std::string& name);
+
+    void declareBody(const std::vector<std::shared_ptr<AST::Stmt>>& body, bool probeBody = false);
+    void declareStmt(std::shared_ptr<AST::Stmt> stmt, bool probeBody = false);
+
+    void resolveBody(const std::vector<std::shared_ptr<AST::Stmt>>& body);
+    void resolveScope(std::shared_ptr<AST::Scope> scope, const std::vector<std::shared_ptr<AST::Stmt>>& body);
+    void resolveFunction(std::shared_ptr<AST::Scope> scope, std::vector<std::shared_ptr<AST::VarDeclarationType>>& params, const std::vector<std::shared_ptr<AST::Stmt>>& body);
+
+    void resolveStmt(std::shared_ptr<AST::Stmt> stmt);
+};
+
+} // namespace Probescript
@@ -0,0 +1,684 @@
+#include <cstring>
+#include <deque>
+#include <unordered_map>
+
+#include "frontend/serializer.hpp"
+
+using namespace Probescript;
+using namespace Probescript::AST;
+
+namespace
+{
+
+constexpr uint8_t NullNode = 0xFF;
+
+class Writer
+{
+public:
+    std::string out;
+
+    void u8(uint8_t value) { out.push_back(static_cast<char>(value)); }
+    void flag(bool value) { u8(value ? 1 : 0); }
+
+    void u32(uint32_t value)
+    {
+        char bytes[4];
+        std::memcpy(bytes, &value, 4);
+        out.append(bytes, 4);
+    }
+
+    void f64(double value)
+    {
+        char bytes[8];
+        std::memcpy(bytes, &value, 8);
+        out.append(bytes, 8);
+    }
+
+    // Each distinct string is written once, later occurrences are its index
+    void str(const std::string& value)
+    {
+        auto found = m_strings.find(value);
+        if (found != m_strings.end())
+        {
+            u32(found->second);
+            return;
+        }
+
+        uint32_t index = m_strings.size();
+        m_strings.emplace(value, index);
+        u32(index);
+        u32(value.size());
+        out.append(value);
+    }
+
+    void token(const Lexer::Token& tk)
+    {
+        str(tk.value);
+        u8(tk.type);
+        flag(tk.file != 0);
+        u32(tk.offset);
+    }
+
+    template <typename T>
+    void nodes(const std::vector<std::shared_ptr<T>>& list)
+    {
+        u32(list.size());
+        for (const std::shared_ptr<T>& item : list) node(item);
+    }
+
+    void node(const std::shared_ptr<Stmt>& stmt);
+
+private:
+    std::unordered_map<std::string, uint32_t> m_strings;
+};
+
+void Writer::node(const std::shared_ptr<Stmt>& stmt)
+{
+    if (!stmt)
+    {
+        u8(NullNode);
+        return;
+    }
+
+    u8(stmt->kind);
+    token(stmt->token);
+
+    switch (stmt->kind)
+    {
+        case NodeType::ReturnStmt:
+            node(static_cast<const ReturnStmtType&>(*stmt).val);
+            break;
+        case NodeType::VarDeclaration:
+        {
+            const VarDeclarationType& decl = static_cast<const VarDeclarationType&>(*stmt);
+            node(decl.value);
+            str(decl.identifier);
+            flag(decl.constant);
+            flag(decl.staticType);
+            node(decl.type);
+            break;
+        }
+        case NodeType::FunctionDeclaration:
+        {
+            const FunctionDeclarationType& fn = static_cast<const FunctionDeclarationType&>(*stmt);
+            flag(fn.staticRet);
+            node(fn.rettype);
+            nodes(fn.parameters);
+            nodes(fn.templateparams);
+            str(fn.name);
+            nodes(fn.body);
+            flag(fn.isAsync);
+            break;
+        }
+        case NodeType::ExportStmt:
+            node(static_cast<const ExportStmtType&>(*stmt).exporting);
+            break;
+        case NodeType::ThrowStmt:
+            node(static_cast<const ThrowStmtType&>(*stmt).err);
+            break;
+        case NodeType::ImportStmt:
+        {
+            const ImportStmtType& import = static_cast<const ImportStmtType&>(*stmt);
+            node(import.module);
+            flag(import.hasMember);
+            flag(import.customIdent);
+            str(import.name);
+            str(import.ident);
+            break;
+        }
+        case NodeType::WhileStmt:
+        {
+            const WhileStmtType& loop = static_cast<const WhileStmtType&>(*stmt);
+            node(loop.condition);
+            nodes(loop.body);
+            break;
+        }
+        case NodeType::ProbeDeclaration:
+        {
+            const ProbeDeclarationType& probe = static_cast<const ProbeDeclarationType&>(*stmt);
+            flag(probe.doesExtend);
+            str(probe.name);
+            node(probe.extends);
+            nodes(probe.body);
+            break;
+        }
+        case NodeType::ForStmt:
+        {
+            const ForStmtType& loop = static_cast<const ForStmtType&>(*stmt);
+            nodes(loop.declarations);
+            nodes(loop.conditions);
+            nodes(loop.updates);
+            nodes(loop.body);
+            break;
+        }
+        case NodeType::IfStmt:
+        {
+            const IfStmtType& branch = static_cast<const IfStmtType&>(*stmt);
+            node(branch.condition);
+            nodes(branch.body);
+            nodes(branch.elseStmt);
+            flag(branch.hasElse);
+            break;
+        }
+        case NodeType::TryStmt:
+        {
+            const TryStmtType& attempt = static_cast<const TryStmtType&>(*stmt);
+            nodes(attempt.body);
+            node(attempt.catchHandler);
+            break;
+        }
+        case NodeType::AssignmentExpr:
+        {
+            const AssignmentExprType& assign = static_cast<const AssignmentExprType&>(*stmt);
+            node(assign.assigne);
+            node(assign.value);
+            str(assign.op);
+            break;
+        }
+        case NodeType::TemplateArgument:
+            nodes(static_cast<const TemplateArgumentType&>(*stmt).arguments);
+            break;
+        case NodeType::CastExpr:
+        {
+            const CastExprType& cast = static_cast<const CastExprType&>(*stmt);
+            node(cast.left);
+            node(cast.type);
+            break;
+        }
+        case NodeType::TemplateCall:
+        {
+            const TemplateCallType& call = static_cast<const TemplateCallType&>(*stmt);
+            node(call.caller);
+            nodes(call.templateArgs);
+            break;
+        }
+        case NodeType::TernaryExpr:
+        {
+            const TernaryExprType& ternary = static_cast<const TernaryExprType&>(*stmt);
+            node(ternary.cond);
+            node(ternary.cons);
+            node(ternary.alt);
+            break;
+        }
+        case NodeType::UnaryPostFix:
+        {
+            const UnaryPostFixType& unary = static_cast<const UnaryPostFixType&>(*stmt);
+            str(unary.op);
+            node(unary.assigne);
+            break;
+        }
+        case NodeType::UnaryPrefix:
+        {
+            const UnaryPrefixType& unary = static_cast<const UnaryPrefixType&>(*stmt);
+            str(unary.op);
+            node(unary.assigne);
+            break;
+        }
+        case NodeType::BinaryExpr:
+        {
+            const BinaryExprType& binop = static_cast<const BinaryExprType&>(*stmt);
+            node(binop.left);
+            node(binop.right);
+            str(binop.op);
+            break;
+        }
+        case NodeType::Identifier:
+            str(static_cast<const IdentifierType&>(*stmt).symbol);
+            break;
+        case NodeType::NumericLiteral:
+            f64(static_cast<const NumericLiteralType&>(*stmt).numValue);
+            break;
+        case NodeType::StringLiteral:
+            str(static_cast<const StringLiteralType&>(*stmt).strValue);
+            break;
+        case NodeType::BoolLiteral:
+            flag(static_cast<const BoolLiteralType&>(*stmt).value);
+            break;
+        case NodeType::ClassDefinition:
+        {
+            const ClassDefinitionType& cls = static_cast<const ClassDefinitionType&>(*stmt);
+            str(cls.name);
+            nodes(cls.body);
+            node(cls.extends);
+            flag(cls.doesExtend);
+            break;
+        }
+        case NodeType::PropertyLiteral:
+        {
+            const PropertyLiteralType& property = static_cast<const PropertyLiteralType&>(*stmt);
+            str(property.key);
+            node(property.val);
+            break;
+        }
+        case NodeType::MapLiteral:
+            nodes(static_cast<const MapLiteralType&>(*stmt).properties);
+            break;
+        case NodeType::ArrayLiteral:
+            nodes(static_cast<const ArrayLiteralType&>(*stmt).items);
+            break;
+        case NodeType::ArrowFunction:
+        {
+            const ArrowFunctionType& fn = static_cast<const ArrowFunctionType&>(*stmt);
+            nodes(fn.params);
+            nodes(fn.body);
+            break;
+        }
+        case NodeType::NewExpr:
+        {
+            const NewExprType& expr = static_cast<const NewExprType&>(*stmt);
+            node(expr.constructor);
+            nodes(expr.args);
+            break;
+        }
+        case NodeType::CallExpr:
+        {
+            const CallExprType& call = static_cast<const CallExprType&>(*stmt);
+            node(call.calee);
+            nodes(call.args);
+            break;
+        }
+        case NodeType::MemberExpr:
+        {
+            const MemberExprType& member = static_cast<const MemberExprType&>(*stmt);
+            node(member.object);
+            node(member.property);
+            str(member.lastProp);
+            flag(member.computed);
+            break;
+        }
+        case NodeType::MemberAssignment:
+        {
+            const MemberAssignmentType& assign = static_cast<const MemberAssignmentType&>(*stmt);
+            node(assign.object);
+            node(assign.property);
+            node(assign.newvalue);
+            str(assign.op);
+            flag(assign.computed);
+            break;
+        }
+        case NodeType::AwaitExpr:
+            node(static_cast<const AwaitExprType&>(*stmt).caller);
+            break;
+        case NodeType::NullLiteral:
+        case NodeType::UndefinedLiteral:
+        case NodeType::BreakStmt:
+        case NodeType::ContinueStmt:
+            break;
+        default:
+            throw SerializeError("Cannot serialize node kind " + std::to_string(stmt->kind));
+    }
+}
+
+class Reader
+{
+public:
+    Reader(std::string_view data, uint32_t file, Arena* arena)
+        : m_data(data), m_file(file), m_arena(arena) {}
+
+    uint8_t u8()
+    {
+        need(1);
+        return static_cast<uint8_t>(m_data[m_pos++]);
+    }
+
+    bool flag() { return u8() != 0; }
+
+    uint32_t u32()
+    {
+        need(4);
+        uint32_t value;
+        std::memcpy(&value, m_data.data() + m_pos, 4);
+        m_pos += 4;
+        return value;
+    }
+
+    double f64()
+    {
+        need(8);
+        double value;
+        std::memcpy(&value, m_data.data() + m_pos, 8);
+        m_pos += 8;
+        return value;
+    }
+
+    const std::string& str()
+    {
+        uint32_t index = u32();
+        if (index < m_strings.size()) return m_strings[index];
+        if (index != m_strings.size()) throw SerializeError("Bad string index in serialized program");
+
+        uint32_t size = u32();
+        need(size);
+        m_strings.emplace_back(m_data.substr(m_pos, size));
+        m_pos += size;
+        return m_strings.back();
+    }
+
+    Lexer::Token token()
+    {
+        Lexer::Token tk;
+        tk.value = str();
+        tk.type = static_cast<Lexer::TokenType>(u8());
+        tk.file = flag() ? m_file : 0;
+        tk.offset = u32();
+        return tk;
+    }
+
+    template <typename T>
+    std::vector<std::shared_ptr<T>> nodes()
+    {
+        // Every node takes at least a byte, so a larger count is a corrupt program and not worth reserving for
+        uint32_t size = u32();
+        need(size);
+
+        std::vector<std::shared_ptr<T>> list;
+        list.reserve(size);
+
+        for (uint32_t i = 0; i < size; i++) list.push_back(nodeAs<T>());
+        return list;
+    }
+
+    // A node of another type than the one its parent holds is a corrupt program as well
+    template <typename T>
+    std::shared_ptr<T> nodeAs()
+    {
+        std::shared_ptr<Stmt> stmt = node();
+        if (!stmt) return nullptr;
+
+        std::shared_ptr<T> typed = std::dynamic_pointer_cast<T>(stmt);
+        if (!typed) throw SerializeError("Unexpected node kind in serialized program");
+        return typed;
+    }
+
+    std::shared_ptr<Stmt> node();
+
+    bool done() const { return m_pos == m_data.size(); }
+
+private:
+    std::string_view m_data;
+    size_t m_pos = 0;
+    uint32_t m_file;
+    Arena* m_arena;
+    // A deque, so the references str() hands out survive later strings
+    std::deque<std::string> m_strings;
+
+    void need(size_t size)
+    {
+        if (m_data.size() - m_pos < size) throw SerializeError("Serialized program is truncated");
+    }
+
+    template <typename T, typename... Args>
+    std::shared_ptr<T> make(Args&&... args)
+    {
+        return std::allocate_shared<T>(ArenaAllocator<T>(m_arena), std::forward<Args>(args)...);
+    }
+};
+
+std::shared_ptr<Stmt> Reader::node()
+{
+    uint8_t kind = u8();
+    if (kind == NullNode) return nullptr;
+
+    Lexer::Token tk = token();
+    std::shared_ptr<Stmt> result;
+
+    switch (kind)
+    {
+        case NodeType::ReturnStmt:
+            result = make<ReturnStmtType>(nodeAs<Expr>());
+            break;
+        case NodeType::VarDeclaration:
+        {
+            std::shared_ptr<Expr> value = nodeAs<Expr>();
+            std::string identifier = str();
+            bool constant = flag();
+            bool staticType = flag();
+            std::shared_ptr<Expr> type = nodeAs<Expr>();
+
+            result = staticType ? make<VarDeclarationType>(value, identifier, type) : make<VarDeclarationType>(value, identifier, constant);
+            break;
+        }
+        case NodeType::FunctionDeclaration:
+        {
+            bool staticRet = flag();
+            std::shared_ptr<Expr> rettype = nodeAs<Expr>();
+            std::vector<std::shared_ptr<VarDeclarationType>> params = nodes<VarDeclarationType>();
+            std::vector<std::shared_ptr<VarDeclarationType>> templateparams = nodes<VarDeclarationType>();
+            std::string name = str();
+            std::vector<std::shared_ptr<Stmt>> body = nodes<Stmt>();
+            bool isAsync = flag();
+
+            std::shared_ptr<FunctionDeclarationType> fn = make<FunctionDeclarationType>(params, name, body, isAsync);
+            fn->staticRet = staticRet;
+            fn->rettype = rettype;
+            fn->templateparams = templateparams;
+            result = fn;
+            break;
+        }
+        case NodeType::ExportStmt:
+            result = make<ExportStmtType>(node());
+            break;
+        case NodeType::ThrowStmt:
+            result = make<ThrowStmtType>(nodeAs<Expr>());
+            break;
+        case NodeType::ImportStmt:
+        {
+            std::shared_ptr<Expr> module = nodeAs<Expr>();
+            bool hasMember = flag();
+            bool customIdent = flag();
+            std::string name = str();
+
+            std::shared_ptr<ImportStmtType> import = make<ImportStmtType>(name);
+            import->module = module;
+            import->hasMember = hasMember;
+            import->customIdent = customIdent;
+            import->ident = str();
+            result = import;
+            break;
+        }
+        case NodeType::WhileStmt:
+        {
+            std::shared_ptr<Expr> condition = nodeAs<Expr>();
+            result = make<WhileStmtType>(condition, nodes<Stmt>());
+            break;
+        }
+        case NodeType::ProbeDeclaration:
+        {
+            bool doesExtend = flag();
+            std::string name = str();
+            std::shared_ptr<Expr> extends = nodeAs<Expr>();
+
+            std::shared_ptr<ProbeDeclarationType> probe = make<ProbeDeclarationType>(name, nodes<Stmt>());
+            probe->extends = extends;
+            probe->doesExtend = doesExtend;
+            result = probe;
+            break;
+        }
+        case NodeType::ForStmt:
+        {
+            std::vector<std::shared_ptr<Stmt>> declarations = nodes<Stmt>();
+            std::vector<std::shared_ptr<Expr>> conditions = nodes<Expr>();
+            std::vector<std::shared_ptr<Expr>> updates = nodes<Expr>();
+            result = make<ForStmtType>(declarations, conditions, updates, nodes<Stmt>());
+            break;
+        }
+        case NodeType::IfStmt:
+        {
+            std::shared_ptr<Expr> condition = nodeAs<Expr>();
+            std::shared_ptr<IfStmtType> branch = make<IfStmtType>(condition, nodes<Stmt>());
+            branch->elseStmt = nodes<Stmt>();
+            branch->hasElse = flag();
+            result = branch;
+            break;
+        }
+        case NodeType::TryStmt:
+        {
+            std::vector<std::shared_ptr<Stmt>> body = nodes<Stmt>();
+            result = make<TryStmtType>(body, nodeAs<FunctionDeclarationType>());
+            break;
+        }
+        case NodeType::AssignmentExpr:
+        {
+            std::shared_ptr<Expr> assigne = nodeAs<Expr>();
+            std::shared_ptr<Expr> value = nodeAs<Expr>();
+            result = make<AssignmentExprType>(assigne, value, str());
+            break;
+        }
+        case NodeType::TemplateArgument:
+            result = make<TemplateArgumentType>(nodes<Expr>());
+            break;
+        case NodeType::CastExpr:
+        {
+            std::shared_ptr<Expr> left = nodeAs<Expr>();
+            result = make<CastExprType>(left, nodeAs<Expr>());
+            break;
+        }
+        case NodeType::TemplateCall:
+        {
+            std::shared_ptr<Expr> caller = nodeAs<Expr>();
+            result = make<TemplateCallType>(caller, nodes<Expr>());
+            break;
+        }
+        case NodeType::TernaryExpr:
+        {
+            std::shared_ptr<Expr> cond = nodeAs<Expr>();
+            std::shared_ptr<Expr> cons = nodeAs<Expr>();
+            result = make<TernaryExprType>(cond, cons, nodeAs<Expr>());
+            break;
+        }
+        case NodeType::UnaryPostFix:
+        {
+            std::string op = str();
+            result = make<UnaryPostFixType>(op, nodeAs<Expr>());
+            break;
+        }
+        case NodeType::UnaryPrefix:
+        {
+            std::string op = str();
+            result = make<UnaryPrefixType>(op, nodeAs<Expr>());
+            break;
+        }
+        case NodeType::BinaryExpr:
+        {
+            std::shared_ptr<Expr> left = nodeAs<Expr>();
+            std::shared_ptr<Expr> right = nodeAs<Expr>();
+            result = make<BinaryExprType>(left, right, str());
+            break;
+        }
+        case NodeType::Identifier:
+            result = make<IdentifierType>(Symbol(str()));
+            break;
+        case NodeType::NumericLiteral:
+            result = make<NumericLiteralType>(f64());
+            break;
+        case NodeType::StringLiteral:
+            result = make<StringLiteralType>(str());
+            break;
+        case NodeType::NullLiteral:
+            result = make<NullLiteralType>();
+            break;
+        case NodeType::UndefinedLiteral:
+            result = make<UndefinedLiteralType>();
+            break;
+        case NodeType::BoolLiteral:
+            result = make<BoolLiteralType>(flag());
+            break;
+        case NodeType::ClassDefinition:
+        {
+            std::string name = str();
+            std::shared_ptr<ClassDefinitionType> cls = make<ClassDefinitionType>(name, nodes<Stmt>());
+            cls->extends = nodeAs<Expr>();
+            cls->doesExtend = flag();
+            result = cls;
+            break;
+        }
+        case NodeType::PropertyLiteral:
+        {
+            Symbol key(str());
+            result = make<PropertyLiteralType>(key, nodeAs<Expr>());
+            break;
+        }
+        case NodeType::MapLiteral:
+            result = make<MapLiteralType>(nodes<PropertyLiteralType>());
+            break;
+        case NodeType::ArrayLiteral:
+            result = make<ArrayLiteralType>(nodes<Expr>());
+            break;
+        case NodeType::ArrowFunction:
+        {
+            std::vector<std::shared_ptr<VarDeclarationType>> params = nodes<VarDeclarationType>();
+            result = make<ArrowFunctionType>(params, nodes<Stmt>());
+            break;
+        }
+        case NodeType::NewExpr:
+        {
+            std::shared_ptr<Expr> constructor = nodeAs<Expr>();
+            result = make<NewExprType>(constructor, nodes<Expr>());
+            break;
+        }
+        case NodeType::CallExpr:
+        {
+            std::shared_ptr<Expr> calee = nodeAs<Expr>();
+            result = make<CallExprType>(calee, nodes<Expr>());
+            break;
+        }
+        case NodeType::MemberExpr:
+        {
+            std::shared_ptr<Expr> object = nodeAs<Expr>();
+            std::shared_ptr<Expr> property = nodeAs<Expr>();
+            std::string lastProp = str();
+            result = make<MemberExprType>(object, property, flag(), lastProp);
+            break;
+        }
+        case NodeType::MemberAssignment:
+        {
+            std::shared_ptr<Expr> object = nodeAs<Expr>();
+            std::shared_ptr<Expr> property = nodeAs<Expr>();
+            std::shared_ptr<Expr> value = nodeAs<Expr>();
+            std::string op = str();
+            result = make<MemberAssignmentType>(object, property, value, flag(), op);
+            break;
+        }
+        case NodeType::BreakStmt:
+            result = make<BreakStmtType>();
+            break;
+        case NodeType::ContinueStmt:
+            result = make<ContinueStmtType>();
+            break;
+        case NodeType::AwaitExpr:
+            result = make<AwaitExprType>(nodeAs<Expr>());
+            break;
+        default:
+            throw SerializeError("Unknown node kind in serialized program");
+    }
+
+    result->token = std::move(tk);
+    return result;
+}
+
+} // namespace
+
+std::string Serializer::write(const ProgramType& program)
+{
+    Writer writer;
+    writer.u32(FormatVersion);
+    writer.token(program.token);
+    writer.nodes(program.body);
+    return std::move(writer.out);
+}
+
+std::shared_ptr<ProgramType> Serializer::read(std::string_view data, Lexer::Sources::Handle source)
+{
+    std::shared_ptr<ProgramType> program = std::make_shared<ProgramType>();
+    program->arena.reset(new Arena());
+    Reader reader(data, Lexer::Sources::id(source), program->arena.get());
+    program->arena->source = std::move(source);
+
+    if (reader.u32() != FormatVersion) throw SerializeError("Serialized program has another format version");
+
+    program->token = reader.token();
+    program->body = reader.nodes<Stmt>();
+
+    if (!reader.done()) throw SerializeError("Trailing data after serialized program");
+    return program;
+}
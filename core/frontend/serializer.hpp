@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "frontend/ast.hpp"
+
+namespace Probescript::AST
+{
+
+// Binary form of a parsed program, used by the on-disk cache. Resolver results are not stored,
+// the loaded program is resolved again. Bump FormatVersion whenever a node changes shape
+class Serializer
+{
+public:
+    static constexpr uint32_t FormatVersion = 1;
+
+    static std::string write(const ProgramType& program);
+
+    // Rebuilds a program written by write(). Tokens are attributed to `source`, which the program keeps.
+    // Throws SerializeError on malformed input
+    static std::shared_ptr<ProgramType> read(std::string_view data, Lexer::Sources::Handle source);
+};
+
+struct SerializeError : public std::runtime_error
+{
+    using std::runtime_error::runtime_error;
+};
+
+} // namespace Probescript::AST
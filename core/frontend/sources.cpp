@@ -0,0 +1,115 @@
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "frontend/sources.hpp"
+
+using namespace Probescript;
+using namespace Probescript::Lexer;
+
+struct Sources::Record
+{
+    uint32_t id;
+    std::string filename;
+    std::string text;
+    size_t hash;
+    // Offset of the first character of every line, empty until first needed
+    std::vector<uint32_t> lineStarts;
+};
+
+namespace
+{
+
+using Key = std::pair<std::string, size_t>;
+
+std::mutex g_sourcesMutex;
+std::unordered_map<uint32_t, std::weak_ptr<Sources::Record>> g_sources;
+std::map<Key, uint32_t> g_byKey;
+// Ids are never reused, a token of a released file cannot point into another one
+uint32_t g_nextId = 1;
+
+void drop(Sources::Record* record)
+{
+    {
+        std::lock_guard<std::mutex> lock(g_sourcesMutex);
+        g_sources.erase(record->id);
+
+        // The key may already belong to a newer record of the same text
+        auto key = g_byKey.find({ record->filename, record->hash });
+        if (key != g_byKey.end() && key->second == record->id) g_byKey.erase(key);
+    }
+
+    delete record;
+}
+
+// Called with the lock held. The caller declares `out` before taking the lock, so the last
+// reference is never dropped while it is held
+bool find(uint32_t file, Sources::Handle& out)
+{
+    auto found = g_sources.find(file);
+    if (found == g_sources.end()) return false;
+
+    out = found->second.lock();
+    return out != nullptr;
+}
+
+} // namespace
+
+Sources::Handle Sources::add(const std::string& filename, const std::string& text)
+{
+    size_t hash = std::hash<std::string>()(text);
+    Handle existing;
+    std::lock_guard<std::mutex> lock(g_sourcesMutex);
+
+    auto key = g_byKey.find({ filename, hash });
+    if (key != g_byKey.end() && find(key->second, existing) && existing->text == text) return existing;
+
+    Handle record(new Record { g_nextId++, filename, text, hash, {} }, drop);
+    g_sources[record->id] = record;
+    g_byKey[{ filename, hash }] = record->id;
+    return record;
+}
+
+uint32_t Sources::id(const Handle& handle)
+{
+    return handle ? handle->id : 0;
+}
+
+Location Sources::locate(uint32_t file, uint32_t offset)
+{
+    Handle source;
+    std::lock_guard<std::mutex> lock(g_sourcesMutex);
+
+    if (!find(file, source)) return {};
+
+    if (source->lineStarts.empty())
+    {
+        source->lineStarts.push_back(0);
+        for (size_t i = 0; i < source->text.size(); i++)
+        {
+            if (source->text[i] == '\n') source->lineStarts.push_back(i + 1);
+        }
+    }
+
+    auto next = std::upper_bound(source->lineStarts.begin(), source->lineStarts.end(), offset);
+    size_t line = next - source->lineStarts.begin();
+
+    return { static_cast<int>(line), static_cast<int>(offset - source->lineStarts[line - 1]) + 1 };
+}
+
+std::string Sources::filename(uint32_t file)
+{
+    Handle source;
+    std::lock_guard<std::mutex> lock(g_sourcesMutex);
+    return find(file, source) ? source->filename : std::string();
+}
+
+std::string Sources::text(uint32_t file)
+{
+    Handle source;
+    std::lock_guard<std::mutex> lock(g_sourcesMutex);
+    return find(file, source) ? source->text : std::string();
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace Probescript::Lexer
+{
+
+struct Location
+{
+    int line = 0;
+    int col = 0;
+};
+
+// Table of the source texts of the programs alive. Tokens refer to their file by a 32 bit id
+// (0 means no file) and to their position by a byte offset, and the line table of a file
+// is only built the first time an error has to report a line and column in it
+namespace Sources
+{
+
+struct Record;
+
+// Keeps a record alive, it is dropped with the last handle. The arena of a program holds one, so the
+// record lives exactly as long as the tokens that point into it
+using Handle = std::shared_ptr<Record>;
+
+// Parsing the same text of the same file again (an import seen twice, a reload) shares its record
+Handle add(const std::string& filename, const std::string& text);
+uint32_t id(const Handle& handle);
+
+// A released file reports no location and an empty name and text
+Location locate(uint32_t file, uint32_t offset);
+std::string filename(uint32_t file);
+std::string text(uint32_t file);
+
+} // namespace Sources
+
+} // namespace Probescript::Lexer
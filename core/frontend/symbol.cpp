@@ -0,0 +1,37 @@
+#include <mutex>
+#include <unordered_set>
+
+#include "frontend/symbol.hpp"
+
+using namespace Probescript::AST;
+
+// Node based, so the strings never move once interned. Never shrinks: the table only ever holds
+// one copy of each name that appeared in some source file
+static std::unordered_set<std::string>& table()
+{
+    static std::unordered_set<std::string> symbols;
+    return symbols;
+}
+
+static std::mutex& tableMutex()
+{
+    static std::mutex mutex;
+    return mutex;
+}
+
+const std::string& Symbol::intern(std::string_view name)
+{
+    std::string key(name);
+
+    std::lock_guard<std::mutex> lock(tableMutex());
+    auto found = table().find(key);
+    if (found != table().end()) return *found;
+
+    return *table().insert(std::move(key)).first;
+}
+
+const std::string& Symbol::blank()
+{
+    static const std::string& name = intern("");
+    return name;
+}
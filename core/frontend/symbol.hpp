@@ -0,0 +1,57 @@
+#pragma once
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace Probescript::AST
+{
+
+// An interned identifier or property name. Every distinct spelling is stored once for the whole
+// process, so a symbol is one pointer and two symbols compare by address
+class Symbol
+{
+public:
+    Symbol() : m_name(&blank()) {}
+    Symbol(std::string_view name) : m_name(&intern(name)) {}
+    Symbol(const std::string& name) : Symbol(std::string_view(name)) {}
+    Symbol(const char* name) : Symbol(std::string_view(name)) {}
+
+    const std::string& str() const { return *m_name; }
+    operator const std::string&() const { return *m_name; }
+
+    bool empty() const { return m_name->empty(); }
+    size_t size() const { return m_name->size(); }
+
+    bool operator==(const Symbol& other) const { return m_name == other.m_name; }
+    bool operator!=(const Symbol& other) const { return m_name != other.m_name; }
+    bool operator==(const std::string& other) const { return *m_name == other; }
+    bool operator!=(const std::string& other) const { return *m_name != other; }
+    bool operator==(const char* other) const { return *m_name == other; }
+    bool operator!=(const char* other) const { return *m_name != other; }
+
+private:
+    const std::string* m_name;
+
+    static const std::string& intern(std::string_view name);
+    static const std::string& blank();
+};
+
+inline std::string operator+(const std::string& left, const Symbol& right) { return left + right.str(); }
+inline std::string operator+(const Symbol& left, const std::string& right) { return left.str() + right; }
+inline std::string operator+(const char* left, const Symbol& right) { return left + right.str(); }
+inline std::string operator+(const Symbol& left, const char* right) { return left.str() + right; }
+
+inline std::ostream& operator<<(std::ostream& out, const Symbol& symbol) { return out << symbol.str(); }
+
+} // namespace Probescript::AST
+
+template <>
+struct std::hash<Probescript::AST::Symbol>
+{
+    size_t operator()(const Probescript::AST::Symbol& symbol) const
+    {
+        return std::hash<const void*>()(&symbol.str());
+    }
+};
@@ -0,0 +1,615 @@
+#include <chrono>
+#include <thread>
+
+#include "loop.hpp"
+#include "executor.hpp"
+#include "errors.hpp"
+
+using namespace Probescript;
+
+#ifdef __linux__
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <queue>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+namespace Probescript::Loop
+{
+
+struct Deadline;
+
+struct Task
+{
+    ucontext_t context;
+    char* stack = nullptr;
+    size_t stackSize = 0;
+    std::function<void()> body;
+    // Set while the task waits on a descriptor with a time limit
+    std::shared_ptr<Deadline> deadline;
+};
+
+// The time limit of a descriptor wait. Whichever of the descriptor and the timer comes first clears `pending`,
+// the other one then leaves the task alone
+struct Deadline
+{
+    Task* task;
+    bool pending = true;
+    bool expired = false;
+};
+
+} // namespace Probescript::Loop
+
+namespace
+{
+
+using Loop::Task;
+using Loop::Deadline;
+using Clock = std::chrono::steady_clock;
+
+// Most of a task's stack is never touched, the pages are only backed once used
+constexpr size_t MinStackSize = 256 * 1024;
+constexpr size_t MaxFreeStacks = 256;
+// What a cached stack keeps backed, the pages a task touched below this are given back when it ends
+constexpr size_t KeptStackSize = 64 * 1024;
+
+struct Timer
+{
+    Clock::time_point deadline;
+    uint64_t seq;
+    Task* task;
+    // Only for the time limit of a descriptor wait
+    std::shared_ptr<Loop::Deadline> limit;
+
+    // Earliest first, and in the order they were set for equal deadlines
+    bool operator>(const Timer& other) const
+    {
+        return deadline != other.deadline ? deadline > other.deadline : seq > other.seq;
+    }
+};
+
+bool g_enabled = false;
+thread_local Task* t_current = nullptr;
+
+ucontext_t g_loopContext;
+int g_epoll = -1;
+int g_wakeFd = -1;
+
+std::deque<Task*> g_ready;
+std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> g_timers;
+uint64_t g_timerSeq = 0;
+// Tasks suspended on the pool or on a descriptor, the loop keeps polling while there are any
+size_t g_offloaded = 0;
+size_t g_watching = 0;
+// Tasks parked on a sync primitive, which a pool thread may still wake
+size_t g_parked = 0;
+// Tasks suspended in daemon(), which only keep the loop going while main has not finished
+size_t g_daemons = 0;
+
+// Tasks woken by pool threads, handed over through the eventfd
+std::mutex g_remoteMutex;
+std::vector<Task*> g_remote;
+
+std::vector<char*> g_freeStacks;
+size_t g_pageSize = 0;
+// Every task gets the stack the main thread would have had, so async recursion goes as deep as sync
+size_t g_stackSize = 0;
+
+char* allocStack(size_t size)
+{
+    if (size == g_stackSize && !g_freeStacks.empty())
+    {
+        char* stack = g_freeStacks.back();
+        g_freeStacks.pop_back();
+        return stack;
+    }
+
+    // One guard page below the stack turns an overflow into a fault instead of corrupting a neighbour
+    void* base = mmap(nullptr, size + g_pageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+    if (base == MAP_FAILED) throw std::runtime_error(CustomError("Could not allocate a task stack", "AsyncError"));
+
+    mprotect(base, g_pageSize, PROT_NONE);
+    return static_cast<char*>(base) + g_pageSize;
+}
+
+void freeStack(char* stack, size_t size)
+{
+    if (size == g_stackSize && g_freeStacks.size() < MaxFreeStacks)
+    {
+        // Stacks grow down, the pages in use by the next task are the ones at the top
+        madvise(stack, size - KeptStackSize, MADV_DONTNEED);
+        g_freeStacks.push_back(stack);
+        return;
+    }
+
+    munmap(stack - g_pageSize, size + g_pageSize);
+}
+
+void entry()
+{
+    t_current->body();
+    t_current->body = nullptr;
+    // Returning switches to uc_link, the loop then frees this stack
+}
+
+Task* create(size_t stackSize, std::function<void()> body)
+{
+    Task* task = new Task();
+    task->stackSize = stackSize;
+    task->stack = allocStack(stackSize);
+    task->body = std::move(body);
+
+    getcontext(&task->context);
+    task->context.uc_stack.ss_sp = task->stack;
+    task->context.uc_stack.ss_size = stackSize;
+    task->context.uc_link = &g_loopContext;
+    makecontext(&task->context, entry, 0);
+
+    return task;
+}
+
+void suspend()
+{
+    swapcontext(&t_current->context, &g_loopContext);
+}
+
+void resume(Task* task)
+{
+    t_current = task;
+    swapcontext(&g_loopContext, &task->context);
+    t_current = nullptr;
+
+    // A task that returned has no body left
+    if (!task->body)
+    {
+        freeStack(task->stack, task->stackSize);
+        delete task;
+    }
+}
+
+void wakeRemote(Task* task)
+{
+    {
+        std::lock_guard<std::mutex> lock(g_remoteMutex);
+        g_remote.push_back(task);
+    }
+
+    uint64_t one = 1;
+    while (write(g_wakeFd, &one, sizeof(one)) < 0 && errno == EINTR) {}
+}
+
+// The stack size the main thread would have had, so scripts recurse as deep as without the loop
+size_t mainStackSize()
+{
+    rlimit limit {};
+    if (getrlimit(RLIMIT_STACK, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY && limit.rlim_cur >= MinStackSize)
+        return (static_cast<size_t>(limit.rlim_cur) + g_pageSize - 1) / g_pageSize * g_pageSize;
+
+    return 8 * 1024 * 1024;
+}
+
+void init()
+{
+    if (g_epoll >= 0) return;
+
+    g_pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    g_stackSize = mainStackSize();
+    g_epoll = epoll_create1(EPOLL_CLOEXEC);
+    g_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    if (g_epoll < 0 || g_wakeFd < 0) throw std::runtime_error(CustomError("Could not start the event loop: " + std::string(strerror(errno)), "AsyncError"));
+
+    // The wake descriptor is the only one registered without a task
+    epoll_event event {};
+    event.events = EPOLLIN;
+    event.data.ptr = nullptr;
+    epoll_ctl(g_epoll, EPOLL_CTL_ADD, g_wakeFd, &event);
+}
+
+// Moves everything that became ready into g_ready, waiting up to `timeout` ms (-1 for no limit) for it
+void poll(int timeout)
+{
+    epoll_event events[256];
+    int count = epoll_wait(g_epoll, events, 256, timeout);
+
+    for (int i = 0; i < count; i++)
+    {
+        Task* task = static_cast<Task*>(events[i].data.ptr);
+
+        if (task)
+        {
+            if (task->deadline)
+            {
+                task->deadline->pending = false;
+                task->deadline.reset();
+            }
+
+            g_ready.push_back(task);
+            continue;
+        }
+
+        uint64_t value;
+        while (read(g_wakeFd, &value, sizeof(value)) > 0) {}
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(g_remoteMutex);
+        g_ready.insert(g_ready.end(), g_remote.begin(), g_remote.end());
+        g_remote.clear();
+    }
+
+    Clock::time_point now = Clock::now();
+    while (!g_timers.empty() && g_timers.top().deadline <= now)
+    {
+        const Timer& timer = g_timers.top();
+
+        if (!timer.limit)
+        {
+            g_ready.push_back(timer.task);
+        }
+        else if (timer.limit->pending)
+        {
+            timer.limit->pending = false;
+            timer.limit->expired = true;
+            timer.task->deadline.reset();
+            g_ready.push_back(timer.task);
+        }
+
+        g_timers.pop();
+    }
+}
+
+int nextTimeout()
+{
+    if (g_timers.empty()) return -1;
+
+    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(g_timers.top().deadline - Clock::now()).count();
+    // Rounded up, waking early would only mean another turn
+    return static_cast<int>(std::max<long long>(0, left + 1));
+}
+
+// False when `timeout` ms (-1 for no limit) passed first
+bool watch(int fd, uint32_t events, int timeout)
+{
+    epoll_event event {};
+    event.events = events | EPOLLONESHOT;
+    event.data.ptr = t_current;
+
+    if (epoll_ctl(g_epoll, EPOLL_CTL_ADD, fd, &event) < 0)
+        throw std::runtime_error(CustomError("Cannot wait on descriptor: " + std::string(strerror(errno)), "AsyncError"));
+
+    std::shared_ptr<Deadline> limit;
+    if (timeout >= 0)
+    {
+        limit = std::make_shared<Deadline>();
+        limit->task = t_current;
+        t_current->deadline = limit;
+        g_timers.push({ Clock::now() + std::chrono::milliseconds(timeout), g_timerSeq++, t_current, limit });
+    }
+
+    g_watching++;
+    suspend();
+    g_watching--;
+
+    epoll_ctl(g_epoll, EPOLL_CTL_DEL, fd, nullptr);
+    return !limit || !limit->expired;
+}
+
+// Runs `fn` on the thread pool while the calling task is suspended
+Values::Val runOnPool(const std::function<Values::Val()>& fn)
+{
+    // Both live on the suspended task's stack until the pool thread wakes it
+    Values::Val result;
+    std::exception_ptr error;
+    Task* task = t_current;
+
+    Executor::post([&fn, &result, &error, task]()
+    {
+        try
+        {
+            result = fn();
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+
+        wakeRemote(task);
+    });
+
+    suspend();
+
+    if (error) std::rethrow_exception(error);
+    return result;
+}
+
+} // namespace
+
+bool Loop::supported()
+{
+    return true;
+}
+
+void Loop::enable()
+{
+    g_enabled = true;
+}
+
+bool Loop::enabled()
+{
+    return g_enabled;
+}
+
+bool Loop::inTask()
+{
+    return t_current != nullptr;
+}
+
+void Loop::run(const std::function<void()>& main)
+{
+    init();
+
+    std::exception_ptr error;
+    bool finished = false;
+
+    g_ready.push_back(create(g_stackSize, [&]()
+    {
+        try
+        {
+            main();
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+
+        finished = true;
+    }));
+
+    while (true)
+    {
+        // Only the tasks ready now run this turn, what they wake runs after the next poll
+        for (size_t count = g_ready.size(); count > 0; count--)
+        {
+            Task* task = g_ready.front();
+            g_ready.pop_front();
+            resume(task);
+        }
+
+        if (!g_ready.empty())
+        {
+            poll(0);
+            continue;
+        }
+
+        if (g_timers.empty() && g_offloaded == 0 && g_watching == 0 && g_parked == 0 && (finished || g_daemons == 0)) break;
+
+        poll(nextTimeout());
+    }
+
+    if (error) std::rethrow_exception(error);
+
+    if (!finished)
+        throw std::runtime_error(CustomError("Every task is awaiting something that can no longer complete", "AsyncError"));
+}
+
+Values::Val Loop::spawn(std::function<Values::Val()> fn)
+{
+    if (!inTask()) return Executor::submit(std::move(fn));
+
+    auto promise = std::make_shared<std::promise<Values::Val>>();
+    auto completion = std::make_shared<Completion>();
+
+    g_ready.push_back(create(g_stackSize, [fn = std::move(fn), promise, completion]()
+    {
+        try
+        {
+            promise->set_value(fn());
+        }
+        catch (...)
+        {
+            promise->set_exception(std::current_exception());
+        }
+
+        completion->done = true;
+        g_ready.insert(g_ready.end(), completion->waiters.begin(), completion->waiters.end());
+        completion->waiters.clear();
+    }));
+
+    return Values::make<Values::FutureVal>(promise->get_future().share(), completion);
+}
+
+void Loop::await(const Values::Ref<Values::FutureVal>& future)
+{
+    if (!inTask())
+    {
+        Executor::wait(future);
+        return;
+    }
+
+    if (future->completion)
+    {
+        if (future->completion->done) return;
+
+        future->completion->waiters.push_back(t_current);
+        suspend();
+        return;
+    }
+
+    // Started on the pool, there is nothing on the loop that will signal it
+    if (future->future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+    {
+        Values::Ref<Values::FutureVal> pending = future;
+        offload([pending]() { Executor::wait(pending); return Values::makeUndefined(); });
+    }
+}
+
+void Loop::sleep(double ms)
+{
+    if (!inTask())
+    {
+        std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(ms));
+        return;
+    }
+
+    auto delay = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(std::max(0.0, ms)));
+    g_timers.push({ Clock::now() + delay, g_timerSeq++, t_current, nullptr });
+    suspend();
+}
+
+void Loop::yield()
+{
+    if (!inTask())
+    {
+        std::this_thread::yield();
+        return;
+    }
+
+    g_ready.push_back(t_current);
+    suspend();
+}
+
+Loop::Task* Loop::current()
+{
+    return t_current;
+}
+
+void Loop::park()
+{
+    g_parked++;
+    suspend();
+    g_parked--;
+}
+
+void Loop::wake(Task* task)
+{
+    // Another task on the loop thread queues it directly, anything else goes through the eventfd
+    if (inTask()) g_ready.push_back(task);
+    else wakeRemote(task);
+}
+
+Values::Val Loop::offload(std::function<Values::Val()> fn)
+{
+    if (!inTask()) return fn();
+
+    g_offloaded++;
+    Values::Val result = runOnPool(fn);
+    g_offloaded--;
+    return result;
+}
+
+Values::Val Loop::daemon(std::function<Values::Val()> fn)
+{
+    auto standAside = [&]()
+    {
+        Values::Val result;
+        Executor::blocking([&]() { result = fn(); });
+        return result;
+    };
+
+    if (!inTask()) return standAside();
+
+    g_daemons++;
+    Values::Val result = runOnPool(standAside);
+    g_daemons--;
+    return result;
+}
+
+bool Loop::waitReadable(int fd, int timeout)
+{
+    return !inTask() || watch(fd, EPOLLIN, timeout);
+}
+
+bool Loop::waitWritable(int fd, int timeout)
+{
+    return !inTask() || watch(fd, EPOLLOUT, timeout);
+}
+
+#else
+
+// Without epoll and ucontext nothing ever runs as a task, so every call takes its fallback
+
+bool Loop::supported()
+{
+    return false;
+}
+
+void Loop::enable() {}
+
+bool Loop::enabled()
+{
+    return false;
+}
+
+bool Loop::inTask()
+{
+    return false;
+}
+
+void Loop::run(const std::function<void()>& main)
+{
+    main();
+}
+
+Values::Val Loop::spawn(std::function<Values::Val()> fn)
+{
+    return Executor::submit(std::move(fn));
+}
+
+void Loop::await(const Values::Ref<Values::FutureVal>& future)
+{
+    Executor::wait(future);
+}
+
+void Loop::sleep(double ms)
+{
+    std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(ms));
+}
+
+void Loop::yield()
+{
+    std::this_thread::yield();
+}
+
+Loop::Task* Loop::current()
+{
+    return nullptr;
+}
+
+void Loop::park() {}
+
+void Loop::wake(Task* task) {}
+
+Values::Val Loop::offload(std::function<Values::Val()> fn)
+{
+    return fn();
+}
+
+Values::Val Loop::daemon(std::function<Values::Val()> fn)
+{
+    Values::Val result;
+    Executor::blocking([&]() { result = fn(); });
+    return result;
+}
+
+bool Loop::waitReadable(int fd, int timeout)
+{
+    return true;
+}
+
+bool Loop::waitWritable(int fd, int timeout)
+{
+    return true;
+}
+
+#endif
@@ -0,0 +1,71 @@
+#pragma once
+#include <functional>
+#include <vector>
+
+#include "runtime/values.hpp"
+
+// Single threaded event loop. Async functions run as tasks on their own stacks and `await` suspends the task
+// instead of blocking a thread, so one core can hold tens of thousands of pending waits.
+// Only implemented on Linux (epoll), elsewhere supported() is false and the thread pool is used
+namespace Probescript::Loop
+{
+
+struct Task;
+
+// Shared by a task's future and the tasks awaiting it, only touched from the loop thread
+struct Completion
+{
+    bool done = false;
+    std::vector<Task*> waiters;
+};
+
+bool supported();
+
+// Makes the CLI drive evaluation through run()
+void enable();
+bool enabled();
+
+// Whether the caller runs as a task on the loop thread. Only tasks suspend, anywhere else the calls below
+// fall back to the thread pool or to blocking
+bool inTask();
+
+// Runs `main` as the first task and returns once it and everything it started have finished.
+// Rethrows what `main` threw, and fails if tasks are left waiting on something that can no longer happen
+void run(const std::function<void()>& main);
+
+// Starts `fn` as a new task, its result or exception is delivered through the returned future
+Values::Val spawn(std::function<Values::Val()> fn);
+
+// Suspends until `future` is ready, without taking its value
+void await(const Values::Ref<Values::FutureVal>& future);
+
+// Suspends for at least `ms` milliseconds
+void sleep(double ms);
+
+// Lets the other ready tasks run before the caller continues
+void yield();
+
+// The calling task, null outside of one. Kept by whatever the task parks on, so it can be woken
+Task* current();
+
+// Suspends the calling task until wake() is called with it. The task has to be registered with its waker first
+void park();
+
+// Resumes a parked task, from a task on the loop or from any other thread
+void wake(Task* task);
+
+// Runs `fn` on the thread pool and suspends until it is done. Used for work that has no readiness
+// notification, like file I/O and name resolution
+Values::Val offload(std::function<Values::Val()> fn);
+
+// Like offload, for work that is not meant to return, such as a server. While main is still running the loop
+// waits for it, once main has finished it is left behind like a pool thread still busy at exit.
+// Outside a task the caller runs it, standing aside for a spare if it is a pool worker
+Values::Val daemon(std::function<Values::Val()> fn);
+
+// Suspend until `fd` is readable or writable, false when `timeout` ms (-1 for no limit) passed first.
+// Only one task may wait on a descriptor at a time
+bool waitReadable(int fd, int timeout = -1);
+bool waitWritable(int fd, int timeout = -1);
+
+} // namespace Probescript::Loop
@@ -0,0 +1,337 @@
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <stdexcept>
+#include <thread>
+
+#include "registry.hpp"
+#include "cache.hpp"
+#include "typechecker.hpp"
+
+using namespace Probescript;
+using namespace Probescript::Registry;
+
+namespace fs = std::filesystem;
+
+namespace
+{
+
+std::mutex g_modulesMutex;
+std::unordered_map<std::string, std::shared_ptr<Module>> g_modules;
+std::map<std::string, std::string> g_imports;
+
+// Which thread runs each Running phase, and which phase each blocked thread waits for
+std::mutex g_phaseMutex;
+std::condition_variable g_phaseChanged;
+std::unordered_map<const Phase*, std::thread::id> g_owners;
+std::unordered_map<std::thread::id, const Phase*> g_waiting;
+
+fs::path canonicalize(const fs::path& path)
+{
+    std::error_code error;
+    fs::path canonical = fs::weakly_canonical(path, error);
+    return error ? fs::absolute(path) : canonical;
+}
+
+// Runs `fn` over a queue of items on `workers` threads until the queue is empty and no item is in progress.
+// `fn` may queue more items through the callback it is given
+template <typename T>
+void runParallel(std::deque<T> queue, size_t workers, const std::function<void(T, const std::function<void(T)>&)>& fn)
+{
+    std::mutex mutex;
+    std::condition_variable cv;
+    size_t pending = queue.size();
+
+    auto push = [&](T item)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back(std::move(item));
+        pending++;
+        cv.notify_one();
+    };
+
+    auto work = [&]()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        while (true)
+        {
+            cv.wait(lock, [&]() { return !queue.empty() || pending == 0; });
+            if (queue.empty()) return;
+
+            T item = std::move(queue.front());
+            queue.pop_front();
+
+            lock.unlock();
+            fn(std::move(item), push);
+            lock.lock();
+
+            if (--pending == 0) cv.notify_all();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < workers; i++) threads.emplace_back(work);
+
+    work();
+    for (std::thread& thread : threads) thread.join();
+}
+
+// Names of the source modules imported by the top level of `program`, in order
+std::vector<std::string> topLevelImports(const AST::ProgramType& program)
+{
+    std::vector<std::string> names;
+
+    for (const std::shared_ptr<AST::Stmt>& stmt : program.body)
+    {
+        if (stmt->kind != AST::NodeType::ImportStmt) continue;
+
+        const std::string& name = std::static_pointer_cast<AST::ImportStmtType>(stmt)->name;
+        if (g_stdlib.find(name) == g_stdlib.end()) names.push_back(name);
+    }
+
+    return names;
+}
+
+} // namespace
+
+std::shared_ptr<Module> Registry::load(const fs::path& path, const std::shared_ptr<Context>& importer)
+{
+    fs::path canonical = canonicalize(path);
+    std::shared_ptr<Module> module;
+
+    {
+        std::lock_guard<std::mutex> lock(g_modulesMutex);
+        std::shared_ptr<Module>& entry = g_modules[canonical.string()];
+
+        if (!entry)
+        {
+            entry = std::make_shared<Module>();
+            entry->path = canonical;
+            entry->context = std::make_shared<Context>();
+            entry->context->filename = canonical.string();
+            entry->context->modules = importer->modules;
+            entry->context->project = importer->project;
+        }
+
+        module = entry;
+    }
+
+    std::lock_guard<std::mutex> lock(module->parseMutex);
+    if (module->program) return module;
+
+    std::ifstream stream(canonical);
+    if (!stream)
+    {
+        throw std::runtime_error(CustomError("Cannot read module " + canonical.string(), "ImportError"));
+    }
+
+    // A module that fails to parse keeps its entry without a program, the next load tries again
+    module->context->file = std::string((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+    module->program = Cache::parse(module->context).program;
+
+    return module;
+}
+
+std::shared_ptr<Module> Registry::import(const std::string& name, const std::shared_ptr<Context>& importer)
+{
+    auto found = importer->modules.find(name);
+
+    {
+        std::lock_guard<std::mutex> lock(g_modulesMutex);
+        g_imports[name] = found != importer->modules.end() ? found->second.string() : "";
+    }
+
+    if (found == importer->modules.end()) return nullptr;
+    return load(found->second, importer);
+}
+
+std::vector<fs::path> Registry::paths()
+{
+    std::lock_guard<std::mutex> lock(g_modulesMutex);
+
+    std::vector<fs::path> paths;
+    for (const auto& [name, module] : g_modules)
+    {
+        if (module->program) paths.push_back(module->path);
+    }
+
+    return paths;
+}
+
+std::vector<std::pair<std::string, std::string>> Registry::imports()
+{
+    std::lock_guard<std::mutex> lock(g_modulesMutex);
+    return { g_imports.begin(), g_imports.end() };
+}
+
+bool Registry::begin(Module& module, Phase& phase, const Lexer::Token& tk)
+{
+    std::unique_lock<std::mutex> lock(g_phaseMutex);
+    std::thread::id self = std::this_thread::get_id();
+
+    while (true)
+    {
+        if (phase == Phase::Done) return false;
+        if (phase == Phase::Pending)
+        {
+            phase = Phase::Running;
+            g_owners[&phase] = self;
+            return true;
+        }
+
+        // Follow the chain of waiting threads from the owner, reaching this thread again is a cycle
+        std::thread::id owner = g_owners[&phase];
+        while (owner != self)
+        {
+            auto waiting = g_waiting.find(owner);
+            if (waiting == g_waiting.end()) break;
+
+            auto next = g_owners.find(waiting->second);
+            if (next == g_owners.end()) break;
+            owner = next->second;
+        }
+
+        if (owner == self)
+        {
+            throw std::runtime_error(CustomError("Circular import of module " + module.path.string(), "ImportError", tk));
+        }
+
+        g_waiting[self] = &phase;
+        g_phaseChanged.wait(lock);
+        g_waiting.erase(self);
+    }
+}
+
+void Registry::finish(Phase& phase, bool done)
+{
+    std::lock_guard<std::mutex> lock(g_phaseMutex);
+
+    phase = done ? Phase::Done : Phase::Pending;
+    g_owners.erase(&phase);
+    g_phaseChanged.notify_all();
+}
+
+void Registry::prepare(const std::shared_ptr<AST::ProgramType>& program, const std::shared_ptr<Context>& ctx, size_t workers)
+{
+    struct Node
+    {
+        fs::path path;
+        std::shared_ptr<Module> module;
+        std::vector<size_t> dependencies;
+        std::vector<size_t> dependents;
+        size_t remaining = 0;
+        bool failed = false;
+    };
+
+    // Nodes are only appended under the mutex. A deque, so a worker's reference stays valid while others append
+    std::mutex mutex;
+    std::deque<Node> nodes;
+    std::unordered_map<std::string, size_t> indices;
+
+    // Finds or adds the node for `name` as imported from `importer`, or -1 when the module is unknown
+    auto nodeFor = [&](const std::string& name, const std::shared_ptr<Context>& importer, bool& added) -> long
+    {
+        auto found = importer->modules.find(name);
+        if (found == importer->modules.end()) return -1;
+
+        std::string key = canonicalize(found->second).string();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        auto existing = indices.find(key);
+        added = existing == indices.end();
+        if (!added) return existing->second;
+
+        indices.emplace(key, nodes.size());
+        nodes.push_back({});
+        nodes.back().path = key;
+        return nodes.size() - 1;
+    };
+
+    std::deque<std::pair<size_t, std::shared_ptr<Context>>> roots;
+    for (const std::string& name : topLevelImports(*program))
+    {
+        bool added;
+        long index = nodeFor(name, ctx, added);
+        if (index >= 0 && added) roots.push_back({ index, ctx });
+    }
+
+    // Discovery: parse each module as soon as some importer names it
+    runParallel<std::pair<size_t, std::shared_ptr<Context>>>(roots, workers, [&](auto task, const auto& push)
+    {
+        auto [index, importer] = task;
+        std::shared_ptr<Module> module;
+
+        try
+        {
+            fs::path path;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                path = nodes[index].path;
+            }
+
+            module = load(path, importer);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            nodes[index].failed = true;
+            return;
+        }
+
+        std::vector<size_t> dependencies;
+        for (const std::string& name : topLevelImports(*module->program))
+        {
+            bool added;
+            long dependency = nodeFor(name, module->context, added);
+            if (dependency < 0) continue;
+
+            dependencies.push_back(dependency);
+            if (added) push({ static_cast<size_t>(dependency), module->context });
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        nodes[index].module = module;
+        nodes[index].dependencies = std::move(dependencies);
+    });
+
+    std::deque<size_t> ready;
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+        Node& node = nodes[i];
+        std::sort(node.dependencies.begin(), node.dependencies.end());
+        node.dependencies.erase(std::unique(node.dependencies.begin(), node.dependencies.end()), node.dependencies.end());
+
+        node.remaining = node.dependencies.size();
+        for (size_t dependency : node.dependencies) nodes[dependency].dependents.push_back(i);
+
+        if (!node.failed && node.remaining == 0) ready.push_back(i);
+    }
+
+    // Checking: a module runs once all of its imports are checked. Modules on an import cycle never become ready,
+    // and dependents of a failed module are skipped, both are left to the regular check
+    runParallel<size_t>(ready, workers, [&](size_t index, const auto& push)
+    {
+        Node& node = nodes[index];
+        bool failed = false;
+
+        try
+        {
+            Typechecker::TC().checkModule(*node.module, node.module->program->token);
+        }
+        catch (...)
+        {
+            failed = true;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t dependent : node.dependents)
+        {
+            if (failed) nodes[dependent].failed = true;
+            if (--nodes[dependent].remaining == 0 && !nodes[dependent].failed) push(dependent);
+        }
+    });
+}
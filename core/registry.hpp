@@ -0,0 +1,85 @@
+#pragma once
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "context.hpp"
+#include "errors.hpp"
+#include "frontend/ast.hpp"
+#include "types.hpp"
+
+namespace Probescript::Registry
+{
+
+// How far one phase of loading a module got. Reaching a module whose phase is Running on the same thread,
+// or on a thread that is itself waiting for this one, means the imports form a cycle
+enum class Phase
+{
+    Pending,
+    Running,
+    Done,
+};
+
+// A source module, shared by every file that imports it
+struct Module
+{
+    std::filesystem::path path;
+    std::shared_ptr<Context> context;
+    std::shared_ptr<AST::ProgramType> program;
+
+    Phase checked = Phase::Pending;
+    std::unordered_map<std::string, Typechecker::TypePtr> types;
+
+    Phase evaluated = Phase::Pending;
+    Values::Val exports;
+
+    // Held while the module is read and parsed, so other modules parse at the same time
+    std::mutex parseMutex;
+};
+
+// The module at `path`, read and parsed on first use and keyed by canonical path from then on.
+// Its own imports resolve through the module table of the first importer
+std::shared_ptr<Module> load(const std::filesystem::path& path, const std::shared_ptr<Context>& importer);
+
+// The module `name` refers to from `importer`, or nullptr when the project has none by that name.
+// Every name is remembered for imports(), a cached typecheck is only reused while they resolve the same
+std::shared_ptr<Module> import(const std::string& name, const std::shared_ptr<Context>& importer);
+
+// Paths of every module loaded so far
+std::vector<std::filesystem::path> paths();
+
+// Every name passed to import() so far with the file it resolved to, empty when it resolved to none
+std::vector<std::pair<std::string, std::string>> imports();
+
+// Parses and export-checks every module reachable through the top level imports of `program` on `workers` threads,
+// leaves before dependents. Errors are not reported here: a module that failed is left Pending, so the regular
+// check that follows reaches it in source order and reports the same error on every run
+void prepare(const std::shared_ptr<AST::ProgramType>& program, const std::shared_ptr<Context>& ctx, size_t workers);
+
+// Claims `phase` for the calling thread. False if it already completed, waits while another thread runs it
+bool begin(Module& module, Phase& phase, const Lexer::Token& tk);
+void finish(Phase& phase, bool done);
+
+// Runs `fn` for one phase of `module` unless that phase already completed. A phase that throws can be retried
+template <typename Fn>
+void once(Module& module, Phase& phase, const Lexer::Token& tk, Fn&& fn)
+{
+    if (!begin(module, phase, tk)) return;
+
+    try
+    {
+        fn();
+    }
+    catch (...)
+    {
+        finish(phase, false);
+        throw;
+    }
+
+    finish(phase, true);
+}
+
+} // namespace Probescript::Registry
@@ -1,4 +1,6 @@
 #include "runtime/interpreter.hpp"
+#include "vm/vm.hpp"
+#include "loop.hpp"
 
 using namespace Probescript;
 using namespace Probescript::Interpreter;
@@ -12,85 +14,96 @@ Values::Val Interpreter::evalCall(std::shared_ptr<AST::CallExprType> call, EnvPt
         args.push_back(eval(arg, env));
     };
 
+    // Calling a method straight off its receiver skips binding it to a temporary function value
+    if (call->calee->kind == AST::NodeType::MemberExpr)
+    {
+        std::shared_ptr<AST::MemberExprType> member = std::static_pointer_cast<AST::MemberExprType>(call->calee);
+
+        if (!member->computed)
+        {
+            Values::Val object = eval(member->object, env);
+            const std::string& key = std::static_pointer_cast<AST::IdentifierType>(member->property)->symbol;
+
+            if (Values::RuntimeVal* value = object.get())
+            {
+                if (Values::Val* prop = value->properties.lookup(key, member->cache)) return evalCallWithFnVal(*prop, args, env, object);
+            }
+
+            if (const Values::NativeMethod* method = Values::findMethod(object, key))
+                return (*method)(object, args, env);
+
+            return evalCallWithFnVal(Values::getMember(object, key), args, env, object);
+        }
+    }
+
     Values::Val fn = eval(call->calee, env);
 
     return evalCallWithFnVal(fn, args, env);
 }
 
-Values::Val Interpreter::evalCallWithFnVal(Values::Val fn, std::vector<Values::Val> args, EnvPtr env)
+Values::Val Interpreter::evalCallWithFnVal(Values::Val fn, std::vector<Values::Val> args, EnvPtr env, Values::Val self)
 {
 
     if (fn == nullptr)
     {
-        throw ThrowException(CustomError("Function call target is null", "FunctionCallError", fn->token));
+        throw ThrowException(CustomError("Function call target is null", "FunctionCallError"));
     }
 
-    if (fn->type == Values::ValueType::NativeFn)
+    if (fn.type() == Values::ValueType::NativeFn)
     {
-        auto nativefn = std::static_pointer_cast<Values::NativeFnValue>(fn);
+        auto nativefn = Values::cast<Values::NativeFnValue>(fn);
 
         Values::Val result = nativefn->call(args, env);
 
         return result;
     }
 
-    if (fn->type == Values::ValueType::Function)
+    if (fn.type() == Values::ValueType::Function)
     {
-        std::shared_ptr<Values::FunctionValue> func = std::static_pointer_cast<Values::FunctionValue>(fn);
+        Values::Ref<Values::FunctionValue> func = Values::cast<Values::FunctionValue>(fn);
         
         if (func->isAsync)
         {
-            return std::make_shared<Values::FutureVal>(std::async(std::launch::async, [func, env, args]() -> Values::Val
+            return Loop::spawn([func, env, args, self]() -> Values::Val
             {
-                EnvPtr scope = std::make_shared<Env>(func->declarationEnv);
+                EnvPtr scope = std::make_shared<Env>(closureEnv(*func, env), func->scope);
+                bindThis(*func, *scope, self, env);
 
                 for (int i = 0; i < func->params.size(); i++)
                 {
-                    std::string varname = func->params[i]->identifier;
                     Values::Val value = (i < args.size()) ? args[i] : eval(func->params[i]->value, env);
-                    scope->declareVar(varname, value, Lexer::Token());
+                    scope->declareVar(func->params[i]->address, func->params[i]->identifier, value, Lexer::Token());
                 }
 
-                Values::Val result = std::make_shared<Values::UndefinedVal>();
+                Values::Completion completion = evalBody(func->body, scope);
+                if (completion.type == Values::Completion::Type::Return) return completion.value;
 
-                try
-                {
-                    evalBody(func->body, scope);
-                }
-                catch (const Values::ReturnSignal& ret)
-                {
-                    result = ret.get(); 
-                }
-                
-                return result;
-            }));
+                return settle(completion, func->token);
+            });
+        }
+        else if (VM::enabled())
+        {
+            return VM::call(func, args, env, self);
         }
         else
         {
-            EnvPtr scope = std::make_shared<Env>(func->declarationEnv);
+            EnvPtr scope = std::make_shared<Env>(closureEnv(*func, env), func->scope);
+            bindThis(*func, *scope, self, env);
 
             for (int i = 0; i < func->params.size(); i++)
             {
-                std::string varname = func->params[i]->identifier;
                 Values::Val value = (i < args.size()) ? args[i] : eval(func->params[i]->value, env);
-                scope->declareVar(varname, value, fn->token);
+                scope->declareVar(func->params[i]->address, func->params[i]->identifier, value, func->token);
             }
-            Values::Val result = std::make_shared<Values::UndefinedVal>();
 
-            try
-            {
-                evalBody(func->body, scope);
-            }
-            catch (const Values::ReturnSignal& ret)
-            {
-                result = ret.get(); 
-            }
-            
-            return result;
+            Values::Completion completion = evalBody(func->body, scope);
+            if (completion.type == Values::Completion::Type::Return) return completion.value;
+
+            return settle(completion, func->token);
         }
     }
 
-    if (fn->type == Values::ValueType::Probe)
+    if (fn.type() == Values::ValueType::Probe)
     {
         return evalProbeCall(fn, env, args);
     }
@@ -101,15 +114,16 @@ Values::Val Interpreter::evalCallWithFnVal(Values::Val fn, std::vector<Values::V
 Values::Val Interpreter::evalAwaitExpr(std::shared_ptr<AST::AwaitExprType> expr, EnvPtr env) {
     Values::Val result = eval(expr->caller, env);
     
-    if (result->type != Values::ValueType::Future)
+    if (result.type() != Values::ValueType::Future)
     {
         throw ThrowException(CustomError("'await' requires a future", "AwaitError", expr->caller->token));
     }
     
-    std::shared_ptr<Values::FutureVal> future = std::static_pointer_cast<Values::FutureVal>(result);
+    Values::Ref<Values::FutureVal> future = Values::cast<Values::FutureVal>(result);
     
     try
     {
+        Loop::await(future);
         return future->future.get();
     }
     catch (...)
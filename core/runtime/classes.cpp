@@ -5,16 +5,75 @@ using namespace Probescript::Interpreter;
 
 Values::Val Interpreter::evalClassDefinition(std::shared_ptr<AST::ClassDefinitionType> def, EnvPtr env)
 {
-    return env->declareVar(def->name, def->doesExtend ? Values::makeVal<Values::ClassVal>(def->token, def->name, env, def->body, def->extends) : Values::makeVal<Values::ClassVal>(def->token, def->name, env, def->body), def->token);
+    Values::Ref<Values::ClassVal> superclass;
+
+    if (def->doesExtend)
+    {
+        Values::Val extendsVal = eval(def->extends, env);
+        if (extendsVal.type() != Values::ValueType::Class)
+        {
+            throw ThrowException(CustomError("Superclass must be a class", "ClassInheritanceError", def->extends->token));
+        }
+
+        superclass = Values::cast<Values::ClassVal>(extendsVal);
+    }
+
+    Values::Ref<Values::ClassVal> cls = Values::makeVal<Values::ClassVal>(def->token, def->name, env, def->body, superclass);
+
+    // Instances start as a copy of the superclass prototype, so inherited members keep their slots
+    // and a method overridden here replaces the inherited one in place
+    if (superclass) cls->prototype = superclass->prototype;
+
+    // Constructors are kept out of the prototype, the superclass one is reachable as `super` from methods
+    Values::Val superConstructor = superclass ? superclass->constructor : nullptr;
+
+    for (std::shared_ptr<AST::Stmt> stmt : def->body)
+    {
+        switch (stmt->kind)
+        {
+            case AST::NodeType::FunctionDeclaration:
+            {
+                Values::Ref<Values::FunctionValue> fnval = Values::cast<Values::FunctionValue>(evalFunctionDeclaration(std::static_pointer_cast<AST::FunctionDeclarationType>(stmt), env, true));
+                fnval->isMethod = true;
+                fnval->superConstructor = superConstructor;
+
+                if (fnval->name == "new") cls->constructor = fnval;
+                else cls->prototype[fnval->name] = fnval;
+                break;
+            }
+            case AST::NodeType::VarDeclaration:
+            {
+                cls->prototype[std::static_pointer_cast<AST::VarDeclarationType>(stmt)->identifier];
+                cls->initializers.push_back(stmt);
+                break;
+            }
+            case AST::NodeType::AssignmentExpr:
+            {
+                std::shared_ptr<AST::AssignmentExprType> assign = std::static_pointer_cast<AST::AssignmentExprType>(stmt);
+                if (assign->op != "=")
+                {
+                    throw ThrowException(CustomError("Only = assignment is allowed in class bodies", "ClassBodyError", assign->token));
+                }
+
+                cls->prototype[std::static_pointer_cast<AST::IdentifierType>(assign->assigne)->symbol];
+                cls->initializers.push_back(stmt);
+                break;
+            }
+            default:
+                cls->initializers.push_back(stmt);
+        }
+    }
+
+    return env->declareVar(def->address, def->name, cls, def->token);
 }
 
 Values::Val Interpreter::evalNewExpr(std::shared_ptr<AST::NewExprType> newexpr, EnvPtr env)
 {
     Values::Val rawcls = eval(newexpr->constructor, env);
 
-    if (rawcls->type == Values::ValueType::NativeClass)
+    if (rawcls.type() == Values::ValueType::NativeClass)
     {
-        std::shared_ptr<Values::NativeClassVal> natcls = std::static_pointer_cast<Values::NativeClassVal>(rawcls);
+        Values::Ref<Values::NativeClassVal> natcls = Values::cast<Values::NativeClassVal>(rawcls);
         std::vector<Values::Val> args;
 
         for (std::shared_ptr<AST::Expr> expr : newexpr->args)
@@ -25,110 +84,75 @@ Values::Val Interpreter::evalNewExpr(std::shared_ptr<AST::NewExprType> newexpr,
         return natcls->constructor(args, std::make_shared<Env>(env));
     }
 
-    if (rawcls->type != Values::ValueType::Class)
+    if (rawcls.type() != Values::ValueType::Class)
     {
         throw ThrowException(CustomError("Cannot construct non class value", "NewError", newexpr->constructor->token));
     }
 
-    std::shared_ptr<Values::ClassVal> cls = std::static_pointer_cast<Values::ClassVal>(rawcls);
+    Values::Ref<Values::ClassVal> cls = Values::cast<Values::ClassVal>(rawcls);
     std::vector<Values::Val> args;
 
     for (std::shared_ptr<AST::Expr> expr : newexpr->args)
     {
         args.push_back(eval(expr, env));
     }
-    
-    EnvPtr scope = std::make_shared<Env>(env);
-    std::shared_ptr<Values::ObjectVal> thisObj = std::make_shared<Values::ObjectVal>();
-    scope->declareVar("this", thisObj, cls->token);
-
-    inheritClass(cls, scope, thisObj, args);
-
-    for (std::shared_ptr<AST::Stmt> stmt : cls->body) {
-        switch (stmt->kind) {
-            case AST::NodeType::FunctionDeclaration: {
-                std::shared_ptr<Values::FunctionValue> fnval = std::static_pointer_cast<Values::FunctionValue>(evalFunctionDeclaration(std::static_pointer_cast<AST::FunctionDeclarationType>(stmt), scope, true));
-                thisObj->properties[fnval->name] = fnval;
-                break;
-            }
-            case AST::NodeType::VarDeclaration: {
+
+    Values::Ref<Values::ObjectVal> thisObj = Values::make<Values::ObjectVal>(cls->prototype);
+    initializeFields(*cls, thisObj);
+
+    if (cls->constructor != nullptr)
+    {
+        evalCallWithFnVal(cls->constructor, args, env, thisObj);
+    }
+
+    return thisObj;
+}
+
+void Interpreter::initializeFields(const Values::ClassVal& cls, Values::Ref<Values::ObjectVal> thisObj)
+{
+    if (cls.superclass) initializeFields(*cls.superclass, thisObj);
+    if (cls.initializers.empty()) return;
+
+    EnvPtr scope = std::make_shared<Env>(cls.parentEnv);
+    scope->declareVar("this", thisObj, cls.token);
+    if (cls.superclass && cls.superclass->constructor != nullptr) scope->declareVar("super", cls.superclass->constructor, cls.token);
+
+    for (const std::shared_ptr<AST::Stmt>& stmt : cls.initializers)
+    {
+        switch (stmt->kind)
+        {
+            case AST::NodeType::VarDeclaration:
+            {
                 std::shared_ptr<AST::VarDeclarationType> var = std::static_pointer_cast<AST::VarDeclarationType>(stmt);
                 thisObj->properties[var->identifier] = eval(var->value, scope);
                 break;
             }
-            case AST::NodeType::AssignmentExpr: {
+            case AST::NodeType::AssignmentExpr:
+            {
                 std::shared_ptr<AST::AssignmentExprType> assign = std::static_pointer_cast<AST::AssignmentExprType>(stmt);
-                if (assign->op != "=") {
-                    throw ThrowException(CustomError("Only = assignment is allowed in class bodies", "ClassBodyError"));
-                }
+                const std::string& name = std::static_pointer_cast<AST::IdentifierType>(assign->assigne)->symbol;
 
                 EnvPtr assignEnv = std::make_shared<Env>();
-
-                assignEnv->declareVar(std::static_pointer_cast<AST::IdentifierType>(assign->assigne)->symbol, std::make_shared<Values::UndefinedVal>(), assign->token);
+                assignEnv->declareVar(name, Values::makeUndefined(), assign->token);
 
                 evalAssignment(assign, assignEnv);
 
-                thisObj->properties[std::static_pointer_cast<AST::IdentifierType>(assign->assigne)->symbol] = assignEnv->variables[std::static_pointer_cast<AST::IdentifierType>(assign->assigne)->symbol];
+                thisObj->properties[name] = assignEnv->variables[name];
                 break;
             }
-        
             default:
-                eval(stmt, env);
+                eval(stmt, scope);
         }
     }
-    
-
-    if (std::static_pointer_cast<Values::ObjectVal>(scope->variables["this"])->properties.find("new") != std::static_pointer_cast<Values::ObjectVal>(scope->variables["this"])->properties.end())
-    {
-        Values::Val constructor = thisObj->properties["new"];
-        evalCallWithFnVal(constructor, args, scope);
-    }
-
-    return scope->lookupVar("this", newexpr->token);
 }
 
-void Interpreter::inheritClass(std::shared_ptr<Values::ClassVal> cls, EnvPtr env, std::shared_ptr<Values::ObjectVal> thisObj, std::vector<Values::Val> args)
+void Interpreter::bindThis(const Values::FunctionValue& fn, Env& scope, Values::Val self, const EnvPtr& callerEnv)
 {
-    if (!cls->doesExtend) return;
-
-    Values::Val extendsVal = eval(cls->extends, cls->parentEnv);
-    if (extendsVal->type != Values::ValueType::Class)
-    {
-        throw ThrowException(CustomError("Superclass must be a class", "ClassInheritanceError"));
-        return;
-    }
-
-    EnvPtr superScope = std::make_shared<Env>(cls->parentEnv);
-    std::shared_ptr<Values::ClassVal> superClass = std::static_pointer_cast<Values::ClassVal>(extendsVal);
-    superScope->declareVar("this", thisObj, superClass->token);
-
-    inheritClass(superClass, superScope, thisObj, args);
-
-    Values::Val cons;
+    if (!fn.isMethod) return;
 
-    for (std::shared_ptr<AST::Stmt> stmt : superClass->body)
-    {
-        if (stmt->kind == AST::NodeType::FunctionDeclaration)
-        {
-            std::shared_ptr<Values::FunctionValue> fnval = std::static_pointer_cast<Values::FunctionValue>(evalFunctionDeclaration(std::static_pointer_cast<AST::FunctionDeclarationType>(stmt), superScope, true));
-            if (fnval->name == "new")
-            {
-                cons = fnval;
-            } else thisObj->properties[fnval->name] = fnval;
-        } else if (stmt->kind == AST::NodeType::VarDeclaration)
-        {
-            std::shared_ptr<AST::VarDeclarationType> decl = std::static_pointer_cast<AST::VarDeclarationType>(stmt);
+    if (fn.boundThis != nullptr) self = fn.boundThis;
+    else if (self == nullptr) self = callerEnv->lookupVar("this", fn.token);
 
-            thisObj->properties[decl->identifier] = eval(decl->value, superScope);
-        } else
-        {
-            eval(stmt, superScope);
-        }
-    }
-
-
-    if (cons != nullptr)
-    {
-        env->declareVar("super", cons, cls->extends->token);
-    }
-}
\ No newline at end of file
+    scope.declareVar("this", self, fn.token);
+    if (fn.superConstructor != nullptr) scope.declareVar("super", fn.superConstructor, fn.token);
+}
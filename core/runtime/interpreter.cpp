@@ -15,7 +15,9 @@ Values::Val Interpreter::evalArray(std::shared_ptr<AST::ArrayLiteralType> expr,
 }
 
 Values::Val Interpreter::evalArrowFunction(std::shared_ptr<AST::ArrowFunctionType> fn, EnvPtr env) {
-    return Values::makeVal<Values::FunctionValue>(fn->token, "arrow", fn->params, env, fn->body);
+    Values::Ref<Values::FunctionValue> value = Values::makeVal<Values::FunctionValue>(fn->token, "arrow", fn->params, env, fn->body);
+    value->scope = fn->scope;
+    return value;
 }
 
 Values::Val Interpreter::evalTemplateCall(std::shared_ptr<AST::TemplateCallType> call, EnvPtr env)
@@ -25,28 +27,33 @@ Values::Val Interpreter::evalTemplateCall(std::shared_ptr<AST::TemplateCallType>
     std::string name = "template";
     std::vector<std::shared_ptr<AST::VarDeclarationType>> params;
     std::vector<std::shared_ptr<AST::Stmt>> body;
+    std::shared_ptr<AST::Scope> fnScope;
 
-    if (caller->type == Values::ValueType::Function)
+    if (caller.type() == Values::ValueType::Function)
     {
-        std::shared_ptr<Values::FunctionValue> fn = std::static_pointer_cast<Values::FunctionValue>(caller);
-        scope = fn->declarationEnv;
+        Values::Ref<Values::FunctionValue> fn = Values::cast<Values::FunctionValue>(caller);
+        scope = closureEnv(*fn, env);
         name = fn->name;
         params = fn->params;
         body = fn->body;
+        fnScope = fn->scope;
 
         for (size_t i = 0; i < fn->templateparams.size(); i++)
         {
             scope->declareVar(
+                fn->templateparams[i]->address,
                 fn->templateparams[i]->identifier, 
                 (call->templateArgs.size() > i 
                     ? eval(call->templateArgs[i], scope) 
-                    : std::make_shared<Values::UndefinedVal>()),
+                    : Values::makeUndefined()),
                 fn->templateparams[i]->token
             );
         }
     }
 
-    return Values::makeVal<Values::FunctionValue>(call->token, name, params, scope, body);
+    Values::Ref<Values::FunctionValue> fn = Values::makeVal<Values::FunctionValue>(call->token, name, params, scope, body);
+    fn->scope = fnScope;
+    return fn;
 }
 
 Values::Val Interpreter::evalAssignment(std::shared_ptr<AST::AssignmentExprType> assignment, EnvPtr env)
@@ -56,54 +63,50 @@ Values::Val Interpreter::evalAssignment(std::shared_ptr<AST::AssignmentExprType>
         throw ThrowException(CustomError("Expected Identifier in assignment", "AssignmentError", assignment->token));
     }
 
-    std::string varName = std::static_pointer_cast<AST::IdentifierType>(assignment->assigne)->symbol;
+    const AST::IdentifierType& ident = *std::static_pointer_cast<AST::IdentifierType>(assignment->assigne);
 
     Values::Val leftVal = eval(assignment->assigne, env);
     Values::Val rightVal = eval(assignment->value, env);
 
-    if (assignment->op == "=")
+    switch (assignment->opType)
     {
-        return env->assignVar(varName, rightVal, assignment->token);
-    }
-
-    Values::Val result;
-
-    if (assignment->op == "-=") result = leftVal->sub(rightVal);
-    else if (assignment->op == "*=") result = leftVal->mul(rightVal);
-    else if (assignment->op == "/=") result = leftVal->div(rightVal);
-    else if (assignment->op == "+=") result = leftVal->add(rightVal);
-    else {
-        throw ThrowException(CustomError("Unsupported assignment operator: " + assignment->op, "AssignmentError", assignment->token));
+        case AST::Operator::Assign:
+            return env->assignVar(ident, rightVal);
+        case AST::Operator::AddAssign:
+        case AST::Operator::SubAssign:
+        case AST::Operator::MulAssign:
+        case AST::Operator::DivAssign:
+            return env->assignVar(ident, applyBinary(AST::arithmeticOf(assignment->opType), leftVal, rightVal, assignment->token));
+        default:
+            throw ThrowException(CustomError("Unsupported assignment operator: " + assignment->op, "AssignmentError", assignment->token));
     }
-
-    return env->assignVar(varName, result, assignment->token);
 }
 
 Values::Val Interpreter::evalUnaryPostfix(std::shared_ptr<AST::UnaryPostFixType> expr, EnvPtr env)
 {
     if (expr->assigne->kind == AST::NodeType::Identifier)
     {
-        std::string varName = std::static_pointer_cast<AST::IdentifierType>(expr->assigne)->symbol;
-        Values::Val current = env->lookupVar(varName, expr->assigne->token);
+        const AST::IdentifierType& ident = *std::static_pointer_cast<AST::IdentifierType>(expr->assigne);
+        Values::Val current = env->lookupVar(ident);
 
-        if (current->type != Values::ValueType::Number)
+        if (current.type() != Values::ValueType::Number)
         {
-            throw ThrowException(CustomError("Postfix operators only supported on numbers", "OperatorError", current->token));
+            throw ThrowException(CustomError("Postfix operators only supported on numbers", "OperatorError", expr->assigne->token));
         }
 
-        double value = std::static_pointer_cast<Values::NumberVal>(current)->toNum();
+        double value = current.asNumber();
         double newValue = value;
 
-        if (expr->op == "++") newValue = value + 1;
-        else if (expr->op == "--") newValue = value - 1;
+        if (expr->opType == AST::Operator::Increment) newValue = value + 1;
+        else if (expr->opType == AST::Operator::Decrement) newValue = value - 1;
         else
         {
             throw ThrowException(CustomError("Unknown postfix operator: " + expr->op, "OperatorError", expr->token));
         }
 
-        env->assignVar(varName, Values::makeVal<Values::NumberVal>(expr->token, newValue), expr->token);
+        env->assignVar(ident, Values::makeNumber(newValue));
 
-        return Values::makeVal<Values::NumberVal>(expr->token, value);
+        return Values::makeNumber(value);
     } else if (expr->assigne->kind == AST::NodeType::MemberExpr) {
         auto member = std::make_shared<AST::MemberAssignmentType>(
             std::static_pointer_cast<AST::MemberExprType>(expr->assigne)->object,
@@ -117,359 +120,312 @@ Values::Val Interpreter::evalUnaryPostfix(std::shared_ptr<AST::UnaryPostFixType>
         return evalMemberAssignment(member, env);
     }
 
-    return std::make_shared<Values::UndefinedVal>();
+    return Values::makeUndefined();
 }
 
 
 Values::Val Interpreter::evalUnaryPrefix(std::shared_ptr<AST::UnaryPrefixType> expr, EnvPtr env) {
     Values::Val val = eval(expr->assigne, env);
 
-    if (expr->op == "!")
+    if (expr->opType == AST::Operator::Not)
     {
-        return Values::makeVal<Values::BooleanVal>(expr->token, !val->toBool());
+        return Values::makeBool(!val.toBool());
     }
 
-    return std::make_shared<Values::UndefinedVal>();
+    return Values::makeUndefined();
 }
 
 
-std::unordered_set<std::string> booleanOperators = { "&&", "||", ">=", "<=", "<", ">", "!=", "==" };
-
 Values::Val Interpreter::evalBinExpr(std::shared_ptr<AST::BinaryExprType> binop, EnvPtr env) {
-    if (booleanOperators.count(binop->op))
-    {
-        return evalBooleanBinExpr(binop, env);
-    }
-
     Values::Val left = eval(binop->left, env);
     Values::Val right = eval(binop->right, env);
 
-    std::string op = binop->op;
-    if (op == "+") {
-        return left->add(right);
-    } else if (op == "-") {
-        return left->sub(right);
-    } else if (op == "*") {
-        return left->mul(right);
-    } else if (op == "/") {
-        return left->div(right);
-    } else if (op == "%") {
-        return left->mod(right);
+    return applyBinary(binop->opType, left, right, binop->token);
+}
+
+// Both operands are already evaluated, && and || included
+Values::Val Interpreter::applyBinary(AST::Operator op, const Values::Val& left, const Values::Val& right, const Lexer::Token& tk)
+{
+    if (left.isNumber() && right.isNumber())
+    {
+        double l = left.asNumber();
+        double r = right.asNumber();
+
+        switch (op)
+        {
+            case AST::Operator::Add: return Values::makeNumber(l + r);
+            case AST::Operator::Sub: return Values::makeNumber(l - r);
+            case AST::Operator::Mul: return Values::makeNumber(l * r);
+            case AST::Operator::Div: return Values::makeNumber(l / r);
+            case AST::Operator::Mod: return Values::makeNumber(fmod(l, r));
+            case AST::Operator::Equal: return Values::makeBool(l == r);
+            case AST::Operator::NotEqual: return Values::makeBool(l != r);
+            case AST::Operator::Less: return Values::makeBool(l < r);
+            case AST::Operator::Greater: return Values::makeBool(l > r);
+            case AST::Operator::LessEqual: return Values::makeBool(l <= r);
+            case AST::Operator::GreaterEqual: return Values::makeBool(l >= r);
+            default: break;
+        }
     }
 
-    throw ThrowException(CustomError("Invalid operants: " + left->toString() + " and " + right->toString(), "OperatorError", binop->token));
+    switch (op)
+    {
+        case AST::Operator::Add: return left.add(right);
+        case AST::Operator::Sub: return left.sub(right);
+        case AST::Operator::Mul: return left.mul(right);
+        case AST::Operator::Div: return left.div(right);
+        case AST::Operator::Mod: return left.mod(right);
+        case AST::Operator::Equal: return Values::makeBool(left.equals(right));
+        case AST::Operator::NotEqual: return Values::makeBool(!left.equals(right));
+        case AST::Operator::Less: return Values::makeBool(left.toNum() < right.toNum());
+        case AST::Operator::Greater: return Values::makeBool(left.toNum() > right.toNum());
+        case AST::Operator::LessEqual: return Values::makeBool(left.toNum() <= right.toNum());
+        case AST::Operator::GreaterEqual: return Values::makeBool(left.toNum() >= right.toNum());
+        case AST::Operator::And: return Values::makeBool(left.toBool() && right.toBool());
+        case AST::Operator::Or: return Values::makeBool(left.toBool() || right.toBool());
+        default: break;
+    }
+
+    throw ThrowException(CustomError("Invalid operants: " + left.toString() + " and " + right.toString(), "OperatorError", tk));
 }
 
-Values::Val Interpreter::evalBody(std::vector<std::shared_ptr<AST::Stmt>> body, EnvPtr env, bool isLoop)
+Values::Completion Interpreter::evalBody(const std::vector<std::shared_ptr<AST::Stmt>>& body, EnvPtr env)
 {
-    for (std::shared_ptr<AST::Stmt> stmt : body)
+    for (const std::shared_ptr<AST::Stmt>& stmt : body)
     {
-        eval(stmt, env);
+        Values::Completion completion = exec(stmt, env);
+        if (completion.isAbrupt()) return completion;
     }
 
-    return std::make_shared<Values::UndefinedVal>();
+    return {};
 }
 
 Values::Val Interpreter::evalTernaryExpr(std::shared_ptr<AST::TernaryExprType> expr, EnvPtr env)
 {
     Values::Val cond = eval(expr->cond, env);
 
-    if (cond->toBool())
+    if (cond.toBool())
         return eval(expr->cons, env);
     else
         return eval(expr->alt, env);
 }
 
-Values::Val Interpreter::evalBooleanBinExpr(std::shared_ptr<AST::BinaryExprType> binop, EnvPtr env)
-{
-    Values::Val left = eval(binop->left, env);
-    Values::Val right = eval(binop->right, env);
-
-    const std::string& op = binop->op;
-
-    if (op == "&&" || op == "||")
-    {
-        bool l = left->toBool();
-        bool r = right->toBool();
-        return Values::makeVal<Values::BooleanVal>(binop->token, ((op == "&&") ? (l && r) : (l || r)));
-    }
-
-    if (op == "==" || op == "!=")
-    {
-        bool result = *left == *right;
-        return Values::makeVal<Values::BooleanVal>(binop->token, op == "==" ? result : !result);
-    }
-
-    if (op == "<" || op == ">" || op == "<=" || op == ">=")
-    {
-        double l = left->toNum();
-        double r = right->toNum();
-        bool result = false;
-
-        if (op == "<") result = l < r;
-        else if (op == ">") result = l > r;
-        else if (op == "<=") result = l <= r;
-        else if (op == ">=") result = l >= r;
-
-        return Values::makeVal<Values::BooleanVal>(binop->token, result);
-    }
-
-    throw ThrowException(CustomError("Invalid binary boolean operator: " + op, "OperatorError", binop->token));
-}
-
 Values::Val Interpreter::evalFunctionDeclaration(std::shared_ptr<AST::FunctionDeclarationType> declaration, EnvPtr env, bool onlyValue)
 {
-    std::shared_ptr<Values::FunctionValue> fn = Values::makeVal<Values::FunctionValue>(declaration->token, declaration->name, declaration->parameters, env, declaration->body, declaration->isAsync);
+    Values::Ref<Values::FunctionValue> fn = Values::makeVal<Values::FunctionValue>(declaration->token, declaration->name, declaration->parameters, env, declaration->body, declaration->isAsync);
     fn->templateparams = declaration->templateparams;
+    fn->scope = declaration->scope;
 
-    return onlyValue ? fn : env->declareVar(declaration->name, fn, declaration->token);
+    return onlyValue ? fn : env->declareVar(declaration->address, declaration->name, fn, declaration->token);
 }
 
 Values::Val Interpreter::evalIdent(std::shared_ptr<AST::IdentifierType> ident, EnvPtr env)
 {
-    Values::Val value = env->lookupVar(ident->symbol, ident->token);
-    return value;
+    return env->lookupVar(*ident);
 }
 
-Values::Val Interpreter::evalIfStmt(std::shared_ptr<AST::IfStmtType> stmt, EnvPtr baseEnv)
+Values::Completion Interpreter::evalIfStmt(std::shared_ptr<AST::IfStmtType> stmt, EnvPtr baseEnv)
 {
     Values::Val condition = eval(stmt->condition, baseEnv);
 
-    bool cond = condition->toBool();
+    bool cond = condition.toBool();
 
     if (cond)
     {
-        EnvPtr env = std::make_shared<Env>(baseEnv);
+        EnvPtr env = std::make_shared<Env>(baseEnv, stmt->scope);
         return evalBody(stmt->body, env);
     }
     else if (stmt->hasElse)
     {
-        EnvPtr env = std::make_shared<Env>(baseEnv);
+        EnvPtr env = std::make_shared<Env>(baseEnv, stmt->elseScope);
         return evalBody(stmt->elseStmt, env);
     }
 
-    return std::make_shared<Values::UndefinedVal>();
+    return {};
 }
 
 Values::Val Interpreter::evalImportStmt(std::shared_ptr<AST::ImportStmtType> importstmt, EnvPtr envptr, std::shared_ptr<Context> context)
 {
     std::string modulename = importstmt->name;
 
-    std::unordered_map<std::string, Values::Val> stdlib;
-
-    for (const auto& [key, pair] : g_stdlib)
-        stdlib[key] = pair.first;
-        
-    if (stdlib.find(modulename) != stdlib.end())
+    auto stdlib = g_stdlib.find(modulename);
+    if (stdlib != g_stdlib.end())
     {
         if (importstmt->hasMember)
         {
             std::shared_ptr<AST::Expr> member = importstmt->module;
             EnvPtr modEnv = std::make_shared<Env>();
-            modEnv->declareVar(modulename, stdlib[modulename], member->token);
-            envptr->declareVar(importstmt->customIdent ? importstmt->ident : std::static_pointer_cast<AST::MemberExprType>(importstmt->module)->lastProp, eval(member, modEnv), member->token);
+            modEnv->declareVar(modulename, stdlib->second.first, member->token);
+            envptr->declareVar(importstmt->address, importstmt->customIdent ? importstmt->ident : std::static_pointer_cast<AST::MemberExprType>(importstmt->module)->lastProp.str(), eval(member, modEnv), member->token);
         }
-        else envptr->declareVar(importstmt->customIdent ? importstmt->ident : modulename, stdlib[modulename], importstmt->token);
-        return std::make_shared<Values::UndefinedVal>();
+        else envptr->declareVar(importstmt->address, importstmt->customIdent ? importstmt->ident : modulename, stdlib->second.first, importstmt->token);
+        return Values::makeUndefined();
     }
 
-    if (context->modules.find(modulename) == context->modules.end())
+    // Every importer shares the module's exports, it runs once per process
+    std::shared_ptr<Registry::Module> module = Registry::import(modulename, context);
+    if (!module)
     {
         throw ThrowException(CustomError("Cannot find module " + modulename, "ImportError", importstmt->token));
     }
 
-    fs::path filepath = context->modules[modulename];
-
-    std::ifstream stream(filepath);
-
-    std::string file((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
-
-    Parser parser;
-
-    std::shared_ptr<AST::ProgramType> program = parser.parse(file);
-
-    std::shared_ptr<Context> conf = std::make_shared<Context>(RuntimeType::Exports);
-
-    conf->modules = context->modules;
+    Registry::once(*module, module->evaluated, importstmt->token, [&]()
+    {
+        std::shared_ptr<Context> conf = std::make_shared<Context>(RuntimeType::Exports);
+        conf->filename = module->context->filename;
+        conf->modules = module->context->modules;
+        conf->project = module->context->project;
 
-    Values::Val evaluated = eval(program, std::make_shared<Env>(), conf);
+        module->exports = eval(module->program, std::make_shared<Env>(), conf);
+    });
 
-    std::shared_ptr<Values::ObjectVal> moduleObj = Values::makeVal<Values::ObjectVal>(importstmt->token, evaluated->exports);
+    Values::Ref<Values::ObjectVal> moduleObj = Values::cast<Values::ObjectVal>(module->exports);
 
     if (importstmt->hasMember)
     {
         std::shared_ptr<AST::Expr> member = importstmt->module;
         EnvPtr modEnv = std::make_shared<Env>();
         modEnv->declareVar(modulename, moduleObj, member->token);
-        envptr->declareVar(importstmt->customIdent ? importstmt->ident : std::static_pointer_cast<AST::MemberExprType>(importstmt->module)->lastProp, eval(member, modEnv), member->token);
+        envptr->declareVar(importstmt->address, importstmt->customIdent ? importstmt->ident : std::static_pointer_cast<AST::MemberExprType>(importstmt->module)->lastProp.str(), eval(member, modEnv), member->token);
     }
-    else envptr->declareVar(importstmt->customIdent ? importstmt->ident : modulename, moduleObj, importstmt->token);
+    else envptr->declareVar(importstmt->address, importstmt->customIdent ? importstmt->ident : modulename, moduleObj, importstmt->token);
 
-    return std::make_shared<Values::UndefinedVal>();
+    return Values::makeUndefined();
 }
 
 Values::Val Interpreter::evalMemberAssignment(std::shared_ptr<AST::MemberAssignmentType> expr, EnvPtr env)
 {
     Values::Val obj = eval(expr->object, env);
     Values::Val value = eval(expr->newvalue, env);
+    Values::Val propValue = expr->computed ? eval(expr->property, env) : Values::makeUndefined();
 
+    return assignMember(*expr, obj, propValue, value);
+}
+
+Values::Val Interpreter::assignMember(const AST::MemberAssignmentType& expr, Values::Val obj, Values::Val propValue, Values::Val value)
+{
     std::string key;
 
-    if (expr->computed)
+    if (expr.computed)
     {
-        Values::Val propValue = eval(expr->property, env);
 
-        if (propValue->type == Values::ValueType::Number)
+        if (propValue.type() == Values::ValueType::Number)
         {
-            int index = propValue->toNum();
+            int index = propValue.toNum();
 
-            if (obj->type == Values::ValueType::Array)
+            if (obj.type() == Values::ValueType::Array)
             {
-                std::shared_ptr<Values::ArrayVal> array = std::static_pointer_cast<Values::ArrayVal>(obj);
+                Values::Ref<Values::ArrayVal> array = Values::cast<Values::ArrayVal>(obj);
 
                 if (index >= array->items.size())
                 {
-                    array->items.resize(index + 1, std::make_shared<Values::UndefinedVal>());
+                    array->items.resize(index + 1, Values::makeUndefined());
                 }
 
-                if (expr->op == "=")
+                if (expr.opType == AST::Operator::Assign)
                 {
                     array->items[index] = value;
                 }
-                else if (expr->op == "+=")
-                {
-                    array->items[index] = array->items[index]->add(value);
-                }
-                else if (expr->op == "-=")
-                {
-                    array->items[index] = array->items[index]->sub(value);
-                }
-                else if (expr->op == "*=")
+                else
                 {
-                    array->items[index] = array->items[index]->mul(value);
-                }
-                else if (expr->op == "/=")
-                {
-                    array->items[index] = array->items[index]->div(value);
-                }
-                else if (expr->op == "++")
-                {
-                    array->items[index] = array->items[index]->add(value);
-                }
-                else if (expr->op == "--")
-                {
-                    array->items[index] = array->items[index]->sub(value);
+                    array->items[index] = applyBinary(AST::arithmeticOf(expr.opType), array->items[index], value, expr.token);
                 }
                 return array;
             }
             else
             {
-                throw ThrowException(CustomError("Cannot use numeric index on non-array object", "MemberError", propValue->token));
+                throw ThrowException(CustomError("Cannot use numeric index on non-array object", "MemberError", expr.property->token));
             }
         }
 
-        if (propValue->type != Values::ValueType::String)
+        if (propValue.type() != Values::ValueType::String)
         {
-            throw ThrowException(CustomError("Computed property must evaluate to a string or number", "MemberError", expr->token));
+            throw ThrowException(CustomError("Computed property must evaluate to a string or number", "MemberError", expr.token));
         }
 
-        key = std::static_pointer_cast<Values::StringVal>(propValue)->string;
+        key = Values::cast<Values::StringVal>(propValue)->string;
     }
     else
     {
-        std::shared_ptr<AST::IdentifierType> ident = std::static_pointer_cast<AST::IdentifierType>(expr->property);
+        std::shared_ptr<AST::IdentifierType> ident = std::static_pointer_cast<AST::IdentifierType>(expr.property);
         key = ident->symbol;
     }
 
-    if (obj->type == Values::ValueType::Object)
+    if (obj.type() == Values::ValueType::Object)
     {
-        std::shared_ptr<Values::ObjectVal> objectVal = std::static_pointer_cast<Values::ObjectVal>(obj);
-        if (expr->op == "=")
-        {
-            objectVal->properties[key] = value;
-        }
-        else if (expr->op == "+=")
-        {
-            objectVal->properties[key] = objectVal->properties[key]->add(value);
-        }
-        else if (expr->op == "-=")
-        {
-            objectVal->properties[key] = objectVal->properties[key]->sub(value);
-        }
-        else if (expr->op == "*=")
-        {
-            objectVal->properties[key] = objectVal->properties[key]->mul(value);
-        }
-        else if (expr->op == "/=")
-        {
-            objectVal->properties[key] = objectVal->properties[key]->div(value);
-        }
-        else if (expr->op == "++")
-        {
-            objectVal->properties[key] = objectVal->properties[key]->add(value);
-        }
-        else if (expr->op == "--")
-        {
-            objectVal->properties[key] = objectVal->properties[key]->sub(value);
-        }
+        Values::Ref<Values::ObjectVal> objectVal = Values::cast<Values::ObjectVal>(obj);
+
+        // Properties the object already has are found through the site's inline cache
+        Values::Val* slot = expr.computed ? nullptr : objectVal->properties.lookup(key, expr.cache);
+        if (!slot) slot = expr.computed ? &objectVal->properties.computed(key) : &objectVal->properties[key];
+
+        *slot = expr.opType == AST::Operator::Assign ? value : applyBinary(AST::arithmeticOf(expr.opType), *slot, value, expr.token);
         return objectVal;
     }
 
-    throw ThrowException(CustomError("Cannot assign member to non-object/non-array value", "TypeError", expr->token));
+    throw ThrowException(CustomError("Cannot assign member to non-object/non-array value", "TypeError", expr.token));
 }
 
 Values::Val Interpreter::evalMemberExpr(std::shared_ptr<AST::MemberExprType> expr, EnvPtr env)
 {
     Values::Val obj = eval(expr->object, env);
-    
-    if (obj->type != Values::ValueType::Array || !expr->computed)
+    Values::Val propValue = expr->computed ? eval(expr->property, env) : Values::makeUndefined();
+
+    return accessMember(*expr, obj, propValue);
+}
+
+// A class method read as a value keeps the object it was read from as `this`
+static Values::Val bindMethod(const Values::Val& member, const Values::Val& obj)
+{
+    if (member.type() != Values::ValueType::Function) return member;
+
+    Values::Ref<Values::FunctionValue> fn = Values::cast<Values::FunctionValue>(member);
+    if (!fn->isMethod || fn->boundThis != nullptr) return member;
+
+    Values::Ref<Values::FunctionValue> bound = Values::make<Values::FunctionValue>(*fn);
+    bound->boundThis = obj;
+    return bound;
+}
+
+Values::Val Interpreter::accessMember(const AST::MemberExprType& expr, Values::Val obj, Values::Val propValue)
+{
+    if (!expr.computed)
     {
-        std::string key;
+        const std::string& key = static_cast<const AST::IdentifierType&>(*expr.property).symbol;
 
-        if (expr->computed)
+        if (Values::RuntimeVal* value = obj.get())
         {
-            Values::Val propValue = eval(expr->property, env);
-    
-            if (propValue->type != Values::ValueType::String)
-            {
-                throw ThrowException(CustomError("Computed property must evaluate to a string", "TypeError", expr->token));
-            }
-    
-            key = std::static_pointer_cast<Values::StringVal>(propValue)->string;
-        }
-        else
-        {
-            std::shared_ptr<AST::IdentifierType> ident = std::static_pointer_cast<AST::IdentifierType>(expr->property);
-            key = ident->symbol;
+            if (Values::Val* prop = value->properties.lookup(key, expr.cache)) return bindMethod(*prop, obj);
         }
 
-        Values::Val object = obj;
+        return Values::getMember(obj, key);
+    }
 
-        if (object->properties.count(key) == 0)
+    if (obj.type() != Values::ValueType::Array)
+    {
+        if (propValue.type() != Values::ValueType::String)
         {
-            return std::make_shared<Values::UndefinedVal>();
+            throw ThrowException(CustomError("Computed property must evaluate to a string", "TypeError", expr.token));
         }
 
-        return object->properties[key];
+        return bindMethod(Values::getMember(obj, Values::cast<Values::StringVal>(propValue)->string), obj);
     }
     else
     {
-        Values::Val indexval = eval(expr->property, env);
+        const Values::Val& indexval = propValue;
 
-        if (indexval->type != Values::ValueType::Number)
+        if (indexval.type() != Values::ValueType::Number)
         {
-            throw ThrowException(CustomError("Array index must evaluate to a number", "TypeError", expr->token));
+            throw ThrowException(CustomError("Array index must evaluate to a number", "TypeError", expr.token));
         }
 
-        std::shared_ptr<Values::NumberVal> index = std::static_pointer_cast<Values::NumberVal>(indexval);
-
-        std::shared_ptr<Values::ArrayVal> array = std::static_pointer_cast<Values::ArrayVal>(obj);
+        Values::Ref<Values::ArrayVal> array = Values::cast<Values::ArrayVal>(obj);
 
-        int idx = index->number;
+        int idx = indexval.asNumber();
 
         if (idx < 0 || idx >= static_cast<int>(array->items.size()))
         {
-            return std::make_shared<Values::UndefinedVal>();
+            return Values::makeUndefined();
         }
 
         return array->items[idx];
@@ -478,7 +434,7 @@ Values::Val Interpreter::evalMemberExpr(std::shared_ptr<AST::MemberExprType> exp
 
 Values::Val Interpreter::evalObject(std::shared_ptr<AST::MapLiteralType> obj, EnvPtr env)
 {
-    std::shared_ptr<Values::ObjectVal> object = std::make_shared<Values::ObjectVal>();
+    Values::Ref<Values::ObjectVal> object = Values::make<Values::ObjectVal>();
     for (std::shared_ptr<AST::PropertyLiteralType> property : obj->properties)
     {
         Values::Val runtimeval = (property->val == nullptr) ? env->lookupVar(property->key, property->token) : eval(property->val, env);
@@ -490,30 +446,90 @@ Values::Val Interpreter::evalObject(std::shared_ptr<AST::MapLiteralType> obj, En
 
 Values::Val Interpreter::evalVarDeclaration(std::shared_ptr<AST::VarDeclarationType> decl, EnvPtr env, bool constant)
 {
-    Values::Val value = decl->value != nullptr ? eval(decl->value, env) : std::make_shared<Values::UndefinedVal>();
-    return env->declareVar(decl->identifier, value, decl->token);
+    Values::Val value = decl->value != nullptr ? eval(decl->value, env) : Values::makeUndefined();
+    return env->declareVar(decl->address, decl->identifier, value, decl->token);
 }
 
 Values::Val Interpreter::evalThrowStmt(std::shared_ptr<AST::ThrowStmtType> stmt, EnvPtr env)
 {
-    throw ThrowException(eval(stmt->err, env)->toString());
+    throw ThrowException(eval(stmt->err, env).toString());
 }
 
-Values::Val Interpreter::evalTryStmt(std::shared_ptr<AST::TryStmtType> stmt, EnvPtr env)
+// The catch body runs like a function called with the error message, but break and continue
+// inside it still reach the enclosing loop. A return only leaves the catch body
+Values::Completion Interpreter::evalTryStmt(std::shared_ptr<AST::TryStmtType> stmt, EnvPtr env)
 {
-    std::shared_ptr<Values::FunctionValue> fn = Values::makeVal<Values::FunctionValue>(stmt->catchHandler->token, "catch", stmt->catchHandler->parameters, env, stmt->catchHandler->body);
-    EnvPtr scope = std::make_shared<Env>(env);
+    EnvPtr scope = std::make_shared<Env>(env, stmt->scope);
+    std::string message;
 
     try
     {
-        evalBody(stmt->body, scope);
+        return evalBody(stmt->body, scope);
     }
     catch (const ThrowException& e)
     {
-        evalCallWithFnVal(fn, { std::make_shared<Values::StringVal>(e.what()) }, scope);
+        message = e.what();
     }
 
-    return std::make_shared<Values::UndefinedVal>();
+    std::shared_ptr<AST::FunctionDeclarationType> handler = stmt->catchHandler;
+    EnvPtr catchScope = std::make_shared<Env>(env, handler->scope);
+
+    for (size_t i = 0; i < handler->parameters.size(); i++)
+    {
+        Values::Val value = (i == 0) ? Values::make<Values::StringVal>(message) : eval(handler->parameters[i]->value, scope);
+        catchScope->declareVar(handler->parameters[i]->address, handler->parameters[i]->identifier, value, handler->token);
+    }
+
+    Values::Completion completion = evalBody(handler->body, catchScope);
+    if (completion.type == Values::Completion::Type::Return) return {};
+
+    return completion;
+}
+
+Values::Completion Interpreter::exec(std::shared_ptr<AST::Stmt> stmt, EnvPtr env)
+{
+    switch (stmt->kind)
+    {
+        case AST::NodeType::ReturnStmt:
+            return { Values::Completion::Type::Return, eval(std::static_pointer_cast<AST::ReturnStmtType>(stmt)->val, env) };
+
+        case AST::NodeType::BreakStmt:
+            return { Values::Completion::Type::Break, {} };
+
+        case AST::NodeType::ContinueStmt:
+            return { Values::Completion::Type::Continue, {} };
+
+        case AST::NodeType::IfStmt:
+            return evalIfStmt(std::static_pointer_cast<AST::IfStmtType>(stmt), env);
+
+        case AST::NodeType::WhileStmt:
+            return evalWhileStmt(std::static_pointer_cast<AST::WhileStmtType>(stmt), env);
+
+        case AST::NodeType::ForStmt:
+            return evalForStmt(std::static_pointer_cast<AST::ForStmtType>(stmt), env);
+
+        case AST::NodeType::TryStmt:
+            return evalTryStmt(std::static_pointer_cast<AST::TryStmtType>(stmt), env);
+
+        default:
+            eval(stmt, env);
+            return {};
+    }
+}
+
+Values::Val Interpreter::settle(const Values::Completion& completion, const Lexer::Token& tk)
+{
+    switch (completion.type)
+    {
+        case Values::Completion::Type::Return:
+            throw Values::ReturnSignal(completion.value, CustomError("Did not expect return statement", "ReturnError", tk));
+        case Values::Completion::Type::Break:
+            throw Values::BreakSignal(CustomError("Did not expect break statement", "BreakError", tk));
+        case Values::Completion::Type::Continue:
+            throw Values::ContinueSignal(CustomError("Did not expect continue statement", "ContinueError", tk));
+        default:
+            return Values::makeUndefined();
+    }
 }
 
 Values::Val Interpreter::eval(std::shared_ptr<AST::Stmt> astNode, EnvPtr env, std::shared_ptr<Context> context)
@@ -523,7 +539,7 @@ Values::Val Interpreter::eval(std::shared_ptr<AST::Stmt> astNode, EnvPtr env, st
         case AST::NodeType::NumericLiteral:
         {
             std::shared_ptr<AST::NumericLiteralType> num = std::static_pointer_cast<AST::NumericLiteralType>(astNode);
-            return Values::makeVal<Values::NumberVal>(astNode->token, num->value());
+            return Values::makeNumber(num->numValue);
         }
 
         case AST::NodeType::StringLiteral:
@@ -534,24 +550,24 @@ Values::Val Interpreter::eval(std::shared_ptr<AST::Stmt> astNode, EnvPtr env, st
 
         case AST::NodeType::UndefinedLiteral:
         {
-            return std::make_shared<Values::UndefinedVal>();
+            return Values::makeUndefined();
         }
 
         case AST::NodeType::BoolLiteral:
-            return Values::makeVal<Values::BooleanVal>(astNode->token, std::static_pointer_cast<AST::BoolLiteralType>(astNode)->value);
+            return Values::makeBool(std::static_pointer_cast<AST::BoolLiteralType>(astNode)->value);
 
         case AST::NodeType::TryStmt:
-            return evalTryStmt(std::static_pointer_cast<AST::TryStmtType>(astNode), env);
+        case AST::NodeType::IfStmt:
+        case AST::NodeType::WhileStmt:
+        case AST::NodeType::ForStmt:
+        case AST::NodeType::ReturnStmt:
+        case AST::NodeType::BreakStmt:
+        case AST::NodeType::ContinueStmt:
+            return settle(exec(astNode, env), astNode->token);
 
         case AST::NodeType::ThrowStmt:
             return evalThrowStmt(std::static_pointer_cast<AST::ThrowStmtType>(astNode), env);
 
-        case AST::NodeType::ReturnStmt:
-        {
-            Values::Val value = eval(std::static_pointer_cast<AST::ReturnStmtType>(astNode)->val, env);
-            throw Values::ReturnSignal(value, CustomError("Did not expect return statement", "ReturnError", astNode->token));
-        }
-        
         case AST::NodeType::ClassDefinition:
             return evalClassDefinition(std::static_pointer_cast<AST::ClassDefinitionType>(astNode), env);
 
@@ -564,14 +580,11 @@ Values::Val Interpreter::eval(std::shared_ptr<AST::Stmt> astNode, EnvPtr env, st
         case AST::NodeType::BinaryExpr:
             return evalBinExpr(std::static_pointer_cast<AST::BinaryExprType>(astNode), env);
             
-        case AST::NodeType::WhileStmt:
-            return evalWhileStmt(std::static_pointer_cast<AST::WhileStmtType>(astNode), env);
-
         case AST::NodeType::Program:
             return evalProgram(std::static_pointer_cast<AST::ProgramType>(astNode), env, context);
 
         case AST::NodeType::NullLiteral:
-            return std::make_shared<Values::NullVal>();
+            return Values::makeNull();
 
         case AST::NodeType::Identifier:
             return evalIdent(std::static_pointer_cast<AST::IdentifierType>(astNode), env);
@@ -591,9 +604,6 @@ Values::Val Interpreter::eval(std::shared_ptr<AST::Stmt> astNode, EnvPtr env, st
         case AST::NodeType::VarDeclaration:
             return evalVarDeclaration(std::static_pointer_cast<AST::VarDeclarationType>(astNode), env);
 
-        case AST::NodeType::IfStmt:
-            return evalIfStmt(std::static_pointer_cast<AST::IfStmtType>(astNode), env);
-
         case AST::NodeType::FunctionDeclaration:
             return evalFunctionDeclaration(std::static_pointer_cast<AST::FunctionDeclarationType>(astNode), env);
 
@@ -606,9 +616,6 @@ Values::Val Interpreter::eval(std::shared_ptr<AST::Stmt> astNode, EnvPtr env, st
         case AST::NodeType::MemberAssignment:
             return evalMemberAssignment(std::static_pointer_cast<AST::MemberAssignmentType>(astNode), env);
 
-        case AST::NodeType::ForStmt:
-            return evalForStmt(std::static_pointer_cast<AST::ForStmtType>(astNode), env);
-
         case AST::NodeType::UnaryPostFix:
             return evalUnaryPostfix(std::static_pointer_cast<AST::UnaryPostFixType>(astNode), env);
         
@@ -618,12 +625,6 @@ Values::Val Interpreter::eval(std::shared_ptr<AST::Stmt> astNode, EnvPtr env, st
         case AST::NodeType::ArrowFunction:
             return evalArrowFunction(std::static_pointer_cast<AST::ArrowFunctionType>(astNode), env);
 
-        case AST::NodeType::BreakStmt:
-            throw Values::BreakSignal(CustomError("Did not expect break statement", "BreakError", astNode->token));
-        
-        case AST::NodeType::ContinueStmt:
-            throw Values::ContinueSignal(CustomError("Did not expect continue statement", "ContinueError", astNode->token));
-
         case AST::NodeType::ImportStmt:
             return evalImportStmt(std::static_pointer_cast<AST::ImportStmtType>(astNode), env, context);
 
@@ -11,6 +11,7 @@
 #include "context.hpp"
 #include "frontend/parser.hpp"
 #include "errors.hpp"
+#include "registry.hpp"
 
 namespace fs = std::filesystem;
 
@@ -19,21 +20,20 @@ extern std::unordered_map<std::string, std::pair<Probescript::Values::Val, Probe
 namespace Probescript::Interpreter
 {
 
-Values::Val evalTryStmt(std::shared_ptr<AST::TryStmtType> stmt, EnvPtr env);
+Values::Completion evalTryStmt(std::shared_ptr<AST::TryStmtType> stmt, EnvPtr env);
 Values::Val evalThrowStmt(std::shared_ptr<AST::ThrowStmtType> stmt, EnvPtr env);
 Values::Val evalArray(std::shared_ptr<AST::ArrayLiteralType> expr, EnvPtr env);
 Values::Val evalArrowFunction(std::shared_ptr<AST::ArrowFunctionType> fn, EnvPtr env);
 Values::Val evalAssignment(std::shared_ptr<AST::AssignmentExprType> assignment, EnvPtr env);
 Values::Val evalBinExpr(std::shared_ptr<AST::BinaryExprType> binop, EnvPtr env);
-Values::Val evalBody(std::vector<std::shared_ptr<AST::Stmt>> body, EnvPtr env, bool isLoop = false);
-Values::Val evalBooleanBinExpr(std::shared_ptr<AST::BinaryExprType> binop, EnvPtr env);
+Values::Completion evalBody(const std::vector<std::shared_ptr<AST::Stmt>>& body, EnvPtr env);
 Values::Val evalCall(std::shared_ptr<AST::CallExprType> call, EnvPtr env);
-Values::Val evalCallWithFnVal(Values::Val fn, std::vector<Values::Val> args, EnvPtr env);
+Values::Val evalCallWithFnVal(Values::Val fn, std::vector<Values::Val> args, EnvPtr env, Values::Val self);
 Values::Val evalClassDefinition(std::shared_ptr<AST::ClassDefinitionType> def, EnvPtr env);
 Values::Val evalFunctionDeclaration(std::shared_ptr<AST::FunctionDeclarationType> declaration, EnvPtr env, bool onlyValue = false);
-Values::Val evalForStmt(std::shared_ptr<AST::ForStmtType> forstmt, EnvPtr env);
+Values::Completion evalForStmt(std::shared_ptr<AST::ForStmtType> forstmt, EnvPtr env);
 Values::Val evalIdent(std::shared_ptr<AST::IdentifierType> ident, EnvPtr env);
-Values::Val evalIfStmt(std::shared_ptr<AST::IfStmtType> stmt, EnvPtr baseEnv);
+Values::Completion evalIfStmt(std::shared_ptr<AST::IfStmtType> stmt, EnvPtr baseEnv);
 Values::Val evalImportStmt(std::shared_ptr<AST::ImportStmtType> importstmt, EnvPtr envptr, std::shared_ptr<Context> config);
 Values::Val evalMemberAssignment(std::shared_ptr<AST::MemberAssignmentType> expr, EnvPtr env);
 Values::Val evalMemberExpr(std::shared_ptr<AST::MemberExprType> expr, EnvPtr env);
@@ -43,15 +43,36 @@ Values::Val evalProbeDeclaration(std::shared_ptr<AST::ProbeDeclarationType> prob
 Values::Val evalProgram(std::shared_ptr<AST::ProgramType> program, EnvPtr env, std::shared_ptr<Context> config);
 Values::Val evalProbeCall(Values::Val val, EnvPtr declarationEnv, std::vector<Values::Val> args = {});
 Values::Val evalVarDeclaration(std::shared_ptr<AST::VarDeclarationType> var, EnvPtr env, bool constant = false);
-Values::Val evalWhileStmt(std::shared_ptr<AST::WhileStmtType> stmt, EnvPtr env);
+Values::Completion evalWhileStmt(std::shared_ptr<AST::WhileStmtType> stmt, EnvPtr env);
 Values::Val evalUnaryPrefix(std::shared_ptr<AST::UnaryPrefixType> expr, EnvPtr env);
 Values::Val evalUnaryPostfix(std::shared_ptr<AST::UnaryPostFixType> expr, EnvPtr env);
 Values::Val evalTernaryExpr(std::shared_ptr<AST::TernaryExprType> expr, EnvPtr env);
 Values::Val evalTemplateCall(std::shared_ptr<AST::TemplateCallType> call, EnvPtr env);
 Values::Val evalAwaitExpr(std::shared_ptr<AST::AwaitExprType> expr, EnvPtr env);
 
-void inheritClass(std::shared_ptr<Values::ClassVal> cls, EnvPtr env, std::shared_ptr<Values::ObjectVal> thisObj, std::vector<Values::Val> args);
-void inheritProbe(std::shared_ptr<Values::ProbeValue> prb, EnvPtr env);
+void initializeFields(const Values::ClassVal& cls, Values::Ref<Values::ObjectVal> thisObj);
+
+// Declares `this` and `super` in the scope of a class method call. Without a receiver, `this` is
+// taken from the caller, which is how `super(...)` reaches the instance being constructed
+void bindThis(const Values::FunctionValue& fn, Env& scope, Values::Val self, const EnvPtr& callerEnv);
+// The environment a call of `fn` runs over. Probe functions take the probe call they were reached from,
+// anything else and a probe function called from outside its probe the environment it was declared in
+EnvPtr closureEnv(const Values::FunctionValue& fn, const EnvPtr& callerEnv);
+// Appends the steps that set up what `prb` inherits, superprobes first
+void inheritProbe(const Values::ProbeValue& prb, std::vector<Values::ProbeTemplate::Step>& steps);
+
+// Applies a binary operator to already evaluated operands, with a fast path when both are numbers
+Values::Val applyBinary(AST::Operator op, const Values::Val& left, const Values::Val& right, const Lexer::Token& tk);
+
+// Member access and assignment on already evaluated operands. `propValue` is only used for computed members
+Values::Val accessMember(const AST::MemberExprType& expr, Values::Val obj, Values::Val propValue);
+Values::Val assignMember(const AST::MemberAssignmentType& expr, Values::Val obj, Values::Val propValue, Values::Val value);
+
+// Executes a statement inside a function or loop body, reporting return/break/continue as a completion
+Values::Completion exec(std::shared_ptr<AST::Stmt> stmt, EnvPtr env);
+
+// Throws the signal for a completion that escaped its function or loop, returns the value of a normal one
+Values::Val settle(const Values::Completion& completion, const Lexer::Token& tk);
 
 Values::Val eval(std::shared_ptr<AST::Stmt> astNode, EnvPtr env, std::shared_ptr<Context> config = std::make_shared<Context>());
 
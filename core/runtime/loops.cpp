@@ -3,26 +3,24 @@
 using namespace Probescript;
 using namespace Probescript::Interpreter;
 
-Values::Val Interpreter::evalForStmt(std::shared_ptr<AST::ForStmtType> forstmt, EnvPtr env)
+Values::Completion Interpreter::evalForStmt(std::shared_ptr<AST::ForStmtType> forstmt, EnvPtr env)
 {
-    EnvPtr parent = std::make_shared<Env>(env);
+    EnvPtr parent = std::make_shared<Env>(env, forstmt->declScope);
 
     for (std::shared_ptr<AST::Stmt> stmt : forstmt->declarations)
     {
         eval(stmt, parent);
     }
 
-    Values::Val result = std::make_shared<Values::UndefinedVal>();
-
     while (true)
     {
-        EnvPtr scope = std::make_shared<Env>(parent);
+        EnvPtr scope = std::make_shared<Env>(parent, forstmt->scope);
 
         bool breaking = false;
         
         for (std::shared_ptr<AST::Expr> expr : forstmt->conditions)
         {
-            if (!eval(expr, scope)->toBool())
+            if (!eval(expr, scope).toBool())
             {
                 breaking = true;
                 break;
@@ -30,22 +28,11 @@ Values::Val Interpreter::evalForStmt(std::shared_ptr<AST::ForStmtType> forstmt,
         }
 
         if (breaking) break;
-        try
-        {
-            evalBody(forstmt->body, scope, true);
-        }
-        catch (const Values::BreakSignal& signal)
-        {
-            break;
-        }
-        catch (const Values::ContinueSignal& signal)
-        {
-            for (std::shared_ptr<AST::Expr> expr : forstmt->updates)
-            {
-                eval(expr, scope);
-            }
-            continue;
-        }
+
+        Values::Completion completion = evalBody(forstmt->body, scope);
+
+        if (completion.type == Values::Completion::Type::Break) break;
+        if (completion.type == Values::Completion::Type::Return) return completion;
 
         for (std::shared_ptr<AST::Expr> expr : forstmt->updates)
         {
@@ -53,29 +40,22 @@ Values::Val Interpreter::evalForStmt(std::shared_ptr<AST::ForStmtType> forstmt,
         }
     }
 
-    return std::make_shared<Values::UndefinedVal>();
+    return {};
 }
 
-Values::Val Interpreter::evalWhileStmt(std::shared_ptr<AST::WhileStmtType> stmt, EnvPtr env) {
+Values::Completion Interpreter::evalWhileStmt(std::shared_ptr<AST::WhileStmtType> stmt, EnvPtr env) {
     while (true) {
         Values::Val result = eval(stmt->condition, env);
 
-        if (result->toBool()) {
-            EnvPtr scope = std::make_shared<Env>(env);
-            try
-            {
-                evalBody(stmt->body, scope);
-            }
-            catch (const Values::BreakSignal& signal)
-            {
-                break;
-            }
-            catch (const Values::ContinueSignal& signal)
-            {
-                continue;
-            }
+        if (result.toBool()) {
+            EnvPtr scope = std::make_shared<Env>(env, stmt->scope);
+
+            Values::Completion completion = evalBody(stmt->body, scope);
+
+            if (completion.type == Values::Completion::Type::Break) break;
+            if (completion.type == Values::Completion::Type::Return) return completion;
         } else break;
     }
 
-    return std::make_shared<Values::UndefinedVal>();
+    return {};
 }
\ No newline at end of file
@@ -4,103 +4,144 @@ using namespace Probescript;
 using namespace Probescript::Interpreter;
 
 Values::Val Interpreter::evalProbeDeclaration(std::shared_ptr<AST::ProbeDeclarationType> probe, EnvPtr env) {
-    std::shared_ptr<Values::ProbeValue> probeval = probe->doesExtend ? std::make_shared<Values::ProbeValue>(probe->name, env, probe->body, probe->extends) : std::make_shared<Values::ProbeValue>(probe->name, env, probe->body);
+    Values::Ref<Values::ProbeValue> probeval = probe->doesExtend ? Values::make<Values::ProbeValue>(probe->name, env, probe->body, probe->extends) : Values::make<Values::ProbeValue>(probe->name, env, probe->body);
+    probeval->scope = probe->scope;
 
-    return env->declareVar(probe->name, probeval, probe->token);
+    return env->declareVar(probe->address, probe->name, probeval, probe->token);
 }
 
-Values::Val Interpreter::evalProbeCall(Values::Val val, EnvPtr declarationEnv, std::vector<Values::Val> args) {
-    if (val->type != Values::ValueType::Probe)
-    {
-        throw ThrowException(TypeError("Probe is not of type probe"));
-    }
+static void buildProbeTemplate(Values::ProbeValue& probe)
+{
+    // A build that threw is retried by the next call
+    std::vector<Values::ProbeTemplate::Step>& steps = probe.probeTemplate.steps;
+    steps.clear();
 
-    std::shared_ptr<Values::ProbeValue> probe = std::static_pointer_cast<Values::ProbeValue>(val);
+    inheritProbe(probe, steps);
 
-    EnvPtr env = std::make_shared<Env>(declarationEnv);
+    for (std::shared_ptr<AST::Stmt> stmt : probe.body) {
+        if (stmt->kind == AST::NodeType::AssignmentExpr) {
+            std::shared_ptr<AST::AssignmentExprType> assign = std::static_pointer_cast<AST::AssignmentExprType>(stmt);
+            if (assign->op != "=") {
+                throw std::runtime_error(CustomError("Only = assignment is allowed in probe bodies", "ProbeBodyError"));
+            }
+            if (assign->assigne->kind != AST::NodeType::Identifier) {
+                throw std::runtime_error(CustomError("Only identifiers can be assigned to in probe bodies", "ProbeBodyError"));
+            }
 
-    inheritProbe(probe, env);
+            steps.push_back({ Values::ProbeTemplate::StepKind::Assignment, "", nullptr, stmt });
+        } else if (stmt->kind == AST::NodeType::FunctionDeclaration) {
+            std::shared_ptr<AST::FunctionDeclarationType> decl = std::static_pointer_cast<AST::FunctionDeclarationType>(stmt);
+            Values::Ref<Values::FunctionValue> fn = Values::cast<Values::FunctionValue>(evalFunctionDeclaration(decl, probe.declarationEnv, true));
+            fn->probeScope = probe.scope;
+
+            steps.push_back({ Values::ProbeTemplate::StepKind::Function, decl->name, fn, stmt });
+        } else
+            steps.push_back({ Values::ProbeTemplate::StepKind::Statement, "", nullptr, stmt });
+    }
+}
 
-    for (std::shared_ptr<AST::Stmt> stmt : probe->body) {
-        switch (stmt->kind) {
-            case AST::NodeType::AssignmentExpr: {
-                std::shared_ptr<AST::AssignmentExprType> assign = std::static_pointer_cast<AST::AssignmentExprType>(stmt);
-                if (assign->op != "=") {
-                    throw std::runtime_error(CustomError("Only = assignment is allowed in probe bodies", "ProbeBodyError"));
+// Runs everything a call does before `run` into `env`: inherited members, assignments and the body
+static void instantiateProbe(Values::ProbeValue& probe, EnvPtr env)
+{
+    std::call_once(probe.templateBuilt, buildProbeTemplate, std::ref(probe));
+
+    for (const Values::ProbeTemplate::Step& step : probe.probeTemplate.steps) {
+        switch (step.kind) {
+            case Values::ProbeTemplate::StepKind::SuperProbe: {
+                // The superprobe's state lives in an instance of its own for this call, which its functions
+                // find through `env`. The probe gets a copy of every member
+                Values::Ref<Values::ProbeValue> superProbe = Values::cast<Values::ProbeValue>(step.value);
+                EnvPtr superEnv = std::make_shared<Env>(superProbe->declarationEnv, superProbe->scope);
+                instantiateProbe(*superProbe, superEnv);
+                env->addBase(superEnv);
+
+                // What the superprobe inherited itself, then its own members
+                for (const auto& member : superEnv->variables) env->variables[member.first] = member.second;
+
+                for (std::shared_ptr<AST::Stmt> stmt : superProbe->body) {
+                    std::string name;
+                    if (stmt->kind == AST::NodeType::FunctionDeclaration) name = std::static_pointer_cast<AST::FunctionDeclarationType>(stmt)->name;
+                    else if (stmt->kind == AST::NodeType::VarDeclaration) name = std::static_pointer_cast<AST::VarDeclarationType>(stmt)->identifier;
+                    else continue;
+
+                    env->variables[name == "run" ? "super" : name] = superEnv->lookupVar(name, stmt->token);
                 }
-                if (assign->assigne->kind != AST::NodeType::Identifier) {
-                    throw std::runtime_error(CustomError("Only identifiers can be assigned to in probe bodies", "ProbeBodyError"));
+                break;
+            }
+            case Values::ProbeTemplate::StepKind::Function: {
+                std::shared_ptr<AST::FunctionDeclarationType> decl = std::static_pointer_cast<AST::FunctionDeclarationType>(step.stmt);
+                env->setVar(decl->address, decl->name, step.value);
+                break;
+            }
+            case Values::ProbeTemplate::StepKind::NativeBase: {
+                Values::Val instance = Values::cast<Values::NativeClassVal>(step.value)->constructor({}, env);
+                for (const auto& prop : instance.get()->properties)
+                {
+                    env->variables[prop.first] = prop.second;
                 }
-                env->variables[std::static_pointer_cast<AST::IdentifierType>(assign->assigne)->symbol] = eval(assign->value, env);
                 break;
             }
-            case AST::NodeType::FunctionDeclaration:
-                eval(stmt, env);
+            case Values::ProbeTemplate::StepKind::Assignment: {
+                std::shared_ptr<AST::AssignmentExprType> assign = std::static_pointer_cast<AST::AssignmentExprType>(step.stmt);
+                std::shared_ptr<AST::IdentifierType> ident = std::static_pointer_cast<AST::IdentifierType>(assign->assigne);
+                env->setVar(ident->address, ident->symbol, eval(assign->value, env));
+                break;
+            }
+            case Values::ProbeTemplate::StepKind::Statement:
+                eval(step.stmt, env);
                 break;
-            default:
-                eval(stmt, env);
         }
     }
+}
 
+Values::Val Interpreter::evalProbeCall(Values::Val val, EnvPtr declarationEnv, std::vector<Values::Val> args) {
+    if (val.type() != Values::ValueType::Probe)
+    {
+        throw ThrowException(TypeError("Probe is not of type probe"));
+    }
 
-    Values::Val runfnval = env->lookupVar("run", val->token);
+    Values::Ref<Values::ProbeValue> probe = Values::cast<Values::ProbeValue>(val);
 
-    if (runfnval->type != Values::ValueType::Function) {
+    EnvPtr env = std::make_shared<Env>(declarationEnv, probe->scope);
+    instantiateProbe(*probe, env);
+
+    Values::Val runfnval = env->lookupVar("run", probe->token);
+
+    if (runfnval.type() != Values::ValueType::Function) {
         throw std::runtime_error(CustomError("Expected 'run' to be of type function", "ProbeError"));
     }
 
     evalCallWithFnVal(runfnval, args, env);
 
-    return std::make_shared<Values::UndefinedVal>();
+    return Values::makeUndefined();
 }
 
-void Interpreter::inheritProbe(std::shared_ptr<Values::ProbeValue> prb, EnvPtr env)
+void Interpreter::inheritProbe(const Values::ProbeValue& prb, std::vector<Values::ProbeTemplate::Step>& steps)
 {
-    if (!prb->doesExtend) return;
+    if (!prb.doesExtend) return;
     
-    Values::Val extends = eval(prb->extends, prb->declarationEnv);
-    EnvPtr parentenv = std::make_shared<Env>();
+    Values::Val extends = eval(prb.extends, prb.declarationEnv);
     
-    if (extends->type != Values::ValueType::Probe)
+    if (extends.type() != Values::ValueType::Probe)
     {
-        if (extends->type == Values::ValueType::NativeClass)
+        if (extends.type() == Values::ValueType::NativeClass)
         {
-            Values::Val instance = std::static_pointer_cast<Values::NativeClassVal>(extends)->constructor({}, env);
-            for (auto& prop : instance->properties)
-            {
-                env->variables[prop.first] = prop.second;
-            }
-
+            steps.push_back({ Values::ProbeTemplate::StepKind::NativeBase, "", extends, nullptr });
             return;
         } else
         {
             throw std::runtime_error(CustomError("Probes can only inherit from probes", "ProbeInheritanceError"));
         }
-    } else
-        parentenv = std::static_pointer_cast<Values::ProbeValue>(extends)->declarationEnv;
+    }
 
-    std::shared_ptr<Values::ProbeValue> superProbe = std::static_pointer_cast<Values::ProbeValue>(extends);
-    
-    inheritProbe(superProbe, env);
+    Values::Ref<Values::ProbeValue> superProbe = Values::cast<Values::ProbeValue>(extends);
+    steps.push_back({ Values::ProbeTemplate::StepKind::SuperProbe, "", superProbe, nullptr });
+}
 
-    bool hasRun = false;
-    Values::Val run = std::make_shared<Values::UndefinedVal>();
-    for (std::shared_ptr<AST::Stmt> stmt : superProbe->body)
-    {
-        if (stmt->kind == AST::NodeType::FunctionDeclaration)
-        {
-            std::shared_ptr<Values::FunctionValue> fn = std::static_pointer_cast<Values::FunctionValue>(evalFunctionDeclaration(std::static_pointer_cast<AST::FunctionDeclarationType>(stmt), parentenv, true));
-            if (fn->name == "run")
-            {
-                hasRun = true;
-                run = fn;
-            } else env->variables[fn->name] = fn;
-        } else if (stmt->kind == AST::NodeType::VarDeclaration) {
-            eval(stmt, parentenv);
-            eval(stmt, env);
-        } else
-            eval(stmt, env);
-    }
+EnvPtr Interpreter::closureEnv(const Values::FunctionValue& fn, const EnvPtr& callerEnv)
+{
+    if (!fn.probeScope || !callerEnv) return fn.declarationEnv;
 
-    if (hasRun) env->variables["super"] = run;
-}
\ No newline at end of file
+    EnvPtr instance = callerEnv->instanceOf(fn.probeScope.get());
+    return instance ? instance : fn.declarationEnv;
+}
@@ -5,7 +5,7 @@ using namespace Probescript::Interpreter;
 
 Values::Val Interpreter::evalProgram(std::shared_ptr<AST::ProgramType> program, EnvPtr env, std::shared_ptr<Context> config) {
     if (config->type == RuntimeType::Normal) {
-        EnvPtr scope = std::make_shared<Env>(env);
+        EnvPtr scope = std::make_shared<Env>(env, program->scope);
         std::shared_ptr<AST::ProbeDeclarationType> probeDeclaration;
         bool foundProbe = false;
         for (std::shared_ptr<AST::Stmt> stmt : program->body) {
@@ -44,13 +44,13 @@ Values::Val Interpreter::evalProgram(std::shared_ptr<AST::ProgramType> program,
         }
 
 
-        std::shared_ptr<Values::ProbeValue> probe = std::static_pointer_cast<Values::ProbeValue>(evalProbeDeclaration(probeDeclaration, scope));
+        Values::Ref<Values::ProbeValue> probe = Values::cast<Values::ProbeValue>(evalProbeDeclaration(probeDeclaration, scope));
 
         Values::Val lastEval = evalProbeCall(probe, scope);
 
         return lastEval;
     } else if (config->type == RuntimeType::REPL) {
-        Values::Val lastEval = std::make_shared<Values::UndefinedVal>();
+        Values::Val lastEval = Values::makeUndefined();
         for (std::shared_ptr<AST::Stmt> stmt : program->body) {
             lastEval = eval(stmt, env, config);
         }
@@ -59,9 +59,7 @@ Values::Val Interpreter::evalProgram(std::shared_ptr<AST::ProgramType> program,
     } else if (config->type == RuntimeType::Exports) {
         std::unordered_map<std::string, Values::Val> exports;
 
-        EnvPtr exportenv = std::make_shared<Env>();
-
-        Values::Val lasteval;
+        EnvPtr exportenv = std::make_shared<Env>(nullptr, program->scope);
 
         for (std::shared_ptr<AST::Stmt> stmt : program->body) {
             if (stmt->kind == AST::NodeType::ExportStmt) {
@@ -75,7 +73,7 @@ Values::Val Interpreter::evalProgram(std::shared_ptr<AST::ProgramType> program,
                     case AST::NodeType::Identifier: {
                         std::shared_ptr<AST::IdentifierType> ident = std::static_pointer_cast<AST::IdentifierType>(exportstmt->exporting);
                         exportname = ident->symbol;
-                        lasteval = exporting = eval(ident, exportenv);
+                        exporting = eval(ident, exportenv);
                         found = true;
                         
                         break;
@@ -87,7 +85,7 @@ Values::Val Interpreter::evalProgram(std::shared_ptr<AST::ProgramType> program,
                             std::cerr << CustomError("Cannot export non identifier assignment", "ExportError");
                         }
                         exportname = std::static_pointer_cast<AST::IdentifierType>(a->assigne)->symbol;
-                        lasteval = exporting = eval(a->value, exportenv);
+                        exporting = eval(a->value, exportenv);
                         found = true;
 
                         break;
@@ -96,7 +94,7 @@ Values::Val Interpreter::evalProgram(std::shared_ptr<AST::ProgramType> program,
                     case AST::NodeType::ProbeDeclaration: {
                         std::shared_ptr<AST::ProbeDeclarationType> probe = std::static_pointer_cast<AST::ProbeDeclarationType>(exportstmt->exporting);
                         exportname = probe->name;
-                        lasteval = exporting = eval(probe, exportenv);
+                        exporting = eval(probe, exportenv);
 
                         found = true;
 
@@ -107,7 +105,7 @@ Values::Val Interpreter::evalProgram(std::shared_ptr<AST::ProgramType> program,
                         std::shared_ptr<AST::FunctionDeclarationType> fn = std::static_pointer_cast<AST::FunctionDeclarationType>(exportstmt->exporting);
                         exportname = fn->name;
                         found = true;
-                        lasteval = exporting = eval(fn, exportenv);
+                        exporting = eval(fn, exportenv);
 
                         break;
                     }
@@ -116,7 +114,7 @@ Values::Val Interpreter::evalProgram(std::shared_ptr<AST::ProgramType> program,
                         std::shared_ptr<AST::ClassDefinitionType> cls = std::static_pointer_cast<AST::ClassDefinitionType>(exportstmt->exporting);
                         exportname = cls->name;
                         found = true;
-                        lasteval = exporting = eval(cls, exportenv);
+                        exporting = eval(cls, exportenv);
 
                         break;
                     }
@@ -131,10 +129,8 @@ Values::Val Interpreter::evalProgram(std::shared_ptr<AST::ProgramType> program,
             }
         }
 
-        lasteval->exports = exports;
-
-        return lasteval;
+        return Values::make<Values::ObjectVal>(exports);
     }
 
-    return std::make_shared<Values::UndefinedVal>();
+    return Values::makeUndefined();
 }
\ No newline at end of file
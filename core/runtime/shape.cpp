@@ -0,0 +1,203 @@
+#include <mutex>
+
+#include "runtime/shape.hpp"
+
+using namespace Probescript;
+using namespace Probescript::Values;
+
+namespace
+{
+
+// Guards the transition tables, a shape's own keys never change once it is reachable
+std::mutex g_shapeMutex;
+uint32_t g_nextShapeId = 1;
+
+} // namespace
+
+Shape* Shape::root()
+{
+    static Shape* root = new Shape(g_nextShapeId++);
+    return root;
+}
+
+Shape* Shape::withKey(const std::string& key)
+{
+    std::lock_guard<std::mutex> lock(g_shapeMutex);
+
+    auto found = m_transitions.find(key);
+    if (found != m_transitions.end()) return found->second.get();
+
+    const std::string* name = &AST::Symbol(key).str();
+
+    std::unique_ptr<Shape> shape(new Shape(g_nextShapeId++));
+    shape->m_keys = m_keys;
+    shape->m_keys.push_back(name);
+    shape->m_index = m_index;
+    shape->m_index.emplace(*name, m_keys.size());
+
+    Shape* result = shape.get();
+    m_transitions.emplace(*name, std::move(shape));
+    return result;
+}
+
+Shape* Shape::existingKey(std::string_view key)
+{
+    std::lock_guard<std::mutex> lock(g_shapeMutex);
+
+    auto found = m_transitions.find(key);
+    return found != m_transitions.end() ? found->second.get() : nullptr;
+}
+
+Properties::Properties(const std::unordered_map<std::string, Val>& map) : Properties()
+{
+    for (const auto& [key, val] : map)
+    {
+        (*this)[key] = val;
+    }
+}
+
+Properties::Properties(const Properties& other)
+    : m_shape(other.m_shape),
+      m_dictionary(other.m_dictionary ? std::make_unique<Dictionary>(*other.m_dictionary) : nullptr),
+      m_values(other.m_values) {}
+
+Properties& Properties::operator=(const Properties& other)
+{
+    if (this == &other) return *this;
+
+    m_shape = other.m_shape;
+    m_dictionary = other.m_dictionary ? std::make_unique<Dictionary>(*other.m_dictionary) : nullptr;
+    m_values = other.m_values;
+    return *this;
+}
+
+// The moved-from side is left as an empty object rather than a shape without values
+Properties::Properties(Properties&& other) noexcept
+    : m_shape(other.m_shape), m_dictionary(std::move(other.m_dictionary)), m_values(std::move(other.m_values))
+{
+    other.m_shape = Shape::root();
+    other.m_values.clear();
+}
+
+Properties& Properties::operator=(Properties&& other) noexcept
+{
+    if (this == &other) return *this;
+
+    m_shape = other.m_shape;
+    m_dictionary = std::move(other.m_dictionary);
+    m_values = std::move(other.m_values);
+
+    other.m_shape = Shape::root();
+    other.m_values.clear();
+    return *this;
+}
+
+int Properties::indexOf(std::string_view key) const
+{
+    if (m_shape) return m_shape->find(key);
+
+    auto found = m_dictionary->index.find(std::string(key));
+    return found != m_dictionary->index.end() ? static_cast<int>(found->second) : -1;
+}
+
+void Properties::toDictionary()
+{
+    m_dictionary = std::make_unique<Dictionary>();
+
+    for (size_t i = 0; i < m_values.size(); i++)
+    {
+        m_dictionary->keys.push_back(m_shape->key(i));
+        m_dictionary->index.emplace(m_shape->key(i), i);
+    }
+
+    m_shape = nullptr;
+}
+
+Val& Properties::operator[](const std::string& key)
+{
+    int index = indexOf(key);
+    if (index >= 0) return m_values[index];
+
+    if (m_shape && m_shape->size() >= Shape::MaxKeys) toDictionary();
+
+    if (m_shape) m_shape = m_shape->withKey(key);
+    return append(key);
+}
+
+Val& Properties::computed(const std::string& key)
+{
+    int index = indexOf(key);
+    if (index >= 0) return m_values[index];
+
+    if (m_shape)
+    {
+        Shape* next = m_shape->existingKey(key);
+        if (next) m_shape = next;
+        else toDictionary();
+    }
+
+    return append(key);
+}
+
+// Adds the slot for `key`, the shape has already been moved on to include it
+Val& Properties::append(const std::string& key)
+{
+    if (!m_shape)
+    {
+        m_dictionary->index.emplace(key, m_values.size());
+        m_dictionary->keys.push_back(key);
+    }
+
+    m_values.push_back(makeUndefined());
+    return m_values.back();
+}
+
+Val* Properties::lookup(std::string_view key)
+{
+    int index = indexOf(key);
+    return index >= 0 ? &m_values[index] : nullptr;
+}
+
+Val* Properties::lookup(std::string_view key, const AST::InlineCache& cache)
+{
+    if (!m_shape) return lookup(key);
+
+    uint64_t id = m_shape->id();
+
+    for (const std::atomic<uint64_t>& entry : cache.entries)
+    {
+        uint64_t cached = entry.load(std::memory_order_relaxed);
+        if ((cached >> 32) == id) return &m_values[static_cast<uint32_t>(cached)];
+    }
+
+    int index = m_shape->find(key);
+    if (index < 0) return nullptr;
+
+    // Fill an empty entry, or evict one once the site has seen more shapes than fit
+    uint64_t packed = (id << 32) | static_cast<uint32_t>(index);
+    std::atomic<uint64_t>* target = &cache.entries[id % AST::InlineCache::Size];
+
+    for (std::atomic<uint64_t>& entry : cache.entries)
+    {
+        if (entry.load(std::memory_order_relaxed) == 0)
+        {
+            target = &entry;
+            break;
+        }
+    }
+
+    target->store(packed, std::memory_order_relaxed);
+    return &m_values[index];
+}
+
+Properties::iterator Properties::find(const std::string& key)
+{
+    int index = indexOf(key);
+    return { this, index >= 0 ? static_cast<size_t>(index) : m_values.size() };
+}
+
+Properties::const_iterator Properties::find(const std::string& key) const
+{
+    int index = indexOf(key);
+    return { this, index >= 0 ? static_cast<size_t>(index) : m_values.size() };
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "frontend/ast.hpp"
+#include "runtime/val.hpp"
+
+namespace Probescript::Values
+{
+
+// Hidden class: the ordered property names of an object. Objects that gained the same properties
+// in the same order share one shape, found by following transitions from Shape::root().
+// Shapes are never freed, so their addresses and ids stay valid for inline caches. That is why keys only
+// known at run time never create one, see Properties::computed
+class Shape
+{
+public:
+    // Objects with more properties than this are used as dictionaries and leave the shape tree
+    static constexpr size_t MaxKeys = 64;
+
+    static Shape* root();
+
+    uint32_t id() const { return m_id; }
+    size_t size() const { return m_keys.size(); }
+    const std::string& key(uint32_t slot) const { return *m_keys[slot]; }
+
+    // The slot of `key`, or -1
+    int find(std::string_view key) const
+    {
+        auto found = m_index.find(key);
+        return found != m_index.end() ? static_cast<int>(found->second) : -1;
+    }
+
+    // The shape reached by appending `key`
+    Shape* withKey(const std::string& key);
+    // Same as withKey, but only a transition some object already took, or nullptr
+    Shape* existingKey(std::string_view key);
+
+private:
+    Shape(uint32_t id) : m_id(id) {}
+
+    uint32_t m_id;
+    // Interned, so the views in m_index stay valid
+    std::vector<const std::string*> m_keys;
+    std::unordered_map<std::string_view, uint32_t> m_index;
+    std::unordered_map<std::string_view, std::unique_ptr<Shape>> m_transitions;
+};
+
+// Property storage of a value: a shape plus one slot per property, in insertion order.
+// Past Shape::MaxKeys properties the object gets its own key index instead of a shape.
+// Slot references are invalidated when a property is added
+class Properties
+{
+public:
+    using value_type = std::pair<const std::string&, Val&>;
+
+    template <typename Owner, typename Value>
+    class Iterator
+    {
+    public:
+        struct Arrow
+        {
+            std::pair<const std::string&, Value&> pair;
+            const std::pair<const std::string&, Value&>* operator->() const { return &pair; }
+        };
+
+        Iterator(Owner* owner, size_t index) : m_owner(owner), m_index(index) {}
+
+        std::pair<const std::string&, Value&> operator*() const { return { m_owner->keyAt(m_index), m_owner->m_values[m_index] }; }
+        Arrow operator->() const { return { **this }; }
+
+        Iterator& operator++() { m_index++; return *this; }
+        bool operator==(const Iterator& other) const { return m_index == other.m_index; }
+        bool operator!=(const Iterator& other) const { return m_index != other.m_index; }
+
+    private:
+        Owner* m_owner;
+        size_t m_index;
+    };
+
+    using iterator = Iterator<Properties, Val>;
+    using const_iterator = Iterator<const Properties, const Val>;
+
+    Properties() : m_shape(Shape::root()) {}
+    Properties(const std::unordered_map<std::string, Val>& map);
+    Properties(const Properties& other);
+    Properties& operator=(const Properties& other);
+    Properties(Properties&& other) noexcept;
+    Properties& operator=(Properties&& other) noexcept;
+
+    Val& operator[](const std::string& key);
+
+    // Same as operator[] for keys computed at run time: adding one only follows a transition another object
+    // already took and otherwise turns the object into a dictionary, so such keys cannot grow the shape tree
+    Val& computed(const std::string& key);
+
+    // The value of `key`, or nullptr
+    Val* lookup(std::string_view key);
+
+    // Same as lookup, but remembers the slot for the object's shape in the member site's cache
+    Val* lookup(std::string_view key, const AST::InlineCache& cache);
+
+    iterator find(const std::string& key);
+    const_iterator find(const std::string& key) const;
+    size_t count(const std::string& key) const { return indexOf(key) >= 0 ? 1 : 0; }
+
+    iterator begin() { return { this, 0 }; }
+    iterator end() { return { this, m_values.size() }; }
+    const_iterator begin() const { return { this, 0 }; }
+    const_iterator end() const { return { this, m_values.size() }; }
+
+    size_t size() const { return m_values.size(); }
+    bool empty() const { return m_values.empty(); }
+
+    // Null once the object has become a dictionary
+    const Shape* shape() const { return m_shape; }
+
+private:
+    struct Dictionary
+    {
+        std::vector<std::string> keys;
+        std::unordered_map<std::string, uint32_t> index;
+    };
+
+    Shape* m_shape;
+    std::unique_ptr<Dictionary> m_dictionary;
+    std::vector<Val> m_values;
+
+    int indexOf(std::string_view key) const;
+    const std::string& keyAt(size_t index) const { return m_shape ? m_shape->key(index) : m_dictionary->keys[index]; }
+    void toDictionary();
+    Val& append(const std::string& key);
+};
+
+} // namespace Probescript::Values
@@ -0,0 +1,240 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+
+namespace Probescript::Values
+{
+
+enum class ValueType {
+    Probe,
+    Null,
+    Number,
+    Boolean,
+    Object,
+    NativeFn,
+    Function,
+    String,
+    Undefined,
+    Array,
+    Class,
+    ReturnSignal,
+    NativeClass,
+    BreakSignal,
+    ContinueSignal,
+    Future,
+};
+
+struct RuntimeVal;
+
+// Base of every heap allocated value. The reference count lives in the object itself
+// so that a Val handle can stay a single 64-bit word
+struct RefCounted
+{
+    mutable std::atomic<uint32_t> refs { 0 };
+    ValueType type;
+
+    RefCounted(ValueType type) : type(type) {}
+    RefCounted(const RefCounted& other) : refs(0), type(other.type) {}
+    RefCounted& operator=(const RefCounted& other) { type = other.type; return *this; }
+    virtual ~RefCounted() = default;
+
+    void retain() const noexcept
+    {
+        refs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void release() const noexcept
+    {
+        if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1) delete this;
+    }
+};
+
+// Typed strong reference to a heap value, used where the concrete type is known (an ObjectVal, a FunctionValue...)
+template <typename T>
+class Ref
+{
+public:
+    Ref() noexcept = default;
+    Ref(std::nullptr_t) noexcept {}
+    explicit Ref(T* ptr) noexcept : m_ptr(ptr) { if (m_ptr) m_ptr->retain(); }
+
+    Ref(const Ref& other) noexcept : m_ptr(other.m_ptr) { if (m_ptr) m_ptr->retain(); }
+    Ref(Ref&& other) noexcept : m_ptr(other.m_ptr) { other.m_ptr = nullptr; }
+
+    template <typename U>
+    Ref(const Ref<U>& other) noexcept : m_ptr(other.get()) { if (m_ptr) m_ptr->retain(); }
+
+    ~Ref() { if (m_ptr) m_ptr->release(); }
+
+    Ref& operator=(Ref other) noexcept
+    {
+        std::swap(m_ptr, other.m_ptr);
+        return *this;
+    }
+
+    T* get() const noexcept { return m_ptr; }
+    T* operator->() const noexcept { return m_ptr; }
+    T& operator*() const noexcept { return *m_ptr; }
+
+    explicit operator bool() const noexcept { return m_ptr != nullptr; }
+    bool operator==(std::nullptr_t) const noexcept { return m_ptr == nullptr; }
+    bool operator!=(std::nullptr_t) const noexcept { return m_ptr != nullptr; }
+
+private:
+    T* m_ptr = nullptr;
+};
+
+template <typename T, typename... Args>
+Ref<T> make(Args&&... args)
+{
+    return Ref<T>(new T(std::forward<Args>(args)...));
+}
+
+// A NaN-boxed value handle
+// Numbers are stored as plain doubles. Every other bit pattern lives inside the quiet NaN space:
+// booleans, null, undefined and the empty handle are tagged singletons, and heap values
+// (strings, arrays, objects, functions...) are stored as a 48-bit pointer with the sign bit set
+class Val
+{
+public:
+    Val() noexcept : m_bits(EmptyBits) {}
+    Val(std::nullptr_t) noexcept : m_bits(EmptyBits) {}
+
+    template <typename T>
+    Val(const Ref<T>& ref) noexcept : Val(static_cast<const RefCounted*>(ref.get())) {}
+
+    Val(const Val& other) noexcept : m_bits(other.m_bits) { retain(); }
+    Val(Val&& other) noexcept : m_bits(other.m_bits) { other.m_bits = EmptyBits; }
+
+    Val& operator=(const Val& other) noexcept
+    {
+        other.retain();
+        release();
+        m_bits = other.m_bits;
+        return *this;
+    }
+
+    Val& operator=(Val&& other) noexcept
+    {
+        if (this != &other)
+        {
+            release();
+            m_bits = other.m_bits;
+            other.m_bits = EmptyBits;
+        }
+        return *this;
+    }
+
+    ~Val() { release(); }
+
+    static Val number(double number) noexcept
+    {
+        Val val;
+        if (number != number)
+            val.m_bits = CanonicalNaN;
+        else
+            std::memcpy(&val.m_bits, &number, sizeof(double));
+        return val;
+    }
+
+    static Val boolean(bool value) noexcept { return Val(value ? TrueBits : FalseBits); }
+    static Val null() noexcept { return Val(NullBits); }
+    static Val undefined() noexcept { return Val(UndefinedBits); }
+
+    bool isNumber() const noexcept { return (m_bits & QNaN) != QNaN; }
+    bool isBool() const noexcept { return (m_bits | 1) == TrueBits; }
+    bool isNull() const noexcept { return m_bits == NullBits; }
+    bool isUndefined() const noexcept { return m_bits == UndefinedBits || m_bits == EmptyBits; }
+    bool isHeap() const noexcept { return (m_bits & HeapMask) == HeapMask; }
+    bool isEmpty() const noexcept { return m_bits == EmptyBits; }
+
+    double asNumber() const noexcept
+    {
+        double number;
+        std::memcpy(&number, &m_bits, sizeof(double));
+        return number;
+    }
+
+    bool asBool() const noexcept { return m_bits == TrueBits; }
+
+    ValueType type() const noexcept
+    {
+        if (isNumber()) return ValueType::Number;
+        if (isHeap()) return heap()->type;
+        if (isBool()) return ValueType::Boolean;
+        if (isNull()) return ValueType::Null;
+        return ValueType::Undefined;
+    }
+
+    const RefCounted* heap() const noexcept
+    {
+        return isHeap() ? reinterpret_cast<const RefCounted*>(static_cast<uintptr_t>(m_bits & PointerMask)) : nullptr;
+    }
+
+    // Returns the heap value, or nullptr for immediates. Defined in values.hpp
+    RuntimeVal* get() const noexcept;
+
+    std::string toString() const;
+    std::string toConsole() const;
+    std::string toJSON() const;
+    double toNum() const;
+    bool toBool() const;
+
+    // Value equality, as used by the == and != operators
+    bool equals(const Val& other) const;
+
+    Val add(const Val& other) const;
+    Val sub(const Val& other) const;
+    Val mul(const Val& other) const;
+    Val div(const Val& other) const;
+    Val mod(const Val& other) const;
+
+    bool operator==(std::nullptr_t) const noexcept { return isEmpty(); }
+    bool operator!=(std::nullptr_t) const noexcept { return !isEmpty(); }
+
+    uint64_t bits() const noexcept { return m_bits; }
+
+private:
+    static constexpr uint64_t SignBit = 0x8000000000000000ULL;
+    static constexpr uint64_t QNaN = 0x7ffc000000000000ULL;
+    static constexpr uint64_t CanonicalNaN = 0x7ff8000000000000ULL;
+    static constexpr uint64_t HeapMask = SignBit | QNaN;
+    static constexpr uint64_t PointerMask = ~HeapMask;
+
+    static constexpr uint64_t EmptyBits = QNaN | 1;
+    static constexpr uint64_t NullBits = QNaN | 2;
+    static constexpr uint64_t UndefinedBits = QNaN | 3;
+    static constexpr uint64_t FalseBits = QNaN | 4;
+    static constexpr uint64_t TrueBits = QNaN | 5;
+
+    explicit Val(uint64_t bits) noexcept : m_bits(bits) {}
+
+    explicit Val(const RefCounted* object) noexcept
+        : m_bits(object ? (HeapMask | static_cast<uint64_t>(reinterpret_cast<uintptr_t>(object))) : EmptyBits)
+    {
+        retain();
+    }
+
+    void retain() const noexcept
+    {
+        if (isHeap()) heap()->retain();
+    }
+
+    void release() noexcept
+    {
+        if (isHeap()) heap()->release();
+    }
+
+    uint64_t m_bits;
+};
+
+inline Val makeNumber(double number) { return Val::number(number); }
+inline Val makeBool(bool value) { return Val::boolean(value); }
+inline Val makeNull() { return Val::null(); }
+inline Val makeUndefined() { return Val::undefined(); }
+
+} // namespace Probescript::Values
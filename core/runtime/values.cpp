@@ -3,184 +3,313 @@
 using namespace Probescript;
 using namespace Probescript::Values;
 
-Val RuntimeVal::add(Val o) const
+static std::string numberToString(double number)
 {
-    return std::make_shared<NumberVal>(0 + o->toNum());
+    return (std::floor(number) == number)
+        ? std::to_string(static_cast<int>(number))
+        : std::to_string(number);
 }
 
-Val RuntimeVal::sub(Val o) const
+std::string Val::toString() const
 {
-    return std::make_shared<NumberVal>(0 - o->toNum()); 
+    if (isNumber()) return numberToString(asNumber());
+    if (isHeap()) return get()->toString();
+    if (isBool()) return asBool() ? "true" : "false";
+    if (isNull()) return "null";
+    return "undefined";
 }
 
-Val RuntimeVal::mul(Val o) const
+std::string Val::toConsole() const
 {
-    return std::make_shared<NumberVal>(0);
+    if (isNumber()) return ConsoleColors::YELLOW + numberToString(asNumber()) + ConsoleColors::RESET;
+    if (isHeap()) return get()->toConsole();
+    if (isBool()) return ConsoleColors::YELLOW + (asBool() ? "true" : "false") + ConsoleColors::RESET;
+    return ConsoleColors::GRAY + toString() + ConsoleColors::RESET;
 }
 
-Val RuntimeVal::div(Val o) const
+std::string Val::toJSON() const
 {
-    return std::make_shared<NumberVal>(0);
+    if (isNumber()) return numberToString(asNumber());
+    if (isHeap()) return get()->toJSON();
+    if (isBool()) return asBool() ? "true" : "false";
+    return "null";
 }
 
-Val RuntimeVal::mod(Val o) const
+bool Val::equals(const Val& other) const
 {
-    return std::make_shared<NumberVal>(0);
+    if (isNumber()) return other.isNumber() && asNumber() == other.asNumber();
+    if (isHeap()) return get()->compare(other);
+    if (isUndefined()) return other.isUndefined();
+    return m_bits == other.m_bits;
 }
 
-ArrayVal::ArrayVal(std::vector<Val> items) : RuntimeVal(ValueType::Array), items(items)
+// Immediates behave like numbers in arithmetic: booleans count as 1/0, null and undefined as 0
+Val Val::add(const Val& o) const
 {
-    properties["size"] = std::make_shared<NativeFnValue>([this](std::vector<Val> _args, EnvPtr _env) -> Val
-    {
-        return std::make_shared<NumberVal>(this->items.size());
-    });
+    if (isHeap()) return get()->add(o);
+    return makeNumber(toNum() + o.toNum());
+}
 
-    properties["push"] = std::make_shared<NativeFnValue>([this](std::vector<Val> args, EnvPtr _env) -> Val
-    {
-        for (Val arg : args)
-        {
-            this->items.push_back(arg);
-        }
+Val Val::sub(const Val& o) const
+{
+    if (isHeap()) return get()->sub(o);
+    return makeNumber(toNum() - o.toNum());
+}
 
-        return std::make_shared<UndefinedVal>();
-    });
+Val Val::mul(const Val& o) const
+{
+    if (isHeap()) return get()->mul(o);
+    if (isNull() || isUndefined()) return makeNumber(0);
+    return makeNumber(toNum() * o.toNum());
+}
 
-    properties["join"] = std::make_shared<NativeFnValue>([items](std::vector<Val> args, EnvPtr env) -> Val
+Val Val::div(const Val& o) const
+{
+    if (isHeap()) return get()->div(o);
+    if (isNull() || isUndefined()) return makeNumber(0);
+    return makeNumber(toNum() / o.toNum());
+}
+
+Val Val::mod(const Val& o) const
+{
+    if (isHeap()) return get()->mod(o);
+    if (isNull() || isUndefined()) return makeNumber(0);
+    return makeNumber(fmod(toNum(), o.toNum()));
+}
+
+Val RuntimeVal::add(const Val& o) const
+{
+    return makeNumber(0 + o.toNum());
+}
+
+Val RuntimeVal::sub(const Val& o) const
+{
+    return makeNumber(0 - o.toNum()); 
+}
+
+Val RuntimeVal::mul(const Val& o) const
+{
+    return makeNumber(0);
+}
+
+Val RuntimeVal::div(const Val& o) const
+{
+    return makeNumber(0);
+}
+
+Val RuntimeVal::mod(const Val& o) const
+{
+    return makeNumber(0);
+}
+
+Val Values::getMember(const Val& object, const std::string& key)
+{
+    RuntimeVal* value = object.get();
+    if (!value) return makeUndefined();
+
+    if (Val* prop = value->properties.lookup(key)) return *prop;
+
+    const NativeMethod* method = findMethod(object, key);
+    if (!method) return makeUndefined();
+
+    Val self = object;
+    return make<NativeFnValue>([self, method](std::vector<Val> args, EnvPtr env) -> Val
     {
-        std::string separator = args.empty() ? "," : args[0]->toString();
-        std::string result;
+        return (*method)(self, args, env);
+    });
+}
 
-        for (size_t i = 0; i < items.size(); ++i)
-        {
+const NativeMethod* Values::findMethod(const Val& object, const std::string& key)
+{
+    RuntimeVal* value = object.get();
+    if (!value || value->properties.count(key)) return nullptr;
 
-            result += items[i]->toString();
+    const MethodTable* table = value->methods();
+    if (!table) return nullptr;
 
-            if (i != items.size() - 1)
+    auto method = table->find(key);
+    return method != table->end() ? &method->second : nullptr;
+}
+
+const MethodTable* ArrayVal::methods() const
+{
+    static const MethodTable table =
+    {
+        {
+            "size",
+            [](const Val& self, std::vector<Val> _args, EnvPtr _env) -> Val
             {
-                result += separator;
+                return makeNumber(cast<ArrayVal>(self)->items.size());
             }
-        }
+        },
+        {
+            "push",
+            [](const Val& self, std::vector<Val> args, EnvPtr _env) -> Val
+            {
+                std::vector<Val>& items = cast<ArrayVal>(self)->items;
+                for (Val arg : args)
+                {
+                    items.push_back(arg);
+                }
 
-        return std::make_shared<StringVal>(result);
-    });
+                return makeUndefined();
+            }
+        },
+        {
+            "join",
+            [](const Val& self, std::vector<Val> args, EnvPtr env) -> Val
+            {
+                const std::vector<Val>& items = cast<ArrayVal>(self)->items;
+                std::string separator = args.empty() ? "," : args[0].toString();
+                std::string result;
 
-    properties["foreach"] = std::make_shared<NativeFnValue>([items](std::vector<Val> args, EnvPtr env) -> Val
-    {
-        if (args.empty())
-            return std::make_shared<UndefinedVal>();
+                for (size_t i = 0; i < items.size(); ++i)
+                {
+                    result += items[i].toString();
 
-        for (size_t i = 0; i < items.size(); ++i)
-            Interpreter::evalCallWithFnVal(args[0], { items[i] }, env);
+                    if (i != items.size() - 1)
+                    {
+                        result += separator;
+                    }
+                }
 
-        return std::make_shared<UndefinedVal>();
-    });
+                return make<StringVal>(result);
+            }
+        },
+        {
+            "foreach",
+            [](const Val& self, std::vector<Val> args, EnvPtr env) -> Val
+            {
+                if (args.empty())
+                    return makeUndefined();
 
-    properties["map"] = std::make_shared<NativeFnValue>([items](std::vector<Val> args, EnvPtr env) -> Val
-    {
-        if (args.empty())
-            return std::make_shared<UndefinedVal>();
+                // Iterate over a snapshot, the callback may push to the array
+                std::vector<Val> items = cast<ArrayVal>(self)->items;
+                for (size_t i = 0; i < items.size(); ++i)
+                    Interpreter::evalCallWithFnVal(args[0], { items[i] }, env);
+
+                return makeUndefined();
+            }
+        },
+        {
+            "map",
+            [](const Val& self, std::vector<Val> args, EnvPtr env) -> Val
+            {
+                if (args.empty())
+                    return makeUndefined();
 
-        auto result = std::make_shared<ArrayVal>();
+                std::vector<Val> items = cast<ArrayVal>(self)->items;
+                auto result = make<ArrayVal>();
+                result->items.reserve(items.size());
 
-        for (size_t i = 0; i < items.size(); ++i)
-            result->items.push_back(Interpreter::evalCallWithFnVal(args[0], { items[i], std::make_shared<NumberVal>(i) }, env));
+                for (size_t i = 0; i < items.size(); ++i)
+                    result->items.push_back(Interpreter::evalCallWithFnVal(args[0], { items[i], makeNumber(i) }, env));
 
-        return result;
-    });
+                return result;
+            }
+        },
+        {
+            "filter",
+            [](const Val& self, std::vector<Val> args, EnvPtr env) -> Val
+            {
+                if (args.empty())
+                    return makeUndefined();
 
-    properties["filter"] = std::make_shared<NativeFnValue>([items](std::vector<Val> args, EnvPtr env) -> Val
-    {
-        if (args.empty())
-            return std::make_shared<UndefinedVal>();
+                std::vector<Val> items = cast<ArrayVal>(self)->items;
+                auto result = make<ArrayVal>();
 
-        auto result = std::make_shared<ArrayVal>();
+                for (size_t i = 0; i < items.size(); ++i)
+                    if (Interpreter::evalCallWithFnVal(args[0], { items[i], makeNumber(i) }, env).toBool())
+                        result->items.push_back(items[i]);
 
-        for (size_t i = 0; i < items.size(); ++i)
-            if (Interpreter::evalCallWithFnVal(args[0], { items[i], std::make_shared<NumberVal>(i) }, env)->toBool())
-                result->items.push_back(items[i]);
+                return result;
+            }
+        }
+    };
 
-        return result;
-    });
+    return &table;
 }
 
-StringVal::StringVal(std::string val) : RuntimeVal(ValueType::String), string(val)
+const MethodTable* StringVal::methods() const
 {
-    properties = 
+    static const MethodTable table =
     {
         {
             "length",
-            std::make_shared<NativeFnValue>([this](std::vector<Val> _args, EnvPtr _env) -> Val
+            [](const Val& self, std::vector<Val> _args, EnvPtr _env) -> Val
             {
-                return std::make_shared<NumberVal>(this->string.length());
-            })
+                return makeNumber(cast<StringVal>(self)->string.length());
+            }
         },
         {
             "split",
-            std::make_shared<NativeFnValue>([this](std::vector<Val> args, EnvPtr _) -> Val
+            [](const Val& self, std::vector<Val> args, EnvPtr _) -> Val
             {
-                if (args.empty() || args[0]->type != ValueType::String)
-                    return std::make_shared<UndefinedVal>();
+                if (args.empty() || args[0].type() != ValueType::String)
+                    return makeUndefined();
 
-                std::string str = this->string;
-                std::string deli = std::static_pointer_cast<StringVal>(args[0])->string;
+                const std::string& str = cast<StringVal>(self)->string;
+                const std::string& deli = cast<StringVal>(args[0])->string;
 
                 std::vector<Val> result;
                 std::vector<std::string> items = split(str, deli);
-                for (const std::string item : items)
-                    result.push_back(std::make_shared<StringVal>(item));
+                for (const std::string& item : items)
+                    result.push_back(make<StringVal>(item));
 
-                return std::make_shared<ArrayVal>(result);
-            })
+                return make<ArrayVal>(result);
+            }
         },
         {
             "tolower",
-            std::make_shared<NativeFnValue>([this](std::vector<Val> _args, EnvPtr _env) -> Val
+            [](const Val& self, std::vector<Val> _args, EnvPtr _env) -> Val
             {
-                std::string temp = this->string;
+                std::string temp = cast<StringVal>(self)->string;
                 std::transform(temp.begin(), temp.end(), temp.begin(), [](unsigned char c){ return std::tolower(c); });
-                return std::make_shared<StringVal>(temp);
-            })
+                return make<StringVal>(temp);
+            }
         },
         {
             "toupper",
-            std::make_shared<NativeFnValue>([this](std::vector<Val> _args, EnvPtr _env) -> Val
+            [](const Val& self, std::vector<Val> _args, EnvPtr _env) -> Val
             {
-                std::string temp = this->string;
+                std::string temp = cast<StringVal>(self)->string;
                 std::transform(temp.begin(), temp.end(), temp.begin(), [](unsigned char c){ return std::toupper(c); });
-                return std::make_shared<StringVal>(temp);
-            })
+                return make<StringVal>(temp);
+            }
         },
         {
             "startswith",
-            std::make_shared<NativeFnValue>([this](std::vector<Val> args, EnvPtr _env) -> Val
+            [](const Val& self, std::vector<Val> args, EnvPtr _env) -> Val
             {
-                return std::make_shared<BooleanVal>(!args.empty() && (this->string.find(args[0]->toString()) == 0));
-            })
+                return makeBool(!args.empty() && (cast<StringVal>(self)->string.find(args[0].toString()) == 0));
+            }
         },
         {
             "find",
-            std::make_shared<NativeFnValue>([this](std::vector<Val> args, EnvPtr _env) -> Val
+            [](const Val& self, std::vector<Val> args, EnvPtr _env) -> Val
             {
-                double pos = !args.empty() ? this->string.find(args[0]->toString()) : -1;
-                return std::make_shared<NumberVal>(pos == std::string::npos ? -1 : pos);
-            })
+                double pos = !args.empty() ? cast<StringVal>(self)->string.find(args[0].toString()) : -1;
+                return makeNumber(pos == std::string::npos ? -1 : pos);
+            }
         },
         {
             "find_last",
-            std::make_shared<NativeFnValue>([this](std::vector<Val> args, EnvPtr _env) -> Val
+            [](const Val& self, std::vector<Val> args, EnvPtr _env) -> Val
             {
-                double pos = !args.empty() ? this->string.find_last_of(args[0]->toString()) : -1;
-                return std::make_shared<NumberVal>(pos == std::string::npos ? -1 : pos);
-            })
+                double pos = !args.empty() ? cast<StringVal>(self)->string.find_last_of(args[0].toString()) : -1;
+                return makeNumber(pos == std::string::npos ? -1 : pos);
+            }
         },
         {
             "includes",
-            std::make_shared<NativeFnValue>([this](std::vector<Val> args, EnvPtr _env) -> Val
+            [](const Val& self, std::vector<Val> args, EnvPtr _env) -> Val
             {
-                return std::make_shared<BooleanVal>(!args.empty() && this->string.find(args[0]->toString()) != std::string::npos);
-            })
+                return makeBool(!args.empty() && cast<StringVal>(self)->string.find(args[0].toString()) != std::string::npos);
+            }
         }
     };
+
+    return &table;
 }
 
 ReturnSignal::ReturnSignal(Val val, std::string msg)
@@ -8,10 +8,13 @@
 #include <algorithm>
 #include <cctype>
 #include <future>
+#include <mutex>
 
 #include "frontend/ast.hpp"
 #include "utils.hpp"
 #include "frontend/lexer.hpp"
+#include "runtime/val.hpp"
+#include "runtime/shape.hpp"
 
 namespace Probescript
 {
@@ -21,56 +24,40 @@ using EnvPtr = std::shared_ptr<Env>;
 
 } // namespace Probescript::Env
 
-namespace Probescript::Values
+namespace Probescript::Interpreter
 {
 
-struct RuntimeVal;
-using Val = std::shared_ptr<RuntimeVal>;
+// `self` is the receiver of a method call, if there was one
+Values::Val evalCallWithFnVal(Values::Val fn, std::vector<Values::Val> args, EnvPtr env, Values::Val self = nullptr);
 
-} // namespace Probescript::Values
+} // namespace Probescript::Interpreter
 
-namespace Probescript::Interpreter
+namespace Probescript::Loop
 {
 
-Values::Val evalCallWithFnVal(Values::Val fn, std::vector<Values::Val> args, EnvPtr env);
+struct Completion;
 
-} // namespace Probescript::Interpreter
+} // namespace Probescript::Loop
 
-namespace Probescript::Values
+namespace Probescript::Executor
 {
 
-enum class ValueType {
-    Probe,
-    Null,
-    Number,
-    Boolean,
-    Object,
-    NativeFn,
-    Function,
-    String,
-    Undefined,
-    Array,
-    Class,
-    ReturnSignal,
-    NativeClass,
-    BreakSignal,
-    ContinueSignal,
-    Future,
-};
+struct Job;
+
+} // namespace Probescript::Executor
 
-struct RuntimeVal;
-struct NumberVal;
-using Val = std::shared_ptr<RuntimeVal>;
+namespace Probescript::Values
+{
 
-struct RuntimeVal {
-    ValueType type;
+// A method shared by every value of a type, called with the receiver it was looked up on
+using NativeMethod = std::function<Val(const Val&, std::vector<Val>, EnvPtr)>;
+using MethodTable = std::unordered_map<std::string, NativeMethod>;
+
+struct RuntimeVal : public RefCounted {
     Lexer::Token token = Lexer::Token();
-    std::string value;
-    std::unordered_map<std::string, Val> exports;
-    std::unordered_map<std::string, Val> properties;
-    RuntimeVal(ValueType type, std::unordered_map<std::string, Val> properties) : type(type), properties(properties) {}
-    RuntimeVal(ValueType type) : type(type), value("") {}
-    RuntimeVal(ValueType type, const std::string& val) : type(type), value(val) {}
+    Properties properties;
+    RuntimeVal(ValueType type, Properties properties) : RefCounted(type), properties(std::move(properties)) {}
+    RuntimeVal(ValueType type) : RefCounted(type) {}
     virtual ~RuntimeVal() = default;
 
     virtual std::string toString() const {
@@ -93,146 +80,64 @@ struct RuntimeVal {
         return toString();
     }
 
-    virtual bool compare(const RuntimeVal& other) const
+    virtual bool compare(const Val& other) const
     {
         return false;
     }
 
-    bool operator == (const RuntimeVal& other) const
+    virtual const MethodTable* methods() const
     {
-        return this->compare(other);
+        return nullptr;
     }
 
-    virtual Val add(Val o) const;
-    virtual Val sub(Val o) const;
-    virtual Val mul(Val o) const;
-    virtual Val div(Val o) const;
-    virtual Val mod(Val o) const;
+    virtual Val add(const Val& o) const;
+    virtual Val sub(const Val& o) const;
+    virtual Val mul(const Val& o) const;
+    virtual Val div(const Val& o) const;
+    virtual Val mod(const Val& o) const;
 };
 
-template<typename T, typename... Args>
-std::shared_ptr<T> makeVal(Lexer::Token tk, Args&&... args)
+inline RuntimeVal* Val::get() const noexcept
 {
-    std::shared_ptr<T> val = std::make_shared<T>(std::forward<Args>(args)...);
-    val->token = tk;
-    return val;
+    return isHeap() ? static_cast<RuntimeVal*>(const_cast<RefCounted*>(heap())) : nullptr;
 }
 
+inline double Val::toNum() const
+{
+    if (isNumber()) return asNumber();
+    if (isHeap()) return get()->toNum();
+    return isBool() && asBool() ? 1 : 0;
+}
 
-using NativeFunction = std::function<Val(std::vector<Val>, EnvPtr)>;
-
-struct NumberVal : public RuntimeVal {
-    double number;
-
-    NumberVal(const std::string& val)
-        : RuntimeVal(ValueType::Number, val), number(std::stod(val)) {}
-    NumberVal(double val)
-        : RuntimeVal(ValueType::Number), number(val) {}
-
-    double getValue() { return number; }
-
-    std::string toString() const override {
-        return (std::floor(number) == number)
-            ? std::to_string(static_cast<int>(number))
-            : std::to_string(number);
-    }
-
-    std::string toConsole() const override {
-        return ConsoleColors::YELLOW + (std::floor(number) == number
-            ? std::to_string(static_cast<int>(number))
-            : std::to_string(number)) + ConsoleColors::RESET;
-    }
-
-    std::string toJSON() const override {
-        return (std::floor(number) == number)
-            ? std::to_string(static_cast<int>(number))
-            : std::to_string(number);
-    }
-
-    double toNum() const override { return number; }
-    bool toBool() const override { return number != 0; }
-
-    Val add(Val o) const override {
-        return std::make_shared<NumberVal>(number + o->toNum());
-    }
-
-    Val sub(Val o) const override {
-        return std::make_shared<NumberVal>(number - o->toNum());
-    }
-
-    Val mul(Val o) const override {
-        return std::make_shared<NumberVal>(number * o->toNum());
-    }
-
-    Val div(Val o) const override {
-        return std::make_shared<NumberVal>(number / o->toNum());
-    }
-
-    Val mod(Val o) const override {
-        return std::make_shared<NumberVal>(fmod(number, o->toNum()));
-    }
-
-    bool compare(const RuntimeVal& other) const override
-    {
-        if (other.type != ValueType::Number)
-            return false;
-    
-        const NumberVal& num = static_cast<const NumberVal&>(other);
-        return num.number == number;
-    }
-};
-
-struct UndefinedVal : public RuntimeVal {
-    UndefinedVal() : RuntimeVal(ValueType::Undefined, "undefined") {}
-    std::string toString() const override { return "undefined"; }
-    double toNum() const override { return 0; }
-    bool toBool() const override { return false; }
-    std::string toJSON() const override {
-        return "null";
-    }
-    std::string toConsole() const override {
-        return ConsoleColors::GRAY + "undefined" + ConsoleColors::RESET;
-    }
-
-    Val add(Val o) const override {
-        return std::make_shared<NumberVal>(0 + o->toNum());
-    }
-
-    Val sub(Val o) const override {
-        return std::make_shared<NumberVal>(0 - o->toNum());
-    }
+inline bool Val::toBool() const
+{
+    if (isNumber()) return asNumber() != 0;
+    if (isHeap()) return get()->toBool();
+    return isBool() && asBool();
+}
 
-    bool compare(const RuntimeVal& other) const override
-    {
-        return other.type == ValueType::Undefined;
-    }
-};
+template<typename T, typename... Args>
+Ref<T> makeVal(Lexer::Token tk, Args&&... args)
+{
+    Ref<T> val = make<T>(std::forward<Args>(args)...);
+    val->token = tk;
+    return val;
+}
 
-struct NullVal : public RuntimeVal {
-    NullVal() : RuntimeVal(ValueType::Null, "null") {}
-    std::string toString() const override { return "null"; }
-    double toNum() const override { return 0; }
-    bool toBool() const override { return false; }
-    std::string toJSON() const override {
-        return "null";
-    }
-    std::string toConsole() const override {
-        return ConsoleColors::GRAY + "null" + ConsoleColors::RESET;
-    }
+// Unchecked downcast of a heap value, the caller is expected to have checked type() first
+template<typename T>
+Ref<T> cast(const Val& val)
+{
+    return Ref<T>(static_cast<T*>(val.get()));
+}
 
-    Val add(Val o) const override {
-        return std::make_shared<NumberVal>(0 + o->toNum());
-    }
+// Looks up an own property first, then the type's method table. Methods are returned bound to the object
+Val getMember(const Val& object, const std::string& key);
 
-    Val sub(Val o) const override {
-        return std::make_shared<NumberVal>(0 - o->toNum());
-    }
+// The method `key` of the object's type, or nullptr if it has none or an own property shadows it
+const NativeMethod* findMethod(const Val& object, const std::string& key);
 
-    bool compare(const RuntimeVal& other) const override
-    {
-        return other.type == ValueType::Null;
-    }
-};
+using NativeFunction = std::function<Val(std::vector<Val>, EnvPtr)>;
 
 struct NativeFnValue : public RuntimeVal
 {
@@ -252,69 +157,23 @@ struct NativeFnValue : public RuntimeVal
     
     bool toBool() const override { return true; }
 
-    bool compare(const RuntimeVal& other) const override
+    bool compare(const Val& other) const override
     {
         return false;
     }
 };
 
-struct BooleanVal : public RuntimeVal {
-    bool value;
-
-    BooleanVal(bool val) 
-        : RuntimeVal(ValueType::Boolean), value(val) {}
-
-    bool getValue() const { return value; }
-
-    std::string toString() const override { return value ? "true" : "false"; }
-    double toNum() const override { return value ? 1 : 0; }
-    bool toBool() const override { return value; }
-    std::string toJSON() const override {
-        return value ? "true" : "false";
-    }
-
-    std::string toConsole() const override {
-        return ConsoleColors::YELLOW + (value ? "true" : "false") + ConsoleColors::RESET;
-    }
-
-    Val add(Val o) const override {
-        return std::make_shared<NumberVal>((value ? 1 : 0) + o->toNum());
-    }
-
-    Val sub(Val o) const override {
-        return std::make_shared<NumberVal>((value ? 1 : 0) - o->toNum());
-    }
-
-    Val mul(Val o) const override {
-        return std::make_shared<NumberVal>((value ? 1 : 0) * o->toNum());
-    }
-
-    Val div(Val o) const override {
-        return std::make_shared<NumberVal>((value ? 1 : 0) / o->toNum());
-    }
-
-    Val mod(Val o) const override {
-        return std::make_shared<NumberVal>(fmod((value ? 1 : 0), o->toNum()));
-    }
-
-    bool compare(const RuntimeVal& other) const override
-    {
-        if (other.type != ValueType::Boolean)
-            return false;
-    
-        const BooleanVal& boolean = static_cast<const BooleanVal&>(other);
-        return boolean.value == value;
-    }
-};
-
 struct ArrayVal : public RuntimeVal {
     std::vector<Val> items;
 
-    ArrayVal(std::vector<Val> items = {});
+    ArrayVal(std::vector<Val> items = {}) : RuntimeVal(ValueType::Array), items(items) {}
+
+    const MethodTable* methods() const override;
+
     std::string toString() const override {
         std::string result = "[";
         for (size_t i = 0; i < items.size(); ++i) {
-            result += items[i]->toString();
+            result += items[i].toString();
             if (i < items.size() - 1) result += ", ";
         }
         result += "]";
@@ -324,7 +183,7 @@ struct ArrayVal : public RuntimeVal {
     std::string toJSON() const override {
         std::string result = "[";
         for (size_t i = 0; i < items.size(); ++i) {
-            result += items[i]->toJSON();
+            result += items[i].toJSON();
             if (i < items.size() - 1) result += ", ";
         }
         result += "]";
@@ -334,7 +193,7 @@ struct ArrayVal : public RuntimeVal {
     std::string toConsole() const override {
         std::string result = "[";
         for (size_t i = 0; i < items.size(); ++i) {
-            result += items[i]->toConsole();
+            result += items[i].toConsole();
             if (i < items.size() - 1) result += ", ";
         }
         result += "]";
@@ -343,24 +202,24 @@ struct ArrayVal : public RuntimeVal {
 
     bool toBool() const override { return true; }
 
-    Val add(Val o) const override {
+    Val add(const Val& o) const override {
         std::vector<Val> citems(items);
         citems.push_back(o);
-        return std::make_shared<ArrayVal>(citems);
+        return make<ArrayVal>(citems);
     }
 
-    bool compare(const RuntimeVal& other) const override
+    bool compare(const Val& other) const override
     {
-        if (other.type != ValueType::Array)
+        if (other.type() != ValueType::Array)
             return false;
     
-        const ArrayVal& arr = static_cast<const ArrayVal&>(other);
+        const ArrayVal& arr = static_cast<const ArrayVal&>(*other.get());
         if (arr.items.size() != items.size())
             return false;
 
         for (size_t i = 0; i < items.size(); i++)
         {
-            if (!(*arr.items[i] == *items[i]))
+            if (!arr.items[i].equals(items[i]))
                 return false;
         }
 
@@ -368,6 +227,25 @@ struct ArrayVal : public RuntimeVal {
     }
 };
 
+// The outcome of executing a statement. Return, Break and Continue travel up through the
+// enclosing bodies until a function call or loop consumes them
+struct Completion
+{
+    enum class Type
+    {
+        Normal,
+        Return,
+        Break,
+        Continue,
+    };
+
+    Type type = Type::Normal;
+    Val value;
+
+    bool isAbrupt() const { return type != Type::Normal; }
+};
+
+// Thrown when a return, break or continue completion escapes the function or loop it belongs to
 class ReturnSignal : public std::runtime_error
 {
 public:
@@ -395,6 +273,7 @@ struct FunctionValue : public RuntimeVal {
     std::vector<std::shared_ptr<AST::VarDeclarationType>> templateparams;
     EnvPtr declarationEnv;
     std::vector<std::shared_ptr<AST::Stmt>> body;
+    std::shared_ptr<AST::Scope> scope;
 
     FunctionValue (std::string name, std::vector<std::shared_ptr<AST::VarDeclarationType>> params, EnvPtr declarationEnv, std::vector<std::shared_ptr<AST::Stmt>> body, bool isAsync = false) 
         : RuntimeVal(ValueType::Function), name(name), params(params), declarationEnv(declarationEnv), body(body), isAsync(isAsync) {}
@@ -411,6 +290,40 @@ struct FunctionValue : public RuntimeVal {
 
     bool toBool() const override { return true; }
     bool isAsync = false;
+
+    // Class methods are shared by every instance and get `this` from the receiver when called.
+    // A method read off an object as a value is a copy bound to that object
+    bool isMethod = false;
+    Val boundThis;
+    Val superConstructor;
+
+    // Set for functions declared in a probe body. They are built once per probe and run over the
+    // environment of the probe call that reached them
+    std::shared_ptr<AST::Scope> probeScope;
+};
+
+// A probe's body as the steps every call replays in order, with its functions already built
+struct ProbeTemplate {
+    enum class StepKind {
+        // Instantiates the superprobe `value` and declares its members, its `run` as `super`
+        SuperProbe,
+        // A function of the probe itself, `value` is built once and declared by every call
+        Function,
+        // Copies the members of a fresh instance of the native class `value`
+        NativeBase,
+        // A `name = value` member of the probe itself
+        Assignment,
+        Statement,
+    };
+
+    struct Step {
+        StepKind kind;
+        std::string name;
+        Val value;
+        std::shared_ptr<AST::Stmt> stmt;
+    };
+
+    std::vector<Step> steps;
 };
 
 struct ProbeValue : public RuntimeVal {
@@ -419,6 +332,12 @@ struct ProbeValue : public RuntimeVal {
     bool doesExtend = false;
     EnvPtr declarationEnv;
     std::vector<std::shared_ptr<AST::Stmt>> body;
+    std::shared_ptr<AST::Scope> scope;
+
+    // Built on the first call
+    ProbeTemplate probeTemplate;
+    std::once_flag templateBuilt;
+
     ProbeValue (std::string name, EnvPtr declarationEnv, std::vector<std::shared_ptr<AST::Stmt>> body) 
         : RuntimeVal(ValueType::Probe), name(name), declarationEnv(declarationEnv), body(body) {}
     ProbeValue (std::string name, EnvPtr declarationEnv, std::vector<std::shared_ptr<AST::Stmt>> body, std::shared_ptr<AST::Expr> extends) 
@@ -432,16 +351,21 @@ struct ProbeValue : public RuntimeVal {
     bool toBool() const override { return true; }
 };
 
+// Built once when the class is defined: `new` copies the prototype and only runs the field initializers
 struct ClassVal : public RuntimeVal {
     std::string name;
     EnvPtr parentEnv;
     std::vector<std::shared_ptr<AST::Stmt>> body;
-    std::shared_ptr<AST::Expr> extends;
-    bool doesExtend = false;
-    ClassVal(std::string name, EnvPtr declarationEnv, std::vector<std::shared_ptr<AST::Stmt>> body) 
-    : RuntimeVal(ValueType::Class), name(name), parentEnv(declarationEnv), body(body) {}
-    ClassVal(std::string name, EnvPtr declarationEnv, std::vector<std::shared_ptr<AST::Stmt>> body, std::shared_ptr<AST::Expr> extends) 
-    : RuntimeVal(ValueType::Class), name(name), parentEnv(declarationEnv), body(body), extends(extends), doesExtend(true) {}
+    Ref<ClassVal> superclass;
+
+    // Inherited and own methods plus every field name, in the order instances get them
+    Properties prototype;
+    // Field initializers and other statements of this class's own body
+    std::vector<std::shared_ptr<AST::Stmt>> initializers;
+    Val constructor;
+
+    ClassVal(std::string name, EnvPtr declarationEnv, std::vector<std::shared_ptr<AST::Stmt>> body, Ref<ClassVal> superclass = nullptr) 
+    : RuntimeVal(ValueType::Class), name(name), parentEnv(declarationEnv), body(body), superclass(superclass) {}
     std::string toString() const override {
         return "[class " + name + "]";
     }
@@ -464,7 +388,10 @@ struct NativeClassVal : public RuntimeVal {
 
 struct StringVal : public RuntimeVal {
     std::string string;
-    StringVal(std::string val);
+    StringVal(std::string val) : RuntimeVal(ValueType::String), string(val) {}
+
+    const MethodTable* methods() const override;
+
     std::string toString() const override { return string; }
     std::string toJSON() const override { return "\"" + string + "\""; }
     double toNum() const override
@@ -486,25 +413,25 @@ struct StringVal : public RuntimeVal {
         return ConsoleColors::GREEN + "\"" + string + "\"" + ConsoleColors::RESET;
     }
 
-    Val add(Val o) const override {
-        return std::make_shared<StringVal>(string + o->toString());
+    Val add(const Val& o) const override {
+        return make<StringVal>(string + o.toString());
     }
 
-    Val mul(Val o) {
+    Val mul(const Val& o) {
         std::string r;
-        for (size_t i = 0; i < o->toNum() && i < 10000; i++) {
+        for (size_t i = 0; i < o.toNum() && i < 10000; i++) {
             r += string;
         }
 
-        return std::make_shared<StringVal>(r);
+        return make<StringVal>(r);
     }
 
-    bool compare(const RuntimeVal& other) const override
+    bool compare(const Val& other) const override
     {
-        if (other.type != ValueType::String)
+        if (other.type() != ValueType::String)
             return false;
     
-        const StringVal& str = static_cast<const StringVal&>(other);
+        const StringVal& str = static_cast<const StringVal&>(*other.get());
         return str.string == string;
     }
 };
@@ -512,8 +439,8 @@ struct StringVal : public RuntimeVal {
 
 struct ObjectVal : public RuntimeVal
 {
-    ObjectVal(std::unordered_map<std::string, Val> properties = {})
-        : RuntimeVal(ValueType::Object, properties) {}
+    ObjectVal(Properties properties = {})
+        : RuntimeVal(ValueType::Object, std::move(properties)) {}
 
     bool hasProperty(const std::string& prop)
     {
@@ -527,7 +454,7 @@ struct ObjectVal : public RuntimeVal
         for (const auto& [key, val] : properties)
         {
             if (!first) result += ", ";
-            result += key + ": " + val->toString();
+            result += key + ": " + val.toString();
             first = false;
         }
         result += " }";
@@ -541,7 +468,7 @@ struct ObjectVal : public RuntimeVal
         for (const auto& [key, val] : properties)
         {
             if (!first) result += ", ";
-            result += "\"" + key + "\"" + ": " + val->toJSON();
+            result += "\"" + key + "\"" + ": " + val.toJSON();
             first = false;
         }
         result += " }";
@@ -555,7 +482,7 @@ struct ObjectVal : public RuntimeVal
         for (const auto& [key, val] : properties)
         {
             if (!first) result += ", ";
-            result += "\"" + key + "\"" + ": " + val->toConsole();
+            result += "\"" + key + "\"" + ": " + val.toConsole();
             first = false;
         }
         result += " }";
@@ -564,7 +491,7 @@ struct ObjectVal : public RuntimeVal
 
     bool toBool() const override { return true; }
 
-    bool compare(const RuntimeVal& other) const override
+    bool compare(const Val& other) const override
     {
         return false;
     }
@@ -573,8 +500,12 @@ struct ObjectVal : public RuntimeVal
 struct FutureVal : public RuntimeVal
 {
     std::shared_future<Val> future;
+    // Set for tasks started on the event loop, which resumes their awaiters through it
+    std::shared_ptr<Loop::Completion> completion;
+    // Set for tasks started on the thread pool, so an awaiter can run one that has not started yet
+    std::shared_ptr<Executor::Job> job;
 
-    bool compare(const RuntimeVal& other) const override
+    bool compare(const Val& other) const override
     {
         return false;
     }
@@ -591,6 +522,12 @@ struct FutureVal : public RuntimeVal
 
     FutureVal(std::shared_future<Val> fut)
         : RuntimeVal(ValueType::Future), future(fut) {}
+
+    FutureVal(std::shared_future<Val> fut, std::shared_ptr<Loop::Completion> completion)
+        : RuntimeVal(ValueType::Future), future(fut), completion(std::move(completion)) {}
+
+    FutureVal(std::shared_future<Val> fut, std::shared_ptr<Executor::Job> job)
+        : RuntimeVal(ValueType::Future), future(fut), job(std::move(job)) {}
 };
 
 } // namespace Probescript::Values
\ No newline at end of file
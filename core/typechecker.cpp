@@ -1,4 +1,5 @@
 #include "typechecker.hpp"
+#include "registry.hpp"
 
 using namespace Probescript;
 using namespace Probescript::Typechecker;
@@ -742,13 +743,10 @@ TypePtr TC::checkArrowFunction(std::shared_ptr<AST::ArrowFunctionType> fn, TypeE
 
 TypePtr TC::checkImportStmt(std::shared_ptr<AST::ImportStmtType> stmt, TypeEnvPtr env, std::shared_ptr<Context> ctx)
 {
-    std::unordered_map<std::string, TypePtr> stdlib;
-    for (const auto& [key, pair] : g_stdlib)
-        stdlib[key] = pair.second;
-
-    if (stdlib.find(stmt->name) != stdlib.end())
+    auto stdlib = g_stdlib.find(stmt->name);
+    if (stdlib != g_stdlib.end())
     {
-        TypePtr lib = stdlib[stmt->name];
+        TypePtr lib = stdlib->second.second;
         if (!stmt->hasMember)
         {
             return env->declareVar(stmt->customIdent ? stmt->ident : stmt->name, lib, stmt->token);
@@ -758,28 +756,19 @@ TypePtr TC::checkImportStmt(std::shared_ptr<AST::ImportStmtType> stmt, TypeEnvPt
         tempenv->declareVar(stmt->name, lib, stmt->module->token);
         TypePtr member = checkMemberExpr(std::static_pointer_cast<AST::MemberExprType>(stmt->module), tempenv);
 
-        return env->declareVar(stmt->customIdent ? stmt->ident : std::static_pointer_cast<AST::MemberExprType>(stmt->module)->lastProp, member, stmt->module->token);
+        return env->declareVar(stmt->customIdent ? stmt->ident : std::static_pointer_cast<AST::MemberExprType>(stmt->module)->lastProp.str(), member, stmt->module->token);
     } else
     {
-        if (ctx->modules.find(stmt->name) == ctx->modules.end())
+        // Checked once per process, the parsed module is the same one the interpreter runs
+        std::shared_ptr<Registry::Module> module = Registry::import(stmt->name, ctx);
+        if (!module)
         {
             throw std::runtime_error(CustomError("Module " + stmt->name + " not found", "ImportError", stmt->token));
         }
 
-        fs::path path = ctx->modules[stmt->name];
-
-        std::ifstream stream(path);
-        std::string file((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
-        Parser parser;
-        std::shared_ptr<Context> context = std::make_shared<Context>();
-        context->file = file;
-        context->filename = fs::absolute(path).string();
-        context->modules = ctx->modules;
-
-        std::shared_ptr<AST::ProgramType> program = parser.parse(file, context);
-        m_context = context;
-        std::unordered_map<std::string, TypePtr> exports = getExports(program, context);
+        checkModule(*module, stmt->token);
         m_context = ctx;
+        const std::unordered_map<std::string, TypePtr>& exports = module->types;
 
         if (!stmt->hasMember)
         {
@@ -790,7 +779,7 @@ TypePtr TC::checkImportStmt(std::shared_ptr<AST::ImportStmtType> stmt, TypeEnvPt
         tempenv->declareVar(stmt->name, std::make_shared<Type>(TypeKind::Module, "module", std::make_shared<TypeVal>(exports)), stmt->module->token);
         TypePtr member = checkMemberExpr(std::static_pointer_cast<AST::MemberExprType>(stmt->module), tempenv);
 
-        return env->declareVar(stmt->customIdent ? stmt->ident : std::static_pointer_cast<AST::MemberExprType>(stmt->module)->lastProp, member, stmt->module->token);
+        return env->declareVar(stmt->customIdent ? stmt->ident : std::static_pointer_cast<AST::MemberExprType>(stmt->module)->lastProp.str(), member, stmt->module->token);
     }
 
     return std::make_shared<Type>(TypeKind::Any, "module");
@@ -852,6 +841,27 @@ TypePtr TC::checkNewExpr(std::shared_ptr<AST::NewExprType> expr, TypeEnvPtr env)
     return type;
 }
 
+void TC::checkModule(Registry::Module& module, const Lexer::Token& tk)
+{
+    Registry::once(module, module.checked, tk, [&]()
+    {
+        std::shared_ptr<Context> previous = m_context;
+        m_context = module.context;
+
+        try
+        {
+            module.types = getExports(module.program, module.context);
+        }
+        catch (...)
+        {
+            m_context = previous;
+            throw;
+        }
+
+        m_context = previous;
+    });
+}
+
 std::unordered_map<std::string, TypePtr> TC::getExports(std::shared_ptr<AST::ProgramType> program, std::shared_ptr<Context> ctx)
 {
     TypeEnvPtr env = std::make_shared<TypeEnv>();
@@ -904,6 +914,9 @@ TypePtr TC::checkAwaitExpr(std::shared_ptr<AST::AwaitExprType> expr, TypeEnvPtr
         throw std::runtime_error(TypeError("Cannot await a value that is not a future", expr->caller->token));
     }
 
+    // Natives like http.get return a plain future, without a result type
+    if (!type->val || !type->val->futureVal) return std::make_shared<Type>(TypeKind::Any, "any");
+
     return type->val->futureVal;
 }
 
@@ -8,6 +8,7 @@
 #include "errors.hpp"
 #include "context.hpp"
 #include "frontend/parser.hpp"
+#include "registry.hpp"
 #include "types.hpp"
 
 extern std::unordered_map<std::string, std::pair<Probescript::Values::Val, Probescript::Typechecker::TypePtr>> g_stdlib;
@@ -24,6 +25,9 @@ class TC
 {
 public:
     void checkProgram(std::shared_ptr<AST::ProgramType> program, TypeEnvPtr env, std::shared_ptr<Context> ctx = std::make_shared<Context>());
+
+    // Collects the exported types of `module`, unless an importer on any thread already did
+    void checkModule(Registry::Module& module, const Lexer::Token& tk);
 private:
     std::shared_ptr<Context> m_context;
     TypePtr m_currentret;
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "frontend/ast.hpp"
+#include "runtime/val.hpp"
+#include "vm/opcodes.hpp"
+
+namespace Probescript::VM
+{
+
+// A compiled function or program body
+struct Chunk
+{
+    std::string name;
+    std::vector<uint8_t> code;
+    std::vector<Values::Val> constants;
+    // Nodes referenced by instructions, for names, addresses and error tokens
+    std::vector<std::shared_ptr<AST::Stmt>> nodes;
+    std::vector<std::shared_ptr<AST::Scope>> scopes;
+
+    uint16_t readU16(size_t at) const
+    {
+        return static_cast<uint16_t>(code[at] | (code[at + 1] << 8));
+    }
+
+    uint32_t readU32(size_t at) const
+    {
+        return static_cast<uint32_t>(code[at])
+            | (static_cast<uint32_t>(code[at + 1]) << 8)
+            | (static_cast<uint32_t>(code[at + 2]) << 16)
+            | (static_cast<uint32_t>(code[at + 3]) << 24);
+    }
+};
+
+using ChunkPtr = std::shared_ptr<const Chunk>;
+
+} // namespace Probescript::VM
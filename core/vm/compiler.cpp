@@ -0,0 +1,584 @@
+#include <optional>
+
+#include "vm/compiler.hpp"
+#include "errors.hpp"
+
+using namespace Probescript;
+using namespace Probescript::VM;
+
+std::shared_ptr<Chunk> Compiler::compileFunction(const std::string& name, const std::vector<std::shared_ptr<AST::Stmt>>& body)
+{
+    m_chunk = std::make_shared<Chunk>();
+    m_chunk->name = name;
+
+    compileBody(body);
+
+    emit(OpCode::Undefined);
+    emit(OpCode::Return);
+
+    return m_chunk;
+}
+
+std::shared_ptr<Chunk> Compiler::compileProgram(std::shared_ptr<AST::ProgramType> program, const std::string& probeName)
+{
+    m_chunk = std::make_shared<Chunk>();
+    m_chunk->name = "<program>";
+
+    for (std::shared_ptr<AST::Stmt> stmt : program->body)
+    {
+        if (
+            stmt->kind == AST::NodeType::ProbeDeclaration
+            && std::static_pointer_cast<AST::ProbeDeclarationType>(stmt)->name == probeName
+        ) break;
+
+        switch (stmt->kind)
+        {
+            case AST::NodeType::VarDeclaration:
+            case AST::NodeType::FunctionDeclaration:
+            case AST::NodeType::ClassDefinition:
+            case AST::NodeType::ProbeDeclaration:
+            case AST::NodeType::ImportStmt:
+                compileStmt(stmt);
+                break;
+            default:
+                throw std::runtime_error(CustomError("Only variable, function, class, and probe declarations are allowed in program bodies", "ProgramError"));
+        }
+    }
+
+    emit(OpCode::Undefined);
+    emit(OpCode::Return);
+
+    return m_chunk;
+}
+
+void Compiler::emit(OpCode op)
+{
+    m_chunk->code.push_back(static_cast<uint8_t>(op));
+}
+
+void Compiler::emitU16(size_t value)
+{
+    if (value > UINT16_MAX)
+    {
+        throw std::runtime_error(CustomError("Function " + m_chunk->name + " is too large to compile", "CompileError"));
+    }
+
+    m_chunk->code.push_back(value & 0xff);
+    m_chunk->code.push_back((value >> 8) & 0xff);
+}
+
+void Compiler::emit(OpCode op, size_t operand)
+{
+    emit(op);
+    emitU16(operand);
+}
+
+// Emits a jump and returns the position of its address operand, for patching
+size_t Compiler::emitJump(OpCode op, size_t target)
+{
+    emit(op);
+    size_t at = m_chunk->code.size();
+    for (int i = 0; i < 4; i++) m_chunk->code.push_back(0);
+    patch(at, target);
+
+    return at;
+}
+
+void Compiler::patch(size_t jump)
+{
+    patch(jump, m_chunk->code.size());
+}
+
+void Compiler::patch(size_t jump, size_t target)
+{
+    for (int i = 0; i < 4; i++)
+        m_chunk->code[jump + i] = (target >> (8 * i)) & 0xff;
+}
+
+size_t Compiler::node(std::shared_ptr<AST::Stmt> stmt)
+{
+    m_chunk->nodes.push_back(stmt);
+    return m_chunk->nodes.size() - 1;
+}
+
+size_t Compiler::scope(std::shared_ptr<AST::Scope> scope)
+{
+    m_chunk->scopes.push_back(scope);
+    return m_chunk->scopes.size() - 1;
+}
+
+size_t Compiler::constant(Values::Val value)
+{
+    for (size_t i = 0; i < m_chunk->constants.size(); i++)
+        if (m_chunk->constants[i].equals(value)) return i;
+
+    m_chunk->constants.push_back(value);
+    return m_chunk->constants.size() - 1;
+}
+
+void Compiler::enterScope(std::shared_ptr<AST::Scope> s)
+{
+    emit(OpCode::EnterScope, scope(s));
+    m_depth++;
+}
+
+void Compiler::leaveScopes(int count)
+{
+    if (count > 0) emit(OpCode::LeaveScope, count);
+}
+
+void Compiler::compileBody(const std::vector<std::shared_ptr<AST::Stmt>>& body)
+{
+    for (std::shared_ptr<AST::Stmt> stmt : body)
+    {
+        compileStmt(stmt);
+    }
+}
+
+void Compiler::compileScopedBody(std::shared_ptr<AST::Scope> s, const std::vector<std::shared_ptr<AST::Stmt>>& body)
+{
+    enterScope(s);
+    compileBody(body);
+    leaveScopes(1);
+    m_depth--;
+}
+
+void Compiler::compileStmt(std::shared_ptr<AST::Stmt> stmt)
+{
+    switch (stmt->kind)
+    {
+        case AST::NodeType::VarDeclaration:
+        {
+            std::shared_ptr<AST::VarDeclarationType> decl = std::static_pointer_cast<AST::VarDeclarationType>(stmt);
+
+            if (decl->value != nullptr) compileExpr(decl->value);
+            else emit(OpCode::Undefined);
+
+            emit(OpCode::Define, node(decl));
+            break;
+        }
+
+        case AST::NodeType::FunctionDeclaration:
+        {
+            size_t index = node(stmt);
+            emit(OpCode::Function, index);
+            emit(OpCode::Define, index);
+            break;
+        }
+
+        case AST::NodeType::ReturnStmt:
+            compileExpr(std::static_pointer_cast<AST::ReturnStmtType>(stmt)->val);
+
+            if (m_catches.empty())
+            {
+                emit(OpCode::Return);
+                break;
+            }
+
+            emit(OpCode::Pop);
+            for (int i = m_catches.back().tries; i < m_tries; i++) emit(OpCode::EndTry);
+            leaveScopes(m_depth - m_catches.back().depth);
+            m_catches.back().exits.push_back(emitJump(OpCode::Jump));
+            break;
+
+        case AST::NodeType::ThrowStmt:
+            compileExpr(std::static_pointer_cast<AST::ThrowStmtType>(stmt)->err);
+            emit(OpCode::Throw);
+            break;
+
+        case AST::NodeType::IfStmt:
+            compileIf(std::static_pointer_cast<AST::IfStmtType>(stmt));
+            break;
+
+        case AST::NodeType::WhileStmt:
+            compileWhile(std::static_pointer_cast<AST::WhileStmtType>(stmt));
+            break;
+
+        case AST::NodeType::ForStmt:
+            compileFor(std::static_pointer_cast<AST::ForStmtType>(stmt));
+            break;
+
+        case AST::NodeType::TryStmt:
+            compileTry(std::static_pointer_cast<AST::TryStmtType>(stmt));
+            break;
+
+        case AST::NodeType::BreakStmt:
+            compileJump(stmt, true);
+            break;
+
+        case AST::NodeType::ContinueStmt:
+            compileJump(stmt, false);
+            break;
+
+        case AST::NodeType::ClassDefinition:
+        case AST::NodeType::ProbeDeclaration:
+        case AST::NodeType::ImportStmt:
+        case AST::NodeType::ExportStmt:
+            emit(OpCode::Eval, node(stmt));
+            emit(OpCode::Pop);
+            break;
+
+        default:
+            compileExpr(stmt);
+            emit(OpCode::Pop);
+    }
+}
+
+void Compiler::compileIf(std::shared_ptr<AST::IfStmtType> stmt)
+{
+    compileExpr(stmt->condition);
+    size_t elseJump = emitJump(OpCode::JumpIfFalse);
+
+    compileScopedBody(stmt->scope, stmt->body);
+
+    if (!stmt->hasElse)
+    {
+        patch(elseJump);
+        return;
+    }
+
+    size_t endJump = emitJump(OpCode::Jump);
+    patch(elseJump);
+    compileScopedBody(stmt->elseScope, stmt->elseStmt);
+    patch(endJump);
+}
+
+void Compiler::compileWhile(std::shared_ptr<AST::WhileStmtType> stmt)
+{
+    size_t start = m_chunk->code.size();
+
+    compileExpr(stmt->condition);
+    size_t exitJump = emitJump(OpCode::JumpIfFalse);
+
+    m_loops.push_back({ m_depth, m_depth, m_tries, {}, {} });
+    compileScopedBody(stmt->scope, stmt->body);
+    emitJump(OpCode::Jump, start);
+
+    Loop loop = m_loops.back();
+    m_loops.pop_back();
+
+    patch(exitJump);
+    for (size_t jump : loop.breaks) patch(jump);
+    for (size_t jump : loop.continues) patch(jump, start);
+}
+
+// The declarations get a scope of their own, each iteration (conditions, body and updates) another
+void Compiler::compileFor(std::shared_ptr<AST::ForStmtType> stmt)
+{
+    enterScope(stmt->declScope);
+    compileBody(stmt->declarations);
+
+    size_t start = m_chunk->code.size();
+    enterScope(stmt->scope);
+
+    std::vector<size_t> exits;
+    for (std::shared_ptr<AST::Expr> cond : stmt->conditions)
+    {
+        compileExpr(cond);
+        exits.push_back(emitJump(OpCode::JumpIfFalse));
+    }
+
+    m_loops.push_back({ m_depth - 1, m_depth, m_tries, {}, {} });
+    compileBody(stmt->body);
+
+    Loop loop = m_loops.back();
+    m_loops.pop_back();
+
+    for (size_t jump : loop.continues) patch(jump);
+    for (std::shared_ptr<AST::Expr> update : stmt->updates)
+    {
+        compileExpr(update);
+        emit(OpCode::Pop);
+    }
+
+    leaveScopes(1);
+    emitJump(OpCode::Jump, start);
+
+    for (size_t jump : exits) patch(jump);
+    leaveScopes(1);
+    m_depth--;
+
+    for (size_t jump : loop.breaks) patch(jump);
+    leaveScopes(1);
+    m_depth--;
+}
+
+// The handler is entered with the error message on the stack, which becomes the first catch parameter
+void Compiler::compileTry(std::shared_ptr<AST::TryStmtType> stmt)
+{
+    size_t handlerJump = emitJump(OpCode::Try);
+    m_tries++;
+
+    compileScopedBody(stmt->scope, stmt->body);
+
+    m_tries--;
+    emit(OpCode::EndTry);
+    size_t endJump = emitJump(OpCode::Jump);
+
+    patch(handlerJump);
+
+    std::shared_ptr<AST::FunctionDeclarationType> handler = stmt->catchHandler;
+    enterScope(handler->scope);
+
+    if (handler->parameters.empty()) emit(OpCode::Pop);
+    for (size_t i = 0; i < handler->parameters.size(); i++)
+    {
+        std::shared_ptr<AST::VarDeclarationType> param = handler->parameters[i];
+        if (i > 0)
+        {
+            if (param->value != nullptr) compileExpr(param->value);
+            else emit(OpCode::Undefined);
+        }
+        emit(OpCode::Define, node(param));
+    }
+
+    m_catches.push_back({ m_depth - 1, m_tries, {} });
+    compileBody(handler->body);
+
+    Catch handled = m_catches.back();
+    m_catches.pop_back();
+
+    leaveScopes(1);
+    m_depth--;
+
+    // Returns land here with the catch scope already left
+    if (!handled.exits.empty())
+    {
+        size_t skip = emitJump(OpCode::Jump);
+        for (size_t jump : handled.exits) patch(jump);
+        patch(skip);
+    }
+
+    patch(endJump);
+}
+
+void Compiler::compileJump(std::shared_ptr<AST::Stmt> stmt, bool isBreak)
+{
+    // Outside of a loop the tree-walker raises the signal
+    if (m_loops.empty())
+    {
+        emit(OpCode::Eval, node(stmt));
+        emit(OpCode::Pop);
+        return;
+    }
+
+    Loop& loop = m_loops.back();
+
+    for (int i = loop.tries; i < m_tries; i++) emit(OpCode::EndTry);
+    leaveScopes(m_depth - (isBreak ? loop.depth : loop.continueDepth));
+
+    (isBreak ? loop.breaks : loop.continues).push_back(emitJump(OpCode::Jump));
+}
+
+void Compiler::compileExpr(std::shared_ptr<AST::Stmt> expr)
+{
+    switch (expr->kind)
+    {
+        case AST::NodeType::NumericLiteral:
+            emit(OpCode::Constant, constant(Values::makeNumber(std::static_pointer_cast<AST::NumericLiteralType>(expr)->numValue)));
+            break;
+
+        case AST::NodeType::StringLiteral:
+            emit(OpCode::String, node(expr));
+            break;
+
+        case AST::NodeType::NullLiteral:
+            emit(OpCode::Null);
+            break;
+
+        case AST::NodeType::UndefinedLiteral:
+            emit(OpCode::Undefined);
+            break;
+
+        case AST::NodeType::BoolLiteral:
+            emit(std::static_pointer_cast<AST::BoolLiteralType>(expr)->value ? OpCode::True : OpCode::False);
+            break;
+
+        case AST::NodeType::Identifier:
+            emit(OpCode::Load, node(expr));
+            break;
+
+        case AST::NodeType::BinaryExpr:
+            compileBinary(std::static_pointer_cast<AST::BinaryExprType>(expr));
+            break;
+
+        case AST::NodeType::AssignmentExpr:
+            compileAssignment(std::static_pointer_cast<AST::AssignmentExprType>(expr));
+            break;
+
+        case AST::NodeType::CallExpr:
+            compileCall(std::static_pointer_cast<AST::CallExprType>(expr));
+            break;
+
+        case AST::NodeType::MemberExpr:
+        {
+            std::shared_ptr<AST::MemberExprType> member = std::static_pointer_cast<AST::MemberExprType>(expr);
+            compileExpr(member->object);
+            if (member->computed) compileExpr(member->property);
+            emit(OpCode::GetMember, node(member));
+            break;
+        }
+
+        case AST::NodeType::MemberAssignment:
+        {
+            std::shared_ptr<AST::MemberAssignmentType> assign = std::static_pointer_cast<AST::MemberAssignmentType>(expr);
+            compileExpr(assign->object);
+            compileExpr(assign->newvalue);
+            if (assign->computed) compileExpr(assign->property);
+            emit(OpCode::SetMember, node(assign));
+            break;
+        }
+
+        case AST::NodeType::ArrayLiteral:
+        {
+            std::shared_ptr<AST::ArrayLiteralType> array = std::static_pointer_cast<AST::ArrayLiteralType>(expr);
+            for (std::shared_ptr<AST::Expr> item : array->items)
+            {
+                compileExpr(item);
+            }
+            emit(OpCode::Array, node(array));
+            break;
+        }
+
+        case AST::NodeType::MapLiteral:
+        {
+            std::shared_ptr<AST::MapLiteralType> map = std::static_pointer_cast<AST::MapLiteralType>(expr);
+            for (std::shared_ptr<AST::PropertyLiteralType> property : map->properties)
+            {
+                if (property->val == nullptr) emit(OpCode::LoadName, node(property));
+                else compileExpr(property->val);
+            }
+            emit(OpCode::Map, node(map));
+            break;
+        }
+
+        case AST::NodeType::TernaryExpr:
+        {
+            std::shared_ptr<AST::TernaryExprType> ternary = std::static_pointer_cast<AST::TernaryExprType>(expr);
+            compileExpr(ternary->cond);
+            size_t altJump = emitJump(OpCode::JumpIfFalse);
+            compileExpr(ternary->cons);
+            size_t endJump = emitJump(OpCode::Jump);
+            patch(altJump);
+            compileExpr(ternary->alt);
+            patch(endJump);
+            break;
+        }
+
+        case AST::NodeType::UnaryPrefix:
+        {
+            std::shared_ptr<AST::UnaryPrefixType> prefix = std::static_pointer_cast<AST::UnaryPrefixType>(expr);
+            compileExpr(prefix->assigne);
+            if (prefix->opType == AST::Operator::Not)
+            {
+                emit(OpCode::Not);
+            }
+            else
+            {
+                emit(OpCode::Pop);
+                emit(OpCode::Undefined);
+            }
+            break;
+        }
+
+        case AST::NodeType::UnaryPostFix:
+        {
+            std::shared_ptr<AST::UnaryPostFixType> postfix = std::static_pointer_cast<AST::UnaryPostFixType>(expr);
+            if (postfix->assigne->kind == AST::NodeType::Identifier) emit(OpCode::Postfix, node(postfix));
+            else emit(OpCode::Eval, node(postfix));
+            break;
+        }
+
+        case AST::NodeType::ArrowFunction:
+            emit(OpCode::Function, node(expr));
+            break;
+
+        case AST::NodeType::CastExpr:
+            compileExpr(std::static_pointer_cast<AST::CastExprType>(expr)->left);
+            break;
+
+        default:
+            emit(OpCode::Eval, node(expr));
+    }
+}
+
+static std::optional<OpCode> binaryOpCode(AST::Operator op)
+{
+    switch (op)
+    {
+        case AST::Operator::Add: return OpCode::Add;
+        case AST::Operator::Sub: return OpCode::Sub;
+        case AST::Operator::Mul: return OpCode::Mul;
+        case AST::Operator::Div: return OpCode::Div;
+        case AST::Operator::Mod: return OpCode::Mod;
+        case AST::Operator::Equal: return OpCode::Equal;
+        case AST::Operator::NotEqual: return OpCode::NotEqual;
+        case AST::Operator::Less: return OpCode::Less;
+        case AST::Operator::Greater: return OpCode::Greater;
+        case AST::Operator::LessEqual: return OpCode::LessEqual;
+        case AST::Operator::GreaterEqual: return OpCode::GreaterEqual;
+        case AST::Operator::And: return OpCode::And;
+        case AST::Operator::Or: return OpCode::Or;
+        default: return std::nullopt;
+    }
+}
+
+// Both operands are always evaluated, && and || included, like in the tree-walker
+void Compiler::compileBinary(std::shared_ptr<AST::BinaryExprType> expr)
+{
+    std::optional<OpCode> op = binaryOpCode(expr->opType);
+    if (!op)
+    {
+        emit(OpCode::Eval, node(expr));
+        return;
+    }
+
+    compileExpr(expr->left);
+    compileExpr(expr->right);
+    emit(*op);
+}
+
+void Compiler::compileAssignment(std::shared_ptr<AST::AssignmentExprType> expr)
+{
+    bool plain = expr->opType == AST::Operator::Assign;
+    std::optional<OpCode> op = binaryOpCode(AST::arithmeticOf(expr->opType));
+    if (expr->assigne->kind != AST::NodeType::Identifier || (!plain && !op))
+    {
+        emit(OpCode::Eval, node(expr));
+        return;
+    }
+
+    size_t ident = node(expr->assigne);
+
+    if (plain)
+    {
+        compileExpr(expr->value);
+    }
+    else
+    {
+        emit(OpCode::Load, ident);
+        compileExpr(expr->value);
+        emit(*op);
+    }
+
+    emit(OpCode::Store, ident);
+}
+
+// Arguments are evaluated before the callee, like in the tree-walker
+void Compiler::compileCall(std::shared_ptr<AST::CallExprType> call)
+{
+    for (std::shared_ptr<AST::Expr> arg : call->args)
+    {
+        compileExpr(arg);
+    }
+
+    if (call->calee->kind == AST::NodeType::MemberExpr && !std::static_pointer_cast<AST::MemberExprType>(call->calee)->computed)
+    {
+        compileExpr(std::static_pointer_cast<AST::MemberExprType>(call->calee)->object);
+        emit(OpCode::CallMethod, node(call));
+        return;
+    }
+
+    compileExpr(call->calee);
+    emit(OpCode::Call, call->args.size());
+}
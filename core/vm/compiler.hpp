@@ -0,0 +1,79 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "frontend/ast.hpp"
+#include "vm/chunk.hpp"
+
+namespace Probescript::VM
+{
+
+// Compiles statement lists into bytecode chunks. Functions are compiled lazily, one chunk per
+// body, the first time they are called. Declarative nodes (classes, probes, imports, new
+// expressions, template calls and awaits) are compiled to Eval and run by the tree-walker
+class Compiler
+{
+public:
+    std::shared_ptr<Chunk> compileFunction(const std::string& name, const std::vector<std::shared_ptr<AST::Stmt>>& body);
+
+    // Top level declarations of a program run with RuntimeType::Normal, up to (not including) the probe `probeName`
+    std::shared_ptr<Chunk> compileProgram(std::shared_ptr<AST::ProgramType> program, const std::string& probeName);
+
+private:
+    struct Loop
+    {
+        // Environment depth outside the loop body, breaks and continues leave everything above it
+        int depth;
+        int continueDepth;
+        int tries;
+        std::vector<size_t> breaks;
+        std::vector<size_t> continues;
+    };
+
+    // Catch bodies are compiled inline. A return inside one only leaves the catch body,
+    // as it does when the tree-walker runs the handler as a function
+    struct Catch
+    {
+        int depth;
+        int tries;
+        std::vector<size_t> exits;
+    };
+
+    std::shared_ptr<Chunk> m_chunk;
+    std::vector<Loop> m_loops;
+    std::vector<Catch> m_catches;
+    int m_depth = 0;
+    int m_tries = 0;
+
+    void emit(OpCode op);
+    void emitU16(size_t value);
+    void emit(OpCode op, size_t operand);
+    size_t emitJump(OpCode op, size_t target = 0);
+    void patch(size_t jump);
+    void patch(size_t jump, size_t target);
+
+    size_t node(std::shared_ptr<AST::Stmt> stmt);
+    size_t scope(std::shared_ptr<AST::Scope> scope);
+    size_t constant(Values::Val value);
+
+    void enterScope(std::shared_ptr<AST::Scope> scope);
+    void leaveScopes(int count);
+
+    void compileBody(const std::vector<std::shared_ptr<AST::Stmt>>& body);
+    void compileScopedBody(std::shared_ptr<AST::Scope> scope, const std::vector<std::shared_ptr<AST::Stmt>>& body);
+    void compileStmt(std::shared_ptr<AST::Stmt> stmt);
+    void compileExpr(std::shared_ptr<AST::Stmt> expr);
+
+    void compileIf(std::shared_ptr<AST::IfStmtType> stmt);
+    void compileWhile(std::shared_ptr<AST::WhileStmtType> stmt);
+    void compileFor(std::shared_ptr<AST::ForStmtType> stmt);
+    void compileTry(std::shared_ptr<AST::TryStmtType> stmt);
+    void compileJump(std::shared_ptr<AST::Stmt> stmt, bool isBreak);
+
+    void compileBinary(std::shared_ptr<AST::BinaryExprType> expr);
+    void compileAssignment(std::shared_ptr<AST::AssignmentExprType> expr);
+    void compileCall(std::shared_ptr<AST::CallExprType> call);
+};
+
+} // namespace Probescript::VM
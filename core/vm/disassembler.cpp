@@ -0,0 +1,238 @@
+#include <iomanip>
+
+#include "vm/disassembler.hpp"
+#include "vm/compiler.hpp"
+
+using namespace Probescript;
+using namespace Probescript::VM;
+
+const char* VM::opName(OpCode op)
+{
+    switch (op)
+    {
+        case OpCode::Constant: return "Constant";
+        case OpCode::String: return "String";
+        case OpCode::Null: return "Null";
+        case OpCode::Undefined: return "Undefined";
+        case OpCode::True: return "True";
+        case OpCode::False: return "False";
+        case OpCode::Pop: return "Pop";
+        case OpCode::Load: return "Load";
+        case OpCode::Store: return "Store";
+        case OpCode::LoadName: return "LoadName";
+        case OpCode::Define: return "Define";
+        case OpCode::Function: return "Function";
+        case OpCode::Add: return "Add";
+        case OpCode::Sub: return "Sub";
+        case OpCode::Mul: return "Mul";
+        case OpCode::Div: return "Div";
+        case OpCode::Mod: return "Mod";
+        case OpCode::Equal: return "Equal";
+        case OpCode::NotEqual: return "NotEqual";
+        case OpCode::Less: return "Less";
+        case OpCode::Greater: return "Greater";
+        case OpCode::LessEqual: return "LessEqual";
+        case OpCode::GreaterEqual: return "GreaterEqual";
+        case OpCode::And: return "And";
+        case OpCode::Or: return "Or";
+        case OpCode::Not: return "Not";
+        case OpCode::Postfix: return "Postfix";
+        case OpCode::GetMember: return "GetMember";
+        case OpCode::SetMember: return "SetMember";
+        case OpCode::Array: return "Array";
+        case OpCode::Map: return "Map";
+        case OpCode::Call: return "Call";
+        case OpCode::CallMethod: return "CallMethod";
+        case OpCode::Return: return "Return";
+        case OpCode::Jump: return "Jump";
+        case OpCode::JumpIfFalse: return "JumpIfFalse";
+        case OpCode::EnterScope: return "EnterScope";
+        case OpCode::LeaveScope: return "LeaveScope";
+        case OpCode::Throw: return "Throw";
+        case OpCode::Try: return "Try";
+        case OpCode::EndTry: return "EndTry";
+        case OpCode::Eval: return "Eval";
+    }
+
+    return "Unknown";
+}
+
+// A short description of the node an instruction refers to
+static std::string describe(const AST::Stmt& node)
+{
+    switch (node.kind)
+    {
+        case AST::NodeType::Identifier:
+            return static_cast<const AST::IdentifierType&>(node).symbol;
+        case AST::NodeType::StringLiteral:
+            return "\"" + static_cast<const AST::StringLiteralType&>(node).strValue + "\"";
+        case AST::NodeType::VarDeclaration:
+            return static_cast<const AST::VarDeclarationType&>(node).identifier;
+        case AST::NodeType::FunctionDeclaration:
+            return "fn " + static_cast<const AST::FunctionDeclarationType&>(node).name;
+        case AST::NodeType::ArrowFunction:
+            return "fn <arrow>";
+        case AST::NodeType::ClassDefinition:
+            return "class " + static_cast<const AST::ClassDefinitionType&>(node).name;
+        case AST::NodeType::ProbeDeclaration:
+            return "probe " + static_cast<const AST::ProbeDeclarationType&>(node).name;
+        case AST::NodeType::ImportStmt:
+            return "import " + static_cast<const AST::ImportStmtType&>(node).name;
+        case AST::NodeType::PropertyLiteral:
+            return static_cast<const AST::PropertyLiteralType&>(node).key;
+        case AST::NodeType::UnaryPostFix:
+        {
+            const AST::UnaryPostFixType& postfix = static_cast<const AST::UnaryPostFixType&>(node);
+            return postfix.assigne->toString() + postfix.op;
+        }
+        case AST::NodeType::MemberExpr:
+        {
+            const AST::MemberExprType& member = static_cast<const AST::MemberExprType&>(node);
+            return member.computed ? "[]" : "." + member.property->toString();
+        }
+        case AST::NodeType::MemberAssignment:
+        {
+            const AST::MemberAssignmentType& member = static_cast<const AST::MemberAssignmentType&>(node);
+            return (member.computed ? "[] " : "." + member.property->toString() + " ") + member.op;
+        }
+        case AST::NodeType::CallExpr:
+        {
+            const AST::CallExprType& call = static_cast<const AST::CallExprType&>(node);
+            const AST::MemberExprType& member = static_cast<const AST::MemberExprType&>(*call.calee);
+            return "." + member.property->toString() + " (" + std::to_string(call.args.size()) + " args)";
+        }
+        case AST::NodeType::ArrayLiteral:
+            return std::to_string(static_cast<const AST::ArrayLiteralType&>(node).items.size()) + " items";
+        case AST::NodeType::MapLiteral:
+            return std::to_string(static_cast<const AST::MapLiteralType&>(node).properties.size()) + " properties";
+        default:
+            return "node kind " + std::to_string(static_cast<int>(node.kind)) + " at line " + std::to_string(node.token.location().line);
+    }
+}
+
+void VM::disassemble(const Chunk& chunk, std::ostream& out)
+{
+    out << "== " << chunk.name << " ==\n";
+
+    std::vector<std::shared_ptr<Chunk>> functions;
+    size_t ip = 0;
+
+    while (ip < chunk.code.size())
+    {
+        OpCode op = static_cast<OpCode>(chunk.code[ip]);
+        out << std::setw(4) << std::setfill('0') << ip << std::setfill(' ') << "  " << std::left << std::setw(14) << opName(op) << std::right;
+        ip++;
+
+        switch (op)
+        {
+            case OpCode::Constant:
+            {
+                uint16_t index = chunk.readU16(ip);
+                out << std::setw(5) << index << "  ; " << chunk.constants[index].toString();
+                ip += 2;
+                break;
+            }
+
+            case OpCode::String:
+            case OpCode::Load:
+            case OpCode::Store:
+            case OpCode::LoadName:
+            case OpCode::Define:
+            case OpCode::Postfix:
+            case OpCode::GetMember:
+            case OpCode::SetMember:
+            case OpCode::Array:
+            case OpCode::Map:
+            case OpCode::CallMethod:
+            case OpCode::Eval:
+            {
+                uint16_t index = chunk.readU16(ip);
+                out << std::setw(5) << index << "  ; " << describe(*chunk.nodes[index]);
+                ip += 2;
+                break;
+            }
+
+            case OpCode::Function:
+            {
+                uint16_t index = chunk.readU16(ip);
+                std::shared_ptr<AST::Stmt> node = chunk.nodes[index];
+                out << std::setw(5) << index << "  ; " << describe(*node);
+                ip += 2;
+
+                if (node->kind == AST::NodeType::FunctionDeclaration)
+                {
+                    std::shared_ptr<AST::FunctionDeclarationType> fn = std::static_pointer_cast<AST::FunctionDeclarationType>(node);
+                    functions.push_back(Compiler().compileFunction(fn->name, fn->body));
+                }
+                else
+                {
+                    functions.push_back(Compiler().compileFunction("arrow", std::static_pointer_cast<AST::ArrowFunctionType>(node)->body));
+                }
+                break;
+            }
+
+            case OpCode::Call:
+            case OpCode::LeaveScope:
+                out << std::setw(5) << chunk.readU16(ip);
+                ip += 2;
+                break;
+
+            case OpCode::EnterScope:
+            {
+                const AST::Scope& scope = *chunk.scopes[chunk.readU16(ip)];
+                out << std::setw(5) << chunk.readU16(ip) << "  ; " << scope.names.size() << " slots";
+                ip += 2;
+                break;
+            }
+
+            case OpCode::Jump:
+            case OpCode::JumpIfFalse:
+            case OpCode::Try:
+                out << std::setw(5) << "-> " << std::setw(4) << std::setfill('0') << chunk.readU32(ip) << std::setfill(' ');
+                ip += 4;
+                break;
+
+            default:
+                break;
+        }
+
+        out << "\n";
+    }
+
+    for (std::shared_ptr<Chunk> function : functions)
+    {
+        out << "\n";
+        disassemble(*function, out);
+    }
+}
+
+void VM::disassemble(std::shared_ptr<AST::ProgramType> program, std::ostream& out)
+{
+    disassemble(*Compiler().compileProgram(program, ""), out);
+
+    for (std::shared_ptr<AST::Stmt> stmt : program->body)
+    {
+        std::string owner;
+        std::vector<std::shared_ptr<AST::Stmt>> body;
+
+        if (stmt->kind == AST::NodeType::ProbeDeclaration)
+        {
+            owner = std::static_pointer_cast<AST::ProbeDeclarationType>(stmt)->name;
+            body = std::static_pointer_cast<AST::ProbeDeclarationType>(stmt)->body;
+        }
+        else if (stmt->kind == AST::NodeType::ClassDefinition)
+        {
+            owner = std::static_pointer_cast<AST::ClassDefinitionType>(stmt)->name;
+            body = std::static_pointer_cast<AST::ClassDefinitionType>(stmt)->body;
+        }
+
+        for (std::shared_ptr<AST::Stmt> member : body)
+        {
+            if (member->kind != AST::NodeType::FunctionDeclaration) continue;
+
+            std::shared_ptr<AST::FunctionDeclarationType> fn = std::static_pointer_cast<AST::FunctionDeclarationType>(member);
+            out << "\n";
+            disassemble(*Compiler().compileFunction(owner + "." + fn->name, fn->body), out);
+        }
+    }
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include <memory>
+#include <ostream>
+
+#include "frontend/ast.hpp"
+#include "vm/chunk.hpp"
+
+namespace Probescript::VM
+{
+
+// Prints a chunk one instruction per line, followed by the chunks of the functions it creates
+void disassemble(const Chunk& chunk, std::ostream& out);
+
+// Prints the top level of a program and the methods of its probes and classes
+void disassemble(std::shared_ptr<AST::ProgramType> program, std::ostream& out);
+
+} // namespace Probescript::VM
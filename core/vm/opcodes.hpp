@@ -0,0 +1,65 @@
+#pragma once
+#include <cstdint>
+
+namespace Probescript::VM
+{
+
+// Instructions are one opcode byte followed by fixed size little endian operands:
+// n = u16 index into the chunk's node table, k = u16 constant index, s = u16 scope index,
+// c = u16 count, a = u32 code address
+enum class OpCode : uint8_t
+{
+    Constant,     // k      push constants[k]
+    String,       // n      push a new string for the StringLiteral node
+    Null,
+    Undefined,
+    True,
+    False,
+    Pop,
+
+    Load,         // n      push the value of the Identifier node
+    Store,        // n      assign the top of the stack to the Identifier node, leaving it on the stack
+    LoadName,     // n      push the variable named by the shorthand PropertyLiteral node
+    Define,       // n      pop a value and declare it for the VarDeclaration/FunctionDeclaration node
+    Function,     // n      push a closure for the FunctionDeclaration/ArrowFunction node
+
+    Add,
+    Sub,
+    Mul,
+    Div,
+    Mod,
+    Equal,
+    NotEqual,
+    Less,
+    Greater,
+    LessEqual,
+    GreaterEqual,
+    And,
+    Or,
+    Not,
+    Postfix,      // n      ++/-- on the Identifier operand of the UnaryPostFix node, push the old value
+
+    GetMember,    // n      [object, property?] -> value for the MemberExpr node
+    SetMember,    // n      [object, value, property?] -> object for the MemberAssignment node
+    Array,        // n      pop the items of the ArrayLiteral node into a new array
+    Map,          // n      pop the properties of the MapLiteral node into a new object
+
+    Call,         // c      [args..., callee] -> result
+    CallMethod,   // n      [args..., object] -> result, calling the member callee of the CallExpr node
+    Return,       //        pop the result and leave the current frame
+
+    Jump,         // a
+    JumpIfFalse,  // a      pop the condition
+    EnterScope,   // s      enter a new environment for scopes[s]
+    LeaveScope,   // c      leave c environments
+
+    Throw,        //        pop a value and throw it
+    Try,          // a      install a handler at a for the current frame, entered with the error message pushed
+    EndTry,       //        remove the innermost handler
+
+    Eval,         // n      evaluate the node with the tree-walking interpreter and push the result
+};
+
+const char* opName(OpCode op);
+
+} // namespace Probescript::VM
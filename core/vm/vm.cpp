@@ -0,0 +1,602 @@
+#include <atomic>
+#include <cmath>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+#include "vm/vm.hpp"
+#include "vm/compiler.hpp"
+#include "runtime/interpreter.hpp"
+
+using namespace Probescript;
+using namespace Probescript::VM;
+
+namespace
+{
+
+// Read by every script call on any thread, set once by VM::run
+std::atomic<bool> g_enabled = false;
+// The context VM::run was given, for calls made where no machine is running
+std::shared_ptr<Context> g_runContext;
+// The context of the machine running on this thread, native code calling back into scripts hands it on
+thread_local std::shared_ptr<Context> g_context;
+
+// Makes `context` the current one for as long as it lives
+struct CurrentContext
+{
+    std::shared_ptr<Context> previous;
+
+    explicit CurrentContext(std::shared_ptr<Context> context) : previous(std::exchange(g_context, std::move(context))) {}
+    ~CurrentContext() { g_context = std::move(previous); }
+};
+
+struct Handler
+{
+    size_t ip;
+    size_t stack;
+    size_t scopes;
+};
+
+struct Frame
+{
+    ChunkPtr chunk;
+    size_t ip;
+    EnvPtr env;
+    // Stack height when the frame was entered
+    size_t base;
+    // Environments saved by EnterScope
+    std::vector<EnvPtr> scopes;
+    std::vector<Handler> handlers;
+};
+
+// Executes chunks on a value stack. Script function calls push frames onto the same machine,
+// native code calling back into scripts gets a machine of its own through VM::call
+class Machine
+{
+public:
+    Machine(std::shared_ptr<Context> context) : m_context(context) {}
+
+    Values::Val execute(ChunkPtr chunk, EnvPtr env)
+    {
+        CurrentContext current(m_context);
+        m_frames.push_back({ chunk, 0, env, m_stack.size(), {}, {} });
+
+        while (true)
+        {
+            try
+            {
+                return dispatch();
+            }
+            catch (const ThrowException& err)
+            {
+                if (!unwind(err)) throw;
+            }
+        }
+    }
+
+private:
+    std::vector<Values::Val> m_stack;
+    std::vector<Frame> m_frames;
+    std::shared_ptr<Context> m_context;
+
+    Values::Val pop()
+    {
+        Values::Val value = std::move(m_stack.back());
+        m_stack.pop_back();
+        return value;
+    }
+
+    std::vector<Values::Val> popArgs(size_t argc)
+    {
+        std::vector<Values::Val> args(std::make_move_iterator(m_stack.end() - argc), std::make_move_iterator(m_stack.end()));
+        m_stack.resize(m_stack.size() - argc);
+        return args;
+    }
+
+    // Jumps to the innermost handler of the current call, dropping frames that have none
+    bool unwind(const ThrowException& err)
+    {
+        while (!m_frames.empty())
+        {
+            Frame& frame = m_frames.back();
+
+            if (!frame.handlers.empty())
+            {
+                Handler handler = frame.handlers.back();
+                frame.handlers.pop_back();
+
+                m_stack.resize(handler.stack);
+                while (frame.scopes.size() > handler.scopes)
+                {
+                    frame.env = frame.scopes.back();
+                    frame.scopes.pop_back();
+                }
+
+                m_stack.push_back(Values::make<Values::StringVal>(err.what()));
+                frame.ip = handler.ip;
+                return true;
+            }
+
+            m_stack.resize(frame.base);
+            m_frames.pop_back();
+        }
+
+        return false;
+    }
+
+    // Pushes a frame for script functions, calls anything else right away and pushes the result
+    void invoke(const Values::Val& callee, size_t argc, EnvPtr env, const Values::Val& self = nullptr)
+    {
+        if (callee.type() == Values::ValueType::Function && !Values::cast<Values::FunctionValue>(callee)->isAsync)
+        {
+            Values::Ref<Values::FunctionValue> fn = Values::cast<Values::FunctionValue>(callee);
+            EnvPtr scope = std::make_shared<Env>(Interpreter::closureEnv(*fn, env), fn->scope);
+            Interpreter::bindThis(*fn, *scope, self, env);
+            size_t first = m_stack.size() - argc;
+
+            for (size_t i = 0; i < fn->params.size(); i++)
+            {
+                Values::Val value = (i < argc) ? m_stack[first + i] : Interpreter::eval(fn->params[i]->value, env);
+                scope->declareVar(fn->params[i]->address, fn->params[i]->identifier, value, fn->token);
+            }
+
+            m_stack.resize(first);
+            m_frames.push_back({ chunkFor(*fn), 0, scope, first, {}, {} });
+            return;
+        }
+
+        std::vector<Values::Val> args = popArgs(argc);
+        m_stack.push_back(Interpreter::evalCallWithFnVal(callee, args, env, self));
+    }
+
+    Values::Val dispatch();
+};
+
+template <typename T>
+const T& nodeAs(const Chunk& chunk, uint16_t index)
+{
+    return static_cast<const T&>(*chunk.nodes[index]);
+}
+
+Values::Val Machine::dispatch()
+{
+    Frame* frame = &m_frames.back();
+    const Chunk* chunk = frame->chunk.get();
+
+    while (true)
+    {
+        OpCode op = static_cast<OpCode>(chunk->code[frame->ip++]);
+
+        switch (op)
+        {
+            case OpCode::Constant:
+                m_stack.push_back(chunk->constants[chunk->readU16(frame->ip)]);
+                frame->ip += 2;
+                break;
+
+            case OpCode::String:
+            {
+                const AST::StringLiteralType& str = nodeAs<AST::StringLiteralType>(*chunk, chunk->readU16(frame->ip));
+                frame->ip += 2;
+                m_stack.push_back(Values::makeVal<Values::StringVal>(str.token, str.strValue));
+                break;
+            }
+
+            case OpCode::Null:
+                m_stack.push_back(Values::makeNull());
+                break;
+
+            case OpCode::Undefined:
+                m_stack.push_back(Values::makeUndefined());
+                break;
+
+            case OpCode::True:
+                m_stack.push_back(Values::makeBool(true));
+                break;
+
+            case OpCode::False:
+                m_stack.push_back(Values::makeBool(false));
+                break;
+
+            case OpCode::Pop:
+                m_stack.pop_back();
+                break;
+
+            case OpCode::Load:
+            {
+                const AST::IdentifierType& ident = nodeAs<AST::IdentifierType>(*chunk, chunk->readU16(frame->ip));
+                frame->ip += 2;
+                m_stack.push_back(frame->env->lookupVar(ident));
+                break;
+            }
+
+            case OpCode::Store:
+            {
+                const AST::IdentifierType& ident = nodeAs<AST::IdentifierType>(*chunk, chunk->readU16(frame->ip));
+                frame->ip += 2;
+                m_stack.back() = frame->env->assignVar(ident, m_stack.back());
+                break;
+            }
+
+            case OpCode::LoadName:
+            {
+                const AST::PropertyLiteralType& property = nodeAs<AST::PropertyLiteralType>(*chunk, chunk->readU16(frame->ip));
+                frame->ip += 2;
+                m_stack.push_back(frame->env->lookupVar(property.key, property.token));
+                break;
+            }
+
+            case OpCode::Define:
+            {
+                const AST::Stmt& node = *chunk->nodes[chunk->readU16(frame->ip)];
+                frame->ip += 2;
+
+                if (node.kind == AST::NodeType::VarDeclaration)
+                {
+                    const AST::VarDeclarationType& decl = static_cast<const AST::VarDeclarationType&>(node);
+                    frame->env->declareVar(decl.address, decl.identifier, pop(), decl.token);
+                }
+                else
+                {
+                    const AST::FunctionDeclarationType& decl = static_cast<const AST::FunctionDeclarationType&>(node);
+                    frame->env->declareVar(decl.address, decl.name, pop(), decl.token);
+                }
+                break;
+            }
+
+            case OpCode::Function:
+            {
+                std::shared_ptr<AST::Stmt> node = chunk->nodes[chunk->readU16(frame->ip)];
+                frame->ip += 2;
+
+                if (node->kind == AST::NodeType::FunctionDeclaration)
+                {
+                    m_stack.push_back(Interpreter::evalFunctionDeclaration(std::static_pointer_cast<AST::FunctionDeclarationType>(node), frame->env, true));
+                }
+                else
+                {
+                    m_stack.push_back(Interpreter::evalArrowFunction(std::static_pointer_cast<AST::ArrowFunctionType>(node), frame->env));
+                }
+                break;
+            }
+
+            case OpCode::Add:
+            {
+                Values::Val right = pop();
+                Values::Val& left = m_stack.back();
+                left = left.isNumber() && right.isNumber() ? Values::makeNumber(left.asNumber() + right.asNumber()) : left.add(right);
+                break;
+            }
+
+            case OpCode::Sub:
+            {
+                Values::Val right = pop();
+                Values::Val& left = m_stack.back();
+                left = left.isNumber() && right.isNumber() ? Values::makeNumber(left.asNumber() - right.asNumber()) : left.sub(right);
+                break;
+            }
+
+            case OpCode::Mul:
+            {
+                Values::Val right = pop();
+                Values::Val& left = m_stack.back();
+                left = left.isNumber() && right.isNumber() ? Values::makeNumber(left.asNumber() * right.asNumber()) : left.mul(right);
+                break;
+            }
+
+            case OpCode::Div:
+            {
+                Values::Val right = pop();
+                Values::Val& left = m_stack.back();
+                left = left.isNumber() && right.isNumber() ? Values::makeNumber(left.asNumber() / right.asNumber()) : left.div(right);
+                break;
+            }
+
+            case OpCode::Mod:
+            {
+                Values::Val right = pop();
+                Values::Val& left = m_stack.back();
+                left = left.isNumber() && right.isNumber() ? Values::makeNumber(fmod(left.asNumber(), right.asNumber())) : left.mod(right);
+                break;
+            }
+
+            case OpCode::Equal:
+            case OpCode::NotEqual:
+            {
+                Values::Val right = pop();
+                const Values::Val& left = m_stack.back();
+                bool result = left.isNumber() && right.isNumber() ? left.asNumber() == right.asNumber() : left.equals(right);
+                m_stack.back() = Values::makeBool(op == OpCode::Equal ? result : !result);
+                break;
+            }
+
+            case OpCode::Less:
+            case OpCode::Greater:
+            case OpCode::LessEqual:
+            case OpCode::GreaterEqual:
+            {
+                double r = pop().toNum();
+                double l = m_stack.back().toNum();
+                bool result = false;
+
+                if (op == OpCode::Less) result = l < r;
+                else if (op == OpCode::Greater) result = l > r;
+                else if (op == OpCode::LessEqual) result = l <= r;
+                else result = l >= r;
+
+                m_stack.back() = Values::makeBool(result);
+                break;
+            }
+
+            case OpCode::And:
+            case OpCode::Or:
+            {
+                bool r = pop().toBool();
+                bool l = m_stack.back().toBool();
+                m_stack.back() = Values::makeBool(op == OpCode::And ? (l && r) : (l || r));
+                break;
+            }
+
+            case OpCode::Not:
+                m_stack.back() = Values::makeBool(!m_stack.back().toBool());
+                break;
+
+            case OpCode::Postfix:
+            {
+                const AST::UnaryPostFixType& expr = nodeAs<AST::UnaryPostFixType>(*chunk, chunk->readU16(frame->ip));
+                frame->ip += 2;
+
+                const AST::IdentifierType& ident = static_cast<const AST::IdentifierType&>(*expr.assigne);
+                Values::Val current = frame->env->lookupVar(ident);
+
+                if (current.type() != Values::ValueType::Number)
+                {
+                    throw ThrowException(CustomError("Postfix operators only supported on numbers", "OperatorError", expr.assigne->token));
+                }
+
+                double value = current.asNumber();
+                double newValue = value;
+
+                if (expr.opType == AST::Operator::Increment) newValue = value + 1;
+                else if (expr.opType == AST::Operator::Decrement) newValue = value - 1;
+                else
+                {
+                    throw ThrowException(CustomError("Unknown postfix operator: " + expr.op, "OperatorError", expr.token));
+                }
+
+                frame->env->assignVar(ident, Values::makeNumber(newValue));
+                m_stack.push_back(current);
+                break;
+            }
+
+            case OpCode::GetMember:
+            {
+                const AST::MemberExprType& expr = nodeAs<AST::MemberExprType>(*chunk, chunk->readU16(frame->ip));
+                frame->ip += 2;
+
+                Values::Val property = expr.computed ? pop() : Values::makeUndefined();
+                m_stack.back() = Interpreter::accessMember(expr, m_stack.back(), property);
+                break;
+            }
+
+            case OpCode::SetMember:
+            {
+                const AST::MemberAssignmentType& expr = nodeAs<AST::MemberAssignmentType>(*chunk, chunk->readU16(frame->ip));
+                frame->ip += 2;
+
+                Values::Val property = expr.computed ? pop() : Values::makeUndefined();
+                Values::Val value = pop();
+                m_stack.back() = Interpreter::assignMember(expr, m_stack.back(), property, value);
+                break;
+            }
+
+            case OpCode::Array:
+            {
+                const AST::ArrayLiteralType& array = nodeAs<AST::ArrayLiteralType>(*chunk, chunk->readU16(frame->ip));
+                frame->ip += 2;
+                m_stack.push_back(Values::makeVal<Values::ArrayVal>(array.token, popArgs(array.items.size())));
+                break;
+            }
+
+            case OpCode::Map:
+            {
+                const AST::MapLiteralType& map = nodeAs<AST::MapLiteralType>(*chunk, chunk->readU16(frame->ip));
+                frame->ip += 2;
+
+                std::vector<Values::Val> values = popArgs(map.properties.size());
+                Values::Ref<Values::ObjectVal> object = Values::make<Values::ObjectVal>();
+                for (size_t i = 0; i < values.size(); i++)
+                {
+                    object->properties[map.properties[i]->key] = values[i];
+                }
+
+                m_stack.push_back(object);
+                break;
+            }
+
+            case OpCode::Call:
+            {
+                size_t argc = chunk->readU16(frame->ip);
+                frame->ip += 2;
+
+                Values::Val callee = pop();
+                invoke(callee, argc, frame->env);
+
+                frame = &m_frames.back();
+                chunk = frame->chunk.get();
+                break;
+            }
+
+            case OpCode::CallMethod:
+            {
+                const AST::CallExprType& call = nodeAs<AST::CallExprType>(*chunk, chunk->readU16(frame->ip));
+                frame->ip += 2;
+
+                const AST::MemberExprType& member = static_cast<const AST::MemberExprType&>(*call.calee);
+                const std::string& key = static_cast<const AST::IdentifierType&>(*member.property).symbol;
+                Values::Val object = pop();
+
+                if (Values::RuntimeVal* value = object.get())
+                {
+                    if (Values::Val* prop = value->properties.lookup(key, member.cache))
+                    {
+                        invoke(*prop, call.args.size(), frame->env, object);
+
+                        frame = &m_frames.back();
+                        chunk = frame->chunk.get();
+                        break;
+                    }
+                }
+
+                if (const Values::NativeMethod* method = Values::findMethod(object, key))
+                {
+                    std::vector<Values::Val> args = popArgs(call.args.size());
+                    m_stack.push_back((*method)(object, args, frame->env));
+                    break;
+                }
+
+                invoke(Values::getMember(object, key), call.args.size(), frame->env, object);
+
+                frame = &m_frames.back();
+                chunk = frame->chunk.get();
+                break;
+            }
+
+            case OpCode::Return:
+            {
+                Values::Val result = pop();
+                m_stack.resize(frame->base);
+                m_frames.pop_back();
+
+                if (m_frames.empty()) return result;
+
+                m_stack.push_back(result);
+                frame = &m_frames.back();
+                chunk = frame->chunk.get();
+                break;
+            }
+
+            case OpCode::Jump:
+                frame->ip = chunk->readU32(frame->ip);
+                break;
+
+            case OpCode::JumpIfFalse:
+                if (!pop().toBool()) frame->ip = chunk->readU32(frame->ip);
+                else frame->ip += 4;
+                break;
+
+            case OpCode::EnterScope:
+            {
+                const std::shared_ptr<AST::Scope>& scope = chunk->scopes[chunk->readU16(frame->ip)];
+                frame->ip += 2;
+
+                EnvPtr env = std::make_shared<Env>(frame->env, scope);
+                frame->scopes.push_back(std::move(frame->env));
+                frame->env = std::move(env);
+                break;
+            }
+
+            case OpCode::LeaveScope:
+            {
+                size_t count = chunk->readU16(frame->ip);
+                frame->ip += 2;
+
+                frame->env = frame->scopes[frame->scopes.size() - count];
+                frame->scopes.resize(frame->scopes.size() - count);
+                break;
+            }
+
+            case OpCode::Throw:
+                throw ThrowException(pop().toString());
+
+            case OpCode::Try:
+                frame->handlers.push_back({ chunk->readU32(frame->ip), m_stack.size(), frame->scopes.size() });
+                frame->ip += 4;
+                break;
+
+            case OpCode::EndTry:
+                frame->handlers.pop_back();
+                break;
+
+            case OpCode::Eval:
+            {
+                std::shared_ptr<AST::Stmt> node = chunk->nodes[chunk->readU16(frame->ip)];
+                frame->ip += 2;
+                m_stack.push_back(Interpreter::eval(node, frame->env, m_context));
+                break;
+            }
+        }
+    }
+}
+
+std::mutex g_chunksMutex;
+// Keyed by the function's scope, which is unique per function in the AST. The scope is kept
+// alive with the chunk so its address cannot be reused by another function
+std::unordered_map<const AST::Scope*, std::pair<std::shared_ptr<AST::Scope>, ChunkPtr>> g_chunks;
+
+} // namespace
+
+ChunkPtr VM::chunkFor(const Values::FunctionValue& fn)
+{
+    if (!fn.scope) return Compiler().compileFunction(fn.name, fn.body);
+
+    std::lock_guard<std::mutex> lock(g_chunksMutex);
+
+    auto cached = g_chunks.find(fn.scope.get());
+    if (cached != g_chunks.end()) return cached->second.second;
+
+    ChunkPtr chunk = Compiler().compileFunction(fn.name, fn.body);
+    g_chunks[fn.scope.get()] = { fn.scope, chunk };
+
+    return chunk;
+}
+
+bool VM::enabled()
+{
+    return g_enabled;
+}
+
+Values::Val VM::call(Values::Ref<Values::FunctionValue> fn, const std::vector<Values::Val>& args, EnvPtr callerEnv, Values::Val self)
+{
+    EnvPtr scope = std::make_shared<Env>(Interpreter::closureEnv(*fn, callerEnv), fn->scope);
+    Interpreter::bindThis(*fn, *scope, self, callerEnv);
+
+    for (size_t i = 0; i < fn->params.size(); i++)
+    {
+        Values::Val value = (i < args.size()) ? args[i] : Interpreter::eval(fn->params[i]->value, callerEnv);
+        scope->declareVar(fn->params[i]->address, fn->params[i]->identifier, value, fn->token);
+    }
+
+    return Machine(g_context ? g_context : g_runContext).execute(chunkFor(*fn), scope);
+}
+
+Values::Val VM::run(std::shared_ptr<AST::ProgramType> program, EnvPtr env, std::shared_ptr<Context> context)
+{
+    if (!g_enabled)
+    {
+        g_runContext = context;
+        g_enabled = true;
+    }
+
+    if (context->type != RuntimeType::Normal) return Interpreter::eval(program, env, context);
+    CurrentContext current(context);
+
+    EnvPtr scope = std::make_shared<Env>(env, program->scope);
+    ChunkPtr chunk = Compiler().compileProgram(program, context->probeName);
+
+    Machine(context).execute(chunk, scope);
+
+    for (std::shared_ptr<AST::Stmt> stmt : program->body)
+    {
+        if (
+            stmt->kind == AST::NodeType::ProbeDeclaration
+            && std::static_pointer_cast<AST::ProbeDeclarationType>(stmt)->name == context->probeName
+        ) {
+            // The probe body only declares members, its `run` function executes on the VM
+            Values::Val probe = Interpreter::evalProbeDeclaration(std::static_pointer_cast<AST::ProbeDeclarationType>(stmt), scope);
+            return Interpreter::evalProbeCall(probe, scope);
+        }
+    }
+
+    throw std::runtime_error(CustomError("Probe " + context->probeName + " is not defined", "MainError"));
+}
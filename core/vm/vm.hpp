@@ -0,0 +1,27 @@
+#pragma once
+#include <memory>
+#include <vector>
+
+#include "runtime/values.hpp"
+#include "frontend/ast.hpp"
+#include "env.hpp"
+#include "context.hpp"
+#include "vm/chunk.hpp"
+
+namespace Probescript::VM
+{
+
+// Runs a program with RuntimeType::Normal on the bytecode engine. Once enabled, every
+// script function call (including callbacks from native code) executes as bytecode
+Values::Val run(std::shared_ptr<AST::ProgramType> program, EnvPtr env, std::shared_ptr<Context> context);
+
+// Calls a (non-async) script function on the bytecode engine, in the context of the machine that called
+// into native code on this thread, or else the one the program was run with
+Values::Val call(Values::Ref<Values::FunctionValue> fn, const std::vector<Values::Val>& args, EnvPtr callerEnv, Values::Val self = nullptr);
+
+bool enabled();
+
+// The chunk for a function body, compiled on first use
+ChunkPtr chunkFor(const Values::FunctionValue& fn);
+
+} // namespace Probescript::VM
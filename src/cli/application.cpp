@@ -37,7 +37,14 @@ void showHelp(char* argv[])
                 << ConsoleColors::BLUE << "  run " << ConsoleColors::RESET << "  Run a probescript file\n"
                 << ConsoleColors::BLUE << "  repl" << ConsoleColors::RESET << "  Start the probescript REPL\n"
                 << ConsoleColors::BLUE << "  test" << ConsoleColors::RESET << "  Run tests on a probescript file using the 'prbtest' standard library\n"
-                << ConsoleColors::BLUE << "  init" << ConsoleColors::RESET << "  Initialize a probescript project\n";
+                << ConsoleColors::BLUE << "  init" << ConsoleColors::RESET << "  Initialize a probescript project\n"
+                << ConsoleColors::BLUE << "  disasm" << ConsoleColors::RESET << "  Print the bytecode of a probescript file\n"
+                << ConsoleColors::BLUE << "  cache clean [dir]" << ConsoleColors::RESET << "  Delete the compiled artifacts in dir/.probescript-cache\n\n"
+              << "Options:\n"
+                << ConsoleColors::BLUE << "  --engine=vm" << ConsoleColors::RESET << "  Run with the bytecode VM instead of the tree-walking interpreter\n"
+                << ConsoleColors::BLUE << "  --workers N" << ConsoleColors::RESET << "  Size of the thread pool running async functions, one per core by default\n"
+                << ConsoleColors::BLUE << "  --event-loop" << ConsoleColors::RESET << "  Run async functions as tasks on one thread, await suspends them instead of blocking\n"
+                << ConsoleColors::BLUE << "  --no-cache" << ConsoleColors::RESET << "  Always parse and typecheck from source, without reading or writing .probescript-cache\n";
 }
 
 Application::Application(int argc, char* argv[])
@@ -47,7 +54,11 @@ Application::Application(int argc, char* argv[])
     {
         std::string arg(argv[i]);
 
-        if (arg.find("--") == 0 || arg.find("-") == 0)
+        if (arg == "--workers" && i + 1 < argc)
+        {
+            m_flags.push_back(arg + "=" + argv[++i]);
+        }
+        else if (arg.find("--") == 0 || arg.find("-") == 0)
         {
             m_flags.push_back(arg);
         }
@@ -62,6 +73,90 @@ Application::Application(int argc, char* argv[])
     }
 }
 
+bool Application::useVM()
+{
+    for (const std::string& flag : m_flags)
+    {
+        if (flag.find("--engine=") != 0) continue;
+
+        std::string engine = flag.substr(9);
+        if (engine == "vm") return true;
+        if (engine == "tree") return false;
+
+        std::cerr << "Unknown engine: " << engine << ", expected 'vm' or 'tree'\n";
+        exit(1);
+    }
+
+    return false;
+}
+
+size_t Application::workers(const Values::Val& project)
+{
+    std::string value;
+
+    for (const std::string& flag : m_flags)
+    {
+        if (flag.find("--workers=") == 0) value = flag.substr(10);
+    }
+
+    if (value.empty() && project.isHeap())
+    {
+        auto found = project.get()->properties.find("workers");
+        if (found != project.get()->properties.end() && found->second.isNumber()) value = found->second.toString();
+    }
+
+    if (value.empty()) return 0;
+
+    try
+    {
+        size_t pos;
+        long workers = std::stol(value, &pos);
+        if (pos == value.size() && workers > 0) return workers;
+    }
+    catch (const std::exception&) {}
+
+    std::cerr << "Invalid worker count: " << value << ", expected a positive number\n";
+    exit(1);
+}
+
+bool Application::useCache()
+{
+    return std::find(m_flags.begin(), m_flags.end(), "--no-cache") == m_flags.end();
+}
+
+bool Application::useEventLoop(const Values::Val& project)
+{
+    if (std::find(m_flags.begin(), m_flags.end(), "--event-loop") != m_flags.end()) return true;
+    if (!project.isHeap()) return false;
+
+    auto found = project.get()->properties.find("event_loop");
+    return found != project.get()->properties.end() && found->second.toBool();
+}
+
+void Application::runMain(const Values::Val& project, const std::function<void()>& main)
+{
+    // Async calls nobody awaited still finish before the process exits
+    struct Drain
+    {
+        ~Drain() { Executor::drain(); }
+    } drain;
+
+    if (!useEventLoop(project))
+    {
+        main();
+        return;
+    }
+
+    if (!Loop::supported())
+    {
+        std::cerr << "The event loop is not supported on this platform\n";
+        exit(1);
+    }
+
+    Loop::enable();
+    Loop::run(main);
+}
+
 void Application::run()
 {
     if (m_command == "repl")
@@ -80,13 +175,12 @@ void Application::run()
         fs::path fileName(m_args[0]);
         try
         {
-            Parser parser;
-            std::pair<std::unordered_map<std::string, fs::path>, Values::Val> indexedPair = ModuleIndexer::indexModules(fileName);
+            std::pair<std::unordered_map<std::string, fs::path>, Values::Val> indexedPair = ModuleIndexer::indexModules(fileName, useCache());
             EnvPtr env = std::make_shared<Env>();
 
-            if (std::filesystem::is_directory(fileName) && indexedPair.second->properties.find("main") != indexedPair.second->properties.end())
+            if (std::filesystem::is_directory(fileName) && indexedPair.second.get()->properties.find("main") != indexedPair.second.get()->properties.end())
             {
-                fileName = fileName / indexedPair.second->properties["main"]->toString();
+                fileName = fileName / indexedPair.second.get()->properties["main"].toString();
             }
 
             std::ifstream stream(fileName);
@@ -100,16 +194,28 @@ void Application::run()
             context->file = file;
             context->modules = indexedPair.first;
             context->project = indexedPair.second;
+
+            Executor::configure(workers(context->project));
             
-            std::shared_ptr<AST::ProgramType> program = parser.parse(file, context);
+            if (useCache()) Cache::enable(std::filesystem::absolute(fileName).parent_path() / ".probescript-cache", __PROBESCRIPTVERSION__);
 
-            std::shared_ptr<Typechecker::TypeEnv> typeenv = std::make_shared<Typechecker::TypeEnv>();
+            Cache::Artifact artifact = Cache::parse(context);
+            std::shared_ptr<AST::ProgramType> program = artifact.program;
 
+            // A cached program that already typechecked against the same sources is not checked again
+            if (!artifact.checked)
+            {
+                Registry::prepare(program, context, Executor::workers());
 
-            Typechecker::TC tc;
-            tc.checkProgram(program, typeenv, context);
+                Typechecker::TC tc;
+                tc.checkProgram(program, std::make_shared<Typechecker::TypeEnv>(), context);
+                Cache::markChecked(context, *program, Registry::paths(), Registry::imports());
+            }
 
-            Values::Val result = Interpreter::eval(program, env, context);
+            runMain(context->project, [&]()
+            {
+                useVM() ? VM::run(program, env, context) : Interpreter::eval(program, env, context);
+            });
 
             return;
         }
@@ -135,13 +241,12 @@ void Application::run()
         fs::path fileName(m_args[0]);
         try
         {
-            Parser parser;
-            std::pair<std::unordered_map<std::string, fs::path>, Values::Val> indexedPair = ModuleIndexer::indexModules(fileName);
+            std::pair<std::unordered_map<std::string, fs::path>, Values::Val> indexedPair = ModuleIndexer::indexModules(fileName, useCache());
             EnvPtr env = std::make_shared<Env>();
 
-            if (std::filesystem::is_directory(fileName) && indexedPair.second->properties.find("main") != indexedPair.second->properties.end())
+            if (std::filesystem::is_directory(fileName) && indexedPair.second.get()->properties.find("main") != indexedPair.second.get()->properties.end())
             {
-                fileName = fileName / indexedPair.second->properties["main"]->toString();
+                fileName = fileName / indexedPair.second.get()->properties["main"].toString();
             }
 
             std::ifstream stream(fileName);
@@ -155,18 +260,29 @@ void Application::run()
             context->file = file;
             context->modules = indexedPair.first;
             context->project = indexedPair.second;
+
+            Executor::configure(workers(context->project));
             
-            std::shared_ptr<AST::ProgramType> program = parser.parse(file, context);
+            if (useCache()) Cache::enable(std::filesystem::absolute(fileName).parent_path() / ".probescript-cache", __PROBESCRIPTVERSION__);
 
-            std::shared_ptr<Typechecker::TypeEnv> typeenv = std::make_shared<Typechecker::TypeEnv>();
+            Cache::Artifact artifact = Cache::parse(context);
+            std::shared_ptr<AST::ProgramType> program = artifact.program;
 
-            Typechecker::TC tc;
-            tc.checkProgram(program, typeenv, context);
-        
+            // A cached program that already typechecked against the same sources is not checked again
+            if (!artifact.checked)
+            {
+                Registry::prepare(program, context, Executor::workers());
 
-            Values::Val result = Interpreter::eval(program, env, context);
+                Typechecker::TC tc;
+                tc.checkProgram(program, std::make_shared<Typechecker::TypeEnv>(), context);
+                Cache::markChecked(context, *program, Registry::paths(), Registry::imports());
+            }
 
-            Stdlib::Prbtest::runTests(fileName.string());
+            runMain(context->project, [&]()
+            {
+                useVM() ? VM::run(program, env, context) : Interpreter::eval(program, env, context);
+                Stdlib::Prbtest::runTests(fileName.string());
+            });
         }
         catch (const std::runtime_error& err)
         {
@@ -179,6 +295,44 @@ void Application::run()
             exit(1);
         }
     }
+    else if (m_command == "disasm")
+    {
+        if (m_args.empty())
+        {
+            std::cerr << "Disasm command expects 1 argument, 0 given";
+            exit(1);
+        }
+
+        try
+        {
+            std::ifstream stream(m_args[0]);
+            std::string file((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+
+            std::shared_ptr<Context> context = std::make_shared<Context>(RuntimeType::Normal, "Main");
+            context->filename = std::filesystem::absolute(m_args[0]).string();
+            context->file = file;
+
+            VM::disassemble(Parser().parse(file, context), std::cout);
+        }
+        catch (const std::runtime_error& err)
+        {
+            std::cerr << err.what();
+            exit(1);
+        }
+    }
+    else if (m_command == "cache")
+    {
+        if (m_args.empty() || m_args[0] != "clean")
+        {
+            std::cerr << "Cache command expects 'clean'";
+            exit(1);
+        }
+
+        fs::path directory = fs::path(m_args.size() > 1 ? m_args[1] : ".") / ".probescript-cache";
+        size_t removed = Cache::clean(directory);
+
+        std::cout << "Removed " << removed << " cached artifact" << (removed == 1 ? "" : "s") << " from " << directory.string() << "\n";
+    }
     else if (std::find(m_flags.begin(), m_flags.end(), "-h") != m_flags.end() || std::find(m_flags.begin(), m_flags.end(), "--help") != m_flags.end()) 
         showHelp(m_argv);
     else if (std::find(m_flags.begin(), m_flags.end(), "-v") != m_flags.end() || std::find(m_flags.begin(), m_flags.end(), "--version") != m_flags.end()) 
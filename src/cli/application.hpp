@@ -6,8 +6,14 @@
 #include "core/frontend/ast.hpp"
 #include "core/runtime/values.hpp"
 #include "core/frontend/parser.hpp"
+#include "core/cache.hpp"
+#include "core/executor.hpp"
+#include "core/loop.hpp"
+#include "core/registry.hpp"
 #include "core/typechecker.hpp"
 #include "core/runtime/interpreter.hpp"
+#include "core/vm/vm.hpp"
+#include "core/vm/disassembler.hpp"
 
 #include "repl.hpp"
 #include "modules.hpp"
@@ -29,4 +35,19 @@ private:
     std::vector<std::string> m_args;
     std::vector<std::string> m_flags;
     char** m_argv;
+
+    // Whether --engine=vm was passed, the tree-walker is the default
+    bool useVM();
+
+    // False when --no-cache was passed
+    bool useCache();
+
+    // The pool size from --workers N, or the "workers" field of project.json, 0 when neither is set
+    size_t workers(const Probescript::Values::Val& project);
+
+    // Whether --event-loop was passed or project.json sets "event_loop"
+    bool useEventLoop(const Probescript::Values::Val& project);
+
+    // Runs `main` on the event loop when it is used, directly otherwise
+    void runMain(const Probescript::Values::Val& project, const std::function<void()>& main);
 };
\ No newline at end of file
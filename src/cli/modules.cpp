@@ -1,8 +1,331 @@
+#include <algorithm>
+#include <cctype>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <thread>
+
 #include "modules.hpp"
+#include "core/cache.hpp"
 
 using namespace Probescript;
 
-std::pair<std::unordered_map<std::string, fs::path>, Values::Val> ModuleIndexer::indexModules(fs::path fileName) {
+namespace {
+
+constexpr const char* IndexVersion = "PRBI 1";
+
+// Only this much of a file is read when looking for its module declaration
+constexpr size_t HeaderBytes = 256;
+
+struct FileRecord {
+    std::string name;
+    int64_t mtime;
+    // Empty when the file does not declare a module
+    std::string module;
+};
+
+struct DirRecord {
+    int64_t mtime = 0;
+    std::vector<std::string> subdirs;
+    std::vector<FileRecord> files;
+};
+
+// Keyed by the directory's path relative to the project root, "." for the root itself
+using Index = std::map<std::string, DirRecord>;
+
+int64_t mtimeOf(const fs::path& path, std::error_code& error) {
+    return fs::last_write_time(path, error).time_since_epoch().count();
+}
+
+// Glob match supporting * and ?
+bool matchGlob(std::string_view pattern, std::string_view text) {
+    size_t p = 0, t = 0, star = std::string_view::npos, mark = 0;
+
+    while (t < text.size()) {
+        if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == text[t])) {
+            p++;
+            t++;
+        } else if (p < pattern.size() && pattern[p] == '*') {
+            star = p++;
+            mark = t;
+        } else if (star != std::string_view::npos) {
+            p = star + 1;
+            t = ++mark;
+        } else {
+            return false;
+        }
+    }
+
+    while (p < pattern.size() && pattern[p] == '*') p++;
+    return p == pattern.size();
+}
+
+// Patterns with a slash match the path relative to the project root, others match the file or directory name
+bool isIgnored(const std::vector<std::string>& patterns, const std::string& relative, const std::string& name) {
+    if (name == ".git" || name == ".probescript-cache") return true;
+
+    for (const std::string& pattern : patterns) {
+        if (matchGlob(pattern, pattern.find('/') != std::string::npos ? relative : name)) return true;
+    }
+
+    return false;
+}
+
+bool isSource(const fs::path& path) {
+    return path.extension() == ".probe" || path.extension() == ".prb";
+}
+
+// The name in a leading `module name;` line, or an empty string
+std::string readModuleName(const fs::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return "";
+
+    char buffer[HeaderBytes];
+    file.read(buffer, HeaderBytes);
+    std::string_view header(buffer, file.gcount());
+
+    if (header.compare(0, 7, "module ") != 0) return "";
+
+    size_t end = header.find_first_of(";\r\n", 7);
+    if (end == std::string_view::npos) end = header.size();
+
+    std::string_view name = header.substr(7, end - 7);
+    while (!name.empty() && std::isspace(static_cast<unsigned char>(name.back()))) name.remove_suffix(1);
+    while (!name.empty() && std::isspace(static_cast<unsigned char>(name.front()))) name.remove_prefix(1);
+
+    return std::string(name);
+}
+
+// Line based: a header with the hash of the ignore patterns, then one D line per directory followed by
+// S lines for its subdirectories and F lines for its source files
+Index readIndex(const fs::path& path, uint64_t patternsHash) {
+    Index index;
+    std::ifstream stream(path);
+    std::string line;
+
+    if (!std::getline(stream, line) || line != std::string(IndexVersion) + "\t" + std::to_string(patternsHash)) return {};
+
+    DirRecord* current = nullptr;
+    while (std::getline(stream, line)) {
+        std::vector<std::string> fields;
+        size_t start = 0;
+
+        for (size_t tab; (tab = line.find('\t', start)) != std::string::npos; start = tab + 1) {
+            fields.push_back(line.substr(start, tab - start));
+        }
+        fields.push_back(line.substr(start));
+
+        try {
+            if (fields[0] == "D" && fields.size() == 3) {
+                current = &index[fields[2]];
+                current->mtime = std::stoll(fields[1]);
+            } else if (fields[0] == "S" && fields.size() == 2 && current) {
+                current->subdirs.push_back(fields[1]);
+            } else if (fields[0] == "F" && fields.size() == 4 && current) {
+                current->files.push_back({ fields[2], std::stoll(fields[1]), fields[3] });
+            } else {
+                return {};
+            }
+        } catch (const std::exception&) {
+            return {};
+        }
+    }
+
+    return index;
+}
+
+// Replaced through a rename, so a concurrent run reads either the old index or the new one
+void writeIndex(const fs::path& path, uint64_t patternsHash, const Index& index) {
+    std::error_code error;
+    fs::create_directories(path.parent_path(), error);
+    if (error) return;
+
+    fs::path temp = path;
+    temp += ".tmp" + std::to_string(std::random_device()());
+
+    {
+        std::ofstream stream(temp, std::ios::trunc);
+        stream << IndexVersion << "\t" << patternsHash << "\n";
+
+        for (const auto& [relative, record] : index) {
+            stream << "D\t" << record.mtime << "\t" << relative << "\n";
+            for (const std::string& subdir : record.subdirs) stream << "S\t" << subdir << "\n";
+            for (const FileRecord& file : record.files) stream << "F\t" << file.mtime << "\t" << file.name << "\t" << file.module << "\n";
+        }
+
+        if (!stream) return;
+    }
+
+    fs::rename(temp, path, error);
+    if (error) fs::remove(temp, error);
+}
+
+// Walks the project one directory per task on a few threads. A directory whose mtime matches the previous
+// index keeps its listing, and only files whose own mtime changed are read again
+class Scanner {
+public:
+    Scanner(const fs::path& root, const std::vector<std::string>& patterns, const Index& previous)
+        : m_root(root), m_patterns(patterns), m_previous(previous) {}
+
+    Index run() {
+        m_queue.push_back(".");
+        m_pending = 1;
+
+        size_t count = std::clamp<size_t>(std::thread::hardware_concurrency(), 1, 8);
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < count; i++) workers.emplace_back([this]() { work(); });
+
+        work();
+        for (std::thread& worker : workers) worker.join();
+
+        if (m_result.size() != m_previous.size()) m_changed = true;
+        return std::move(m_result);
+    }
+
+    bool changed() const { return m_changed; }
+
+private:
+    fs::path m_root;
+    const std::vector<std::string>& m_patterns;
+    const Index& m_previous;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<std::string> m_queue;
+    // Directories queued or being visited
+    size_t m_pending = 0;
+    Index m_result;
+    bool m_changed = false;
+
+    void work() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        while (true) {
+            m_cv.wait(lock, [this]() { return !m_queue.empty() || m_pending == 0; });
+            if (m_queue.empty()) return;
+
+            std::string relative = std::move(m_queue.front());
+            m_queue.pop_front();
+
+            lock.unlock();
+            std::optional<DirRecord> record = visit(relative);
+            lock.lock();
+
+            if (record) {
+                for (const std::string& subdir : record->subdirs) {
+                    m_queue.push_back(relative == "." ? subdir : relative + "/" + subdir);
+                }
+
+                m_pending += record->subdirs.size();
+                m_result.emplace(relative, std::move(*record));
+            }
+
+            if (--m_pending == 0 || !m_queue.empty()) m_cv.notify_all();
+        }
+    }
+
+    // Marks the index as changed, may be called from any worker
+    void markChanged() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_changed = true;
+    }
+
+    void refresh(const fs::path& directory, FileRecord& file, const FileRecord* cached) {
+        if (cached && cached->mtime == file.mtime) {
+            file.module = cached->module;
+            return;
+        }
+
+        file.module = readModuleName(directory / file.name);
+        markChanged();
+    }
+
+    std::optional<DirRecord> visit(const std::string& relative) {
+        fs::path directory = relative == "." ? m_root : m_root / relative;
+        std::error_code error;
+
+        DirRecord record;
+        record.mtime = mtimeOf(directory, error);
+        if (error) return std::nullopt;
+
+        auto found = m_previous.find(relative);
+        const DirRecord* cached = found != m_previous.end() ? &found->second : nullptr;
+
+        auto cachedFile = [&](const std::string& name) -> const FileRecord* {
+            if (!cached) return nullptr;
+
+            auto file = std::lower_bound(cached->files.begin(), cached->files.end(), name, [](const FileRecord& a, const std::string& b) { return a.name < b; });
+            return file != cached->files.end() && file->name == name ? &*file : nullptr;
+        };
+
+        if (cached && cached->mtime == record.mtime) {
+            record.subdirs = cached->subdirs;
+
+            for (const FileRecord& previous : cached->files) {
+                FileRecord file { previous.name, mtimeOf(directory / previous.name, error), "" };
+                if (error) {
+                    markChanged();
+                    continue;
+                }
+
+                refresh(directory, file, &previous);
+                record.files.push_back(std::move(file));
+            }
+
+            return record;
+        }
+
+        markChanged();
+
+        for (const fs::directory_entry& entry : fs::directory_iterator(directory, error)) {
+            std::string name = entry.path().filename().string();
+            std::string path = relative == "." ? name : relative + "/" + name;
+
+            if (isIgnored(m_patterns, path, name)) continue;
+
+            std::error_code status;
+            if (entry.is_directory(status) && !entry.is_symlink(status)) {
+                record.subdirs.push_back(name);
+            } else if (entry.is_regular_file(status) && isSource(entry.path())) {
+                FileRecord file { name, mtimeOf(entry.path(), status), "" };
+                if (status) continue;
+
+                refresh(directory, file, cachedFile(name));
+                record.files.push_back(std::move(file));
+            }
+        }
+
+        std::sort(record.subdirs.begin(), record.subdirs.end());
+        std::sort(record.files.begin(), record.files.end(), [](const FileRecord& a, const FileRecord& b) { return a.name < b.name; });
+
+        return record;
+    }
+};
+
+std::vector<std::string> ignorePatterns(const Values::Val& project) {
+    std::vector<std::string> patterns;
+    if (!project.isHeap()) return patterns;
+
+    auto ignore = project.get()->properties.find("ignore");
+    if (ignore == project.get()->properties.end() || ignore->second.type() != Values::ValueType::Array) return patterns;
+
+    for (const Values::Val& item : Values::cast<Values::ArrayVal>(ignore->second)->items) {
+        if (item.type() != Values::ValueType::String) continue;
+
+        std::string pattern = item.toString();
+        while (!pattern.empty() && pattern.back() == '/') pattern.pop_back();
+        if (!pattern.empty()) patterns.push_back(pattern);
+    }
+
+    return patterns;
+}
+
+} // namespace
+
+std::pair<std::unordered_map<std::string, fs::path>, Values::Val> ModuleIndexer::indexModules(fs::path fileName, bool useCache) {
     fs::path current = fs::is_directory(fileName) ? fileName : fs::current_path() / fileName.parent_path();
     fs::path projectFile;
     bool found = false;
@@ -23,37 +346,35 @@ std::pair<std::unordered_map<std::string, fs::path>, Values::Val> ModuleIndexer:
     }
 
     std::unordered_map<std::string, fs::path> modules;
-    if (!found) return { modules, std::make_shared<Values::ObjectVal>() };
+    if (!found) return { modules, Values::make<Values::ObjectVal>() };
 
-    for (const auto& entry : fs::recursive_directory_iterator(projectFile.parent_path())) {
-        if (entry.is_regular_file()) {
-            fs::path path = entry.path();
+    std::ifstream stream(projectFile);
+    std::string file((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+    Stdlib::JSON::JSONParser parser(file);
+    Values::Val project = parser.parse();
 
-            if (path.extension() == ".probe" || path.extension() == ".prb") {
-                std::ifstream file(path);
+    fs::path root = fs::absolute(projectFile.parent_path());
+    fs::path indexFile = root / ".probescript-cache" / "modules.index";
 
-                if (file.is_open()) {
-                    std::string firstLine;
-                    std::getline(file, firstLine);
+    std::vector<std::string> patterns = ignorePatterns(project);
+    uint64_t patternsHash = Cache::hash("");
+    for (const std::string& pattern : patterns) patternsHash = Cache::hash(pattern + '\n', patternsHash);
 
-                    if (firstLine.find("module") == 0) {
-                        std::string modulename;
-                        if (firstLine.find(";") != std::string::npos) {
-                            modulename = firstLine.substr(7, firstLine.find(";") - 7);
-                        } else {
-                            modulename = firstLine.substr(7);
-                        }
+    Index previous = useCache ? readIndex(indexFile, patternsHash) : Index();
 
-                        modules[modulename] = path;
-                    }
-                }
-            }
+    Scanner scanner(root, patterns, previous);
+    Index index = scanner.run();
+
+    if (useCache && scanner.changed()) writeIndex(indexFile, patternsHash, index);
+
+    // Walked in path order, so when two files declare the same module the first path wins on every run
+    for (const auto& [relative, record] : index) {
+        fs::path directory = relative == "." ? root : root / relative;
+
+        for (const FileRecord& source : record.files) {
+            if (!source.module.empty()) modules.emplace(source.module, directory / source.name);
         }
     }
 
-    std::ifstream stream(projectFile);
-    std::string file((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
-    Stdlib::JSON::JSONParser parser(file);
-
-    return { modules, parser.parse() };
-}
\ No newline at end of file
+    return { modules, project };
+}
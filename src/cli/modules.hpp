@@ -14,6 +14,9 @@ namespace fs = std::filesystem;
 namespace Probescript::ModuleIndexer
 {
     
-std::pair<std::unordered_map<std::string, fs::path>, Values::Val> indexModules(fs::path fileName);
+// Finds the project.json above `fileName` and maps every module declared in the project to its file.
+// The scan skips the "ignore" patterns of project.json and is kept in .probescript-cache/modules.index,
+// so later runs only re-read directories and files whose mtime changed. `useCache` false scans from scratch
+std::pair<std::unordered_map<std::string, fs::path>, Values::Val> indexModules(fs::path fileName, bool useCache = true);
 
 } // namespace Probescript::ModuleIndexer
\ No newline at end of file
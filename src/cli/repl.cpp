@@ -22,7 +22,7 @@ void REPL::start()
 
             Values::Val result = Interpreter::eval(program, env, context);
 
-            std::cout << result->toConsole() << "\n";
+            std::cout << result.toConsole() << "\n";
         }
         catch (const std::runtime_error& err)
         {
@@ -0,0 +1,549 @@
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+#ifdef _WIN32
+
+#include <winsock2.h>
+#include <ws2tcpip.h>
+
+#else
+
+#include <cerrno>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#endif
+
+#include "client.hpp"
+
+using namespace Probescript;
+using namespace Probescript::Stdlib;
+using namespace Probescript::Stdlib::Http;
+
+namespace
+{
+
+#ifdef _WIN32
+using Socket = SOCKET;
+const Socket InvalidSocket = INVALID_SOCKET;
+void closeSocket(Socket fd) { closesocket(fd); }
+#else
+using Socket = int;
+const Socket InvalidSocket = -1;
+void closeSocket(Socket fd) { close(fd); }
+#endif
+
+#ifdef MSG_NOSIGNAL
+const int SendFlags = MSG_NOSIGNAL;
+#else
+const int SendFlags = 0;
+#endif
+
+using Clock = std::chrono::steady_clock;
+
+// getaddrinfo does not report the record's TTL, so answers are trusted for a fixed time
+constexpr auto ResolveTtl = std::chrono::seconds(60);
+// Servers drop idle connections on their own (ours after 5 s), older sockets are closed instead of reused
+constexpr auto IdleLimit = std::chrono::seconds(4);
+constexpr size_t MaxIdlePerHost = 32;
+constexpr int IoTimeoutMs = 30000;
+
+// Thrown when a reused connection turns out to be closed before any of the response arrived
+struct StaleConnection {};
+
+// Methods the spec lets a client repeat. A POST that reached the server before it closed may have been acted
+// on, so it is only sent again when none of it went out
+bool idempotent(const std::string& method)
+{
+    return method == "GET" || method == "HEAD" || method == "PUT" || method == "DELETE" || method == "OPTIONS" || method == "TRACE";
+}
+
+struct Address
+{
+    sockaddr_storage storage;
+    socklen_t length;
+};
+
+struct Resolved
+{
+    std::vector<Address> addresses;
+    Clock::time_point expires;
+};
+
+struct Idle
+{
+    Socket fd;
+    Clock::time_point since;
+};
+
+std::mutex g_resolveMutex;
+std::unordered_map<std::string, Resolved> g_resolved;
+
+std::mutex g_poolMutex;
+std::unordered_map<std::string, std::vector<Idle>> g_idle;
+
+void startup()
+{
+#ifdef _WIN32
+    static std::once_flag once;
+    std::call_once(once, []()
+    {
+        WSADATA data;
+        WSAStartup(MAKEWORD(2, 2), &data);
+    });
+#endif
+}
+
+// Failed lookups are not cached, the next request tries again
+std::vector<Address> resolve(const std::string& host, int port)
+{
+    std::string key = host + ":" + std::to_string(port);
+
+    {
+        std::lock_guard<std::mutex> lock(g_resolveMutex);
+        auto found = g_resolved.find(key);
+        if (found != g_resolved.end() && found->second.expires > Clock::now()) return found->second.addresses;
+    }
+
+    std::vector<Address> addresses;
+
+    // Resolving blocks, on the event loop it runs on the pool instead
+    Loop::offload([&]() -> Values::Val
+    {
+        addrinfo hints {};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+
+        addrinfo* result = nullptr;
+        if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result) != 0) return Values::makeUndefined();
+
+        for (addrinfo* entry = result; entry; entry = entry->ai_next)
+        {
+            Address address {};
+            std::memcpy(&address.storage, entry->ai_addr, entry->ai_addrlen);
+            address.length = static_cast<socklen_t>(entry->ai_addrlen);
+            addresses.push_back(address);
+        }
+
+        freeaddrinfo(result);
+        return Values::makeUndefined();
+    });
+
+    if (addresses.empty()) throw ThrowException("[HttpError]: Failed to resolve host: " + host);
+
+    std::lock_guard<std::mutex> lock(g_resolveMutex);
+    g_resolved[key] = { addresses, Clock::now() + ResolveTtl };
+    return addresses;
+}
+
+bool wouldBlock()
+{
+#ifdef _WIN32
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+}
+
+// Sockets are non-blocking outside Windows. Tasks on the event loop suspend until they are ready, threads poll
+void waitFor(Socket fd, bool write)
+{
+#ifndef _WIN32
+    if (Loop::inTask())
+    {
+        bool ready = write ? Loop::waitWritable(fd, IoTimeoutMs) : Loop::waitReadable(fd, IoTimeoutMs);
+        if (!ready) throw ThrowException("[HttpError]: Timed out waiting for the server");
+        return;
+    }
+
+    pollfd entry { fd, static_cast<short>(write ? POLLOUT : POLLIN), 0 };
+
+    int ready;
+    do ready = poll(&entry, 1, IoTimeoutMs);
+    while (ready < 0 && errno == EINTR);
+
+    if (ready == 0) throw ThrowException("[HttpError]: Timed out waiting for the server");
+#endif
+}
+
+Socket connectTo(const std::vector<Address>& addresses)
+{
+    for (const Address& address : addresses)
+    {
+        Socket fd = socket(address.storage.ss_family, SOCK_STREAM, 0);
+        if (fd == InvalidSocket) continue;
+
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&one), sizeof(one));
+
+#ifndef _WIN32
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+#endif
+
+        if (connect(fd, reinterpret_cast<const sockaddr*>(&address.storage), address.length) == 0) return fd;
+
+#ifndef _WIN32
+        if (errno == EINPROGRESS)
+        {
+            try
+            {
+                waitFor(fd, true);
+            }
+            catch (...)
+            {
+                closeSocket(fd);
+                throw;
+            }
+
+            int error = 0;
+            socklen_t length = sizeof(error);
+            if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) == 0 && error == 0) return fd;
+        }
+#endif
+
+        closeSocket(fd);
+    }
+
+    return InvalidSocket;
+}
+
+Socket takeIdle(const std::string& key)
+{
+    std::lock_guard<std::mutex> lock(g_poolMutex);
+    std::vector<Idle>& idle = g_idle[key];
+
+    while (!idle.empty())
+    {
+        Idle entry = idle.back();
+        idle.pop_back();
+
+        if (Clock::now() - entry.since < IdleLimit) return entry.fd;
+        closeSocket(entry.fd);
+    }
+
+    return InvalidSocket;
+}
+
+void giveBack(const std::string& key, Socket fd)
+{
+    std::lock_guard<std::mutex> lock(g_poolMutex);
+    std::vector<Idle>& idle = g_idle[key];
+
+    if (idle.size() >= MaxIdlePerHost)
+    {
+        closeSocket(fd);
+        return;
+    }
+
+    idle.push_back({ fd, Clock::now() });
+}
+
+// `sent` counts the bytes the socket took, also when it fails part way
+bool sendAll(Socket fd, const std::string& data, size_t& sent)
+{
+    sent = 0;
+
+    while (sent < data.size())
+    {
+        int bytes = send(fd, data.data() + sent, static_cast<int>(data.size() - sent), SendFlags);
+
+        if (bytes > 0) sent += bytes;
+        else if (bytes < 0 && wouldBlock()) waitFor(fd, true);
+        else return false;
+    }
+
+    return true;
+}
+
+// Buffered reads off a socket, bodies may hold any bytes
+class Reader
+{
+public:
+    explicit Reader(Socket fd) : m_fd(fd) {}
+
+    // Reads more into the buffer, false once the server closed
+    bool fill()
+    {
+        char chunk[16 * 1024];
+
+        while (true)
+        {
+            int bytes = recv(m_fd, chunk, sizeof(chunk), 0);
+
+            if (bytes > 0)
+            {
+                m_buffer.append(chunk, bytes);
+                m_received += bytes;
+                return true;
+            }
+
+            if (bytes < 0 && wouldBlock())
+            {
+                waitFor(m_fd, false);
+                continue;
+            }
+
+            return false;
+        }
+    }
+
+    // The next line without its \r\n
+    std::string line()
+    {
+        size_t end;
+        while ((end = m_buffer.find("\r\n", m_pos)) == std::string::npos)
+        {
+            if (!fill()) closed();
+        }
+
+        std::string result = m_buffer.substr(m_pos, end - m_pos);
+        m_pos = end + 2;
+        return result;
+    }
+
+    std::string take(size_t count)
+    {
+        while (m_buffer.size() - m_pos < count)
+        {
+            if (!fill()) closed();
+        }
+
+        std::string result = m_buffer.substr(m_pos, count);
+        m_pos += count;
+        compact();
+        return result;
+    }
+
+    std::string rest()
+    {
+        while (fill()) {}
+
+        std::string result = m_buffer.substr(m_pos);
+        m_pos = m_buffer.size();
+        return result;
+    }
+
+    // Whether bytes past the response arrived, which would make the connection unusable for the next one
+    bool drained() const { return m_pos == m_buffer.size(); }
+
+private:
+    Socket m_fd;
+    std::string m_buffer;
+    size_t m_pos = 0;
+    size_t m_received = 0;
+
+    [[noreturn]] void closed()
+    {
+        if (m_received == 0) throw StaleConnection();
+        throw ThrowException("[HttpError]: Connection closed in the middle of the response");
+    }
+
+    // Drops what was consumed once it is most of the buffer
+    void compact()
+    {
+        if (m_pos > 64 * 1024 && m_pos * 2 > m_buffer.size())
+        {
+            m_buffer.erase(0, m_pos);
+            m_pos = 0;
+        }
+    }
+};
+
+size_t parseSize(const std::string& text, int base)
+{
+    try
+    {
+        size_t pos;
+        size_t value = std::stoul(text, &pos, base);
+        if (pos == 0) throw std::invalid_argument(text);
+        return value;
+    }
+    catch (const std::exception&)
+    {
+        throw ThrowException("[HttpError]: Malformed HTTP response");
+    }
+}
+
+// Reads one response, and whether the connection can carry another request after it
+std::pair<ClientResponse, bool> readResponse(Reader& reader, const std::string& method)
+{
+    ClientResponse response;
+    std::string version;
+
+    // 1xx interim responses come before the real one
+    do
+    {
+        std::string statusLine = reader.line();
+        size_t space = statusLine.find(' ');
+        if (space == std::string::npos) throw ThrowException("[HttpError]: Malformed HTTP response");
+
+        version = statusLine.substr(0, space);
+
+        try
+        {
+            response.status = std::stoi(statusLine.substr(space + 1));
+        }
+        catch (...)
+        {
+            throw ThrowException("[HttpError]: Invalid status code: " + statusLine.substr(space + 1));
+        }
+
+        response.headers.clear();
+        for (std::string line = reader.line(); !line.empty(); line = reader.line())
+        {
+            size_t colon = line.find(':');
+            if (colon == std::string::npos) continue;
+
+            response.headers.emplace_back(trim(line.substr(0, colon)), trim(line.substr(colon + 1)));
+        }
+    }
+    while (response.status >= 100 && response.status < 200 && response.status != 101);
+
+    const std::string* length = nullptr;
+    bool chunked = false;
+    bool keepAlive = version == "HTTP/1.1";
+
+    for (const auto& [key, value] : response.headers)
+    {
+        if (equalsIgnoreCase(key, "Content-Length")) length = &value;
+        else if (equalsIgnoreCase(key, "Transfer-Encoding")) chunked = value.find("chunked") != std::string::npos;
+        else if (equalsIgnoreCase(key, "Connection")) keepAlive = equalsIgnoreCase(value, "keep-alive") || (keepAlive && !equalsIgnoreCase(value, "close"));
+    }
+
+    if (method == "HEAD" || response.status == 204 || response.status == 304)
+    {
+        // No body
+    }
+    else if (chunked)
+    {
+        while (true)
+        {
+            std::string sizeLine = reader.line();
+            size_t size = parseSize(sizeLine.substr(0, sizeLine.find(';')), 16);
+
+            if (size == 0)
+            {
+                while (!reader.line().empty()) {}
+                break;
+            }
+
+            response.body += reader.take(size);
+            if (!reader.line().empty()) throw ThrowException("[HttpError]: Malformed chunked body");
+        }
+    }
+    else if (length)
+    {
+        response.body = reader.take(parseSize(*length, 10));
+    }
+    else
+    {
+        // Delimited by the server closing, so the connection ends with it
+        response.body = reader.rest();
+        keepAlive = false;
+    }
+
+    return { std::move(response), keepAlive && reader.drained() };
+}
+
+} // namespace
+
+Url Http::parseUrl(const std::string& url)
+{
+    Url result;
+    size_t start = 0;
+
+    if (url.compare(0, 7, "http://") == 0) start = 7;
+    else if (url.find("://") != std::string::npos) throw ThrowException("[HttpError]: Unsupported URL scheme: " + url);
+
+    size_t hostEnd = url.find_first_of(":/?", start);
+    result.host = url.substr(start, hostEnd == std::string::npos ? std::string::npos : hostEnd - start);
+    if (result.host.empty()) throw ThrowException("[HttpError]: Invalid URL format: " + url);
+
+    size_t pathStart = hostEnd;
+    if (hostEnd != std::string::npos && url[hostEnd] == ':')
+    {
+        pathStart = url.find_first_of("/?", hostEnd + 1);
+        std::string port = url.substr(hostEnd + 1, pathStart == std::string::npos ? std::string::npos : pathStart - hostEnd - 1);
+
+        if (port.empty() || port.size() > 5 || !std::all_of(port.begin(), port.end(), [](char c) { return std::isdigit(static_cast<unsigned char>(c)); }) || std::stoi(port) > 65535)
+            throw ThrowException("[HttpError]: Invalid port number in URL: " + port);
+
+        result.port = std::stoi(port);
+    }
+
+    if (pathStart != std::string::npos)
+    {
+        result.path = url.substr(pathStart);
+        if (result.path[0] == '?') result.path = "/" + result.path;
+    }
+
+    return result;
+}
+
+ClientResponse Http::fetch(const std::string& method, const std::string& url, const std::string& headers, const std::string& body)
+{
+    startup();
+
+    Url target = parseUrl(url);
+    std::string key = target.host + ":" + std::to_string(target.port);
+
+    std::string request = method + " " + target.path + " HTTP/1.1\r\n"
+        + "Host: " + (target.port == 80 ? target.host : key) + "\r\n"
+        + "Content-Length: " + std::to_string(body.size()) + "\r\n"
+        + headers + "\r\n"
+        + body;
+
+    // A pooled connection the server has closed in the meantime fails before any response byte, the request is
+    // then sent once more on a new connection if that is safe
+    for (int attempt = 0; attempt < 2; attempt++)
+    {
+        Socket fd = attempt == 0 ? takeIdle(key) : InvalidSocket;
+        bool reused = fd != InvalidSocket;
+        size_t sent = 0;
+
+        if (!reused)
+        {
+            fd = connectTo(resolve(target.host, target.port));
+            if (fd == InvalidSocket) throw ThrowException("[HttpError]: Connection to " + key + " failed");
+        }
+
+        try
+        {
+            if (!sendAll(fd, request, sent))
+            {
+                if (reused) throw StaleConnection();
+                throw ThrowException("[HttpError]: Failed to send the request to " + key);
+            }
+
+            Reader reader(fd);
+            auto [response, reusable] = readResponse(reader, method);
+
+            if (reusable) giveBack(key, fd);
+            else closeSocket(fd);
+
+            return response;
+        }
+        catch (const StaleConnection&)
+        {
+            closeSocket(fd);
+            if (!reused || (sent > 0 && !idempotent(method))) throw ThrowException("[HttpError]: Connection to " + key + " closed without a response");
+        }
+        catch (...)
+        {
+            closeSocket(fd);
+            throw;
+        }
+    }
+
+    throw ThrowException("[HttpError]: Connection to " + key + " closed without a response");
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "http.hpp"
+
+namespace Probescript::Stdlib::Http
+{
+
+struct Url
+{
+    std::string host;
+    int port = 80;
+    std::string path = "/";
+};
+
+struct ClientResponse
+{
+    int status = 0;
+    std::vector<std::pair<std::string, std::string>> headers;
+    std::string body;
+};
+
+// Splits an http:// url, the scheme is optional. Throws on anything else
+Url parseUrl(const std::string& url);
+
+// Sends one request over a pooled keep-alive connection to the url's host and port. `headers` are extra
+// header lines, each ending in \r\n. On the event loop the task suspends instead of blocking
+ClientResponse fetch(const std::string& method, const std::string& url, const std::string& headers, const std::string& body);
+
+} // namespace Probescript::Stdlib::Http
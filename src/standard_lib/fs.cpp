@@ -3,20 +3,34 @@
 using namespace Probescript;
 using namespace Probescript::Stdlib;
 
+namespace
+{
+
+// File calls block, so on the event loop they run on the pool while the calling task is suspended
+Values::Ref<Values::NativeFnValue> blocking(Values::NativeFunction fn)
+{
+    return Values::make<Values::NativeFnValue>([fn](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
+    {
+        return Loop::offload([&]() { return fn(args, env); });
+    });
+}
+
+} // namespace
+
 Values::Val Fs::getValFsModule()
 {
-    return std::make_shared<Values::ObjectVal>(std::unordered_map<std::string, Values::Val>(
+    return Values::make<Values::ObjectVal>(std::unordered_map<std::string, Values::Val>(
     {
         {
             "read_file",
-            std::make_shared<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
+            blocking([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
             {
-                if (args.size() != 1 || args[0]->type != Values::ValueType::String)
+                if (args.size() != 1 || args[0].type() != Values::ValueType::String)
                 {
                     throw ThrowException(ArgumentError("readFile: Expected one string argument (file path)"));
                 }
 
-                fs::path filePath = g_currentCwd / fs::path(std::static_pointer_cast<Values::StringVal>(args[0])->string);
+                fs::path filePath = g_currentCwd / fs::path(Values::cast<Values::StringVal>(args[0])->string);
 
                 if (!fs::exists(filePath))
                 {
@@ -40,20 +54,20 @@ Values::Val Fs::getValFsModule()
                 }
 
                 file.close();
-                return std::make_shared<Values::StringVal>(fileContent);
+                return Values::make<Values::StringVal>(fileContent);
         })
         },
         {
             "write_file",
-            std::make_shared<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
+            blocking([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
             {
-                if (args.size() != 2 || args[0]->type != Values::ValueType::String || args[1]->type != Values::ValueType::String)
+                if (args.size() != 2 || args[0].type() != Values::ValueType::String || args[1].type() != Values::ValueType::String)
                 {
                     throw ThrowException(ArgumentError("writeFile: Expected two string arguments (path, content)"));
                 }
 
-                fs::path filePath = g_currentCwd / fs::path(std::static_pointer_cast<Values::StringVal>(args[0])->string);
-                std::string content = std::static_pointer_cast<Values::StringVal>(args[1])->string;
+                fs::path filePath = g_currentCwd / fs::path(Values::cast<Values::StringVal>(args[0])->string);
+                std::string content = Values::cast<Values::StringVal>(args[1])->string;
 
                 std::ofstream file(filePath);
                 if (!file.is_open())
@@ -64,56 +78,56 @@ Values::Val Fs::getValFsModule()
                 file << content;
                 file.close();
 
-                return std::make_shared<Values::UndefinedVal>();
+                return Values::makeUndefined();
             }
         )
         },
         {
             "exists",
-            std::make_shared<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
+            blocking([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
             {
-                if (args.size() != 1 || args[0]->type != Values::ValueType::String)
+                if (args.size() != 1 || args[0].type() != Values::ValueType::String)
                 {
                     throw ThrowException(ArgumentError("exists: Expected one string argument (path)"));
                 }
 
-                std::string path = std::static_pointer_cast<Values::StringVal>(args[0])->string;
-                return std::make_shared<Values::BooleanVal>(fs::exists(path));
+                std::string path = Values::cast<Values::StringVal>(args[0])->string;
+                return Values::makeBool(fs::exists(path));
             })
         },
         {
             "is_directory",
-            std::make_shared<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
+            blocking([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
             {
-                if (args.size() != 1 || args[0]->type != Values::ValueType::String)
+                if (args.size() != 1 || args[0].type() != Values::ValueType::String)
                 {
                     throw ThrowException(ArgumentError("isDirectory: Expected one string argument (path)"));
                 }
 
-                std::string path = std::static_pointer_cast<Values::StringVal>(args[0])->string;
-                return std::make_shared<Values::BooleanVal>(fs::is_directory(path));
+                std::string path = Values::cast<Values::StringVal>(args[0])->string;
+                return Values::makeBool(fs::is_directory(path));
             })
         },
         {
             "list_dir",
-            std::make_shared<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
+            blocking([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
             {
-                if (args.size() != 1 || args[0]->type != Values::ValueType::String)
+                if (args.size() != 1 || args[0].type() != Values::ValueType::String)
                 {
                     throw ThrowException(ArgumentError("listDir: Expected one string argument (path)"));
                 }
 
-                std::string path = std::static_pointer_cast<Values::StringVal>(args[0])->string;
+                std::string path = Values::cast<Values::StringVal>(args[0])->string;
 
                 if (!fs::is_directory(path))
                 {
                     throw ThrowException(ArgumentError("Provided path is not a directory: " + path));
                 }
 
-                auto array = std::make_shared<Values::ArrayVal>();
+                auto array = Values::make<Values::ArrayVal>();
                 for (const auto& entry : fs::directory_iterator(path))
                 {
-                    array->items.push_back(std::make_shared<Values::StringVal>(entry.path().string()));
+                    array->items.push_back(Values::make<Values::StringVal>(entry.path().string()));
                 }
 
                 return array;
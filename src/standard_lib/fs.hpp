@@ -8,6 +8,7 @@
 #include "core/types.hpp"
 #include "core/env.hpp"
 #include "core/errors.hpp"
+#include "core/loop.hpp"
 
 namespace fs = std::filesystem;
 
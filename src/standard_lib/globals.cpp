@@ -7,39 +7,39 @@ std::unordered_map<std::string, std::pair<Values::Val, Typechecker::TypePtr>> g_
     {
         "console",
         {
-            std::make_shared<Values::ObjectVal>(std::unordered_map<std::string, Values::Val>({
+            Values::make<Values::ObjectVal>(std::unordered_map<std::string, Values::Val>({
                 {
                     "println",
-                    std::make_shared<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val {
+                    Values::make<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val {
                         for (Values::Val arg : args) {
-                            std::cout << (arg->type == Values::ValueType::Object ? arg->toConsole() : arg->toString()) << " ";
+                            std::cout << (arg.type() == Values::ValueType::Object ? arg.toConsole() : arg.toString()) << " ";
                         }
 
                         std::cout << std::endl;
-                        return std::make_shared<Values::UndefinedVal>();
+                        return Values::makeUndefined();
                     })
                 },
                 {
                     "print",
-                    std::make_shared<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val {
+                    Values::make<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val {
                         for (Values::Val arg : args) {
-                            std::cout << (arg->type == Values::ValueType::Object ? arg->toConsole() : arg->toString()) << " ";
+                            std::cout << (arg.type() == Values::ValueType::Object ? arg.toConsole() : arg.toString()) << " ";
                         }
 
-                        return std::make_shared<Values::UndefinedVal>();
+                        return Values::makeUndefined();
                     })
                 },
                 {
                     "prompt",
-                    std::make_shared<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val {
+                    Values::make<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val {
                         for (Values::Val arg : args) {
-                            std::cout << arg->toString();
+                            std::cout << arg.toString();
                         }
 
                         std::string input;
                         std::getline(std::cin, input);
 
-                        return std::make_shared<Values::StringVal>(input);
+                        return Values::make<Values::StringVal>(input);
                     })
                 }
             })),
@@ -49,13 +49,13 @@ std::unordered_map<std::string, std::pair<Values::Val, Typechecker::TypePtr>> g_
     {
         "num",
         {
-            std::make_shared<Values::NativeClassVal>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val {
-                if (!args.empty() && !isNum(args[0]->toString()))
+            Values::make<Values::NativeClassVal>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val {
+                if (!args.empty() && !isNum(args[0].toString()))
                 {
-                    throw ThrowException(ArgumentError("Invalid argument: '" + args[0]->toString() + "' is not a number"));
+                    throw ThrowException(ArgumentError("Invalid argument: '" + args[0].toString() + "' is not a number"));
                 }
 
-                return std::make_shared<Values::NumberVal>(!args.empty() ? args[0]->toNum() : 0);
+                return Values::makeNumber(!args.empty() ? args[0].toNum() : 0);
             }),
             std::make_shared<Typechecker::Type>(Typechecker::TypeKind::Class, "native class", std::make_shared<Typechecker::TypeVal>(std::make_shared<Typechecker::Type>(Typechecker::TypeKind::Number, "number")))
         }
@@ -63,8 +63,8 @@ std::unordered_map<std::string, std::pair<Values::Val, Typechecker::TypePtr>> g_
     {
         "str",
         {
-            std::make_shared<Values::NativeClassVal>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val {
-                return std::make_shared<Values::StringVal>(!args.empty() ? args[0]->toString() : "");
+            Values::make<Values::NativeClassVal>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val {
+                return Values::make<Values::StringVal>(!args.empty() ? args[0].toString() : "");
             }),
             std::make_shared<Typechecker::Type>(Typechecker::TypeKind::Class, "native class", std::make_shared<Typechecker::TypeVal>(std::make_shared<Typechecker::Type>(Typechecker::TypeKind::String, "string")))
         }
@@ -72,8 +72,8 @@ std::unordered_map<std::string, std::pair<Values::Val, Typechecker::TypePtr>> g_
     {
         "bool",
         {
-            std::make_shared<Values::NativeClassVal>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val {
-                return std::make_shared<Values::BooleanVal>(!args.empty() ? args[0]->toBool() : false);
+            Values::make<Values::NativeClassVal>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val {
+                return Values::makeBool(!args.empty() ? args[0].toBool() : false);
             }),
             std::make_shared<Typechecker::Type>(Typechecker::TypeKind::Class, "native class", std::make_shared<Typechecker::TypeVal>(std::make_shared<Typechecker::Type>(Typechecker::TypeKind::Bool, "boolean")))
         }
@@ -81,8 +81,8 @@ std::unordered_map<std::string, std::pair<Values::Val, Typechecker::TypePtr>> g_
     {
         "map",
         {
-            std::make_shared<Values::NativeClassVal>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val {
-                return std::make_shared<Values::ObjectVal>(args.empty() ? std::unordered_map<std::string, Values::Val>() : args[0]->properties);
+            Values::make<Values::NativeClassVal>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val {
+                return Values::make<Values::ObjectVal>(args.empty() || !args[0].isHeap() ? Values::Properties() : args[0].get()->properties);
             }),
             std::make_shared<Typechecker::Type>(Typechecker::TypeKind::Class, "native class", std::make_shared<Typechecker::TypeVal>(std::make_shared<Typechecker::Type>(Typechecker::TypeKind::Object, "map")))
         }
@@ -90,10 +90,10 @@ std::unordered_map<std::string, std::pair<Values::Val, Typechecker::TypePtr>> g_
     {
         "function",
         {
-            std::make_shared<Values::NativeClassVal>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val {
-                if (args.empty() || args[0]->type == Values::ValueType::Function) throw ThrowException(ArgumentError("Usage: new function(fn: function)"));
+            Values::make<Values::NativeClassVal>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val {
+                if (args.empty() || args[0].type() == Values::ValueType::Function) throw ThrowException(ArgumentError("Usage: new function(fn: function)"));
 
-                return std::static_pointer_cast<Values::FunctionValue>(args[0]);
+                return Values::cast<Values::FunctionValue>(args[0]);
             }),
             std::make_shared<Typechecker::Type>(Typechecker::TypeKind::Class, "native class", std::make_shared<Typechecker::TypeVal>(std::make_shared<Typechecker::Type>(Typechecker::TypeKind::Function, "function")))
         }
@@ -101,9 +101,9 @@ std::unordered_map<std::string, std::pair<Values::Val, Typechecker::TypePtr>> g_
     {
         "future",
         {
-            std::make_shared<Values::NativeClassVal>([](std::vector<Values::Val> _args, EnvPtr _env) -> Values::Val
+            Values::make<Values::NativeClassVal>([](std::vector<Values::Val> _args, EnvPtr _env) -> Values::Val
             {
-                return std::make_shared<Values::UndefinedVal>();
+                return Values::makeUndefined();
             }),
             std::make_shared<Typechecker::Type>(Typechecker::TypeKind::Class, "native class", std::make_shared<Typechecker::TypeVal>(std::make_shared<Typechecker::Type>(Typechecker::TypeKind::Future, "future")))
         }
@@ -111,8 +111,8 @@ std::unordered_map<std::string, std::pair<Values::Val, Typechecker::TypePtr>> g_
     {
         "array",
         {
-            std::make_shared<Values::NativeClassVal>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val {
-                std::shared_ptr<Values::ArrayVal> array = std::make_shared<Values::ArrayVal>();
+            Values::make<Values::NativeClassVal>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val {
+                Values::Ref<Values::ArrayVal> array = Values::make<Values::ArrayVal>();
 
                 for (Values::Val val : args)
                     array->items.push_back(val);
@@ -125,10 +125,10 @@ std::unordered_map<std::string, std::pair<Values::Val, Typechecker::TypePtr>> g_
     {
         "exit",
         {
-            std::make_shared<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
+            Values::make<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
             {
-                exit(args.empty() ? 0 : args[0]->toNum());
-                return std::make_shared<Values::UndefinedVal>();
+                exit(args.empty() ? 0 : args[0].toNum());
+                return Values::makeUndefined();
             }),
             std::make_shared<Typechecker::Type>(Typechecker::TypeKind::Any, "native module", std::make_shared<Typechecker::TypeVal>(std::vector({ std::make_shared<Typechecker::Parameter>("code", Typechecker::g_numty, true) })))
         }
@@ -136,15 +136,15 @@ std::unordered_map<std::string, std::pair<Values::Val, Typechecker::TypePtr>> g_
     {
         "keys",
         {
-            std::make_shared<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
+            Values::make<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
             {
-                if (args.empty() || args[0]->type != Values::ValueType::Object) throw ThrowException(ArgumentError("Usage: keys(obj: Object)"));
+                if (args.empty() || args[0].type() != Values::ValueType::Object) throw ThrowException(ArgumentError("Usage: keys(obj: Object)"));
 
-                std::shared_ptr<Values::ArrayVal> array = std::make_shared<Values::ArrayVal>();
+                Values::Ref<Values::ArrayVal> array = Values::make<Values::ArrayVal>();
 
-                for (const auto& [key, _] : args[0]->properties)
+                for (const auto& [key, _] : args[0].get()->properties)
                 {
-                    array->items.push_back(std::make_shared<Values::StringVal>(key));
+                    array->items.push_back(Values::make<Values::StringVal>(key));
                 }
 
                 return array;
@@ -155,13 +155,13 @@ std::unordered_map<std::string, std::pair<Values::Val, Typechecker::TypePtr>> g_
     {
         "values",
         {
-            std::make_shared<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
+            Values::make<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
             {
-                if (args.empty() || args[0]->type != Values::ValueType::Object) throw ThrowException(ArgumentError("Usage: values(obj: Object)"));
+                if (args.empty() || args[0].type() != Values::ValueType::Object) throw ThrowException(ArgumentError("Usage: values(obj: Object)"));
 
-                std::shared_ptr<Values::ArrayVal> array = std::make_shared<Values::ArrayVal>();
+                Values::Ref<Values::ArrayVal> array = Values::make<Values::ArrayVal>();
 
-                for (const auto& [_, val] : args[0]->properties)
+                for (const auto& [_, val] : args[0].get()->properties)
                 {
                     array->items.push_back(val);
                 }
@@ -174,11 +174,13 @@ std::unordered_map<std::string, std::pair<Values::Val, Typechecker::TypePtr>> g_
     {
         "copy",
         {
-            std::make_shared<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
+            Values::make<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
             {
                 if (args.empty()) throw ThrowException(ArgumentError("Usage: copy(val: any)"));
 
-                return std::make_shared<Values::RuntimeVal>(*args[0]);
+                if (!args[0].isHeap()) return args[0];
+
+                return Values::make<Values::RuntimeVal>(*args[0].get());
             }),
             std::make_shared<Typechecker::Type>(Typechecker::TypeKind::Function, "function", std::make_shared<Typechecker::TypeVal>(std::vector({ std::make_shared<Typechecker::Parameter>("val", Typechecker::g_anyty, false) })))
         }
@@ -186,13 +188,13 @@ std::unordered_map<std::string, std::pair<Values::Val, Typechecker::TypePtr>> g_
     {
         "evaluate",
         {
-            std::make_shared<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
+            Values::make<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
             {
                 if (args.empty()) throw ThrowException(ArgumentError("Usage: evaluate(val: string)"));
 
                 try
                 {
-                    std::string code = args[0]->toString();
+                    std::string code = args[0].toString();
                     return Interpreter::eval(Parser().parse(code), std::make_shared<Env>(), std::make_shared<Context>(RuntimeType::REPL));
                 }
                 catch (const std::runtime_error& err)
@@ -200,7 +202,7 @@ std::unordered_map<std::string, std::pair<Values::Val, Typechecker::TypePtr>> g_
                     throw ThrowException(err.what());
                 }
 
-                return std::make_shared<Values::UndefinedVal>();
+                return Values::makeUndefined();
             }),
             std::make_shared<Typechecker::Type>(Typechecker::TypeKind::Function, "function", std::make_shared<Typechecker::TypeVal>(std::vector({ std::make_shared<Typechecker::Parameter>("input", Typechecker::g_strty, false) })))
         }
@@ -208,14 +210,14 @@ std::unordered_map<std::string, std::pair<Values::Val, Typechecker::TypePtr>> g_
     {
         "sleep",
         {
-            std::make_shared<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
+            Values::make<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
             {
                 if (!args.empty())
                 {
-                    std::this_thread::sleep_for(std::chrono::milliseconds(static_cast<int>(args[0]->toNum())));
+                    Loop::sleep(args[0].toNum());
                 }
 
-                return std::make_shared<Values::UndefinedVal>();
+                return Values::makeUndefined();
             }),
             std::make_shared<Typechecker::Type>(Typechecker::TypeKind::Function, "function", std::make_shared<Typechecker::TypeVal>(std::vector({ std::make_shared<Typechecker::Parameter>("milliseconds", Typechecker::g_numty, false) })))
         }
@@ -223,30 +225,30 @@ std::unordered_map<std::string, std::pair<Values::Val, Typechecker::TypePtr>> g_
     {
         "Regex",
         {
-            std::make_shared<Values::NativeClassVal>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
+            Values::make<Values::NativeClassVal>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
             {
                 if (args.empty()) throw ThrowException(ArgumentError("Usage: std::make_shared<Regex(expr: string)"));
 
-                std::regex regex(args[0]->toString());
-                std::shared_ptr<Values::ObjectVal> obj = std::make_shared<Values::ObjectVal>();
+                std::regex regex(args[0].toString());
+                Values::Ref<Values::ObjectVal> obj = Values::make<Values::ObjectVal>();
 
-                obj->properties["test"] = std::make_shared<Values::NativeFnValue>([regex](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
+                obj->properties["test"] = Values::make<Values::NativeFnValue>([regex](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
                 {
                     if (args.empty()) throw ThrowException(ArgumentError("Usage: regex.match(input: string)"));
 
-                    return std::make_shared<Values::BooleanVal>(std::regex_match(args[0]->toString(), regex));
+                    return Values::makeBool(std::regex_match(args[0].toString(), regex));
                 });
 
-                obj->properties["search"] = std::make_shared<Values::NativeFnValue>([regex](std::vector<Values::Val> args, EnvPtr env) -> Values::Val {
+                obj->properties["search"] = Values::make<Values::NativeFnValue>([regex](std::vector<Values::Val> args, EnvPtr env) -> Values::Val {
                     if (args.empty()) throw ThrowException(ArgumentError("Usage: regex.search(input: string)"));
-                    return std::make_shared<Values::BooleanVal>(std::regex_search(args[0]->toString(), regex));
+                    return Values::makeBool(std::regex_search(args[0].toString(), regex));
                 });
 
-                obj->properties["replace"] = std::make_shared<Values::NativeFnValue>([regex](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
+                obj->properties["replace"] = Values::make<Values::NativeFnValue>([regex](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
                 {
                     if (args.size() < 2) throw ThrowException(ArgumentError("Usage: regex.replace(input: string, replacement: string)"));
-                    std::string result = std::regex_replace(args[0]->toString(), regex, args[1]->toString());
-                    return std::make_shared<Values::StringVal>(result);
+                    std::string result = std::regex_replace(args[0].toString(), regex, args[1].toString());
+                    return Values::make<Values::StringVal>(result);
                 });
 
                 return obj;
@@ -10,4 +10,5 @@
 #include "core/env.hpp"
 #include "core/errors.hpp"
 #include "core/frontend/parser.hpp"
-#include "core/runtime/interpreter.hpp"
\ No newline at end of file
+#include "core/runtime/interpreter.hpp"
+#include "core/loop.hpp"
\ No newline at end of file
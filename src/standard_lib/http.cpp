@@ -1,4 +1,9 @@
 #include "http.hpp"
+#include "server.hpp"
+#include "client.hpp"
+#include "static_file.hpp"
+#include "fs.hpp"
+#include "core/executor.hpp"
 
 #ifdef _WIN32
 
@@ -6,6 +11,7 @@
 
 #include <winsock2.h>
 #include <ws2tcpip.h>
+#include <io.h>
 #include <thread>
 #include "threads.hpp"
 #include <sstream>
@@ -26,8 +32,10 @@ using namespace Probescript;
 using namespace Probescript::Stdlib;
 using namespace Probescript::Stdlib::Http;
 
-void startServer(const int port, std::function<void(std::shared_ptr<Request>, std::shared_ptr<Response>)> handler)
+// Thread per connection, used where there is no epoll. The connection limit and worker count do not apply
+void startServer(const ServerOptions& options, Handler handler)
 {
+    const int port = options.port;
     struct sockaddr_in serverAddr;
 #ifdef _WIN32
     WSADATA wsaData;
@@ -79,7 +87,10 @@ void startServer(const int port, std::function<void(std::shared_ptr<Request>, st
     }
 #endif
 
-    listen(serverSocket, SOMAXCONN);
+    listen(serverSocket, options.backlog > 0 ? options.backlog : SOMAXCONN);
+
+    RequestParser::Limits limits;
+    limits.maxBodySize = options.maxBodySize;
 
     while (true)
     {
@@ -95,16 +106,11 @@ void startServer(const int port, std::function<void(std::shared_ptr<Request>, st
         if (clientSocket < 0) continue;
 #endif
 
-        std::thread([clientSocket, handler]()
+        std::thread([clientSocket, handler, limits]()
         {
-            std::string request = "";
-            bool headersParsed = false;
-            size_t contentLength = 0;
-            size_t headerEnd = 0;
-            size_t bodyReceived = 0;
-            std::string bufferedBody = ""; // Buffer for body data received before handler sets ondata
-            
-            auto req = std::make_shared<Request>();
+            std::string request;
+            RequestParser parser(limits);
+
             auto res = std::make_shared<Response>();
             
             res->send = [clientSocket](std::string body, std::unordered_map<std::string, std::string> headers) -> void
@@ -130,75 +136,79 @@ void startServer(const int port, std::function<void(std::shared_ptr<Request>, st
                 close(clientSocket);
 #endif
             };
-            
-            while (true)
+
+            res->sendFile = [clientSocket](FileReply reply) -> void
             {
-                char buffer[4096];
-                int bytesReceived = recv(clientSocket, buffer, sizeof(buffer), 0);
-                if (bytesReceived <= 0) break;
-                
-                if (!headersParsed)
+                std::ostringstream response;
+                response << "HTTP/1.1 " << reply.status << "\r\n"
+                        << "Content-Length: " << reply.contentLength << "\r\n"
+                        << "Connection: close\r\n";
+
+                for (const auto& [key, val] : reply.headers)
                 {
-                    request.append(buffer, bytesReceived);
-                    headerEnd = request.find("\r\n\r\n");
-                    if (headerEnd != std::string::npos)
-                    {
-                        headersParsed = true;
-                        std::string headerPart = request.substr(0, headerEnd);
-                        
-                        auto [method, path] = parseMethodAndPath(headerPart);
-                        req->path = path;
-                        req->method = method;
-                        req->raw = headerPart;
-                        
-                        std::unordered_map<std::string, std::string> headersMap = {};
-                        for (const auto& [key, value] : parseHeaders(headerPart))
-                        {
-                            headersMap[key] = value;
-                        }
-                        
-                        req->headers = headersMap;
-                        if (headersMap.find("Cookie") != headersMap.end())
-                        {
-                            std::unordered_map<std::string, std::string> cookies = parseCookies(headersMap["Cookie"]);
-                            req->cookies = cookies;
-                        }
-                        
-                        if (headersMap.find("Content-Length") != headersMap.end())
-                        {
-                            contentLength = std::stoul(headersMap["Content-Length"]);
-                        }
-                        
-                        handler(req, res);
-                        
-                        if (request.length() > headerEnd + 4)
-                        {
-                            std::string bodyPart = request.substr(headerEnd + 4);
-                            bufferedBody += bodyPart;
-                            bodyReceived += bodyPart.length();
-                        }
-                        
-                        if (!bufferedBody.empty() && req->ondata)
-                        {
-                            req->ondata(bufferedBody);
-                        }
-                    }
+                    response << key << ": " << val << "\r\n";
                 }
-                else
+
+                response << "\r\n";
+
+                std::string resStr = response.str();
+                send(clientSocket, resStr.c_str(), resStr.size(), 0);
+
+                // No sendfile here, the file is copied through a fixed buffer
+                if (reply.body && lseek(reply.body->fd, reply.body->offset, SEEK_SET) >= 0)
                 {
-                    std::string bodyPart(buffer, bytesReceived);
-                    
-                    if (req->ondata)
+                    char chunk[64 * 1024];
+                    uint64_t left = reply.body->length;
+
+                    while (left > 0)
                     {
-                        req->ondata(bodyPart);
+                        int bytes = read(reply.body->fd, chunk, static_cast<unsigned int>(std::min<uint64_t>(left, sizeof(chunk))));
+                        if (bytes <= 0 || send(clientSocket, chunk, bytes, 0) != bytes) break;
+                        left -= bytes;
                     }
-                    bodyReceived += bytesReceived;
                 }
-                
-                if (headersParsed && bodyReceived >= contentLength) break;
-                if (headersParsed && contentLength == 0) break;
-            }
+
+#ifdef _WIN32
+                closesocket(clientSocket);
+#else
+                close(clientSocket);
+#endif
+            };
             
+            // The whole request is read before the handler runs, as on the epoll server
+            RequestParser::State state = RequestParser::State::Incomplete;
+            while (state == RequestParser::State::Incomplete)
+            {
+                char buffer[4096];
+                int bytesReceived = recv(clientSocket, buffer, sizeof(buffer), 0);
+                if (bytesReceived <= 0) break;
+
+                request.append(buffer, bytesReceived);
+                state = parser.parse(request);
+            }
+
+            if (state != RequestParser::State::Complete)
+            {
+                if (state == RequestParser::State::Error)
+                {
+                    std::string response = "HTTP/1.1 " + std::to_string(parser.error()) + "\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+                    send(clientSocket, response.c_str(), response.size(), 0);
+                }
+
+#ifdef _WIN32
+                closesocket(clientSocket);
+#else
+                close(clientSocket);
+#endif
+                return;
+            }
+
+            std::shared_ptr<Request> req = makeRequest(parser);
+            std::string body(parser.body());
+
+            handler(req, res);
+
+            if (!body.empty() && req->ondata) req->ondata(body);
             if (req->end) req->end();
 
         }).detach();
@@ -212,365 +222,320 @@ void startServer(const int port, std::function<void(std::shared_ptr<Request>, st
 #endif
 }
 
-Values::Val sendReq(const std::string& method, std::string& url, std::shared_ptr<Values::ObjectVal> conf, EnvPtr env)
+Values::Val sendReq(const std::string& method, std::string& url, Values::Ref<Values::ObjectVal> conf, EnvPtr env)
 {
     std::string headers;
-    if (conf->hasProperty("headers") && conf->properties["headers"]->type == Values::ValueType::Object)
+    if (conf->hasProperty("headers") && conf->properties["headers"].type() == Values::ValueType::Object)
     {
-        for (auto& [key, val] : std::static_pointer_cast<Values::ObjectVal>(conf->properties["headers"])->properties)
+        for (const auto& [key, val] : Values::cast<Values::ObjectVal>(conf->properties["headers"])->properties)
         {
-            if (val->type == Values::ValueType::String)
+            if (val.type() == Values::ValueType::String)
             {
-                headers += key + ": " + std::static_pointer_cast<Values::StringVal>(val)->string + "\r\n";
+                headers += key + ": " + Values::cast<Values::StringVal>(val)->string + "\r\n";
             }
         }
     }
 
     std::string body;
-    if (conf->hasProperty("body") && conf->properties["body"]->type == Values::ValueType::String)
-    {
-        body = std::static_pointer_cast<Values::StringVal>(conf->properties["body"])->string;
-    }
-
-    std::regex urlRegex(R"(^(http?://)?([^:/]+)(:(\d+))?(/.*)?$)");
-    std::smatch match;
-    if (!std::regex_match(url, match, urlRegex))
+    if (conf->hasProperty("body") && conf->properties["body"].type() == Values::ValueType::String)
     {
-        throw ThrowException("[HttpError]: Invalid URL format: " + url);
+        body = Values::cast<Values::StringVal>(conf->properties["body"])->string;
     }
 
-    int port = 80;
-    if (match[4].matched)
-    {
-        try
-        {
-            port = std::stoi(match[4]);
-        }
-        catch (...)
-        {
-            throw ThrowException("[HttpError]: Invalid port number in URL: " + match[4].str());
-        }
-    }
-
-    std::string host = match[2];
-    std::string path = match[5].matched ? match[5].str() : "/";
-    std::ostringstream reqStream;
-    reqStream << method << " " << path << " HTTP/1.1\r\n"
-              << "Host: " << host << "\r\n"
-              << "Connection: close\r\n"
-              << "Content-length: " << body.length() << "\r\n"
-              << headers << "\r\n"
-              << body;
-
-    std::string req = reqStream.str();
-
-#ifdef _WIN32
-    WSADATA wsaData;
-    WSAStartup(MAKEWORD(2, 2), &wsaData);
-#endif
-
-    struct hostent *server = gethostbyname(host.c_str());
-    if (!server)
-    {
-        throw ThrowException("[HttpError]: Failed to resolve host: " + host);
-    }
+    ClientResponse response = fetch(method, url, headers, body);
 
-    int sock = socket(AF_INET, SOCK_STREAM, 0);
-    if (sock < 0)
+    auto headerMap = Values::make<Values::ObjectVal>();
+    for (const auto& [key, value] : response.headers)
     {
-        throw ThrowException("[HttpError]: Socket creation failed");
-    }
-
-    sockaddr_in serverAddr{};
-    serverAddr.sin_family = AF_INET;
-    serverAddr.sin_port = htons(port);
-    serverAddr.sin_addr.s_addr = *(unsigned long*)server->h_addr;
-
-    if (connect(sock, (struct sockaddr*)&serverAddr, sizeof(serverAddr)) < 0)
-    {
-        throw ThrowException("[HttpError]: Connection to " + host + ":" + std::to_string(port) + " failed");
-    }
-
-    send(sock, req.c_str(), req.size(), 0);
-
-    char buffer[4096];
-    std::string res;
-    int bytes;
-    while ((bytes = recv(sock, buffer, sizeof(buffer) - 1, 0)) > 0)
-    {
-        buffer[bytes] = '\0';
-        res += buffer;
-    }
-
-#ifdef _WIN32
-    closesocket(sock);
-    WSACleanup();
-#else
-    close(sock);
-#endif
-
-    size_t headerEnd = res.find("\r\n\r\n");
-    if (headerEnd == std::string::npos)
-    {
-        throw ThrowException("[HttpError]: Malformed HTTP response");
-    }
-
-    std::string headerPart = res.substr(0, headerEnd);
-    std::string bodyPart = res.substr(headerEnd + 4);
-
-    std::istringstream stream(headerPart);
-    std::string statusLine;
-    std::getline(stream, statusLine);
-    std::istringstream statusStream(statusLine);
-    std::string httpVersion, statusCodeStr, statusText;
-    statusStream >> httpVersion >> statusCodeStr;
-    std::getline(statusStream, statusText);
-    statusText = std::regex_replace(statusText, std::regex("^ +"), "");
-
-    int statusCode = 0;
-    try
-    {
-        statusCode = std::stoi(statusCodeStr);
-    }
-    catch (...)
-    {
-        throw ThrowException("[HttpError]: Invalid status code: " + statusCodeStr);
-    }
-
-    // Parse headers into ObjectVal
-    auto headerMap = std::make_shared<Values::ObjectVal>();
-    std::string line;
-    while (std::getline(stream, line))
-    {
-        if (line.empty() || line == "\r") continue;
-        size_t colonPos = line.find(':');
-        if (colonPos != std::string::npos)
-        {
-            std::string key = line.substr(0, colonPos);
-            std::string val = line.substr(colonPos + 1);
-            val = std::regex_replace(val, std::regex("^ +"), "");
-            val = std::regex_replace(val, std::regex("\r$"), "");
-            headerMap->properties[key] = std::make_shared<Values::StringVal>(val);
-        }
+        headerMap->properties.computed(key) = Values::make<Values::StringVal>(value);
     }
 
     std::unordered_map<std::string, Values::Val> props = {
-        { "status", std::make_shared<Values::NumberVal>(statusCode) },
+        { "status", Values::makeNumber(response.status) },
         { "headers", headerMap },
-        { "body", std::make_shared<Values::NativeFnValue>([bodyPart](std::vector<Values::Val>, EnvPtr) -> Values::Val {
-            return std::make_shared<Values::StringVal>(bodyPart);
+        { "body", Values::make<Values::NativeFnValue>([body = std::move(response.body)](std::vector<Values::Val>, EnvPtr) -> Values::Val {
+            return Values::make<Values::StringVal>(body);
         }) }
     };
 
-    return std::make_shared<Values::ObjectVal>(props);
+    return Values::make<Values::ObjectVal>(props);
 }
 
 Values::Val Http::getValHttpModule()
 {
-    return std::make_shared<Values::ObjectVal>(std::unordered_map<std::string, Values::Val>({
+    return Values::make<Values::ObjectVal>(std::unordered_map<std::string, Values::Val>({
         {
             "Serve",
-            std::make_shared<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val {
+            Values::make<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val {
                 if (
                     args.size() < 2
-		    || args[0]->type != Values::ValueType::Number
-		    || args[1]->type != Values::ValueType::Function
-                ) throw ThrowException(ArgumentError("Usage: http.Serve(port: number, handler: function)"));
+		    || args[0].type() != Values::ValueType::Number
+		    || args[1].type() != Values::ValueType::Function
+                ) throw ThrowException(ArgumentError("Usage: http.Serve(port: number, handler: function, options?: { backlog, max_connections, workers, io_threads, idle_timeout, handler_timeout, max_requests, max_body_size })"));
 
-                startServer(
-                    std::static_pointer_cast<Values::NumberVal>(args[0])->number,
-                    [args, env](std::shared_ptr<Request> request, std::shared_ptr<Response> response) -> void
+                ServerOptions options;
+                options.port = args[0].asNumber();
+
+                if (args.size() > 2 && args[2].type() == Values::ValueType::Object)
+                {
+                    Values::Ref<Values::ObjectVal> conf = Values::cast<Values::ObjectVal>(args[2]);
+
+                    auto count = [&](const std::string& key, size_t fallback) -> size_t
                     {
-                        std::shared_ptr<Values::ObjectVal> req = std::make_shared<Values::ObjectVal>();
-                        std::shared_ptr<Values::ObjectVal> res = std::make_shared<Values::ObjectVal>();
+                        if (!conf->hasProperty(key)) return fallback;
+
+                        Values::Val value = conf->properties[key];
+                        if (!value.isNumber() || value.asNumber() < 1) throw ThrowException(ArgumentError("http.Serve: " + key + " must be a positive number"));
+                        return static_cast<size_t>(value.asNumber());
+                    };
+
+                    options.backlog = static_cast<int>(count("backlog", options.backlog));
+                    options.maxConnections = count("max_connections", options.maxConnections);
+                    options.workers = count("workers", options.workers);
+                    options.ioThreads = count("io_threads", options.ioThreads);
+                    options.idleTimeout = count("idle_timeout", options.idleTimeout);
+                    options.handlerTimeout = count("handler_timeout", options.handlerTimeout);
+                    options.maxRequests = count("max_requests", options.maxRequests);
+                    options.maxBodySize = count("max_body_size", options.maxBodySize);
+                }
 
-                        req->properties["path"] = std::make_shared<Values::StringVal>(request->path);
-                        req->properties["method"] = std::make_shared<Values::StringVal>(request->method);
-                        req->properties["headers"] = std::make_shared<Values::ObjectVal>();
-                        req->properties["cookies"] = std::make_shared<Values::ObjectVal>();
+                Handler handler = [args, env](std::shared_ptr<Request> request, std::shared_ptr<Response> response) -> void
+                {
+                    Values::Ref<Values::ObjectVal> req = Values::make<Values::ObjectVal>();
+                    Values::Ref<Values::ObjectVal> res = Values::make<Values::ObjectVal>();
 
-                        req->properties["ondata"] = std::make_shared<Values::NativeFnValue>([request](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
-                        {
-                            if (args.empty() || args[0]->type != Values::ValueType::Function) 
-                                throw ThrowException(ArgumentError("Usage: req.ondata(callback: function)"));
-                            
-                            request->ondata = std::function<void(std::string)>([args, env](std::string data)
-                            {
-                                Interpreter::evalCallWithFnVal(args[0], { std::make_shared<Values::StringVal>(data) }, env);
-                            });
+                    req->properties["path"] = Values::make<Values::StringVal>(request->path);
+                    req->properties["method"] = Values::make<Values::StringVal>(request->method);
+                    req->properties["query"] = Values::make<Values::StringVal>(request->query);
+                    req->properties["headers"] = Values::make<Values::ObjectVal>();
+                    req->properties["cookies"] = Values::make<Values::ObjectVal>();
 
-                            return std::make_shared<Values::UndefinedVal>();
+                    req->properties["ondata"] = Values::make<Values::NativeFnValue>([request](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
+                    {
+                        if (args.empty() || args[0].type() != Values::ValueType::Function) 
+                            throw ThrowException(ArgumentError("Usage: req.ondata(callback: function)"));
+                        
+                        request->ondata = std::function<void(std::string)>([args, env](std::string data)
+                        {
+                            Interpreter::evalCallWithFnVal(args[0], { Values::make<Values::StringVal>(data) }, env);
                         });
 
-                        req->properties["end"] = std::make_shared<Values::NativeFnValue>([request](std::vector<Values::Val> args, EnvPtr _env) -> Values::Val
-                        {
-                            if (args.empty() || args[0]->type != Values::ValueType::Function) 
-                                throw ThrowException(ArgumentError("Usage: req.end(callback: function)"));
-                            
-                            request->end = std::function<void()>([args, _env]()
-                            {
-                                Interpreter::evalCallWithFnVal(args[0], {}, _env);
-                            });
+                        return Values::makeUndefined();
+                    });
 
-                            return std::make_shared<Values::UndefinedVal>();
+                    req->properties["end"] = Values::make<Values::NativeFnValue>([request](std::vector<Values::Val> args, EnvPtr _env) -> Values::Val
+                    {
+                        if (args.empty() || args[0].type() != Values::ValueType::Function) 
+                            throw ThrowException(ArgumentError("Usage: req.end(callback: function)"));
+                        
+                        request->end = std::function<void()>([args, _env]()
+                        {
+                            Interpreter::evalCallWithFnVal(args[0], {}, _env);
                         });
 
-                        for (const auto& [key, val] : request->headers)
-                            req->properties["headers"]->properties[key] = std::make_shared<Values::StringVal>(val);
+                        return Values::makeUndefined();
+                    });
 
-                        for (const auto& [key, val] : request->cookies)
-                            req->properties["cookies"]->properties[key] = std::make_shared<Values::StringVal>(val);
+                    for (const auto& [key, val] : request->headers)
+                        req->properties["headers"].get()->properties.computed(key) = Values::make<Values::StringVal>(val);
 
-                        req->properties["raw"] =
-                        std::make_shared<Values::NativeFnValue>([request](std::vector<Values::Val> _args, EnvPtr _env) -> Values::Val
-                        {
-                            return std::make_shared<Values::StringVal>(request->raw);
-                        });
+                    for (const auto& [key, val] : request->cookies)
+                        req->properties["cookies"].get()->properties.computed(key) = Values::make<Values::StringVal>(val);
 
-                        auto resheaders = std::make_shared<std::unordered_map<std::string, std::string>>();
-                        (*resheaders)["Content-Type"] = "text/plain";
+                    req->properties["raw"] =
+                    Values::make<Values::NativeFnValue>([request](std::vector<Values::Val> _args, EnvPtr _env) -> Values::Val
+                    {
+                        return Values::make<Values::StringVal>(request->raw);
+                    });
 
-                        res->properties["content_type"] = std::make_shared<Values::NativeFnValue>([resheaders](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
-                        {
-                            if (args.empty()) throw ThrowException(ArgumentError("Usage: res.content_type(type: str)"));
+                    auto resheaders = std::make_shared<std::unordered_map<std::string, std::string>>();
+                    (*resheaders)["Content-Type"] = "text/plain";
 
-                            (*resheaders)["Content-Type"] = args[0]->toString();
+                    res->properties["content_type"] = Values::make<Values::NativeFnValue>([resheaders](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
+                    {
+                        if (args.empty()) throw ThrowException(ArgumentError("Usage: res.content_type(type: str)"));
 
-                            return std::make_shared<Values::UndefinedVal>();
-                        });
+                        (*resheaders)["Content-Type"] = args[0].toString();
 
-                        res->properties["header"] = std::make_shared<Values::NativeFnValue>([resheaders](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
-                        {
-                            if (args.empty()) throw ThrowException(ArgumentError("Usage: res.header(key: str, value: str)"));
+                        return Values::makeUndefined();
+                    });
 
-                            (*resheaders)[args[0]->toString()] = args[1]->toString();
+                    res->properties["header"] = Values::make<Values::NativeFnValue>([resheaders](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
+                    {
+                        if (args.empty()) throw ThrowException(ArgumentError("Usage: res.header(key: str, value: str)"));
 
-                            return std::make_shared<Values::UndefinedVal>();
-                        });
+                        (*resheaders)[args[0].toString()] = args[1].toString();
 
-                        res->properties["send"] = std::make_shared<Values::NativeFnValue>([resheaders, response](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
-                        {
-                            if (args.empty()) throw ThrowException(ArgumentError("Usage: res.send(body: str)"));
+                        return Values::makeUndefined();
+                    });
 
-                            response->send(args[0]->toString(), (*resheaders));
+                    res->properties["send"] = Values::make<Values::NativeFnValue>([resheaders, response](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
+                    {
+                        if (args.empty()) throw ThrowException(ArgumentError("Usage: res.send(body: str)"));
 
-                            return std::make_shared<Values::UndefinedVal>();
-                        });
+                        response->send(args[0].toString(), (*resheaders));
+
+                        return Values::makeUndefined();
+                    });
 
-                        res->properties["html"] = std::make_shared<Values::NativeFnValue>([resheaders, response](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
+                    res->properties["send_file"] = Values::make<Values::NativeFnValue>([resheaders, request, response](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
+                    {
+                        if (args.empty() || args[0].type() != Values::ValueType::String) throw ThrowException(ArgumentError("Usage: res.send_file(path: str, options?: { content_type, max_age })"));
+
+                        FileOptions options;
+                        if (args.size() > 1 && args[1].type() == Values::ValueType::Object)
                         {
-                            if (args.empty()) throw ThrowException(ArgumentError("Usage: res.html(html: str)"));
+                            Values::Ref<Values::ObjectVal> conf = Values::cast<Values::ObjectVal>(args[1]);
 
-                            (*resheaders)["Content-Type"] = "text/html";
-                            response->send(args[0]->toString(), (*resheaders));
+                            if (conf->hasProperty("content_type")) options.contentType = conf->properties["content_type"].toString();
+                            if (conf->hasProperty("max_age"))
+                            {
+                                Values::Val maxAge = conf->properties["max_age"];
+                                if (!maxAge.isNumber() || maxAge.asNumber() < 0) throw ThrowException(ArgumentError("res.send_file: max_age must be a number of seconds"));
+                                options.maxAge = static_cast<long long>(maxAge.asNumber());
+                            }
+                        }
 
-                            return std::make_shared<Values::UndefinedVal>();
-                        });
+                        // Relative paths start at the script's directory, like fs.read_file
+                        fs::path filePath = g_currentCwd / fs::path(args[0].toString());
+                        FileReply reply = prepareFile(filePath.string(), *request, options);
 
-                        res->properties["json"] = std::make_shared<Values::NativeFnValue>([resheaders, response](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
+                        // Headers set with res.header are kept, the ones describing the file win
+                        for (const auto& [key, val] : *resheaders)
                         {
-                            if (args.empty()) throw ThrowException(ArgumentError("Usage: res.html(object)"));
+                            if (!findHeader(reply.headers, key)) reply.headers[key] = val;
+                        }
 
-                            (*resheaders)["Content-Type"] = "application/json";
-                            response->send(args[0]->toJSON(), (*resheaders));
+                        response->sendFile(std::move(reply));
 
-                            return std::make_shared<Values::UndefinedVal>();
-                        });
+                        return Values::makeUndefined();
+                    });
 
-                        Interpreter::evalCallWithFnVal(args[1], { req, res }, env);
-                    }
-                );
+                    res->properties["html"] = Values::make<Values::NativeFnValue>([resheaders, response](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
+                    {
+                        if (args.empty()) throw ThrowException(ArgumentError("Usage: res.html(html: str)"));
+
+                        (*resheaders)["Content-Type"] = "text/html";
+                        response->send(args[0].toString(), (*resheaders));
+
+                        return Values::makeUndefined();
+                    });
+
+                    res->properties["json"] = Values::make<Values::NativeFnValue>([resheaders, response](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
+                    {
+                        if (args.empty()) throw ThrowException(ArgumentError("Usage: res.html(object)"));
+
+                        (*resheaders)["Content-Type"] = "application/json";
+                        response->send(args[0].toJSON(), (*resheaders));
+
+                        return Values::makeUndefined();
+                    });
+
+                    Interpreter::evalCallWithFnVal(args[1], { req, res }, env);
+                };
 
-                return std::make_shared<Values::UndefinedVal>();
+                auto run = [&]()
+                {
+#ifdef __linux__
+                    serve(options, handler);
+#else
+                    startServer(options, handler);
+#endif
+                };
+
+                // Never returns, so it runs beside the loop and stands aside for a spare on a pool worker
+                Loop::daemon([&]() { run(); return Values::makeUndefined(); });
+
+                return Values::makeUndefined();
             })
         },
         {
             "get",
-            std::make_shared<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val {
-                if (args.size() < 2 || args[0]->type != Values::ValueType::String || args[1]->type != Values::ValueType::Object) throw ThrowException(ArgumentError("Usage: http.get(\"http://example.com\", { headers: {} })"));
+            Values::make<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val {
+                if (args.size() < 2 || args[0].type() != Values::ValueType::String || args[1].type() != Values::ValueType::Object) throw ThrowException(ArgumentError("Usage: http.get(\"http://example.com\", { headers: {} })"));
                 
-                return std::make_shared<Values::FutureVal>(std::async(std::launch::async, [args, env]() -> Values::Val
+                return Loop::spawn([args, env]() -> Values::Val
                 {
-                    return sendReq("GET", std::static_pointer_cast<Values::StringVal>(args[0])->string, std::static_pointer_cast<Values::ObjectVal>(args[1]), env);
-                }));
+                    return sendReq("GET", Values::cast<Values::StringVal>(args[0])->string, Values::cast<Values::ObjectVal>(args[1]), env);
+                });
             })
         },
         {
             "post",
-            std::make_shared<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val {
-                if (args.size() < 2 || args[0]->type != Values::ValueType::String || args[1]->type != Values::ValueType::Object) throw ThrowException(ArgumentError("Usage: http.post(\"http://example.com\", { body: \"body\", headers: {} })"));
+            Values::make<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val {
+                if (args.size() < 2 || args[0].type() != Values::ValueType::String || args[1].type() != Values::ValueType::Object) throw ThrowException(ArgumentError("Usage: http.post(\"http://example.com\", { body: \"body\", headers: {} })"));
                 
-                return std::make_shared<Values::FutureVal>(std::async(std::launch::async, [args, env]() -> Values::Val
+                return Loop::spawn([args, env]() -> Values::Val
                 {
-                    return sendReq("POST", std::static_pointer_cast<Values::StringVal>(args[0])->string, ((args.size() > 1 && args[1]->type == Values::ValueType::Object) ? std::static_pointer_cast<Values::ObjectVal>(args[1]) : std::make_shared<Values::ObjectVal>()), env);
-                }));
+                    return sendReq("POST", Values::cast<Values::StringVal>(args[0])->string, ((args.size() > 1 && args[1].type() == Values::ValueType::Object) ? Values::cast<Values::ObjectVal>(args[1]) : Values::make<Values::ObjectVal>()), env);
+                });
             })
         },
         {
             "delete",
-            std::make_shared<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val {
-                if (args.size() < 2 || args[0]->type != Values::ValueType::String || args[1]->type != Values::ValueType::Object) throw ThrowException(ArgumentError("Usage: http.delete(\"http://example.com\", { body: \"body\", headers: {} })"));
+            Values::make<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val {
+                if (args.size() < 2 || args[0].type() != Values::ValueType::String || args[1].type() != Values::ValueType::Object) throw ThrowException(ArgumentError("Usage: http.delete(\"http://example.com\", { body: \"body\", headers: {} })"));
                 
-                return std::make_shared<Values::FutureVal>(std::async(std::launch::async, [args, env]() -> Values::Val
+                return Loop::spawn([args, env]() -> Values::Val
                 {
-                    return sendReq("DELETE", std::static_pointer_cast<Values::StringVal>(args[0])->string, ((args.size() > 1 && args[1]->type == Values::ValueType::Object) ? std::static_pointer_cast<Values::ObjectVal>(args[1]) : std::make_shared<Values::ObjectVal>()), env);
-                }));
+                    return sendReq("DELETE", Values::cast<Values::StringVal>(args[0])->string, ((args.size() > 1 && args[1].type() == Values::ValueType::Object) ? Values::cast<Values::ObjectVal>(args[1]) : Values::make<Values::ObjectVal>()), env);
+                });
             })
         },
         {
             "put",
-            std::make_shared<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val {
-                if (args.size() < 2 || args[0]->type != Values::ValueType::String || args[1]->type != Values::ValueType::Object) throw ThrowException(ArgumentError("Usage: http.put(\"http://example.com\", { body: \"body\", headers: {} })"));
+            Values::make<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val {
+                if (args.size() < 2 || args[0].type() != Values::ValueType::String || args[1].type() != Values::ValueType::Object) throw ThrowException(ArgumentError("Usage: http.put(\"http://example.com\", { body: \"body\", headers: {} })"));
                 
-                return std::make_shared<Values::FutureVal>(std::async(std::launch::async, [args, env]() -> Values::Val
+                return Loop::spawn([args, env]() -> Values::Val
                 {    
-                    return sendReq("PUT", std::static_pointer_cast<Values::StringVal>(args[0])->string, ((args.size() > 1 && args[1]->type == Values::ValueType::Object) ? std::static_pointer_cast<Values::ObjectVal>(args[1]) : std::make_shared<Values::ObjectVal>()), env);
-                }));
+                    return sendReq("PUT", Values::cast<Values::StringVal>(args[0])->string, ((args.size() > 1 && args[1].type() == Values::ValueType::Object) ? Values::cast<Values::ObjectVal>(args[1]) : Values::make<Values::ObjectVal>()), env);
+                });
             })
         },
         {
             "patch",
-            std::make_shared<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val {
-                if (args.size() < 2 || args[0]->type != Values::ValueType::String || args[1]->type != Values::ValueType::Object) throw ThrowException(ArgumentError("Usage: http.patch(\"http://example.com\", { body: \"body\", headers: {} })"));
+            Values::make<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val {
+                if (args.size() < 2 || args[0].type() != Values::ValueType::String || args[1].type() != Values::ValueType::Object) throw ThrowException(ArgumentError("Usage: http.patch(\"http://example.com\", { body: \"body\", headers: {} })"));
                 
-                return std::make_shared<Values::FutureVal>(std::async(std::launch::async, [args, env]() -> Values::Val
+                return Loop::spawn([args, env]() -> Values::Val
                 {
-                    return sendReq("PATCH", std::static_pointer_cast<Values::StringVal>(args[0])->string, ((args.size() > 1 && args[1]->type == Values::ValueType::Object) ? std::static_pointer_cast<Values::ObjectVal>(args[1]) : std::make_shared<Values::ObjectVal>()), env);
-                }));
+                    return sendReq("PATCH", Values::cast<Values::StringVal>(args[0])->string, ((args.size() > 1 && args[1].type() == Values::ValueType::Object) ? Values::cast<Values::ObjectVal>(args[1]) : Values::make<Values::ObjectVal>()), env);
+                });
             })
         },
         {
             "options",
-            std::make_shared<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val {
-                if (args.size() < 2 || args[0]->type != Values::ValueType::String || args[1]->type != Values::ValueType::Object) throw ThrowException(ArgumentError("Usage: http.options(\"http://example.com\", { headers: {} })"));
+            Values::make<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val {
+                if (args.size() < 2 || args[0].type() != Values::ValueType::String || args[1].type() != Values::ValueType::Object) throw ThrowException(ArgumentError("Usage: http.options(\"http://example.com\", { headers: {} })"));
                 
-                return std::make_shared<Values::FutureVal>(std::async(std::launch::async, [args, env]() -> Values::Val
+                return Loop::spawn([args, env]() -> Values::Val
                 {
-                    return sendReq("OPTIONS", std::static_pointer_cast<Values::StringVal>(args[0])->string, ((args.size() > 1 && args[1]->type == Values::ValueType::Object) ? std::static_pointer_cast<Values::ObjectVal>(args[1]) : std::make_shared<Values::ObjectVal>()), env);
-                }));
+                    return sendReq("OPTIONS", Values::cast<Values::StringVal>(args[0])->string, ((args.size() > 1 && args[1].type() == Values::ValueType::Object) ? Values::cast<Values::ObjectVal>(args[1]) : Values::make<Values::ObjectVal>()), env);
+                });
             })
         },
         {
             "head",
-            std::make_shared<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val {
-                if (args.size() < 2 || args[0]->type != Values::ValueType::String || args[1]->type != Values::ValueType::Object) throw ThrowException(ArgumentError("Usage: http.head(\"http://example.com\", { headers: {} })"));
+            Values::make<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val {
+                if (args.size() < 2 || args[0].type() != Values::ValueType::String || args[1].type() != Values::ValueType::Object) throw ThrowException(ArgumentError("Usage: http.head(\"http://example.com\", { headers: {} })"));
                 
-                return std::make_shared<Values::FutureVal>(std::async(std::launch::async, [args, env]() -> Values::Val
+                return Loop::spawn([args, env]() -> Values::Val
                 {
-                    return sendReq("HEAD", std::static_pointer_cast<Values::StringVal>(args[0])->string, ((args.size() > 1 && args[1]->type == Values::ValueType::Object) ? std::static_pointer_cast<Values::ObjectVal>(args[1]) : std::make_shared<Values::ObjectVal>()), env);
-                }));
+                    return sendReq("HEAD", Values::cast<Values::StringVal>(args[0])->string, ((args.size() > 1 && args[1].type() == Values::ValueType::Object) ? Values::cast<Values::ObjectVal>(args[1]) : Values::make<Values::ObjectVal>()), env);
+                });
             })
         },
         {
             "Request",
-            std::make_shared<Values::NativeClassVal>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val {
-                return std::make_shared<Values::UndefinedVal>();
+            Values::make<Values::NativeClassVal>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val {
+                return Values::makeUndefined();
             })
         },
         {
             "Response",
-            std::make_shared<Values::NativeClassVal>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val {
-                return std::make_shared<Values::UndefinedVal>();
+            Values::make<Values::NativeClassVal>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val {
+                return Values::makeUndefined();
             })
         }
     }));
@@ -588,7 +553,8 @@ Typechecker::TypePtr Http::getTypeHttpModule()
                     std::vector({
                         std::make_shared<Typechecker::Parameter>("port", Typechecker::g_numty, false),
                         std::make_shared<Typechecker::Parameter>("handler", std::make_shared<Typechecker::Type>(Typechecker::TypeKind::Function, "function"),
-                        false)
+                        false),
+                        std::make_shared<Typechecker::Parameter>("options", Typechecker::g_mapty, true)
                     })
                 )
             )
@@ -717,6 +683,10 @@ Typechecker::TypePtr Http::getTypeHttpModule()
                     "path",
                     std::make_shared<Typechecker::Type>(Typechecker::TypeKind::String, "string")
                 },
+                {
+                    "query",
+                    std::make_shared<Typechecker::Type>(Typechecker::TypeKind::String, "string")
+                },
                 {
                     "ondata",
                     std::make_shared<Typechecker::Type>(Typechecker::TypeKind::Function, "function", std::make_shared<Typechecker::TypeVal>(std::vector({ std::make_shared<Typechecker::Parameter>("function", std::make_shared<Typechecker::Type>(Typechecker::TypeKind::Function, "function"), false) })))
@@ -755,6 +725,10 @@ Typechecker::TypePtr Http::getTypeHttpModule()
                     "send",
                     std::make_shared<Typechecker::Type>(Typechecker::TypeKind::Function, "function", std::make_shared<Typechecker::TypeVal>(std::vector({ std::make_shared<Typechecker::Parameter>("data", Typechecker::g_strty, false) })))
                 },
+                {
+                    "send_file",
+                    std::make_shared<Typechecker::Type>(Typechecker::TypeKind::Function, "function", std::make_shared<Typechecker::TypeVal>(std::vector({ std::make_shared<Typechecker::Parameter>("path", Typechecker::g_strty, false), std::make_shared<Typechecker::Parameter>("options", Typechecker::g_mapty, true) })))
+                },
                 {
                     "html",
                     std::make_shared<Typechecker::Type>(Typechecker::TypeKind::Function, "function", std::make_shared<Typechecker::TypeVal>(std::vector({ std::make_shared<Typechecker::Parameter>("html", Typechecker::g_strty, false) })))
@@ -2,23 +2,31 @@
 
 #include <unordered_map>
 #include <string>
+#include <string_view>
 #include <sstream>
 #include <regex>
 #include <algorithm>
+#include <cctype>
+#include <cstdint>
 
 #include "core/runtime/values.hpp"
 #include "core/runtime/interpreter.hpp"
+#include "core/loop.hpp"
 #include "core/utils.hpp"
 #include "core/types.hpp"
 #include "core/env.hpp"
 
+#include "request_parser.hpp"
+
 namespace Probescript::Stdlib::Http
 {
 
 struct Request
 {
     std::string method;
+    // The target as sent, query included
     std::string path;
+    std::string query;
     std::string raw;
 
     std::function<void(std::string)> ondata;
@@ -28,9 +36,34 @@ struct Request
     std::unordered_map<std::string, std::string> cookies = {};
 };
 
+// The open file behind res.send_file, the descriptor is closed with the last reference
+struct FileBody
+{
+    int fd = -1;
+    // Where the bytes still to be sent start and how many there are, advanced as they go out
+    uint64_t offset = 0;
+    uint64_t length = 0;
+
+    FileBody() = default;
+    FileBody(const FileBody&) = delete;
+    FileBody& operator=(const FileBody&) = delete;
+    ~FileBody();
+};
+
+// What res.send_file answers with. Content-Length is `contentLength` even when no bytes follow, as for 304 and HEAD
+struct FileReply
+{
+    int status = 200;
+    uint64_t contentLength = 0;
+    std::unordered_map<std::string, std::string> headers;
+    // Null when only the head is sent
+    std::shared_ptr<FileBody> body;
+};
+
 struct Response
 {
     std::function<void(std::string, std::unordered_map<std::string, std::string>)> send;
+    std::function<void(FileReply)> sendFile;
 };
 
 Values::Val getValHttpModule();
@@ -45,28 +78,22 @@ inline std::string trim(const std::string& str) {
     return str.substr(start, end - start + 1);
 }
 
-inline std::unordered_map<std::string, std::string> parseHeaders(const std::string& req)
+// ASCII only, which is all header names and tokens can hold
+inline bool equalsIgnoreCase(std::string_view a, std::string_view b)
 {
-    std::unordered_map<std::string, std::string> headers;
-    std::istringstream stream(req);
-    std::string line;
-
-    std::getline(stream, line);
+    auto lower = [](unsigned char c) { return c >= 'A' && c <= 'Z' ? c | 0x20 : c; };
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [&](unsigned char x, unsigned char y) { return lower(x) == lower(y); });
+}
 
-    while (std::getline(stream, line))
+// Header names are case insensitive, scripts mostly send them capitalized
+inline const std::string* findHeader(const std::unordered_map<std::string, std::string>& headers, const std::string& name)
+{
+    for (const auto& [key, value] : headers)
     {
-        if (line == "\r" || line.empty()) break;
-
-        size_t colon = line.find(':');
-        if (colon != std::string::npos)
-        {
-            std::string key = trim(line.substr(0, colon));
-            std::string value = trim(line.substr(colon + 1));
-            headers[key] = value;
-        }
+        if (equalsIgnoreCase(key, name)) return &value;
     }
 
-    return headers;
+    return nullptr;
 }
 
 inline std::unordered_map<std::string, std::string> parseCookies(const std::string& c)
@@ -85,13 +112,23 @@ inline std::unordered_map<std::string, std::string> parseCookies(const std::stri
     return cookies;
 }
 
-
-inline std::pair<std::string, std::string> parseMethodAndPath(const std::string& request)
+// Copies a parsed request out of the receive buffer, the handler runs on another thread
+inline std::shared_ptr<Request> makeRequest(const RequestParser& parser)
 {
-    std::istringstream stream(request);
-    std::string method, path;
-    stream >> method >> path;
-    return {method, path};
+    auto request = std::make_shared<Request>();
+    request->method = parser.method();
+    request->path = parser.target();
+    request->query = parser.query();
+    request->raw = parser.head();
+
+    for (size_t i = 0; i < parser.headerCount(); i++)
+    {
+        auto [name, value] = parser.header(i);
+        request->headers[std::string(name)] = value;
+    }
+
+    if (std::optional<std::string_view> cookie = parser.header("Cookie")) request->cookies = parseCookies(std::string(*cookie));
+    return request;
 }
 
 } // namespace Probescript::Stdlib::Http
\ No newline at end of file
@@ -1,215 +1,367 @@
+#include <fstream>
+
 #include "json.hpp"
+#include "fs.hpp"
+#include "core/runtime/interpreter.hpp"
 
 using namespace Probescript;
 using namespace Probescript::Stdlib;
 using namespace Probescript::Stdlib::JSON;
 
-Values::Val JSONParser::parse()
+bool JSONParser::refill()
+{
+    if (!stream || !*stream) return false;
+
+    // Everything before `pos` has been consumed, so the buffer can start over
+    buffer.resize(ChunkSize);
+    stream->read(buffer.data(), ChunkSize);
+    buffer.resize(stream->gcount());
+
+    data = buffer;
+    pos = 0;
+    return !buffer.empty();
+}
+
+void JSONParser::fail(const std::string& message)
 {
-    if (tokenize()) return std::make_shared<Values::UndefinedVal>();
-    return parseTokens();
+    throw ThrowException(CustomError(message + " at " + std::to_string(line) + ":" + std::to_string(col), "JsonError"));
 }
 
-bool JSONParser::tokenize()
+void JSONParser::skipWhitespace()
 {
-    std::vector<std::string> src = splitToChars(file);
-    std::vector<Token> tokens;
-    while (!src.empty())
+    while (true)
     {
-        if (skippable(src[0]))
-        {
-            shift(src);
-            continue;
-        }
+        char c = peek();
+        if (c != ' ' && c != '\n' && c != '\t' && c != '\r') return;
+        next();
+    }
+}
 
-        if (src[0] == "\"")
-        {
-            shift(src);
-            std::string r;
-            while (!src.empty() && src[0] != "\"")
-            {
-                r += shift(src);
-            }
+void JSONParser::expect(char c)
+{
+    skipWhitespace();
+    char found = peek();
 
-            if (src.empty())
-            {
-                throw ThrowException(CustomError("Expected end \" after string", "JsonError"));
-                return true;
-            }
+    if (found != c)
+    {
+        fail(std::string("Expected '") + c + "' but found " + (found == '\0' ? "end of input" : std::string("'") + found + "'"));
+    }
 
-            shift(src);
+    next();
+}
 
-            tokens.push_back(Token(r, String));
-            continue;
-        }
+void JSONParser::expectWord(const char* word)
+{
+    for (const char* c = word; *c; c++)
+    {
+        if (peek() != *c) fail(std::string("Invalid literal, expected ") + word);
+        next();
+    }
+}
 
-        if (src[0] == "t" && src[1] == "r" && src[2] == "u" && src[3] == "e")
-        {
-            shift(src);
-            shift(src);
-            shift(src);
-            shift(src);
+Values::Val JSONParser::parse()
+{
+    Values::Val value = parseValue();
 
-            tokens.push_back(Token("true", Boolean));
-            continue;
-        }
+    skipWhitespace();
+    if (peek() != '\0') fail(std::string("Unexpected '") + peek() + "' after JSON value");
 
-        if (src[0] == "f" && src[1] == "a" && src[2] == "l" && src[3] == "s" && src[4] == "e")
-        {
-            shift(src);
-            shift(src);
-            shift(src);
-            shift(src);
-            shift(src);
-
-            tokens.push_back(Token("false", Boolean));
-            continue;
-        }
+    return value;
+}
+
+void JSONParser::parseStream(const std::function<void(Values::Val)>& onItem)
+{
+    expect('[');
+    skipWhitespace();
 
-        if (isInt(src[0]) || ((src[0] == "-" || src[0] == ".") && isInt(src[1])))
+    if (peek() == ']')
+    {
+        next();
+    }
+    else
+    {
+        while (true)
         {
-            std::string num = "";
-            while (!src.empty() && (isInt(src[0]) || ((src[0] == "-" || src[0] == ".") && isInt(src[1]))))
+            onItem(parseValue());
+
+            skipWhitespace();
+            if (peek() == ']')
             {
-                num += shift(src);
+                next();
+                break;
             }
-            tokens.push_back(Token(num, Number));
-            continue;
-        }
 
-        if (src[0] == "{")
-        {
-            tokens.push_back(Token(shift(src), OpenBrace));
-            continue;
-        }
-        else if (src[0] == "}")
-        {
-            tokens.push_back(Token(shift(src), ClosedBrace));
-            continue;
-        }
-        else if (src[0] == ":")
-        {
-            tokens.push_back(Token(shift(src), Colon));
-            continue;
-        }
-        else if (src[0] == ",")
-        {
-            tokens.push_back(Token(shift(src), Comma));
-            continue;
-        }
-        else if (src[0] == "[")
-        {
-            tokens.push_back(Token(shift(src), OpenBracket));
-        }
-        else if (src[0] == "]")
-        {
-            tokens.push_back(Token(shift(src), CloseBracket));
-        }
-        else
-        {
-            throw ThrowException(CustomError("Unknown sign in JSON: '" + src[0] + "'", "JsonError"));
-            return true;
+            expect(',');
         }
     }
 
-    this->tokens = tokens;
-    return false;
+    skipWhitespace();
+    if (peek() != '\0') fail(std::string("Unexpected '") + peek() + "' after JSON array");
 }
 
-Values::Val JSONParser::parseValue() {
-    switch (tokens[0].type) {
-        case TokenType::String:
-            return std::make_shared<Values::StringVal>(eat().val);
-        case TokenType::Number:
-            return std::make_shared<Values::NumberVal>(eat().val);
-        case TokenType::OpenBrace:
-            return parseObject();
-        case TokenType::Boolean:
-            return std::make_shared<Values::BooleanVal>(eat().val == "true");
-        case TokenType::OpenBracket:
-            return parseArray();
+Values::Val JSONParser::parseValue()
+{
+    skipWhitespace();
+
+    switch (peek())
+    {
+        case '{':
+        case '[':
+        {
+            // Every level is a recursive call, a hostile document could otherwise run the stack out
+            if (++depth > MaxDepth) fail("Nesting deeper than " + std::to_string(MaxDepth) + " levels");
+
+            Values::Val value = peek() == '{' ? parseObject() : parseArray();
+            depth--;
+            return value;
+        }
+        case '"':
+            return Values::make<Values::StringVal>(parseString());
+        case 't':
+            expectWord("true");
+            return Values::makeBool(true);
+        case 'f':
+            expectWord("false");
+            return Values::makeBool(false);
+        case 'n':
+            expectWord("null");
+            return Values::makeNull();
+        case '\0':
+            fail("Unexpected end of input");
         default:
-            throw ThrowException(CustomError("Unknown value type in JSON", "JsonError"));
+            if (peek() == '-' || (peek() >= '0' && peek() <= '9')) return parseNumber();
+            fail(std::string("Unexpected '") + peek() + "'");
     }
 }
 
 Values::Val JSONParser::parseObject()
 {
-    eat();
-    std::shared_ptr<Values::ObjectVal> o = std::make_shared<Values::ObjectVal>();
-    if (tokens[0].type == TokenType::ClosedBrace)
+    next();
+    Values::Ref<Values::ObjectVal> object = Values::make<Values::ObjectVal>();
+
+    skipWhitespace();
+    if (peek() == '}')
+    {
+        next();
+        return object;
+    }
+
+    while (true)
     {
-        eat();
-        return std::make_shared<Values::ObjectVal>();
+        skipWhitespace();
+        if (peek() != '"') fail("Expected object key to be of type string");
+
+        std::string key = parseString();
+        expect(':');
+        object->properties.computed(key) = parseValue();
+
+        skipWhitespace();
+        if (peek() == '}')
+        {
+            next();
+            return object;
+        }
+
+        expect(',');
     }
+}
+
+Values::Val JSONParser::parseArray()
+{
+    next();
+    std::vector<Values::Val> items;
 
-    if (tokens[0].type != TokenType::String)
+    skipWhitespace();
+    if (peek() == ']')
     {
-        throw ThrowException(CustomError("Expected object key to be of type string", "JsonError"));
+        next();
+        return Values::make<Values::ArrayVal>(items);
     }
-    std::string key = eat().val;
 
-    eat();
-    Values::Val val = parseValue();
-    o->properties[key] = val;
-    while (tokens[0].type != TokenType::ClosedBrace)
+    while (true)
     {
-        if (tokens[0].type != TokenType::Comma)
+        items.push_back(parseValue());
+
+        skipWhitespace();
+        if (peek() == ']')
         {
-            throw ThrowException(CustomError("Expected comma after object property", "JsonError"));
+            next();
+            return Values::make<Values::ArrayVal>(items);
         }
-        eat();
-        if (tokens[0].type != TokenType::String)
+
+        expect(',');
+    }
+}
+
+std::string JSONParser::parseString()
+{
+    next();
+    std::string out;
+
+    while (true)
+    {
+        if (pos >= data.size() && !refill()) fail("Expected end \" after string");
+
+        // Copy the run up to the next quote, escape or control character at once
+        size_t start = pos;
+        while (pos < data.size() && data[pos] != '"' && data[pos] != '\\' && static_cast<unsigned char>(data[pos]) >= 0x20) pos++;
+        out.append(data.substr(start, pos - start));
+        col += pos - start;
+
+        if (pos >= data.size()) continue;
+
+        char c = next();
+        if (c == '"') return out;
+        if (c != '\\') fail("Unescaped control character in string");
+
+        switch (char escape = next())
         {
-            throw ThrowException(CustomError("Expected object key to be of type string", "JsonError"));
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/': out += '/'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u':
+            {
+                uint32_t codePoint = parseHex4();
+
+                // A high surrogate has to be followed by an escaped low surrogate
+                if (codePoint >= 0xD800 && codePoint <= 0xDBFF)
+                {
+                    if (next() != '\\' || next() != 'u') fail("Expected low surrogate after high surrogate");
+                    uint32_t low = parseHex4();
+                    if (low < 0xDC00 || low > 0xDFFF) fail("Invalid low surrogate");
+                    codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                }
+
+                appendCodePoint(out, codePoint);
+                break;
+            }
+            default:
+                fail(std::string("Invalid escape '\\") + escape + "'");
         }
-        std::string key = eat().val;
-        eat();
-        Values::Val val = parseValue();
-        o->properties[key] = val;
+    }
+}
+
+uint32_t JSONParser::parseHex4()
+{
+    uint32_t value = 0;
+
+    for (int i = 0; i < 4; i++)
+    {
+        char c = next();
+        value <<= 4;
+
+        if (c >= '0' && c <= '9') value |= c - '0';
+        else if (c >= 'a' && c <= 'f') value |= c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') value |= c - 'A' + 10;
+        else fail("Invalid \\u escape");
     }
 
-    eat();
-    return o;
+    return value;
 }
 
-Values::Val JSONParser::parseArray() {
-    eat();
-    std::vector<Values::Val> items;
-    items.push_back(parseValue());
-    while (!tokens.empty() && tokens[0].type == TokenType::Comma) {
-        eat();
-        items.push_back(parseValue());
+void JSONParser::appendCodePoint(std::string& out, uint32_t codePoint)
+{
+    if (codePoint < 0x80)
+    {
+        out += static_cast<char>(codePoint);
+    }
+    else if (codePoint < 0x800)
+    {
+        out += static_cast<char>(0xC0 | (codePoint >> 6));
+        out += static_cast<char>(0x80 | (codePoint & 0x3F));
     }
+    else if (codePoint < 0x10000)
+    {
+        out += static_cast<char>(0xE0 | (codePoint >> 12));
+        out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (codePoint & 0x3F));
+    }
+    else
+    {
+        out += static_cast<char>(0xF0 | (codePoint >> 18));
+        out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (codePoint & 0x3F));
+    }
+}
+
+// -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+Values::Val JSONParser::parseNumber()
+{
+    std::string number;
+    auto digits = [&]()
+    {
+        if (peek() < '0' || peek() > '9') fail("Expected digit in number");
+        while (peek() >= '0' && peek() <= '9') number += next();
+    };
 
-    if (tokens[0].type != TokenType::CloseBracket) {
-        throw ThrowException(CustomError("Expected closing bracket after array", "JsonError"));
+    if (peek() == '-') number += next();
+
+    if (peek() == '0') number += next();
+    else digits();
+
+    if (peek() == '.')
+    {
+        number += next();
+        digits();
+    }
+
+    if (peek() == 'e' || peek() == 'E')
+    {
+        number += next();
+        if (peek() == '+' || peek() == '-') number += next();
+        digits();
     }
-    eat();
 
-    return std::make_shared<Values::ArrayVal>(items);
+    return Values::makeNumber(std::strtod(number.c_str(), nullptr));
 }
 
 Values::Val JSON::getValJsonModule()
 {
     return
-    std::make_shared<Values::ObjectVal>(std::unordered_map<std::string, Values::Val>({
+    Values::make<Values::ObjectVal>(std::unordered_map<std::string, Values::Val>({
         {
             "parse",
-            std::make_shared<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
+            Values::make<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
             {
-                if (args.empty() || args[0]->type != Values::ValueType::String) throw ThrowException(ArgumentError("Usage: json.parse(input: str)"));
+                if (args.empty() || args[0].type() != Values::ValueType::String) throw ThrowException(ArgumentError("Usage: json.parse(input: str)"));
 
-                JSON::JSONParser parser(std::static_pointer_cast<Values::StringVal>(args[0])->string, env);
+                JSON::JSONParser parser(Values::cast<Values::StringVal>(args[0])->string, env);
                 return parser.parse();
             })
         },
+        {
+            "parse_stream",
+            Values::make<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
+            {
+                if (args.size() < 2 || args[0].type() != Values::ValueType::String || args[1].type() != Values::ValueType::Function)
+                    throw ThrowException(ArgumentError("Usage: json.parse_stream(path: str, callback: function)"));
+
+                fs::path filePath = g_currentCwd / fs::path(Values::cast<Values::StringVal>(args[0])->string);
+                std::ifstream file(filePath, std::ios::binary);
+                if (!file.is_open()) throw ThrowException(ArgumentError("Failed to open file: " + filePath.string()));
+
+                Values::Val callback = args[1];
+                JSON::JSONParser parser(file, env);
+                parser.parseStream([&](Values::Val item)
+                {
+                    Interpreter::evalCallWithFnVal(callback, { item }, env);
+                });
+
+                return Values::makeUndefined();
+            })
+        },
         {
             "to_string",
-            std::make_shared<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
+            Values::make<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
             {
                 if (args.empty()) throw ThrowException(ArgumentError("Usage: json.to_string(object)"));
-                return std::make_shared<Values::StringVal>(args[0]->toJSON());
+                return Values::make<Values::StringVal>(args[0].toJSON());
             })
         }
     }));
@@ -224,6 +376,10 @@ Typechecker::TypePtr JSON::getTypeJsonModule()
             "parse",
             std::make_shared<Typechecker::Type>(Typechecker::TypeKind::Function, "function", std::make_shared<Typechecker::TypeVal>(std::vector({ std::make_shared<Typechecker::Parameter>("raw", Typechecker::g_strty, false) })))
         },
+        {
+            "parse_stream",
+            std::make_shared<Typechecker::Type>(Typechecker::TypeKind::Function, "function", std::make_shared<Typechecker::TypeVal>(std::vector({ std::make_shared<Typechecker::Parameter>("path", Typechecker::g_strty, false), std::make_shared<Typechecker::Parameter>("callback", Typechecker::g_anyty, false) })))
+        },
         {
             "to_string",
             std::make_shared<Typechecker::Type>(Typechecker::TypeKind::Function, "function", std::make_shared<Typechecker::TypeVal>(std::vector({ std::make_shared<Typechecker::Parameter>("value", Typechecker::g_anyty, false) })))
@@ -1,5 +1,10 @@
 #pragma once
 
+#include <functional>
+#include <istream>
+#include <string>
+#include <string_view>
+
 #include "core/runtime/values.hpp"
 #include "core/env.hpp"
 #include "core/utils.hpp"
@@ -9,64 +14,75 @@
 namespace Probescript::Stdlib::JSON
 {
 
-enum TokenType
-{
-    String,
-    OpenBrace,
-    ClosedBrace,
-    Number,
-    Colon,
-    Comma,
-    Boolean,
-    OpenBracket,
-    CloseBracket,
-};
-
-struct Token
-{
-    std::string val;
-    TokenType type;
-
-    Token(std::string v, TokenType t)
-        : val(v), type(t) {}
-};
-
+// Single pass recursive descent parser. Values are built directly from the input, which is either
+// a string held by the caller or a stream read in fixed size chunks
 class JSONParser
 {
 public:
-    JSONParser(std::string& file, EnvPtr env = std::make_shared<Env>()) : file(file), env(env) {}
+    JSONParser(std::string_view input, EnvPtr env = std::make_shared<Env>()) : env(env), data(input) {}
+    JSONParser(std::istream& stream, EnvPtr env = std::make_shared<Env>()) : env(env), stream(&stream) {}
+
+    // Parses one document, anything but whitespace after it is an error
     Values::Val parse();
 
+    // Parses a document that is a top level array, handing each element to `onItem` as soon as it is complete
+    // instead of collecting them
+    void parseStream(const std::function<void(Values::Val)>& onItem);
+
 private:
+    static constexpr size_t ChunkSize = 64 * 1024;
+    static constexpr int MaxDepth = 1000;
+
     EnvPtr env;
-    std::string& file;
-    std::vector<Token> tokens;
-    bool tokenize();
+    std::istream* stream = nullptr;
+    std::string buffer;
+    std::string_view data;
+    size_t pos = 0;
 
-    inline bool skippable(std::string& s) {
-        return (s == " " || s == "" || s == "\n" || s == "\t" || s == "\r");
-    }
+    int line = 1;
+    int col = 1;
+    // Arrays and objects currently open
+    int depth = 0;
+
+    bool refill();
 
-    inline bool isInt(const std::string& str) {
-        return str.length() == 1 && isdigit(str[0]);
+    inline char peek()
+    {
+        if (pos >= data.size() && !refill()) return '\0';
+        return data[pos];
     }
 
-    inline Values::Val parseTokens() {
-        return parseValue();
+    inline char next()
+    {
+        char c = peek();
+        if (c == '\0') return c;
+
+        pos++;
+        if (c == '\n')
+        {
+            line++;
+            col = 1;
+        }
+        else col++;
+
+        return c;
     }
-    
+
+    void skipWhitespace();
+    void expect(char c);
+    void expectWord(const char* word);
+    [[noreturn]] void fail(const std::string& message);
+
     Values::Val parseValue();
-    
     Values::Val parseObject();
-
     Values::Val parseArray();
-
-    inline Token eat() {
-        return shift(tokens);
-    }
+    std::string parseString();
+    Values::Val parseNumber();
+    void appendCodePoint(std::string& out, uint32_t codePoint);
+    uint32_t parseHex4();
 };
 
 Values::Val getValJsonModule();
 Typechecker::TypePtr getTypeJsonModule();
 
-} // namespace Probescript::Stdlib::JSON
\ No newline at end of file
+} // namespace Probescript::Stdlib::JSON
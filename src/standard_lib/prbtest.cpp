@@ -8,28 +8,28 @@ std::vector<TestCase> g_tests = {};
 
 Values::Val Prbtest::getValTestLib()
 {
-    return std::make_shared<Values::ObjectVal>(std::unordered_map<std::string, Values::Val>(
+    return Values::make<Values::ObjectVal>(std::unordered_map<std::string, Values::Val>(
     {
         {
             "assert",
-            std::make_shared<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
+            Values::make<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
             {
                 if (args.empty()) throw ThrowException(ArgumentError("Usage: assert(expression, message?: str)"));
-                if (!args[0]->toBool()) throw ThrowException(CustomError(args.size() < 2 ? "Assertion failed" : args[1]->toString(), "AssertError"));
-                return std::make_shared<Values::UndefinedVal>();
+                if (!args[0].toBool()) throw ThrowException(CustomError(args.size() < 2 ? "Assertion failed" : args[1].toString(), "AssertError"));
+                return Values::makeUndefined();
             })
         },
         {
             "test",
-            std::make_shared<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
+            Values::make<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
             {
                 if (args.size() < 2) throw ThrowException(ArgumentError("Usage: test(name: str, fn: function)"));
-                g_tests.push_back(TestCase(args[0]->toString(), [args]()
+                g_tests.push_back(TestCase(args[0].toString(), [args]()
                 {
                     Interpreter::evalCallWithFnVal(args[1], {}, std::make_shared<Env>());
                 }));
 
-                return std::make_shared<Values::UndefinedVal>();
+                return Values::makeUndefined();
             })
         }
     }));
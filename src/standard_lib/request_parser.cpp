@@ -0,0 +1,455 @@
+#include <algorithm>
+#include <cstring>
+
+#include "request_parser.hpp"
+#include "http.hpp"
+
+using namespace Probescript::Stdlib::Http;
+
+namespace
+{
+
+// A chunk size line is a hex number with optional extensions, anything longer is not worth waiting for
+constexpr size_t MaxChunkLine = 4096;
+// A decoded body buffer past this is given back when the next request starts
+constexpr size_t KeptBodyCapacity = 64 * 1024;
+
+bool isTokenChar(unsigned char c)
+{
+    if (c >= '0' && c <= '9') return true;
+    if ((c | 0x20) >= 'a' && (c | 0x20) <= 'z') return true;
+    return c != 0 && std::strchr("!#$%&'*+-.^_`|~", c) != nullptr;
+}
+
+bool isToken(std::string_view text)
+{
+    return !text.empty() && std::all_of(text.begin(), text.end(), [](char c) { return isTokenChar(static_cast<unsigned char>(c)); });
+}
+
+std::string_view trimSpace(std::string_view text)
+{
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) text.remove_prefix(1);
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t')) text.remove_suffix(1);
+    return text;
+}
+
+// Digits only, and nothing that could overflow
+bool parseLength(std::string_view text, size_t& out)
+{
+    if (text.empty() || text.size() > 18) return false;
+
+    out = 0;
+    for (char c : text)
+    {
+        if (c < '0' || c > '9') return false;
+        out = out * 10 + (c - '0');
+    }
+
+    return true;
+}
+
+bool hasToken(std::string_view list, std::string_view token)
+{
+    while (!list.empty())
+    {
+        size_t comma = list.find(',');
+        if (equalsIgnoreCase(trimSpace(list.substr(0, comma)), token)) return true;
+        if (comma == std::string_view::npos) break;
+        list.remove_prefix(comma + 1);
+    }
+
+    return false;
+}
+
+} // namespace
+
+RequestParser::RequestParser() : RequestParser(Limits()) {}
+
+RequestParser::RequestParser(Limits limits) : m_limits(limits)
+{
+    m_headers.reserve(16);
+}
+
+void RequestParser::reset()
+{
+    m_input = {};
+    m_step = Step::RequestLine;
+    m_pos = 0;
+    m_scan = 0;
+    m_error = 0;
+    m_requestStart = 0;
+    m_method = m_target = m_head = m_body = {};
+    m_minorVersion = 1;
+    m_headers.clear();
+    m_chunked = false;
+    m_chunkLeft = 0;
+    m_trailerStart = 0;
+
+    m_decoded.clear();
+    if (m_decoded.capacity() > KeptBodyCapacity) std::string().swap(m_decoded);
+}
+
+RequestParser::State RequestParser::fail(int status)
+{
+    m_error = status;
+    return State::Error;
+}
+
+// The next line without its line ending, a bare \n is taken as well as \r\n
+bool RequestParser::nextLine(std::string_view& line)
+{
+    const void* found = m_scan < m_input.size() ? std::memchr(m_input.data() + m_scan, '\n', m_input.size() - m_scan) : nullptr;
+
+    if (!found)
+    {
+        m_scan = m_input.size();
+        return false;
+    }
+
+    size_t end = static_cast<const char*>(found) - m_input.data();
+    line = m_input.substr(m_pos, end - m_pos);
+    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+
+    m_pos = m_scan = end + 1;
+    return true;
+}
+
+RequestParser::State RequestParser::parse(std::string_view input)
+{
+    if (m_error) return State::Error;
+    m_input = input;
+
+    while (true)
+    {
+        std::string_view line;
+
+        switch (m_step)
+        {
+            case Step::RequestLine:
+            case Step::Headers:
+            {
+                // Blank lines skipped before the request count as well
+                if (!nextLine(line))
+                {
+                    if (m_scan > m_limits.maxHeaderSize) return fail(431);
+                    return State::Incomplete;
+                }
+
+                if (m_pos > m_limits.maxHeaderSize) return fail(431);
+
+                if (m_step == Step::RequestLine)
+                {
+                    // Empty lines before a request are skipped, some clients send one after a body
+                    if (line.empty())
+                    {
+                        m_requestStart = m_pos;
+                        break;
+                    }
+
+                    if (!parseRequestLine(line)) return fail(400);
+                    m_step = Step::Headers;
+                    break;
+                }
+
+                if (line.empty())
+                {
+                    m_head = { m_requestStart, static_cast<size_t>(line.data() - m_input.data()) - m_requestStart };
+                    while (m_head.length > 0 && (m_input[m_head.offset + m_head.length - 1] == '\n' || m_input[m_head.offset + m_head.length - 1] == '\r')) m_head.length--;
+
+                    if (!startBody()) return State::Error;
+                    break;
+                }
+
+                if (m_headers.size() >= m_limits.maxHeaders) return fail(431);
+                if (!parseHeader(line)) return fail(400);
+                break;
+            }
+
+            case Step::Body:
+            {
+                if (m_input.size() - m_body.offset < m_body.length) return State::Incomplete;
+
+                m_pos = m_scan = m_body.offset + m_body.length;
+                m_step = Step::Done;
+                break;
+            }
+
+            case Step::ChunkSize:
+            {
+                size_t lineStart = m_pos;
+                if (!nextLine(line))
+                {
+                    if (m_scan - m_pos > MaxChunkLine) return fail(400);
+                    return State::Incomplete;
+                }
+
+                if (m_pos - 1 - lineStart > MaxChunkLine) return fail(400);
+                if (!parseChunkSize(line)) return State::Error;
+                break;
+            }
+
+            case Step::ChunkData:
+            {
+                size_t take = std::min(m_chunkLeft, m_input.size() - m_pos);
+                m_decoded.append(m_input.data() + m_pos, take);
+                m_pos = m_scan = m_pos + take;
+                m_chunkLeft -= take;
+
+                if (m_chunkLeft > 0) return State::Incomplete;
+                m_step = Step::ChunkEnd;
+                break;
+            }
+
+            case Step::ChunkEnd:
+            {
+                if (m_pos >= m_input.size()) return State::Incomplete;
+
+                if (m_input[m_pos] == '\r')
+                {
+                    if (m_pos + 1 >= m_input.size()) return State::Incomplete;
+                    if (m_input[m_pos + 1] != '\n') return fail(400);
+                    m_pos++;
+                }
+                else if (m_input[m_pos] != '\n')
+                {
+                    return fail(400);
+                }
+
+                m_pos = m_scan = m_pos + 1;
+                m_step = Step::ChunkSize;
+                break;
+            }
+
+            // Trailer fields are read past and dropped
+            case Step::Trailers:
+            {
+                if (!nextLine(line))
+                {
+                    if (m_scan - m_trailerStart > m_limits.maxHeaderSize) return fail(431);
+                    return State::Incomplete;
+                }
+
+                if (m_pos - m_trailerStart > m_limits.maxHeaderSize) return fail(431);
+                if (line.empty()) m_step = Step::Done;
+                break;
+            }
+
+            case Step::Done:
+                return State::Complete;
+        }
+    }
+}
+
+// METHOD SP target SP HTTP/1.x, with exactly one space between each
+bool RequestParser::parseRequestLine(std::string_view line)
+{
+    size_t first = line.find(' ');
+    if (first == std::string_view::npos) return false;
+
+    size_t second = line.find(' ', first + 1);
+    if (second == std::string_view::npos) return false;
+
+    std::string_view method = line.substr(0, first);
+    std::string_view target = line.substr(first + 1, second - first - 1);
+    std::string_view version = line.substr(second + 1);
+
+    if (!isToken(method) || target.empty()) return false;
+    for (char c : target)
+    {
+        if (static_cast<unsigned char>(c) <= ' ' || c == 0x7f) return false;
+    }
+
+    if (version.size() != 8 || version.compare(0, 7, "HTTP/1.") != 0 || version[7] < '0' || version[7] > '9') return false;
+
+    m_method = span(method);
+    m_target = span(target);
+    m_minorVersion = version[7] - '0';
+    return true;
+}
+
+bool RequestParser::parseHeader(std::string_view line)
+{
+    // Folded continuation lines are obsolete and a smuggling risk
+    if (line.front() == ' ' || line.front() == '\t') return false;
+
+    size_t colon = line.find(':');
+    if (colon == std::string_view::npos) return false;
+
+    std::string_view name = line.substr(0, colon);
+    if (!isToken(name)) return false;
+
+    std::string_view value = trimSpace(line.substr(colon + 1));
+    for (char c : value)
+    {
+        if (c == '\r' || c == '\n' || c == 0) return false;
+    }
+
+    m_headers.emplace_back(span(name), span(value));
+    return true;
+}
+
+bool RequestParser::startBody()
+{
+    bool encodingGiven = false;
+    size_t codings = 0;
+    bool chunkedOnly = true;
+    bool lengthGiven = false;
+    size_t length = 0;
+
+    // Repeated Transfer-Encoding lines form one list, which has to be exactly chunked
+    for (const auto& [name, value] : m_headers)
+    {
+        if (!equalsIgnoreCase(view(name), "Transfer-Encoding")) continue;
+        encodingGiven = true;
+
+        std::string_view list = view(value);
+        while (true)
+        {
+            size_t comma = list.find(',');
+            std::string_view coding = trimSpace(list.substr(0, comma));
+
+            if (!coding.empty())
+            {
+                codings++;
+                if (!equalsIgnoreCase(coding, "chunked")) chunkedOnly = false;
+            }
+
+            if (comma == std::string_view::npos) break;
+            list.remove_prefix(comma + 1);
+        }
+    }
+
+    // Repeated Content-Length headers have to agree
+    for (const auto& [name, value] : m_headers)
+    {
+        if (!equalsIgnoreCase(view(name), "Content-Length")) continue;
+
+        size_t parsed;
+        if (!parseLength(view(value), parsed) || (lengthGiven && parsed != length))
+        {
+            fail(400);
+            return false;
+        }
+
+        length = parsed;
+        lengthGiven = true;
+    }
+
+    if (encodingGiven)
+    {
+        // Both framings at once is how requests get smuggled past proxies
+        if (lengthGiven)
+        {
+            fail(400);
+            return false;
+        }
+
+        if (codings != 1 || !chunkedOnly)
+        {
+            fail(501);
+            return false;
+        }
+
+        m_chunked = true;
+        m_step = Step::ChunkSize;
+        return true;
+    }
+
+    if (length > m_limits.maxBodySize)
+    {
+        fail(413);
+        return false;
+    }
+
+    m_body = { m_pos, length };
+    m_step = Step::Body;
+    return true;
+}
+
+bool RequestParser::parseChunkSize(std::string_view line)
+{
+    size_t size = 0;
+    size_t digits = 0;
+
+    for (; digits < line.size(); digits++)
+    {
+        char c = line[digits];
+        int value;
+        if (c >= '0' && c <= '9') value = c - '0';
+        else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f') value = (c | 0x20) - 'a' + 10;
+        else break;
+
+        if (size > (m_limits.maxBodySize >> 4) + 1)
+        {
+            fail(413);
+            return false;
+        }
+
+        size = size * 16 + value;
+    }
+
+    std::string_view rest = trimSpace(line.substr(digits));
+    if (digits == 0 || (!rest.empty() && rest.front() != ';'))
+    {
+        fail(400);
+        return false;
+    }
+
+    if (size > m_limits.maxBodySize - m_decoded.size())
+    {
+        fail(413);
+        return false;
+    }
+
+    if (size == 0)
+    {
+        m_trailerStart = m_pos;
+        m_step = Step::Trailers;
+        return true;
+    }
+
+    m_chunkLeft = size;
+    m_step = Step::ChunkData;
+    return true;
+}
+
+std::string_view RequestParser::path() const
+{
+    std::string_view target = this->target();
+    return target.substr(0, target.find('?'));
+}
+
+std::string_view RequestParser::query() const
+{
+    std::string_view target = this->target();
+    size_t mark = target.find('?');
+    return mark == std::string_view::npos ? std::string_view() : target.substr(mark + 1);
+}
+
+std::pair<std::string_view, std::string_view> RequestParser::header(size_t index) const
+{
+    return { view(m_headers[index].first), view(m_headers[index].second) };
+}
+
+std::optional<std::string_view> RequestParser::header(std::string_view name) const
+{
+    for (auto it = m_headers.rbegin(); it != m_headers.rend(); ++it)
+    {
+        if (equalsIgnoreCase(view(it->first), name)) return view(it->second);
+    }
+
+    return std::nullopt;
+}
+
+bool RequestParser::keepAlive() const
+{
+    std::optional<std::string_view> connection = header("Connection");
+    if (m_minorVersion >= 1) return !connection || !hasToken(*connection, "close");
+    return connection && hasToken(*connection, "keep-alive");
+}
+
+std::string_view RequestParser::body() const
+{
+    if (m_chunked) return m_decoded;
+    return view(m_body);
+}
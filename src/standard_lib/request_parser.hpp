@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace Probescript::Stdlib::Http
+{
+
+// Resumable HTTP/1.x request parser working on the connection's receive buffer. parse() is called again
+// whenever more bytes arrive and carries on where it stopped, so every byte is looked at once. The views it
+// hands out point into the buffer and stay valid until the caller drops the request from it
+class RequestParser
+{
+public:
+    enum class State
+    {
+        Incomplete,
+        Complete,
+        Error,
+    };
+
+    struct Limits
+    {
+        // Request line and headers together, and the chunk trailers on their own
+        size_t maxHeaderSize = 64 * 1024;
+        size_t maxHeaders = 100;
+        size_t maxBodySize = 16 * 1024 * 1024;
+    };
+
+    RequestParser();
+    explicit RequestParser(Limits limits);
+
+    // `input` starts at the request's first byte and holds everything received so far. The bytes given to an
+    // earlier call must still be there, unchanged
+    State parse(std::string_view input);
+
+    // Starts over for the next request, which begins at consumed() in the old input
+    void reset();
+
+    // Bytes of input the complete request took
+    size_t consumed() const { return m_pos; }
+    // Status to answer a request that could not be parsed with: 400, 413, 431 or 501
+    int error() const { return m_error; }
+
+    std::string_view method() const { return view(m_method); }
+    // The request target as sent, the path and the query
+    std::string_view target() const { return view(m_target); }
+    std::string_view path() const;
+    // What follows the ?, empty when there is none
+    std::string_view query() const;
+    // Request line and headers, up to the blank line
+    std::string_view head() const { return view(m_head); }
+    // 0 for HTTP/1.0, 1 for HTTP/1.1
+    int minorVersion() const { return m_minorVersion; }
+
+    size_t headerCount() const { return m_headers.size(); }
+    std::pair<std::string_view, std::string_view> header(size_t index) const;
+    // Names are case insensitive, the last one wins when a header repeats
+    std::optional<std::string_view> header(std::string_view name) const;
+
+    // HTTP/1.1 keeps the connection unless asked to close, HTTP/1.0 only when asked to keep it
+    bool keepAlive() const;
+    bool chunked() const { return m_chunked; }
+    // A chunked body is decoded into the parser, any other is a view of the input
+    std::string_view body() const;
+
+private:
+    struct Span
+    {
+        size_t offset = 0;
+        size_t length = 0;
+    };
+
+    enum class Step
+    {
+        RequestLine,
+        Headers,
+        Body,
+        ChunkSize,
+        ChunkData,
+        ChunkEnd,
+        Trailers,
+        Done,
+    };
+
+    Limits m_limits;
+    std::string_view m_input;
+
+    Step m_step = Step::RequestLine;
+    // Start of the unparsed input, and how far the search for the current line's end got
+    size_t m_pos = 0;
+    size_t m_scan = 0;
+    int m_error = 0;
+
+    size_t m_requestStart = 0;
+    Span m_method;
+    Span m_target;
+    Span m_head;
+    int m_minorVersion = 1;
+    std::vector<std::pair<Span, Span>> m_headers;
+
+    bool m_chunked = false;
+    Span m_body;
+    std::string m_decoded;
+    size_t m_chunkLeft = 0;
+    size_t m_trailerStart = 0;
+
+    std::string_view view(Span span) const { return m_input.substr(span.offset, span.length); }
+    Span span(std::string_view part) const { return { static_cast<size_t>(part.data() - m_input.data()), part.size() }; }
+
+    State fail(int status);
+    bool nextLine(std::string_view& line);
+
+    bool parseRequestLine(std::string_view line);
+    bool parseHeader(std::string_view line);
+    // Picks how the body is framed once the headers are in
+    bool startBody();
+    bool parseChunkSize(std::string_view line);
+};
+
+} // namespace Probescript::Stdlib::Http
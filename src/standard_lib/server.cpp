@@ -0,0 +1,717 @@
+#ifdef __linux__
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "server.hpp"
+
+using namespace Probescript;
+using namespace Probescript::Stdlib;
+using namespace Probescript::Stdlib::Http;
+
+namespace
+{
+
+constexpr size_t MaxHeaderSize = 64 * 1024;
+constexpr size_t MaxHeaders = 100;
+constexpr size_t ReadSize = 16 * 1024;
+// Pipelined input buffered while a request is being handled, reading pauses past it
+constexpr size_t MaxBuffered = 1024 * 1024;
+// Most bytes of a file handed to one sendfile call, the socket buffer usually fills long before
+constexpr size_t FileChunk = 4 * 1024 * 1024;
+// How often a thread that stopped accepting checks whether connections were freed elsewhere
+constexpr int PausedPollMs = 50;
+// How long accepting pauses after running out of descriptors, the listener would stay readable meanwhile
+constexpr auto DescriptorRetry = std::chrono::milliseconds(250);
+// Descriptors kept back from the connection limit, for the listener, epoll, files sent and outgoing requests
+constexpr size_t ReservedDescriptors = 64;
+
+// Runs handlers on a fixed number of threads, in the order they were queued
+class WorkerPool
+{
+public:
+    explicit WorkerPool(size_t size)
+    {
+        for (size_t i = 0; i < size; i++) m_threads.emplace_back([this]() { loop(); });
+    }
+
+    ~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+
+        m_wake.notify_all();
+        for (std::thread& thread : m_threads) thread.join();
+    }
+
+    void post(std::function<void()> job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_jobs.push_back(std::move(job));
+        }
+
+        m_wake.notify_one();
+    }
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::deque<std::function<void()>> m_jobs;
+    std::vector<std::thread> m_threads;
+    bool m_stopping = false;
+
+    void loop()
+    {
+        while (true)
+        {
+            std::function<void()> job;
+
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wake.wait(lock, [this]() { return m_stopping || !m_jobs.empty(); });
+                if (m_jobs.empty()) return;
+
+                job = std::move(m_jobs.front());
+                m_jobs.pop_front();
+            }
+
+            job();
+        }
+    }
+};
+
+class IoThread;
+
+using Clock = std::chrono::steady_clock;
+
+struct Connection
+{
+    int fd;
+    IoThread* owner;
+
+    // Only touched by the owning I/O thread
+    std::string in;
+    RequestParser parser;
+    uint32_t events = 0;
+    bool handling = false;
+    bool waitingWrite = false;
+    bool peerClosed = false;
+    size_t served = 0;
+    // Last byte read or written, and when the handler of the current request was started
+    Clock::time_point lastActive = Clock::now();
+    Clock::time_point handlingSince;
+
+    // Filled by the worker that answers, drained by the I/O thread. `request` counts the requests handled,
+    // so a late send for an earlier one is not taken as the answer to the next
+    std::mutex mutex;
+    std::string out;
+    size_t written = 0;
+    // Sent from the file with sendfile once `out`, the head, has been written
+    std::shared_ptr<FileBody> file;
+    uint64_t request = 0;
+    bool responded = false;
+    bool keepAlive = false;
+    bool closed = false;
+};
+
+using ConnectionPtr = std::shared_ptr<Connection>;
+
+struct Shared
+{
+    ServerOptions options;
+    Handler handler;
+    int listener;
+    WorkerPool workers;
+    std::atomic<size_t> connections { 0 };
+
+    Shared(const ServerOptions& options, Handler handler, int listener, size_t workers)
+        : options(options), handler(std::move(handler)), listener(listener), workers(workers) {}
+};
+
+// The Connection header is always the server's, it knows whether the socket stays open
+std::string formatHead(int status, uint64_t contentLength, const std::unordered_map<std::string, std::string>& headers, bool keepAlive)
+{
+    std::ostringstream response;
+    response << "HTTP/1.1 " << status << "\r\n"
+             << "Content-Length: " << contentLength << "\r\n"
+             << "Connection: " << (keepAlive ? "keep-alive" : "close") << "\r\n";
+
+    for (const auto& [key, val] : headers)
+    {
+        if (!equalsIgnoreCase(key, "Connection")) response << key << ": " << val << "\r\n";
+    }
+
+    response << "\r\n";
+    return response.str();
+}
+
+// One epoll instance with the connections it accepted. The first I/O thread runs on the caller of serve()
+class IoThread
+{
+public:
+    explicit IoThread(Shared& shared) : m_shared(shared)
+    {
+        m_epoll = epoll_create1(EPOLL_CLOEXEC);
+        m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+        if (m_epoll < 0 || m_wakeFd < 0) throw std::runtime_error(CustomError("Could not create the server's event queue", "HttpError"));
+
+        epoll_event event {};
+        event.events = EPOLLIN;
+        event.data.fd = m_wakeFd;
+        epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wakeFd, &event);
+
+        listen(true);
+    }
+
+    // Called by a worker once the connection has output to write
+    void wake(ConnectionPtr connection)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_pendingMutex);
+            m_pending.push_back(std::move(connection));
+        }
+
+        uint64_t one = 1;
+        while (write(m_wakeFd, &one, sizeof(one)) < 0 && errno == EINTR) {}
+    }
+
+    void run()
+    {
+        epoll_event events[256];
+
+        // Idle connections are closed, and slow handlers answered for, within a quarter of the timeout of going over it
+        auto sweepInterval = std::chrono::milliseconds(std::max<size_t>(1, std::min(m_shared.options.idleTimeout, m_shared.options.handlerTimeout) / 4));
+        Clock::time_point nextSweep = Clock::now() + sweepInterval;
+
+        while (true)
+        {
+            if (!m_listening && m_shared.connections.load() < m_shared.options.maxConnections && Clock::now() >= m_resumeAccept) listen(true);
+
+            int timeout = m_listening ? -1 : PausedPollMs;
+            if (!m_connections.empty())
+            {
+                auto untilSweep = std::chrono::duration_cast<std::chrono::milliseconds>(nextSweep - Clock::now()).count();
+                int sweep = static_cast<int>(std::max<long long>(0, untilSweep));
+                timeout = timeout < 0 ? sweep : std::min(timeout, sweep);
+            }
+
+            int count = epoll_wait(m_epoll, events, 256, timeout);
+
+            if (Clock::now() >= nextSweep)
+            {
+                closeIdle();
+                nextSweep = Clock::now() + sweepInterval;
+            }
+
+            for (int i = 0; i < count; i++)
+            {
+                int fd = events[i].data.fd;
+
+                if (fd == m_shared.listener)
+                {
+                    acceptAll();
+                    continue;
+                }
+
+                if (fd == m_wakeFd)
+                {
+                    drainPending();
+                    continue;
+                }
+
+                auto found = m_connections.find(fd);
+                if (found == m_connections.end()) continue;
+
+                ConnectionPtr connection = found->second;
+
+                if (events[i].events & (EPOLLERR | EPOLLHUP))
+                {
+                    close(connection);
+                    continue;
+                }
+
+                if (events[i].events & (EPOLLIN | EPOLLRDHUP)) readFrom(connection);
+                if (events[i].events & EPOLLOUT) flush(connection);
+            }
+        }
+    }
+
+private:
+    Shared& m_shared;
+    int m_epoll;
+    int m_wakeFd;
+    bool m_listening = false;
+    // Accepting stays paused until then after the process ran out of descriptors
+    Clock::time_point m_resumeAccept;
+
+    std::unordered_map<int, ConnectionPtr> m_connections;
+
+    std::mutex m_pendingMutex;
+    std::vector<ConnectionPtr> m_pending;
+
+    // Every I/O thread watches the listener, EPOLLEXCLUSIVE wakes only one of them per connection
+    void listen(bool enable)
+    {
+        if (enable == m_listening) return;
+
+        epoll_event event {};
+        event.events = EPOLLIN | EPOLLEXCLUSIVE;
+        event.data.fd = m_shared.listener;
+
+        epoll_ctl(m_epoll, enable ? EPOLL_CTL_ADD : EPOLL_CTL_DEL, m_shared.listener, enable ? &event : nullptr);
+        m_listening = enable;
+    }
+
+    // Takes a slot under the connection limit, false when the server is full
+    bool reserve()
+    {
+        size_t current = m_shared.connections.load();
+        while (current < m_shared.options.maxConnections)
+        {
+            if (m_shared.connections.compare_exchange_weak(current, current + 1)) return true;
+        }
+
+        return false;
+    }
+
+    void acceptAll()
+    {
+        while (true)
+        {
+            // Full: leave the rest in the kernel backlog until a connection closes
+            if (!reserve())
+            {
+                listen(false);
+                return;
+            }
+
+            int fd = accept4(m_shared.listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0)
+            {
+                m_shared.connections--;
+
+                if (errno == EINTR || errno == ECONNABORTED) continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK) return;
+
+                // Out of descriptors or memory. The pending connection stays queued and the listener readable, so
+                // accepting pauses instead of waking for it over and over
+                listen(false);
+                m_resumeAccept = Clock::now() + DescriptorRetry;
+                return;
+            }
+
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+            auto connection = std::make_shared<Connection>();
+            connection->fd = fd;
+            connection->parser = RequestParser({ MaxHeaderSize, MaxHeaders, m_shared.options.maxBodySize });
+            connection->owner = this;
+            connection->events = EPOLLIN | EPOLLRDHUP;
+            m_connections.emplace(fd, connection);
+
+            epoll_event event {};
+            event.events = connection->events;
+            event.data.fd = fd;
+            epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &event);
+        }
+    }
+
+    // Reads while there is room for input, writes while output is stuck in a full socket buffer
+    void updateEvents(const ConnectionPtr& connection)
+    {
+        uint32_t events = 0;
+        if (!connection->peerClosed && (!connection->handling || connection->in.size() < MaxBuffered)) events |= EPOLLIN | EPOLLRDHUP;
+        if (connection->waitingWrite) events |= EPOLLOUT;
+
+        if (events == connection->events) return;
+
+        epoll_event event {};
+        event.events = events;
+        event.data.fd = connection->fd;
+        epoll_ctl(m_epoll, EPOLL_CTL_MOD, connection->fd, &event);
+        connection->events = events;
+    }
+
+    // Closes connections that waited too long for a request or for the client to take a response, and answers
+    // for handlers that take too long. The handler keeps running, what it sends later is dropped
+    void closeIdle()
+    {
+        Clock::time_point now = Clock::now();
+        Clock::time_point idleLimit = now - std::chrono::milliseconds(m_shared.options.idleTimeout);
+        Clock::time_point handlerLimit = now - std::chrono::milliseconds(m_shared.options.handlerTimeout);
+
+        std::vector<ConnectionPtr> idle;
+        std::vector<ConnectionPtr> slow;
+        for (const auto& [fd, connection] : m_connections)
+        {
+            if (!connection->handling)
+            {
+                if (connection->lastActive < idleLimit) idle.push_back(connection);
+                continue;
+            }
+
+            bool responded;
+            {
+                std::lock_guard<std::mutex> lock(connection->mutex);
+                responded = connection->responded;
+            }
+
+            if (responded && connection->lastActive < idleLimit) idle.push_back(connection);
+            else if (!responded && connection->handlingSince < handlerLimit) slow.push_back(connection);
+        }
+
+        for (const ConnectionPtr& connection : idle) close(connection);
+
+        for (const ConnectionPtr& connection : slow)
+        {
+            uint64_t id;
+            {
+                std::lock_guard<std::mutex> lock(connection->mutex);
+                connection->keepAlive = false;
+                id = connection->request;
+            }
+
+            respond(connection, id, 503, "Service Unavailable", {});
+        }
+    }
+
+    void drainPending()
+    {
+        uint64_t value;
+        while (read(m_wakeFd, &value, sizeof(value)) > 0) {}
+
+        std::vector<ConnectionPtr> pending;
+        {
+            std::lock_guard<std::mutex> lock(m_pendingMutex);
+            pending.swap(m_pending);
+        }
+
+        for (const ConnectionPtr& connection : pending) flush(connection);
+    }
+
+    void readFrom(const ConnectionPtr& connection)
+    {
+        char buffer[ReadSize];
+
+        while (!connection->handling || connection->in.size() < MaxBuffered)
+        {
+            ssize_t bytes = recv(connection->fd, buffer, sizeof(buffer), 0);
+
+            if (bytes > 0)
+            {
+                connection->in.append(buffer, bytes);
+                connection->lastActive = Clock::now();
+                continue;
+            }
+
+            if (bytes < 0 && errno == EINTR) continue;
+            if (bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+
+            // The peer closed its side, requests it already sent still get their answers
+            connection->peerClosed = true;
+            break;
+        }
+
+        advance(connection);
+    }
+
+    // Starts the next buffered request if the connection is free, and closes it once nothing more can arrive
+    void advance(const ConnectionPtr& connection)
+    {
+        parse(connection);
+
+        if (connection->peerClosed && !connection->handling)
+        {
+            close(connection);
+            return;
+        }
+
+        updateEvents(connection);
+    }
+
+    // Picks up where the last read left the parser, the handler runs once the whole body is in
+    void parse(const ConnectionPtr& connection)
+    {
+        if (connection->handling) return;
+
+        RequestParser& parser = connection->parser;
+        RequestParser::State state = parser.parse(connection->in);
+
+        if (state == RequestParser::State::Incomplete) return;
+
+        if (state == RequestParser::State::Error)
+        {
+            reject(connection, parser.error());
+            return;
+        }
+
+        std::shared_ptr<Request> request = makeRequest(parser);
+        std::string body(parser.body());
+        bool keepAlive = parser.keepAlive() && connection->served + 1 < m_shared.options.maxRequests;
+
+        connection->in.erase(0, parser.consumed());
+        parser.reset();
+
+        connection->handling = true;
+        connection->handlingSince = Clock::now();
+        dispatch(connection, request, std::move(body), keepAlive);
+    }
+
+    void dispatch(const ConnectionPtr& connection, std::shared_ptr<Request> request, std::string body, bool keepAlive)
+    {
+        uint64_t id;
+        {
+            std::lock_guard<std::mutex> lock(connection->mutex);
+            connection->keepAlive = keepAlive;
+            id = connection->request;
+        }
+
+        auto response = std::make_shared<Response>();
+        response->send = [connection, id](std::string body, std::unordered_map<std::string, std::string> headers)
+        {
+            respond(connection, id, 200, body, headers);
+        };
+
+        response->sendFile = [connection, id](FileReply reply)
+        {
+            respond(connection, id, reply.status, "", reply.headers, reply.contentLength, std::move(reply.body));
+        };
+
+        Handler& handler = m_shared.handler;
+        m_shared.workers.post([&handler, connection, id, request, response, body = std::move(body)]()
+        {
+            try
+            {
+                handler(request, response);
+                if (!body.empty() && request->ondata) request->ondata(body);
+                if (request->end) request->end();
+            }
+            catch (const std::exception& err)
+            {
+                std::cerr << err.what() << "\n";
+                respond(connection, id, 500, "Internal Server Error", {});
+            }
+        });
+    }
+
+    // Queues the one response to request `id`, later ones are dropped. A file, if given, follows the head in
+    // place of `body` and `contentLength` is its length
+    static void respond(const ConnectionPtr& connection, uint64_t id, int status, const std::string& body, const std::unordered_map<std::string, std::string>& headers,
+        uint64_t contentLength = 0, std::shared_ptr<FileBody> file = nullptr)
+    {
+        {
+            std::lock_guard<std::mutex> lock(connection->mutex);
+            if (connection->responded || connection->closed || connection->request != id) return;
+
+            const std::string* requested = findHeader(headers, "Connection");
+            if (requested && equalsIgnoreCase(*requested, "close")) connection->keepAlive = false;
+
+            connection->out = formatHead(status, body.empty() ? contentLength : body.size(), headers, connection->keepAlive) + body;
+            connection->file = std::move(file);
+            connection->responded = true;
+        }
+
+        connection->owner->wake(connection);
+    }
+
+    // Answers a request that could not be parsed, the rest of the input cannot be trusted so the connection closes
+    void reject(const ConnectionPtr& connection, int status)
+    {
+        connection->handling = true;
+
+        uint64_t id;
+        {
+            std::lock_guard<std::mutex> lock(connection->mutex);
+            connection->keepAlive = false;
+            id = connection->request;
+        }
+
+        respond(connection, id, status, "", {});
+    }
+
+    void flush(const ConnectionPtr& connection)
+    {
+        std::unique_lock<std::mutex> lock(connection->mutex);
+        if (connection->closed) return;
+
+        while (connection->written < connection->out.size())
+        {
+            ssize_t bytes = send(connection->fd, connection->out.data() + connection->written, connection->out.size() - connection->written, MSG_NOSIGNAL);
+
+            if (bytes > 0)
+            {
+                connection->written += bytes;
+                connection->lastActive = Clock::now();
+                continue;
+            }
+
+            if (bytes < 0 && errno == EINTR) continue;
+
+            if (bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            {
+                lock.unlock();
+                connection->waitingWrite = true;
+                updateEvents(connection);
+                return;
+            }
+
+            // The peer is gone
+            lock.unlock();
+            close(connection);
+            return;
+        }
+
+        while (connection->file && connection->file->length > 0)
+        {
+            FileBody& file = *connection->file;
+            off_t offset = static_cast<off_t>(file.offset);
+            ssize_t bytes = sendfile(connection->fd, file.fd, &offset, std::min<uint64_t>(file.length, FileChunk));
+
+            if (bytes > 0)
+            {
+                file.offset += bytes;
+                file.length -= bytes;
+                connection->lastActive = Clock::now();
+                continue;
+            }
+
+            if (bytes < 0 && errno == EINTR) continue;
+
+            if (bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            {
+                lock.unlock();
+                connection->waitingWrite = true;
+                updateEvents(connection);
+                return;
+            }
+
+            // The peer is gone, or the file shrank and the promised length can no longer be kept
+            lock.unlock();
+            close(connection);
+            return;
+        }
+
+        if (!connection->responded) return;
+
+        if (!connection->keepAlive)
+        {
+            lock.unlock();
+            close(connection);
+            return;
+        }
+
+        connection->out.clear();
+        connection->written = 0;
+        connection->file.reset();
+        connection->responded = false;
+        connection->request++;
+        lock.unlock();
+
+        connection->handling = false;
+        connection->waitingWrite = false;
+        connection->served++;
+        connection->lastActive = Clock::now();
+
+        // Pipelined requests are answered in the order they arrived, one at a time
+        advance(connection);
+    }
+
+    void close(const ConnectionPtr& connection)
+    {
+        {
+            std::lock_guard<std::mutex> lock(connection->mutex);
+            if (connection->closed) return;
+            connection->closed = true;
+            connection->file.reset();
+        }
+
+        epoll_ctl(m_epoll, EPOLL_CTL_DEL, connection->fd, nullptr);
+        ::close(connection->fd);
+        m_connections.erase(connection->fd);
+        m_shared.connections--;
+    }
+};
+
+} // namespace
+
+void Http::serve(const ServerOptions& requested, Handler handler)
+{
+    ServerOptions options = requested;
+
+    // The usual soft limit of 1024 descriptors is far below the default connection limit
+    rlimit files {};
+    if (getrlimit(RLIMIT_NOFILE, &files) == 0)
+    {
+        if (files.rlim_cur < files.rlim_max)
+        {
+            files.rlim_cur = files.rlim_max;
+            setrlimit(RLIMIT_NOFILE, &files);
+            getrlimit(RLIMIT_NOFILE, &files);
+        }
+
+        // Connections past what the process may open would only fail to be accepted
+        if (files.rlim_cur != RLIM_INFINITY)
+        {
+            size_t usable = files.rlim_cur > ReservedDescriptors * 2 ? files.rlim_cur - ReservedDescriptors : files.rlim_cur / 2;
+            options.maxConnections = std::max<size_t>(1, std::min(options.maxConnections, usable));
+        }
+    }
+
+    int listener = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listener < 0) throw std::runtime_error(CustomError("Socket creation failed", "HttpError"));
+
+    int one = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in address {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(options.port);
+    address.sin_addr.s_addr = INADDR_ANY;
+
+    if (bind(listener, (sockaddr*)&address, sizeof(address)) < 0)
+    {
+        ::close(listener);
+        throw std::runtime_error(CustomError("Bind failed", "HttpError"));
+    }
+
+    if (::listen(listener, options.backlog > 0 ? options.backlog : SOMAXCONN) < 0)
+    {
+        ::close(listener);
+        throw std::runtime_error(CustomError("Listen failed", "HttpError"));
+    }
+
+    size_t workers = options.workers ? options.workers : std::max(1u, std::thread::hardware_concurrency());
+    Shared shared(options, std::move(handler), listener, workers);
+
+    std::vector<std::unique_ptr<IoThread>> ioThreads;
+    for (size_t i = 0; i < std::max<size_t>(1, options.ioThreads); i++) ioThreads.push_back(std::make_unique<IoThread>(shared));
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < ioThreads.size(); i++) threads.emplace_back([&ioThreads, i]() { ioThreads[i]->run(); });
+
+    ioThreads[0]->run();
+}
+
+#endif
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+
+#include "http.hpp"
+
+namespace Probescript::Stdlib::Http
+{
+
+// Settings of http.Serve, read from its optional third argument
+struct ServerOptions
+{
+    int port = 0;
+    // Connections the kernel queues before they are accepted, 0 for the system maximum
+    int backlog = 0;
+    // Past this many open connections the server stops accepting until one closes. Lowered to what the
+    // descriptor limit allows
+    size_t maxConnections = 10000;
+    // Threads running the handlers, 0 for one per hardware thread
+    size_t workers = 0;
+    // Threads doing the non-blocking socket I/O
+    size_t ioThreads = 1;
+    // Milliseconds a kept-alive connection may sit without a request, or a response go without the client
+    // reading any of it, before it is closed
+    size_t idleTimeout = 5000;
+    // Milliseconds a handler may take before the request is answered with 503 and the connection closed
+    size_t handlerTimeout = 30000;
+    // Requests answered on one connection before it is closed, 1 turns keep-alive off
+    size_t maxRequests = 1000;
+    // Largest request body accepted, larger ones are answered with 413
+    size_t maxBodySize = 16 * 1024 * 1024;
+};
+
+using Handler = std::function<void(std::shared_ptr<Request>, std::shared_ptr<Response>)>;
+
+// Serves on an epoll reactor, never returns unless binding fails. Only built on Linux,
+// other platforms use a thread per connection
+void serve(const ServerOptions& options, Handler handler);
+
+} // namespace Probescript::Stdlib::Http
@@ -0,0 +1,269 @@
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "static_file.hpp"
+
+using namespace Probescript;
+using namespace Probescript::Stdlib;
+using namespace Probescript::Stdlib::Http;
+
+namespace
+{
+
+const std::unordered_map<std::string, std::string> g_mimeTypes = {
+    { "html", "text/html; charset=utf-8" },
+    { "htm", "text/html; charset=utf-8" },
+    { "css", "text/css; charset=utf-8" },
+    { "js", "text/javascript; charset=utf-8" },
+    { "mjs", "text/javascript; charset=utf-8" },
+    { "json", "application/json" },
+    { "map", "application/json" },
+    { "txt", "text/plain; charset=utf-8" },
+    { "md", "text/markdown; charset=utf-8" },
+    { "csv", "text/csv; charset=utf-8" },
+    { "xml", "application/xml" },
+    { "svg", "image/svg+xml" },
+    { "png", "image/png" },
+    { "jpg", "image/jpeg" },
+    { "jpeg", "image/jpeg" },
+    { "gif", "image/gif" },
+    { "webp", "image/webp" },
+    { "avif", "image/avif" },
+    { "ico", "image/x-icon" },
+    { "woff", "font/woff" },
+    { "woff2", "font/woff2" },
+    { "ttf", "font/ttf" },
+    { "otf", "font/otf" },
+    { "wasm", "application/wasm" },
+    { "pdf", "application/pdf" },
+    { "zip", "application/zip" },
+    { "gz", "application/gzip" },
+    { "tar", "application/x-tar" },
+    { "mp3", "audio/mpeg" },
+    { "wav", "audio/wav" },
+    { "ogg", "audio/ogg" },
+    { "mp4", "video/mp4" },
+    { "webm", "video/webm" },
+};
+
+enum class RangeKind
+{
+    // No usable Range header, the whole file is sent
+    Whole,
+    Satisfiable,
+    Unsatisfiable,
+};
+
+struct ByteRange
+{
+    RangeKind kind = RangeKind::Whole;
+    uint64_t first = 0;
+    uint64_t last = 0;
+};
+
+// Digits only, stoull would also take signs and spaces
+bool parseOffset(const std::string& text, uint64_t& out)
+{
+    if (text.empty() || text.size() > 19) return false;
+
+    out = 0;
+    for (char c : text)
+    {
+        if (c < '0' || c > '9') return false;
+        out = out * 10 + (c - '0');
+    }
+
+    return true;
+}
+
+// Only single ranges are served, a list of them gets the whole file, which the spec allows
+ByteRange parseRange(const std::string& header, uint64_t size)
+{
+    ByteRange range;
+
+    std::string value = trim(header);
+    if (value.compare(0, 6, "bytes=") != 0 || value.find(',') != std::string::npos) return range;
+
+    std::string spec = trim(value.substr(6));
+    size_t dash = spec.find('-');
+    if (dash == std::string::npos) return range;
+
+    std::string first = trim(spec.substr(0, dash));
+    std::string last = trim(spec.substr(dash + 1));
+
+    // bytes=-N is the last N bytes
+    if (first.empty())
+    {
+        uint64_t suffix;
+        if (!parseOffset(last, suffix)) return range;
+
+        if (suffix == 0 || size == 0)
+        {
+            range.kind = RangeKind::Unsatisfiable;
+            return range;
+        }
+
+        range.kind = RangeKind::Satisfiable;
+        range.first = size - std::min(suffix, size);
+        range.last = size - 1;
+        return range;
+    }
+
+    uint64_t start, end = size ? size - 1 : 0;
+    if (!parseOffset(first, start)) return range;
+    if (!last.empty())
+    {
+        if (!parseOffset(last, end) || end < start) return range;
+        end = std::min(end, size ? size - 1 : 0);
+    }
+
+    if (start >= size)
+    {
+        range.kind = RangeKind::Unsatisfiable;
+        return range;
+    }
+
+    range.kind = RangeKind::Satisfiable;
+    range.first = start;
+    range.last = end;
+    return range;
+}
+
+std::string toHex(uint64_t value)
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string out;
+    do
+    {
+        out.insert(out.begin(), digits[value & 15]);
+        value >>= 4;
+    } while (value);
+
+    return out;
+}
+
+// Nanoseconds, so a rewrite of the same size within one second still changes the tag
+uint64_t modifiedAt(const struct stat& info)
+{
+#if defined(__APPLE__)
+    return static_cast<uint64_t>(info.st_mtimespec.tv_sec) * 1000000000 + info.st_mtimespec.tv_nsec;
+#elif defined(_WIN32)
+    return static_cast<uint64_t>(info.st_mtime) * 1000000000;
+#else
+    return static_cast<uint64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+#endif
+}
+
+// If-None-Match holds a list of tags or *, compared weakly as the spec asks
+bool matchesTag(const std::string& header, const std::string& etag)
+{
+    for (const std::string& part : split(header, ","))
+    {
+        std::string tag = trim(part);
+        if (tag == "*") return true;
+        if (tag.compare(0, 2, "W/") == 0) tag = tag.substr(2);
+        if (tag == etag) return true;
+    }
+
+    return false;
+}
+
+} // namespace
+
+Http::FileBody::~FileBody()
+{
+    if (fd >= 0) ::close(fd);
+}
+
+std::string Http::mimeType(const std::string& path)
+{
+    size_t dot = path.find_last_of('.');
+    size_t slash = path.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) return "application/octet-stream";
+
+    std::string extension = path.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return std::tolower(c); });
+
+    auto found = g_mimeTypes.find(extension);
+    return found == g_mimeTypes.end() ? "application/octet-stream" : found->second;
+}
+
+Http::FileReply Http::prepareFile(const std::string& path, const Request& request, const FileOptions& options)
+{
+    FileReply reply;
+
+    int flags = O_RDONLY;
+#ifdef O_CLOEXEC
+    flags |= O_CLOEXEC;
+#endif
+#ifdef _WIN32
+    flags |= O_BINARY;
+#endif
+
+    auto body = std::make_shared<FileBody>();
+    body->fd = ::open(path.c_str(), flags);
+
+    // Stat the open descriptor, so the size and tag belong to the bytes that will be sent
+    struct stat info;
+    if (body->fd < 0 || fstat(body->fd, &info) != 0 || (info.st_mode & S_IFMT) != S_IFREG)
+    {
+        reply.status = 404;
+        return reply;
+    }
+
+    uint64_t size = static_cast<uint64_t>(info.st_size);
+    std::string etag = "\"" + toHex(size) + "-" + toHex(modifiedAt(info)) + "\"";
+
+    reply.headers["Content-Type"] = options.contentType.empty() ? mimeType(path) : options.contentType;
+    reply.headers["ETag"] = etag;
+    reply.headers["Accept-Ranges"] = "bytes";
+    if (options.maxAge >= 0) reply.headers["Cache-Control"] = "public, max-age=" + std::to_string(options.maxAge);
+
+    // Content-Length of a 304 is what the 200 would have carried
+    reply.contentLength = size;
+
+    if (const std::string* tags = findHeader(request.headers, "If-None-Match"))
+    {
+        if (matchesTag(*tags, etag))
+        {
+            reply.status = 304;
+            return reply;
+        }
+    }
+
+    ByteRange range;
+    const std::string* requested = findHeader(request.headers, "Range");
+    const std::string* ifRange = findHeader(request.headers, "If-Range");
+
+    // A range only applies to the version the client already has part of
+    if (requested && request.method == "GET" && (!ifRange || trim(*ifRange) == etag)) range = parseRange(*requested, size);
+
+    if (range.kind == RangeKind::Unsatisfiable)
+    {
+        reply.status = 416;
+        reply.contentLength = 0;
+        reply.headers["Content-Range"] = "bytes */" + std::to_string(size);
+        return reply;
+    }
+
+    body->offset = 0;
+    body->length = size;
+
+    if (range.kind == RangeKind::Satisfiable)
+    {
+        reply.status = 206;
+        body->offset = range.first;
+        body->length = range.last - range.first + 1;
+        reply.contentLength = body->length;
+        reply.headers["Content-Range"] = "bytes " + std::to_string(range.first) + "-" + std::to_string(range.last) + "/" + std::to_string(size);
+    }
+
+    if (request.method != "HEAD" && body->length > 0) reply.body = body;
+    return reply;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string>
+
+#include "http.hpp"
+
+namespace Probescript::Stdlib::Http
+{
+
+// Settings of res.send_file, read from its optional second argument
+struct FileOptions
+{
+    // Overrides the type guessed from the extension
+    std::string contentType;
+    // Seconds clients may cache the file without asking again, -1 for no Cache-Control header
+    long long maxAge = -1;
+};
+
+// Content-Type for a file name, application/octet-stream when the extension is unknown
+std::string mimeType(const std::string& path);
+
+// Opens `path` and decides how to answer `request` with it: the whole file, one byte range (206), 304 when
+// If-None-Match has the file's ETag, 404 when it cannot be read and 416 for a range past its end.
+// Nothing is read here, the server streams `body` straight from the file
+FileReply prepareFile(const std::string& path, const Request& request, const FileOptions& options);
+
+} // namespace Probescript::Stdlib::Http
@@ -7,23 +7,23 @@ Values::Val getValRandomModule() {
     static std::random_device rd;
     static std::mt19937 gen(rd());
 
-    return std::make_shared<Values::ObjectVal>(std::unordered_map<std::string, Values::Val>({
+    return Values::make<Values::ObjectVal>(std::unordered_map<std::string, Values::Val>({
         {
             "randint",
-            std::make_shared<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val {
+            Values::make<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val {
                 if (args.size() < 2) {
                     throw ThrowException(ArgumentError("randInt expects two arguments"));
                 }
 
-                std::uniform_int_distribution<> distrib(args[0]->toNum(), args[1]->toNum());
-                return std::make_shared<Values::NumberVal>(distrib(gen));
+                std::uniform_int_distribution<> distrib(args[0].toNum(), args[1].toNum());
+                return Values::makeNumber(distrib(gen));
             })
         },
         {
             "rand",
-            std::make_shared<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val {
+            Values::make<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val {
                 std::uniform_real_distribution<double> distrib(0.0, 1.0);
-                return std::make_shared<Values::NumberVal>(distrib(gen));
+                return Values::makeNumber(distrib(gen));
             })
         }
     }));
@@ -71,10 +71,10 @@ std::unordered_map<std::string, std::pair<Values::Val, Typechecker::TypePtr>> g_
     {
         "date",
         {
-            std::make_shared<Values::ObjectVal>(std::unordered_map<std::string, Values::Val>({
+            Values::make<Values::ObjectVal>(std::unordered_map<std::string, Values::Val>({
                 {
                     "stamp",
-                    std::make_shared<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
+                    Values::make<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
                     {
                         using namespace std::chrono;
 
@@ -82,9 +82,9 @@ std::unordered_map<std::string, std::pair<Values::Val, Typechecker::TypePtr>> g_
                         auto duration = now.time_since_epoch();
 
                         std::string unit = "sec";
-                        if (!args.empty() && args[0]->type == Values::ValueType::String)
+                        if (!args.empty() && args[0].type() == Values::ValueType::String)
                         {
-                            unit = std::static_pointer_cast<Values::StringVal>(args[0])->string;
+                            unit = Values::cast<Values::StringVal>(args[0])->string;
                             std::transform(unit.begin(), unit.end(), unit.begin(), ::tolower);
                         }
 
@@ -108,43 +108,43 @@ std::unordered_map<std::string, std::pair<Values::Val, Typechecker::TypePtr>> g_
                         }
                         else
                         {
-                            return std::make_shared<Values::StringVal>("Invalid time unit: " + unit);
+                            return Values::make<Values::StringVal>("Invalid time unit: " + unit);
                         }
-                        return std::make_shared<Values::NumberVal>(std::to_string(result));
+                        return Values::makeNumber(result);
                     })
                 },
                 {
                     "now",
-                    std::make_shared<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
+                    Values::make<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
                     {
                         using namespace std::chrono;
                         auto now = system_clock::now();
                         auto t = system_clock::to_time_t(now);
                         std::ostringstream oss;
                         oss << std::put_time(std::localtime(&t), "%Y-%m-%dT%H:%M:%S");
-                        return std::make_shared<Values::StringVal>(oss.str());
+                        return Values::make<Values::StringVal>(oss.str());
                     })
                 },
                 {
                     "is_leapyear",
-                    std::make_shared<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val {
-                        if (args.empty() || args[0]->type != Values::ValueType::Number)
+                    Values::make<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val {
+                        if (args.empty() || args[0].type() != Values::ValueType::Number)
                             throw ThrowException(ArgumentError("Usage: date.is_leapyear(year: num)"));
 
-                        int year = static_cast<int>(std::static_pointer_cast<Values::NumberVal>(args[0])->number);
+                        int year = static_cast<int>(args[0].asNumber());
 
                         bool leap = (year % 4 == 0 && (year % 100 != 0 || year % 400 == 0));
-                        return std::make_shared<Values::BooleanVal>(leap);
+                        return Values::makeBool(leap);
                     })
                 },
                 {
                     "days_in_month",
-                    std::make_shared<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val {
-                        if (args.size() < 2 || args[0]->type != Values::ValueType::Number || args[1]->type != Values::ValueType::Number)
+                    Values::make<Values::NativeFnValue>([](std::vector<Values::Val> args, EnvPtr env) -> Values::Val {
+                        if (args.size() < 2 || args[0].type() != Values::ValueType::Number || args[1].type() != Values::ValueType::Number)
                             throw ThrowException(ArgumentError("Usage: date.days_in_month(year: num, month: num)"));
 
-                        int year = static_cast<int>(std::static_pointer_cast<Values::NumberVal>(args[0])->number);
-                        int month = static_cast<int>(std::static_pointer_cast<Values::NumberVal>(args[1])->number);
+                        int year = static_cast<int>(args[0].asNumber());
+                        int month = static_cast<int>(args[1].asNumber());
 
                         if (month < 1 || month > 12)
                             throw ThrowException(CustomError("Invalid month: " + std::to_string(month), "DateError"));
@@ -155,7 +155,7 @@ std::unordered_map<std::string, std::pair<Values::Val, Typechecker::TypePtr>> g_
                         if (month == 2 && (year % 4 == 0 && (year % 100 != 0 || year % 400 == 0)))
                             result = 29;
 
-                        return std::make_shared<Values::NumberVal>(std::to_string(result));
+                        return Values::makeNumber(result);
                     })
                 }
             })),
@@ -179,6 +179,13 @@ std::unordered_map<std::string, std::pair<Values::Val, Typechecker::TypePtr>> g_
             })))
         }
     },
+    {
+        "sync",
+        {
+            Sync::getValSyncModule(),
+            Sync::getTypeSyncModule()
+        }
+    },
     {
         "prbtest",
         {
@@ -15,4 +15,5 @@
 #include "http.hpp"
 #include "json.hpp"
 #include "fs.hpp"
-#include "prbtest.hpp"
\ No newline at end of file
+#include "prbtest.hpp"
+#include "sync.hpp"
\ No newline at end of file
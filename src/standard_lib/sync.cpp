@@ -0,0 +1,385 @@
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+#include "sync.hpp"
+
+using namespace Probescript;
+using namespace Probescript::Stdlib;
+
+namespace
+{
+
+// The most items a channel can buffer
+constexpr double MaxChannelCapacity = 4294967295.0;
+
+// One thing a primitive's callers wait for. Threads wait on the condition variable, event loop tasks park in
+// the list. Both are touched under the primitive's mutex only
+struct Condition
+{
+    std::condition_variable cv;
+    std::deque<Loop::Task*> tasks;
+
+    void notifyOne()
+    {
+        if (!tasks.empty())
+        {
+            Loop::wake(tasks.front());
+            tasks.pop_front();
+        }
+
+        cv.notify_one();
+    }
+
+    void notifyAll()
+    {
+        for (Loop::Task* task : tasks) Loop::wake(task);
+        tasks.clear();
+        cv.notify_all();
+    }
+};
+
+// Waits on `condition` until `ready()`. Nothing else runs on the caller's stack meanwhile, a task run there could
+// wait for a lock the caller holds. On a pool worker a spare thread takes over the queued tasks instead
+template <typename Pred>
+void block(std::unique_lock<std::mutex>& lock, Condition& condition, Pred ready)
+{
+    if (ready()) return;
+
+    // A task on the event loop parks instead, the task it waits for runs on the same thread
+    if (Loop::Task* task = Loop::current())
+    {
+        while (!ready())
+        {
+            condition.tasks.push_back(task);
+            lock.unlock();
+            Loop::park();
+            lock.lock();
+        }
+
+        return;
+    }
+
+    Executor::blocking([&]() { condition.cv.wait(lock, ready); });
+}
+
+Values::Ref<Values::NativeFnValue> method(Values::NativeFunction fn)
+{
+    return Values::make<Values::NativeFnValue>(std::move(fn));
+}
+
+// Not owned by a thread: a task may lock on one worker and unlock on another
+struct MutexState
+{
+    std::mutex mutex;
+    Condition released;
+    bool locked = false;
+
+    void lock()
+    {
+        std::unique_lock<std::mutex> guard(mutex);
+        block(guard, released, [this]() { return !locked; });
+        locked = true;
+    }
+
+    void unlock()
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        if (!locked) throw ThrowException(CustomError("Mutex is not locked", "SyncError"));
+
+        locked = false;
+        released.notifyOne();
+    }
+};
+
+struct ChannelState
+{
+    std::mutex mutex;
+    Condition notFull;
+    Condition notEmpty;
+    std::deque<Values::Val> items;
+    size_t capacity;
+    bool closed = false;
+
+    explicit ChannelState(size_t capacity) : capacity(capacity) {}
+};
+
+struct WaitGroupState
+{
+    std::mutex mutex;
+    Condition zero;
+    long count = 0;
+};
+
+// Doubles have no atomic read-modify-write in C++17, so updates go through a compare exchange loop
+struct AtomicState
+{
+    std::atomic<double> value;
+
+    explicit AtomicState(double value) : value(value) {}
+
+    double add(double delta)
+    {
+        double current = value.load();
+        while (!value.compare_exchange_weak(current, current + delta)) {}
+        return current + delta;
+    }
+};
+
+Values::Val makeMutex(std::vector<Values::Val> args, EnvPtr env)
+{
+    auto state = std::make_shared<MutexState>();
+    Values::Ref<Values::ObjectVal> obj = Values::make<Values::ObjectVal>();
+
+    obj->properties["lock"] = method([state](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
+    {
+        state->lock();
+        return Values::makeUndefined();
+    });
+
+    obj->properties["unlock"] = method([state](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
+    {
+        state->unlock();
+        return Values::makeUndefined();
+    });
+
+    obj->properties["try_lock"] = method([state](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
+    {
+        std::lock_guard<std::mutex> guard(state->mutex);
+        if (state->locked) return Values::makeBool(false);
+
+        state->locked = true;
+        return Values::makeBool(true);
+    });
+
+    obj->properties["with_lock"] = method([state](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
+    {
+        if (args.empty()) throw ThrowException(ArgumentError("Usage: mutex.with_lock(fn: function)"));
+
+        state->lock();
+
+        Values::Val result;
+        try
+        {
+            result = Interpreter::evalCallWithFnVal(args[0], {}, env);
+        }
+        catch (...)
+        {
+            state->unlock();
+            throw;
+        }
+
+        state->unlock();
+        return result;
+    });
+
+    return obj;
+}
+
+Values::Val makeChannel(std::vector<Values::Val> args, EnvPtr env)
+{
+    double capacity = args.empty() ? 1 : args[0].toNum();
+    // Written so NaN fails as well
+    if (!(capacity >= 1 && capacity <= MaxChannelCapacity) || capacity != std::floor(capacity))
+        throw ThrowException(ArgumentError("Usage: new sync.Channel(capacity: num), capacity must be a whole number from 1 to 4294967295"));
+
+    auto state = std::make_shared<ChannelState>(static_cast<size_t>(capacity));
+    Values::Ref<Values::ObjectVal> obj = Values::make<Values::ObjectVal>();
+
+    // Blocks while the channel is full
+    obj->properties["send"] = method([state](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
+    {
+        if (args.empty()) throw ThrowException(ArgumentError("Usage: channel.send(value: any)"));
+
+        std::unique_lock<std::mutex> lock(state->mutex);
+        block(lock, state->notFull, [&]() { return state->closed || state->items.size() < state->capacity; });
+
+        if (state->closed) throw ThrowException(CustomError("Cannot send on a closed channel", "SyncError"));
+        state->items.push_back(args[0]);
+        state->notEmpty.notifyOne();
+        return Values::makeUndefined();
+    });
+
+    // Blocks while the channel is empty. A closed and drained channel gives undefined
+    obj->properties["recv"] = method([state](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
+    {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        block(lock, state->notEmpty, [&]() { return state->closed || !state->items.empty(); });
+
+        if (state->items.empty()) return Values::makeUndefined();
+
+        Values::Val item = state->items.front();
+        state->items.pop_front();
+        state->notFull.notifyOne();
+        return item;
+    });
+
+    obj->properties["close"] = method([state](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->closed = true;
+        state->notFull.notifyAll();
+        state->notEmpty.notifyAll();
+        return Values::makeUndefined();
+    });
+
+    obj->properties["size"] = method([state](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        return Values::makeNumber(state->items.size());
+    });
+
+    return obj;
+}
+
+Values::Val makeWaitGroup(std::vector<Values::Val> args, EnvPtr env)
+{
+    auto state = std::make_shared<WaitGroupState>();
+    Values::Ref<Values::ObjectVal> obj = Values::make<Values::ObjectVal>();
+
+    auto add = [state](long delta)
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (state->count + delta < 0) throw ThrowException(CustomError("WaitGroup counter cannot go below zero", "SyncError"));
+
+        state->count += delta;
+        if (state->count == 0) state->zero.notifyAll();
+    };
+
+    obj->properties["add"] = method([add](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
+    {
+        add(args.empty() ? 1 : static_cast<long>(args[0].toNum()));
+        return Values::makeUndefined();
+    });
+
+    obj->properties["done"] = method([add](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
+    {
+        add(-1);
+        return Values::makeUndefined();
+    });
+
+    obj->properties["wait"] = method([state](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
+    {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        block(lock, state->zero, [&]() { return state->count == 0; });
+        return Values::makeUndefined();
+    });
+
+    return obj;
+}
+
+Values::Val makeAtomicNumber(std::vector<Values::Val> args, EnvPtr env)
+{
+    auto state = std::make_shared<AtomicState>(args.empty() ? 0 : args[0].toNum());
+    Values::Ref<Values::ObjectVal> obj = Values::make<Values::ObjectVal>();
+
+    obj->properties["get"] = method([state](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
+    {
+        return Values::makeNumber(state->value.load());
+    });
+
+    obj->properties["set"] = method([state](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
+    {
+        if (args.empty()) throw ThrowException(ArgumentError("Usage: atomic.set(value: num)"));
+
+        state->value.store(args[0].toNum());
+        return Values::makeUndefined();
+    });
+
+    // Returns the new value
+    obj->properties["add"] = method([state](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
+    {
+        return Values::makeNumber(state->add(args.empty() ? 1 : args[0].toNum()));
+    });
+
+    // Sets the value to `desired` if it is `expected`, returns whether it did
+    obj->properties["compare_exchange"] = method([state](std::vector<Values::Val> args, EnvPtr env) -> Values::Val
+    {
+        if (args.size() < 2) throw ThrowException(ArgumentError("Usage: atomic.compare_exchange(expected: num, desired: num)"));
+
+        double expected = args[0].toNum();
+        return Values::makeBool(state->value.compare_exchange_strong(expected, args[1].toNum()));
+    });
+
+    return obj;
+}
+
+Typechecker::TypePtr function(std::vector<std::shared_ptr<Typechecker::Parameter>> params, Typechecker::TypePtr returntype = nullptr)
+{
+    return std::make_shared<Typechecker::Type>(Typechecker::TypeKind::Function, "function", std::make_shared<Typechecker::TypeVal>(params, returntype));
+}
+
+std::shared_ptr<Typechecker::Parameter> param(const std::string& name, Typechecker::TypePtr type, bool optional = false)
+{
+    return std::make_shared<Typechecker::Parameter>(name, type, Lexer::Token(), optional);
+}
+
+Typechecker::TypePtr nativeClass(const std::string& name, std::unordered_map<std::string, Typechecker::TypePtr> members)
+{
+    return std::make_shared<Typechecker::Type>(Typechecker::TypeKind::Class, "native class", std::make_shared<Typechecker::TypeVal>(members), name);
+}
+
+} // namespace
+
+Values::Val Sync::getValSyncModule()
+{
+    return Values::make<Values::ObjectVal>(std::unordered_map<std::string, Values::Val>(
+    {
+        { "Mutex", Values::make<Values::NativeClassVal>(makeMutex) },
+        { "Channel", Values::make<Values::NativeClassVal>(makeChannel) },
+        { "WaitGroup", Values::make<Values::NativeClassVal>(makeWaitGroup) },
+        { "AtomicNumber", Values::make<Values::NativeClassVal>(makeAtomicNumber) }
+    }));
+}
+
+Typechecker::TypePtr Sync::getTypeSyncModule()
+{
+    using namespace Typechecker;
+
+    // Built here rather than taken from g_numty and friends, which may not be initialized yet while g_stdlib is
+    TypePtr number = std::make_shared<Type>(TypeKind::Number, "number");
+    TypePtr boolean = std::make_shared<Type>(TypeKind::Bool, "bool");
+    TypePtr any = std::make_shared<Type>(TypeKind::Any, "any");
+
+    return std::make_shared<Type>(TypeKind::Module, "native module", std::make_shared<TypeVal>(std::unordered_map<std::string, TypePtr>(
+    {
+        {
+            "Mutex",
+            nativeClass("Mutex", {
+                { "lock", function({}) },
+                { "unlock", function({}) },
+                { "try_lock", function({}, boolean) },
+                { "with_lock", function({ param("fn", std::make_shared<Type>(TypeKind::Function, "function")) }) }
+            })
+        },
+        {
+            "Channel",
+            nativeClass("Channel", {
+                { "new", function({ param("capacity", number, true) }) },
+                { "send", function({ param("value", any) }) },
+                { "recv", function({}, any) },
+                { "close", function({}) },
+                { "size", function({}, number) }
+            })
+        },
+        {
+            "WaitGroup",
+            nativeClass("WaitGroup", {
+                { "add", function({ param("count", number, true) }) },
+                { "done", function({}) },
+                { "wait", function({}) }
+            })
+        },
+        {
+            "AtomicNumber",
+            nativeClass("AtomicNumber", {
+                { "new", function({ param("initial", number, true) }) },
+                { "get", function({}, number) },
+                { "set", function({ param("value", number) }) },
+                { "add", function({ param("delta", number, true) }, number) },
+                { "compare_exchange", function({ param("expected", number), param("desired", number) }, boolean) }
+            })
+        }
+    })));
+}
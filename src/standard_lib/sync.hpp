@@ -0,0 +1,20 @@
+#pragma once
+
+#include <unordered_map>
+#include <string>
+
+#include "core/runtime/values.hpp"
+#include "core/runtime/interpreter.hpp"
+#include "core/executor.hpp"
+#include "core/loop.hpp"
+#include "core/types.hpp"
+#include "core/env.hpp"
+#include "core/errors.hpp"
+
+namespace Probescript::Stdlib::Sync
+{
+
+Values::Val getValSyncModule();
+Typechecker::TypePtr getTypeSyncModule();
+
+} // namespace Probescript::Stdlib::Sync
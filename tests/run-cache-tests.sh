@@ -0,0 +1,131 @@
+#!/bin/bash
+
+# Runs scripts against .probescript-cache artifacts that went stale or corrupt, every run has to behave
+# exactly like one with --no-cache
+
+cd "$(dirname "${BASH_SOURCE[0]}")"
+
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+NC='\033[0m'
+
+probescript="$(pwd)/../probescript"
+project="$(mktemp -d)"
+trap 'rm -rf "$project"' EXIT
+
+passed_tests=0
+failed_tests=0
+
+check() {
+    local name="$1"
+    local expected="$2"
+    local actual="$3"
+
+    printf "Testing %-50s " "$name"
+    if [ "$expected" == "$actual" ]; then
+        echo -e "${GREEN}✓ PASS${NC}"
+        ((passed_tests++))
+    else
+        echo -e "${RED}✗ FAIL${NC}"
+        echo "   Expected:"
+        echo "$expected" | sed 's/^/   │ /'
+        echo "   Got:"
+        echo "$actual" | sed 's/^/   │ /'
+        ((failed_tests++))
+    fi
+}
+
+run() {
+    "$probescript" run "$project/main.prb" "$@" 2>&1
+    echo "exit $?"
+}
+
+mkdir -p "$project/modules" "$project/deps"
+
+cat > "$project/project.json" <<'EOF'
+{
+    "name": "cache tests",
+    "ignore": ["deps"]
+}
+EOF
+
+cat > "$project/modules/counter.probe" <<'EOF'
+module counter;
+
+export fn bump(): num
+{
+    return 1;
+}
+EOF
+
+# Takes the name of modules/counter.probe once deps/ is no longer ignored
+cat > "$project/deps/counter.probe" <<'EOF'
+module counter;
+
+export fn current(): num
+{
+    return -1;
+}
+EOF
+
+cat > "$project/main.prb" <<'EOF'
+import counter;
+
+probe Main
+{
+    Main()
+    {
+        console.println("bumped " + counter.bump());
+    }
+}
+EOF
+
+echo "Running cache tests..."
+echo "==================="
+
+expected="$(run --no-cache)"
+check "cold run" "$expected" "$(run)"
+check "warm run" "$expected" "$(run)"
+
+# The artifact of main.prb, the one that lists the module it was checked against
+artifact="$(grep -la "modules/counter.probe" "$project"/.probescript-cache/*.prbc | head -n 1)"
+cp "$artifact" "$project/artifact"
+size=$(wc -c < "$project/artifact")
+
+flipped=""
+for ((offset = 0; offset < size; offset++)); do
+    cp "$project/artifact" "$artifact"
+    printf "\\x$(printf %x $(( ($(od -An -tu1 -j $offset -N1 "$project/artifact") ^ 0xff) )))" | dd of="$artifact" bs=1 seek=$offset conv=notrunc status=none
+
+    output="$(run)"
+    [ "$output" == "$expected" ] || flipped+="byte $offset: $output"$'\n'
+done
+check "artifact with any one byte flipped ($size bytes)" "" "$flipped"
+
+truncated=""
+for ((length = 0; length < size; length += 7)); do
+    head -c $length "$project/artifact" > "$artifact"
+
+    output="$(run)"
+    [ "$output" == "$expected" ] || truncated+="$length bytes: $output"$'\n'
+done
+check "artifact cut short" "" "$truncated"
+
+# Which file an import name maps to is part of what the check depended on
+sed -i 's/"ignore": \["deps"\]/"ignore": []/' "$project/project.json"
+check "import resolving to another module" "$(run --no-cache)" "$(run)"
+
+sed -i 's/"ignore": \[\]/"ignore": ["deps"]/' "$project/project.json"
+check "import resolving back" "$expected" "$(run)"
+
+echo
+echo "==================="
+echo -e "Passed: ${GREEN}$passed_tests${NC}"
+echo -e "Failed: ${RED}$failed_tests${NC}"
+
+if [ $failed_tests -gt 0 ]; then
+    exit 1
+fi
+
+echo
+echo -e "${GREEN}All cache tests passed!${NC}"